@@ -0,0 +1,418 @@
+/* ============================================================================
+* R interface (.Call) over the embedding API (src/include/gday_api.h)
+*
+* A model is an external pointer. Forcing columns (numeric data.frame
+* columns, or the columns of a numeric matrix) are used in place: the R
+* objects are kept alive on the pointer's protected list rather than
+* copied, one entry per met column, so setting a column again lets go of
+* the old one. Integer columns (year, doy) are coerced to double once.
+*
+* rgday_run_members runs a matrix of parameter sets, one clone per thread
+* (pthreads), and fills a long-format matrix of member, day, variable,
+* value. No R API is touched from the worker threads.
+*
+* =========================================================================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <R.h>
+#include <Rinternals.h>
+#include <R_ext/Rdynload.h>
+#include "gday_api.h"
+
+typedef struct {
+    gday_model  *g;             /* this thread's clone */
+    const char **keys;
+    const char **values;        /* nmembers x nkeys, row (member) major */
+    int          nkeys;
+    int          first;         /* members first, first+stride, ... */
+    int          stride;
+    int          nmembers;
+    long         ndays;
+    int          nout;
+    double      *buf;           /* ndays x nout */
+    double      *out;           /* the long matrix */
+    int          failed;        /* first member that failed, or -1 */
+    char         msg[256];
+} worker;
+
+static gday_model *model_ptr(SEXP);
+static void        model_finalise(SEXP);
+static void        keep(SEXP, const char *, SEXP);
+static void       *run_worker(void *);
+
+
+SEXP rgday_open(SEXP cfg_fname) {
+    gday_model *g = NULL;
+    SEXP        ptr;
+
+    if ((g = gday_open(CHAR(STRING_ELT(cfg_fname, 0)))) == NULL)
+        error("Can't open parameter file %s", CHAR(STRING_ELT(cfg_fname, 0)));
+    ptr = PROTECT(R_MakeExternalPtr(g, install("gday_model"), R_NilValue));
+    R_RegisterCFinalizerEx(ptr, model_finalise, TRUE);
+    UNPROTECT(1);
+
+    return (ptr);
+}
+
+SEXP rgday_set(SEXP ptr, SEXP key, SEXP value) {
+    gday_model *g = model_ptr(ptr);
+
+    if (gday_set(g, CHAR(STRING_ELT(key, 0)), CHAR(STRING_ELT(value, 0))) != 0)
+        error("%s", gday_error(g));
+
+    return (R_NilValue);
+}
+
+SEXP rgday_get(SEXP ptr, SEXP key) {
+    gday_model *g = model_ptr(ptr);
+    char        buf[256];
+
+    if (gday_get(g, CHAR(STRING_ELT(key, 0)), buf, sizeof(buf)) != 0)
+        error("%s", gday_error(g));
+
+    return (mkString(buf));
+}
+
+SEXP rgday_set_forcing(SEXP ptr, SEXP x, SEXP names) {
+    /*
+        x is a list of columns (a data.frame) or a numeric matrix, names the
+        met column each is; NA names are skipped
+    */
+    gday_model *g = model_ptr(ptr);
+    SEXP        col;
+    const char *name;
+    long        n;
+    int         j, ncol = LENGTH(names);
+
+    if (isMatrix(x)) {
+        if (TYPEOF(x) != REALSXP)
+            error("The forcing matrix must be numeric");
+        n = nrows(x);
+        if (ncols(x) != ncol)
+            error("%d names for %d forcing columns", ncol, ncols(x));
+        for (j = 0; j < ncol; j++) {
+            if (STRING_ELT(names, j) == NA_STRING)
+                continue;
+            name = CHAR(STRING_ELT(names, j));
+            if (gday_set_forcing(g, name, REAL(x) + (R_xlen_t)j * n, n) != 0)
+                error("%s", gday_error(g));
+            keep(ptr, name, x);
+        }
+        return (R_NilValue);
+    }
+
+    if (TYPEOF(x) != VECSXP || LENGTH(x) != ncol)
+        error("The forcing must be a data.frame or a numeric matrix");
+    for (j = 0; j < ncol; j++) {
+        if (STRING_ELT(names, j) == NA_STRING)
+            continue;
+        name = CHAR(STRING_ELT(names, j));
+        col = VECTOR_ELT(x, j);
+        if (TYPEOF(col) == INTSXP || TYPEOF(col) == LGLSXP)
+            col = coerceVector(col, REALSXP);
+        else if (TYPEOF(col) != REALSXP)
+            error("Forcing column %s isn't numeric", name);
+        PROTECT(col);
+        if (gday_set_forcing(g, name, REAL(col), XLENGTH(col)) != 0)
+            error("%s", gday_error(g));
+        keep(ptr, name, col);
+        UNPROTECT(1);
+    }
+
+    return (R_NilValue);
+}
+
+SEXP rgday_load_met(SEXP ptr) {
+    gday_model *g = model_ptr(ptr);
+
+    if (gday_load_met(g) != 0)
+        error("%s", gday_error(g));
+    R_SetExternalPtrProtected(ptr, R_NilValue);   /* no longer used */
+
+    return (R_NilValue);
+}
+
+SEXP rgday_outputs(SEXP ptr, SEXP names) {
+    /* select the daily outputs (unless names is NULL), return the selection */
+    gday_model  *g = model_ptr(ptr);
+    const char **sel = NULL;
+    SEXP         res;
+    int          i, n;
+
+    if (!isNull(names)) {
+        n = LENGTH(names);
+        sel = (const char **)R_alloc(n + 1, sizeof(char *));
+        for (i = 0; i < n; i++)
+            sel[i] = CHAR(STRING_ELT(names, i));
+        if (gday_select_outputs(g, sel, n) != 0)
+            error("%s", gday_error(g));
+    }
+    n = gday_noutputs(g);
+    res = PROTECT(allocVector(STRSXP, n));
+    for (i = 0; i < n; i++)
+        SET_STRING_ELT(res, i, mkChar(gday_output_name(g, i)));
+    UNPROTECT(1);
+
+    return (res);
+}
+
+SEXP rgday_daily_output_names(void) {
+    SEXP res;
+    int  i, n = gday_num_daily_outputs();
+
+    res = PROTECT(allocVector(STRSXP, n));
+    for (i = 0; i < n; i++)
+        SET_STRING_ELT(res, i, mkChar(gday_daily_output_name(i)));
+    UNPROTECT(1);
+
+    return (res);
+}
+
+SEXP rgday_ndays(SEXP ptr) {
+    return (ScalarReal((double)gday_ndays(model_ptr(ptr))));
+}
+
+SEXP rgday_run(SEXP ptr) {
+    /* one run, a days x outputs matrix */
+    gday_model *g = model_ptr(ptr);
+    SEXP        res;
+    double     *buf = NULL;
+    long        ndays = gday_ndays(g), d, nd;
+    int         k, nout = gday_noutputs(g);
+
+    buf = (double *)R_alloc((size_t)(ndays > 0 ? ndays : 1) * nout,
+                            sizeof(double));
+    if ((nd = gday_run(g, buf, ndays)) < 0)
+        error("%s", gday_error(g));
+
+    res = PROTECT(allocMatrix(REALSXP, (int)nd, nout));
+    for (d = 0; d < nd; d++) {
+        for (k = 0; k < nout; k++)
+            REAL(res)[(R_xlen_t)k * nd + d] = buf[d * nout + k];
+    }
+    UNPROTECT(1);
+
+    return (res);
+}
+
+SEXP rgday_run_members(SEXP ptr, SEXP params, SEXP nthreads) {
+    /*
+        params is a character matrix, one row per member, one column per
+        section.key (colnames). Returns the long matrix, member x day x
+        variable rows of (member, day, variable, value), variable indexing
+        the selected outputs; all 1-based.
+    */
+    gday_model  *g = model_ptr(ptr), *trial = NULL;
+    worker      *w = NULL;
+    pthread_t   *tid = NULL;
+    SEXP         res, colnames;
+    const char **keys = NULL, **values = NULL;
+    long         ndays = gday_ndays(g);
+    R_xlen_t     nrow;
+    int          nmembers, nkeys, nthr, nout = gday_noutputs(g);
+    int          i, j, t, failed = -1, started;
+
+    if (!isMatrix(params) || TYPEOF(params) != STRSXP)
+        error("params must be a character matrix");
+    colnames = getAttrib(params, R_DimNamesSymbol);
+    if (isNull(colnames) || isNull(VECTOR_ELT(colnames, 1)))
+        error("params needs section.key column names");
+    colnames = VECTOR_ELT(colnames, 1);
+    nmembers = nrows(params);
+    nkeys = ncols(params);
+    if (nmembers < 1)
+        error("params has no members");
+    nthr = asInteger(nthreads);
+    if (nthr < 1 || nthr == NA_INTEGER)
+        nthr = 1;
+    if (nthr > nmembers)
+        nthr = nmembers;
+    if (ndays <= 0)
+        error("No forcing, call gday_forcing or gday_load_met");
+
+    keys = (const char **)R_alloc(nkeys, sizeof(char *));
+    values = (const char **)R_alloc((size_t)nmembers * nkeys, sizeof(char *));
+    for (j = 0; j < nkeys; j++)
+        keys[j] = CHAR(STRING_ELT(colnames, j));
+    for (i = 0; i < nmembers; i++) {
+        for (j = 0; j < nkeys; j++) {
+            if (STRING_ELT(params, (R_xlen_t)j * nmembers + i) == NA_STRING)
+                error("params has an NA for member %d, %s", i + 1, keys[j]);
+            values[(size_t)i * nkeys + j] =
+                CHAR(STRING_ELT(params, (R_xlen_t)j * nmembers + i));
+        }
+    }
+
+    /* bad keys (or options) show up here rather than in the threads */
+    if ((trial = gday_clone(g)) == NULL)
+        error("Out of memory");
+    for (j = 0; j < nkeys; j++) {
+        if (gday_set(trial, keys[j], values[j]) != 0) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "%s", gday_error(trial));
+            gday_close(trial);
+            error("%s", msg);
+        }
+    }
+    gday_close(trial);
+
+    nrow = (R_xlen_t)nmembers * ndays * nout;
+    res = PROTECT(allocMatrix(REALSXP, nrow, 4));
+
+    w = (worker *)R_alloc(nthr, sizeof(worker));
+    tid = (pthread_t *)R_alloc(nthr, sizeof(pthread_t));
+    for (t = 0; t < nthr; t++) {
+        memset(&w[t], 0, sizeof(worker));
+        w[t].g = gday_clone(g);
+        w[t].buf = malloc((size_t)ndays * (nout > 0 ? nout : 1) *
+                          sizeof(double));
+        w[t].keys = keys;
+        w[t].values = values;
+        w[t].nkeys = nkeys;
+        w[t].first = t;
+        w[t].stride = nthr;
+        w[t].nmembers = nmembers;
+        w[t].ndays = ndays;
+        w[t].nout = nout;
+        w[t].out = REAL(res);
+        w[t].failed = -1;
+        if (w[t].g == NULL || w[t].buf == NULL) {
+            for (i = 0; i <= t; i++) {
+                gday_close(w[i].g);
+                free(w[i].buf);
+            }
+            error("Out of memory");
+        }
+    }
+
+    /* the calling thread takes the first share */
+    for (started = 1; started < nthr; started++) {
+        if (pthread_create(&tid[started], NULL, run_worker, &w[started]) != 0)
+            break;
+    }
+    run_worker(&w[0]);
+    for (t = 1; t < started; t++)
+        pthread_join(tid[t], NULL);
+    /* shares that didn't get a thread */
+    for (t = started; t < nthr; t++)
+        run_worker(&w[t]);
+
+    for (t = 0; t < nthr; t++) {
+        if (w[t].failed >= 0 && (failed < 0 || w[t].failed < failed)) {
+            failed = w[t].failed;
+            snprintf(w[0].msg, sizeof(w[0].msg), "%s", w[t].msg);
+        }
+        gday_close(w[t].g);
+        free(w[t].buf);
+    }
+    if (failed >= 0)
+        error("Member %d: %s", failed + 1, w[0].msg);
+    UNPROTECT(1);
+
+    return (res);
+}
+
+static void *run_worker(void *arg) {
+    /* this thread's members, each run straight into its rows */
+    worker   *w = (worker *)arg;
+    R_xlen_t  nrow = (R_xlen_t)w->nmembers * w->ndays * w->nout, r;
+    double   *member = w->out, *day = w->out + nrow;
+    double   *var = w->out + 2 * nrow, *value = w->out + 3 * nrow;
+    long      d;
+    int       i, j, k;
+
+    for (i = w->first; i < w->nmembers; i += w->stride) {
+        for (j = 0; j < w->nkeys; j++) {
+            if (gday_set(w->g, w->keys[j],
+                         w->values[(size_t)i * w->nkeys + j]) != 0)
+                break;
+        }
+        if (j < w->nkeys || gday_run(w->g, w->buf, w->ndays) < 0) {
+            if (w->failed < 0) {
+                w->failed = i;
+                snprintf(w->msg, sizeof(w->msg), "%s",
+                         gday_error(w->g));
+            }
+            continue;
+        }
+
+        r = (R_xlen_t)i * w->ndays * w->nout;
+        for (d = 0; d < w->ndays; d++) {
+            for (k = 0; k < w->nout; k++, r++) {
+                member[r] = i + 1;
+                day[r] = d + 1;
+                var[r] = k + 1;
+                value[r] = w->buf[d * w->nout + k];
+            }
+        }
+    }
+
+    return (NULL);
+}
+
+static gday_model *model_ptr(SEXP ptr) {
+    gday_model *g = NULL;
+
+    if (TYPEOF(ptr) != EXTPTRSXP ||
+        (g = (gday_model *)R_ExternalPtrAddr(ptr)) == NULL)
+        error("Not an open gday model");
+
+    return (g);
+}
+
+static void model_finalise(SEXP ptr) {
+    gday_model *g = (gday_model *)R_ExternalPtrAddr(ptr);
+
+    if (g != NULL) {
+        gday_close(g);
+        R_ClearExternalPtr(ptr);
+    }
+
+    return;
+}
+
+static void keep(SEXP ptr, const char *name, SEXP x) {
+    /*
+        Hold x for as long as the model uses it for met column name, in
+        place of whatever was held for that column before. The list is
+        tagged with the column names.
+    */
+    SEXP tag = install(name), node;
+
+    for (node = R_ExternalPtrProtected(ptr); node != R_NilValue;
+         node = CDR(node)) {
+        if (TAG(node) == tag) {
+            SETCAR(node, x);
+            return;
+        }
+    }
+    node = PROTECT(CONS(x, R_ExternalPtrProtected(ptr)));
+    SET_TAG(node, tag);
+    R_SetExternalPtrProtected(ptr, node);
+    UNPROTECT(1);
+
+    return;
+}
+
+static const R_CallMethodDef call_methods[] = {
+    {"rgday_open", (DL_FUNC)&rgday_open, 1},
+    {"rgday_set", (DL_FUNC)&rgday_set, 3},
+    {"rgday_get", (DL_FUNC)&rgday_get, 2},
+    {"rgday_set_forcing", (DL_FUNC)&rgday_set_forcing, 3},
+    {"rgday_load_met", (DL_FUNC)&rgday_load_met, 1},
+    {"rgday_outputs", (DL_FUNC)&rgday_outputs, 2},
+    {"rgday_daily_output_names", (DL_FUNC)&rgday_daily_output_names, 0},
+    {"rgday_ndays", (DL_FUNC)&rgday_ndays, 1},
+    {"rgday_run", (DL_FUNC)&rgday_run, 1},
+    {"rgday_run_members", (DL_FUNC)&rgday_run_members, 3},
+    {NULL, NULL, 0}
+};
+
+void R_init_rgday(DllInfo *dll) {
+    R_registerRoutines(dll, NULL, call_methods, NULL, NULL);
+    R_useDynamicSymbols(dll, FALSE);
+
+    return;
+}
@@ -0,0 +1,162 @@
+"""
+Run G'DAY in-process, with the forcing and outputs as numpy arrays.
+
+    import numpy as np
+    import pygday
+
+    m = pygday.Model("params/duke.cfg")
+    m.set_forcing(met)                    # dict/DataFrame of met columns
+    out = m.run(outputs=["gpp", "lai"])   # DataFrame (or dict of arrays)
+
+    m.set("params.g1", 4.2)               # later runs start from the same
+    out2 = m.run()                        # state, with the new g1
+
+The forcing columns are used in place when they are already contiguous
+float64 arrays (e.g. read with np.loadtxt or pandas), nothing is written to
+disk. The model releases the GIL while it runs, so run_members() runs
+parameter sets on threads.
+"""
+
+from concurrent.futures import ThreadPoolExecutor
+import os
+
+import numpy as np
+
+from pygday._core import daily_output_names
+from pygday import _core
+
+# met file column names, in file order
+DAILY_MET = ["year", "doy", "tair", "rain", "tsoil", "tam", "tpm", "tmin",
+             "tmax", "tday", "vpd_am", "vpd_pm", "co2", "ndep", "nfix",
+             "wind", "press", "wind_am", "wind_pm", "par_am", "par_pm"]
+SUBDAILY_MET = ["year", "doy", "hod", "rain", "par", "tair", "tsoil", "vpd",
+                "co2", "ndep", "nfix", "wind", "press"]
+
+
+class Model(object):
+
+    def __init__(self, cfg_fname, forcing=None, outputs=None):
+        self._m = _core.Model(cfg_fname)
+        self._forcing = {}
+        if forcing is not None:
+            self.set_forcing(forcing)
+        if outputs is not None:
+            self._m.select_outputs(list(outputs))
+
+    def set(self, key, value):
+        """ Change a .cfg value (section.key) for the runs that follow """
+        if isinstance(value, bool):
+            value = "true" if value else "false"
+        self._m.set(key, str(value))
+
+    def get(self, key):
+        return self._m.get(key)
+
+    def set_forcing(self, forcing):
+        """
+        forcing: a DataFrame, dict of arrays or a 2-d array with the columns
+        in met file order. Arrays which are already contiguous float64 are
+        not copied, the rest are converted once and kept here.
+
+        Columns of the same length as the forcing already set replace just
+        those columns, anything else starts the forcing again. The columns
+        are all checked first, so an error leaves the forcing as it was.
+        """
+        names = (SUBDAILY_MET if self.get("control.sub_daily") == "true"
+                 else DAILY_MET)
+        if isinstance(forcing, np.ndarray) and forcing.ndim == 2:
+            forcing = {n: forcing[:, i] for i, n in enumerate(names)}
+
+        cols = {}
+        for name in forcing.keys():
+            if name == "hod":
+                continue        # implied by the record order
+            col = np.ascontiguousarray(np.asarray(forcing[name]),
+                                       dtype=np.float64)
+            name = "press" if name == "pres" else name
+            if name not in names:
+                raise ValueError("%s isn't a met column" % name)
+            if col.ndim != 1:
+                raise ValueError("%s must be 1-d" % name)
+            cols[name] = col
+        lengths = set(len(col) for col in cols.values())
+        if len(lengths) > 1:
+            raise ValueError("The met columns must all be the same length")
+
+        held = set(len(col) for col in self._forcing.values())
+        if lengths and held != lengths:
+            self._m.clear_forcing()
+            self._forcing = {}
+        for name, col in cols.items():
+            self._m.set_forcing(name, col)
+            self._forcing[name] = col
+
+    def load_met(self, met_fname=None):
+        """ Read the met file named in the .cfg file, or met_fname """
+        if met_fname is not None:
+            self.set("files.met_fname", met_fname)
+        self._m.load_met()
+        self._forcing = {}
+
+    @property
+    def ndays(self):
+        return self._m.ndays
+
+    def select_outputs(self, names):
+        """ The daily outputs run() returns, in this order """
+        self._m.select_outputs(list(names))
+
+    @property
+    def outputs(self):
+        return self._m.outputs
+
+    def run(self, outputs=None, out=None, as_frame=True):
+        """
+        Run over the whole forcing. Returns a DataFrame of the daily
+        outputs if pandas is available (and as_frame), else a dict of
+        arrays, which are views of one (ndays, noutputs) array. Pass out to
+        reuse a buffer between calls.
+        """
+        if outputs is not None:
+            self._m.select_outputs(list(outputs))
+        names = self._m.outputs
+        if out is None:
+            out = np.empty((self._m.ndays, len(names)))
+        ndays = self._m.run(out)
+        return _package(out[:ndays], names, as_frame)
+
+    def clone(self):
+        """ An independent copy sharing the forcing, one per thread """
+        copy = Model.__new__(Model)
+        copy._m = self._m.clone()
+        copy._forcing = dict(self._forcing)
+        return copy
+
+
+def run_members(model, members, outputs=None, threads=None, as_frame=True):
+    """
+    Run one member per dict of {section.key: value} in members, on threads
+    sharing the model's forcing. Returns a list of results, as Model.run.
+    """
+    if outputs is not None:
+        model._m.select_outputs(list(outputs))
+    threads = threads or os.cpu_count() or 1
+
+    def one(member):
+        m = model.clone()
+        for key, value in member.items():
+            m.set(key, value)
+        return m.run(as_frame=as_frame)
+
+    with ThreadPoolExecutor(max_workers=threads) as pool:
+        return list(pool.map(one, members))
+
+
+def _package(out, names, as_frame):
+    if as_frame:
+        try:
+            import pandas as pd
+            return pd.DataFrame(out, columns=names, copy=False)
+        except ImportError:
+            pass
+    return {n: out[:, i] for i, n in enumerate(names)}
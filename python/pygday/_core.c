@@ -0,0 +1,361 @@
+/* ============================================================================
+* CPython extension over the embedding API (src/include/gday_api.h)
+*
+* Kept to the buffer protocol, so it builds without numpy: forcing columns
+* are any C-contiguous float64 buffers (numpy arrays, array('d'), ...), held
+* and used in place, and run() writes into a caller-supplied buffer. The
+* numpy/pandas conveniences live in __init__.py.
+*
+* Each model holds its forcing as a dict of met column name -> memoryview,
+* so setting a column again lets go of the old array. A clone takes a copy
+* of the dict, which keeps the arrays it was made with alive however the
+* model it came from changes later.
+*
+* The GIL is released while the model runs, so clones can be run from
+* threads in parallel.
+*
+* =========================================================================== */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "gday_api.h"
+
+typedef struct ModelObject {
+    PyObject_HEAD
+    gday_model *g;
+    PyObject   *forcing;                /* name -> memoryview in use */
+    struct ModelObject *parent;         /* a clone shares its forcing */
+    int         nclones;                /* clones still open */
+    int         running;
+} ModelObject;
+
+static PyTypeObject ModelType;
+
+
+static PyObject *model_error(ModelObject *self) {
+    PyErr_SetString(PyExc_ValueError, gday_error(self->g));
+    return (NULL);
+}
+
+static int Model_init(ModelObject *self, PyObject *args, PyObject *kwds) {
+    const char *cfg_fname;
+
+    if (!PyArg_ParseTuple(args, "s", &cfg_fname))
+        return (-1);
+    if (self->g != NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Model is already open");
+        return (-1);
+    }
+    if ((self->forcing = PyDict_New()) == NULL)
+        return (-1);
+    if ((self->g = gday_open(cfg_fname)) == NULL) {
+        PyErr_Format(PyExc_ValueError, "Can't open parameter file %s",
+                     cfg_fname);
+        return (-1);
+    }
+
+    return (0);
+}
+
+static void Model_dealloc(ModelObject *self) {
+
+    gday_close(self->g);
+    Py_XDECREF(self->forcing);
+    if (self->parent != NULL) {
+        self->parent->nclones--;
+        Py_DECREF(self->parent);
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+
+    return;
+}
+
+static PyObject *Model_set(ModelObject *self, PyObject *args) {
+    const char *key, *value;
+
+    if (!PyArg_ParseTuple(args, "ss", &key, &value))
+        return (NULL);
+    if (gday_set(self->g, key, value) != 0)
+        return (model_error(self));
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *Model_get(ModelObject *self, PyObject *args) {
+    const char *key;
+    char        buf[256];
+
+    if (!PyArg_ParseTuple(args, "s", &key))
+        return (NULL);
+    if (gday_get(self->g, key, buf, sizeof(buf)) != 0)
+        return (model_error(self));
+
+    return (PyUnicode_FromString(buf));
+}
+
+static PyObject *Model_set_forcing(ModelObject *self, PyObject *args) {
+    /*
+        set_forcing(name, buffer), the buffer is used in place and replaces
+        any earlier one for name. Nothing changes if it can't be used.
+    */
+    const char *name;
+    PyObject   *obj, *mv;
+    Py_buffer  *view;
+
+    if (!PyArg_ParseTuple(args, "sO", &name, &obj))
+        return (NULL);
+    if (self->parent != NULL) {
+        PyErr_SetString(PyExc_ValueError, "A clone shares its forcing");
+        return (NULL);
+    }
+    if ((mv = PyMemoryView_FromObject(obj)) == NULL)
+        return (NULL);
+    view = PyMemoryView_GET_BUFFER(mv);
+    if (view->ndim != 1 || view->itemsize != sizeof(double) ||
+        view->format == NULL || strcmp(view->format, "d") != 0 ||
+        !PyBuffer_IsContiguous(view, 'C')) {
+        Py_DECREF(mv);
+        PyErr_Format(PyExc_TypeError, "%s must be a contiguous 1-d float64 "
+                     "array", name);
+        return (NULL);
+    }
+    if (gday_set_forcing(self->g, name, (const double *)view->buf,
+                         (long)(view->len / sizeof(double))) != 0) {
+        Py_DECREF(mv);
+        return (model_error(self));
+    }
+    if (PyDict_SetItemString(self->forcing, name, mv) != 0) {
+        Py_DECREF(mv);
+        return (NULL);
+    }
+    Py_DECREF(mv);
+
+    Py_RETURN_NONE;
+}
+
+static int no_clones(ModelObject *self) {
+    /* the forcing a clone may be using can't be freed under it */
+
+    if (self->parent != NULL) {
+        PyErr_SetString(PyExc_ValueError, "A clone shares its forcing");
+        return (0);
+    }
+    if (self->nclones > 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Close the model's clones "
+                        "before replacing its forcing");
+        return (0);
+    }
+
+    return (1);
+}
+
+static PyObject *Model_clear_forcing(ModelObject *self, PyObject *noargs) {
+
+    if (!no_clones(self))
+        return (NULL);
+    gday_clear_forcing(self->g);
+    PyDict_Clear(self->forcing);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *Model_load_met(ModelObject *self, PyObject *noargs) {
+
+    if (!no_clones(self))
+        return (NULL);
+    if (gday_load_met(self->g) != 0)
+        return (model_error(self));
+    PyDict_Clear(self->forcing);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *Model_select_outputs(ModelObject *self, PyObject *args) {
+    PyObject    *seq, *item;
+    const char **names;
+    Py_ssize_t   i, n;
+    int          status;
+
+    if (!PyArg_ParseTuple(args, "O", &seq))
+        return (NULL);
+    if ((seq = PySequence_Fast(seq, "outputs must be a sequence")) == NULL)
+        return (NULL);
+    n = PySequence_Fast_GET_SIZE(seq);
+    if ((names = PyMem_Malloc((n + 1) * sizeof(char *))) == NULL) {
+        Py_DECREF(seq);
+        return (PyErr_NoMemory());
+    }
+    for (i = 0; i < n; i++) {
+        item = PySequence_Fast_GET_ITEM(seq, i);
+        if ((names[i] = PyUnicode_AsUTF8(item)) == NULL) {
+            PyMem_Free(names);
+            Py_DECREF(seq);
+            return (NULL);
+        }
+    }
+    status = gday_select_outputs(self->g, names, (int)n);
+    PyMem_Free(names);
+    Py_DECREF(seq);
+    if (status != 0)
+        return (model_error(self));
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *Model_outputs(ModelObject *self, void *closure) {
+    PyObject *names;
+    int       i, n = gday_noutputs(self->g);
+
+    if ((names = PyList_New(n)) == NULL)
+        return (NULL);
+    for (i = 0; i < n; i++)
+        PyList_SET_ITEM(names, i,
+                        PyUnicode_FromString(gday_output_name(self->g, i)));
+
+    return (names);
+}
+
+static PyObject *Model_ndays(ModelObject *self, void *closure) {
+    return (PyLong_FromLong(gday_ndays(self->g)));
+}
+
+static PyObject *Model_run(ModelObject *self, PyObject *args) {
+    /*
+        run(out), out is a writable float64 buffer of at least
+        ndays x len(outputs), returns the number of days
+    */
+    PyObject *obj;
+    Py_buffer view;
+    long      ndays;
+
+    if (!PyArg_ParseTuple(args, "O", &obj))
+        return (NULL);
+    if (PyObject_GetBuffer(obj, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT |
+                           PyBUF_WRITABLE) != 0)
+        return (NULL);
+    if (view.itemsize != sizeof(double) || strcmp(view.format, "d") != 0) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_TypeError, "out must be a float64 array");
+        return (NULL);
+    }
+    if (self->running) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_RuntimeError,
+                        "Model is already running, use a clone per thread");
+        return (NULL);
+    }
+
+    self->running = 1;
+    Py_BEGIN_ALLOW_THREADS
+    ndays = gday_run(self->g, (double *)view.buf,
+                     (long)(view.len / sizeof(double)) /
+                     (gday_noutputs(self->g) > 0 ? gday_noutputs(self->g) : 1));
+    Py_END_ALLOW_THREADS
+    self->running = 0;
+    PyBuffer_Release(&view);
+
+    if (ndays < 0)
+        return (model_error(self));
+
+    return (PyLong_FromLong(ndays));
+}
+
+static PyObject *Model_clone(ModelObject *self, PyObject *noargs) {
+    /* an independent model sharing this one's forcing */
+    ModelObject *copy;
+
+    copy = (ModelObject *)ModelType.tp_alloc(&ModelType, 0);
+    if (copy == NULL)
+        return (NULL);
+    if ((copy->g = gday_clone(self->g)) == NULL) {
+        Py_DECREF(copy);
+        return (PyErr_NoMemory());
+    }
+    if ((copy->forcing = PyDict_Copy(self->forcing)) == NULL) {
+        Py_DECREF(copy);
+        return (NULL);
+    }
+    copy->parent = (self->parent != NULL) ? self->parent : self;
+    copy->parent->nclones++;
+    Py_INCREF(copy->parent);
+
+    return ((PyObject *)copy);
+}
+
+static PyMethodDef Model_methods[] = {
+    {"set", (PyCFunction)Model_set, METH_VARARGS,
+     "set(key, value): change a .cfg value, key is section.key"},
+    {"get", (PyCFunction)Model_get, METH_VARARGS,
+     "get(key): a .cfg value, as a string"},
+    {"set_forcing", (PyCFunction)Model_set_forcing, METH_VARARGS,
+     "set_forcing(name, array): use a float64 array as a met column"},
+    {"clear_forcing", (PyCFunction)Model_clear_forcing, METH_NOARGS,
+     "clear_forcing(): drop the forcing, e.g. to set a different length"},
+    {"load_met", (PyCFunction)Model_load_met, METH_NOARGS,
+     "load_met(): read files.met_fname instead"},
+    {"select_outputs", (PyCFunction)Model_select_outputs, METH_VARARGS,
+     "select_outputs(names): the daily outputs run() returns"},
+    {"run", (PyCFunction)Model_run, METH_VARARGS,
+     "run(out): run the model into out, returns the number of days"},
+    {"clone", (PyCFunction)Model_clone, METH_NOARGS,
+     "clone(): an independent copy sharing the forcing"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Model_getset[] = {
+    {"outputs", (getter)Model_outputs, NULL, "selected daily outputs", NULL},
+    {"ndays", (getter)Model_ndays, NULL, "days of forcing", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyTypeObject ModelType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pygday._core.Model",
+    .tp_basicsize = sizeof(ModelObject),
+    .tp_dealloc = (destructor)Model_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Model(cfg_fname): the G'DAY model set up from a .cfg file",
+    .tp_methods = Model_methods,
+    .tp_getset = Model_getset,
+    .tp_init = (initproc)Model_init,
+    .tp_new = PyType_GenericNew,
+};
+
+static PyObject *daily_output_names(PyObject *module, PyObject *noargs) {
+    PyObject *names;
+    int       i, n = gday_num_daily_outputs();
+
+    if ((names = PyList_New(n)) == NULL)
+        return (NULL);
+    for (i = 0; i < n; i++)
+        PyList_SET_ITEM(names, i,
+                        PyUnicode_FromString(gday_daily_output_name(i)));
+
+    return (names);
+}
+
+static PyMethodDef module_methods[] = {
+    {"daily_output_names", daily_output_names, METH_NOARGS,
+     "Every daily output the model can return"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef core_module = {
+    PyModuleDef_HEAD_INIT, "_core", "G'DAY model core", -1, module_methods
+};
+
+PyMODINIT_FUNC PyInit__core(void) {
+    PyObject *m;
+
+    if (PyType_Ready(&ModelType) < 0)
+        return (NULL);
+    if ((m = PyModule_Create(&core_module)) == NULL)
+        return (NULL);
+    Py_INCREF(&ModelType);
+    if (PyModule_AddObject(m, "Model", (PyObject *)&ModelType) < 0) {
+        Py_DECREF(&ModelType);
+        Py_DECREF(m);
+        return (NULL);
+    }
+
+    return (m);
+}
@@ -0,0 +1,60 @@
+#!/usr/bin/env python
+
+"""
+Build the pygday extension straight from the model sources in ../src:
+
+    $ cd python
+    $ pip install .
+
+numpy is needed to use the module, but not to build it.
+"""
+
+import glob
+import os
+import subprocess
+
+from setuptools import setup, Extension
+
+__author__ = "Martin De Kauwe"
+__version__ = "1.0"
+
+here = os.path.dirname(os.path.abspath(__file__))
+src = os.path.join(here, "..", "src")
+
+
+def write_version(fname):
+    """ What the Makefile's version.c rule writes """
+    try:
+        sha = subprocess.check_output(["git", "rev-parse", "HEAD"],
+                                      cwd=src).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        sha = "unknown"
+    with open(fname, "w") as f:
+        f.write('#include "version.h"\n')
+        f.write('const char *build_git_sha = "%s";\n' % sha)
+        f.write('const char *build_git_time = "";\n')
+
+
+version_c = os.path.join(here, "pygday", "_version.c")
+write_version(version_c)
+
+# the model minus the generated version.c and the canopy_bench tool, gday.c
+# loses main (GDAY_LIBRARY)
+sources = [f for f in sorted(glob.glob(os.path.join(src, "*.c")))
+           if os.path.basename(f) not in ("version.c", "canopy_bench.c")]
+
+core = Extension("pygday._core",
+                 sources=["pygday/_core.c", "pygday/_version.c"] +
+                         [os.path.relpath(f, here) for f in sources],
+                 include_dirs=[os.path.join(src, "include")],
+                 define_macros=[("GDAY_LIBRARY", None)],
+                 extra_compile_args=["-O3"],
+                 libraries=["m"])
+
+setup(name="pygday",
+      version=__version__,
+      description="In-process bindings for the G'DAY model",
+      author=__author__,
+      packages=["pygday"],
+      ext_modules=[core],
+      install_requires=["numpy"])
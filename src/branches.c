@@ -0,0 +1,492 @@
+/* ============================================================================
+* Treatment branches
+*
+* gday -p base.cfg --branches face.ini
+*
+* runs the years before start_year once and then forks one process per
+* branch, each carrying on from the shared in-memory state with its own
+* forcing and param overrides, e.g. a FACE experiment
+*
+*   [branches]
+*   start_year = 1996       ; first year which differs between branches
+*   jobs = 4                ; branches run at once, default one per CPU
+*   spin_up = true          ; spin up once before the shared years
+*
+*   [amb]
+*
+*   [ele]
+*   forcing.co2 = 550.0
+*
+*   [ele_dry]
+*   forcing.co2_add = 200.0
+*   forcing.rain_scale = 0.7
+*   params.g1 = 3.5
+*
+* A section per branch, its name tags that branch's output files (e.g.
+* outputs/run_ele.csv), the untagged files hold the shared years. Params are
+* set as section.key, as for --set. Forcing changes apply from start_year on:
+*
+*   forcing.met_fname   met file with the same dates to take the forcing from
+*   forcing.co2         fixed CO2 (ppm)
+*   forcing.co2_add     added to CO2 (ppm)
+*   forcing.rain_scale  multiplies the rainfall
+*   forcing.ndep_add    added to N deposition, in the met file's units
+*
+* NOTES:
+*   Branches are forked from the running model so nothing is recomputed or
+*   copied up front, each branch only pays for its own years. Parameters only
+*   used when a run starts (e.g. the soil setup) keep their shared values.
+*   Arrow and NetCDF outputs can't be branched, use native output.
+*
+* =========================================================================== */
+#include "branches.h"
+
+static void read_branch_file(const char *, branch_setup *);
+static void branch_handler(const char *, const char *, char *,
+                           branch_setup *);
+static void new_branch(branch_setup *, const char *);
+static void start_branch(canopy_wk *, control *, met_arrays *, params *,
+                         state *, branch *);
+static void apply_forcing(canopy_wk *, control *, met_arrays *, params *,
+                          branch *);
+static FILE *private_copy(FILE *);
+static void free_branches(branch_setup *);
+
+
+void run_branches(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
+                  met_arrays *ma, met *m, params *p, state *s, nrutil *nr) {
+    /*
+        Shared spin-up and years, then the branches, see fork_branches
+    */
+    branch_setup *brs = NULL;
+    long          i, n;
+
+    if ((brs = calloc(1, sizeof(branch_setup))) == NULL) {
+        fprintf(stderr, "malloc failed allocating branch setup\n");
+        exit(EXIT_FAILURE);
+    }
+    read_branch_file(c->branches_fname, brs);
+
+    if (c->output_format == ARROW || c->output_format == NETCDF) {
+        fprintf(stderr, "Arrow/NetCDF output can't be branched, use "
+                "native output\n");
+        exit(EXIT_FAILURE);
+    }
+
+    n = c->sub_daily ? c->total_num_days * 48 : c->total_num_days;
+    for (i = 0; i < n; i++) {
+        if ((int)ma->year[i] == brs->start_year)
+            break;
+    }
+    if (i == n) {
+        fprintf(stderr, "Branch start_year %d isn't in the met file\n",
+                brs->start_year);
+        exit(EXIT_FAILURE);
+    }
+
+    if (brs->spin_up || c->spin_up) {
+        fprintf(stderr, "Shared spin-up for the branches...\n");
+        c->spin_up = TRUE;
+        run_model(cw, c, f, fs, ma, m, p, s, nr);
+        c->spin_up = FALSE;
+    }
+
+    c->brs = brs;
+    run_model(cw, c, f, fs, ma, m, p, s, nr);
+    c->brs = NULL;
+
+    free_branches(brs);
+
+    return;
+}
+
+int fork_branches(canopy_wk *cw, control *c, met_arrays *ma, params *p,
+                  state *s) {
+    /*
+        Called by run_sim at the start of c->brs->start_year. Forks a copy of
+        the model per branch, at most jobs at a time, and waits for them all.
+
+        Returns:
+        --------
+        BRANCH_CHILD in the branches, which carry on with the run, and
+        BRANCH_PARENT once all of them have finished.
+    */
+    branch_setup *brs = c->brs;
+    pid_t        *pids = NULL, pid;
+    int           i, j, status, running = 0, failed = 0;
+
+    if ((pids = malloc(brs->nbranches * sizeof(pid_t))) == NULL) {
+        fprintf(stderr, "malloc failed allocating branch pids\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i <= brs->nbranches; i++) {
+        /* wait for a free slot, or for everything at the end */
+        while (running > 0 && (running == brs->jobs || i == brs->nbranches)) {
+            if ((pid = wait(&status)) < 0) {
+                fprintf(stderr, "Error waiting for branches\n");
+                exit(EXIT_FAILURE);
+            }
+            running--;
+            for (j = 0; j < i; j++) {
+                if (pids[j] == pid)
+                    break;
+            }
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+                fprintf(stderr, "Branch %s failed\n",
+                        j < i ? brs->items[j].name : "?");
+                failed++;
+            }
+        }
+        if (i == brs->nbranches)
+            break;
+
+        /* don't let the children inherit unwritten output */
+        fflush(NULL);
+        if ((pid = fork()) < 0) {
+            fprintf(stderr, "Error forking branch %s\n", brs->items[i].name);
+            exit(EXIT_FAILURE);
+        } else if (pid == 0) {
+            start_branch(cw, c, ma, p, s, &brs->items[i]);
+            free(pids);
+            return (BRANCH_CHILD);
+        }
+        pids[i] = pid;
+        running++;
+    }
+    free(pids);
+
+    if (failed) {
+        fprintf(stderr, "%d of %d branches failed\n", failed,
+                brs->nbranches);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(stderr, "All %d branches finished\n", brs->nbranches);
+
+    return (BRANCH_PARENT);
+}
+
+static void start_branch(canopy_wk *cw, control *c, met_arrays *ma,
+                         params *p, state *s, branch *br) {
+    /* turn the forked copy into branch br */
+    override_list *ol = NULL;
+    int            i;
+
+    fprintf(stderr, "Branch %s\n", br->name);
+    c->brs = NULL;
+
+    /* the final state is written by re-reading the .cfg file, whose handle
+       (and offset) every child shares with the parent */
+    c->ifp = private_copy(c->ifp);
+
+    /* the shared years went to the untagged files */
+    close_output_files(c);
+
+    /* run_sim only derives the params before the first day */
+    apply_overrides(br->ol, c, p, s);
+    if (check_flags(c) > 0)
+        exit(EXIT_FAILURE);
+    if (!p->derived.valid)
+        derive_params(c, p);
+
+    ol = copy_override_list(c->ovr);
+    for (i = 0; i < br->ol->num; i++)
+        add_override(ol, br->ol->items[i].fld, br->ol->items[i].value);
+    c->ovr = ol;
+
+    apply_forcing(cw, c, ma, p, br);
+
+    tag_output_fnames(c, br->ol, br->name);
+    open_run_outputs(c, ma, p);
+
+    return;
+}
+
+static void apply_forcing(canopy_wk *cw, control *c, met_arrays *ma,
+                          params *p, branch *br) {
+    /* change the forcing from the current time step to the end */
+    control     tmp;
+    met_arrays  alt;
+    char       *prog[] = {"gday", NULL};
+    long        i, start, n;
+    int         hour_idx, num_days;
+
+    start = c->sub_daily ? c->hour_idx : c->day_idx;
+    n = c->sub_daily ? c->total_num_days * 48 : c->total_num_days;
+
+    if (strcmp(br->fv.met_fname, "*NOT SET*") != 0) {
+        tmp = *c;
+        memset(&alt, 0, sizeof(met_arrays));
+        strcpy(tmp.met_fname, br->fv.met_fname);
+        if (c->sub_daily)
+            read_subdaily_met_data(prog, &tmp, &alt);
+        else
+            read_daily_met_data(prog, &tmp, &alt);
+
+        if (tmp.total_num_days != c->total_num_days) {
+            fprintf(stderr, "Branch %s: %s doesn't cover the same days as "
+                    "%s\n", br->name, br->fv.met_fname, c->met_fname);
+            exit(EXIT_FAILURE);
+        }
+        for (i = 0; i < n; i++) {
+            if (!float_eq(alt.year[i], ma->year[i])) {
+                fprintf(stderr, "Branch %s: %s doesn't cover the same "
+                        "days as %s\n", br->name, br->fv.met_fname,
+                        c->met_fname);
+                exit(EXIT_FAILURE);
+            }
+        }
+        /* the old arrays are still shared with the parent, leave them */
+        *ma = alt;
+        strcpy(c->met_fname, br->fv.met_fname);
+
+        if (c->sub_daily) {
+            /* the solar stores depend on the PAR forcing */
+            hour_idx = c->hour_idx;
+            num_days = c->num_days;
+            free(cw->cz_store);
+            free(cw->ele_store);
+            free(cw->df_store);
+            free(cw->daytime);
+            fill_up_solar_arrays(cw, c, ma, p);
+            c->hour_idx = hour_idx;
+            c->num_days = num_days;
+        }
+    }
+
+    adjust_forcing(ma, start, n, &br->fv);
+
+    /* the MATE terms depend on the forcing too */
+    if (c->mate != NULL)
+        build_mate_table(c, ma, p);
+
+    return;
+}
+
+void init_forcing_view(forcing_view *fv) {
+    /* the forcing as it is in the met file */
+    strcpy(fv->met_fname, "*NOT SET*");
+    fv->co2 = -1.0;
+    fv->co2_add = 0.0;
+    fv->rain_scale = 1.0;
+    fv->ndep_add = 0.0;
+
+    return;
+}
+
+int set_forcing_view(forcing_view *fv, const char *name, const char *value) {
+    /* forcing.* keys, returns FALSE if name isn't one of them */
+
+    if (strcasecmp(name, "forcing.met_fname") == 0)
+        strncpy0(fv->met_fname, (char *)value, sizeof(fv->met_fname));
+    else if (strcasecmp(name, "forcing.co2") == 0)
+        fv->co2 = atof(value);
+    else if (strcasecmp(name, "forcing.co2_add") == 0)
+        fv->co2_add = atof(value);
+    else if (strcasecmp(name, "forcing.rain_scale") == 0)
+        fv->rain_scale = atof(value);
+    else if (strcasecmp(name, "forcing.ndep_add") == 0)
+        fv->ndep_add = atof(value);
+    else
+        return (FALSE);
+
+    return (TRUE);
+}
+
+void adjust_forcing(met_arrays *ma, long start, long n, forcing_view *fv) {
+    /* CO2, rain and N deposition changes for time steps start..n-1 */
+    long i;
+
+    for (i = start; i < n; i++) {
+        if (fv->co2 >= 0.0)
+            ma->co2[i] = fv->co2;
+        ma->co2[i] += fv->co2_add;
+        ma->rain[i] *= fv->rain_scale;
+        ma->ndep[i] += fv->ndep_add;
+    }
+
+    return;
+}
+
+static void read_branch_file(const char *fname, branch_setup *brs) {
+    /* same flavour of .ini file as the param file */
+    FILE *fp = NULL;
+    char  line[STRING_LENGTH];
+    char  section[STRING_LENGTH] = "";
+    char *start, *end, *name, *value;
+    int   line_number = 0;
+    long  ncpu;
+
+    brs->start_year = -1;
+    ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    brs->jobs = (ncpu > 0) ? (int)ncpu : 1;
+    brs->spin_up = FALSE;
+    brs->nbranches = 0;
+    brs->max_branches = 0;
+    brs->items = NULL;
+
+    if ((fp = fopen(fname, "r")) == NULL) {
+        fprintf(stderr, "Error opening branches file %s\n", fname);
+        exit(EXIT_FAILURE);
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        start = lskip(rstrip(line));
+        if (*start == '\0' || *start == ';' || *start == '#') {
+            continue;
+        } else if (*start == '[') {
+            end = find_char_or_comment(start + 1, ']');
+            if (*end != ']') {
+                fprintf(stderr, "%s: no ']' on line %d\n", fname,
+                        line_number);
+                exit(EXIT_FAILURE);
+            }
+            *end = '\0';
+            strncpy0(section, start + 1, sizeof(section));
+            if (strcasecmp(section, "branches") != 0)
+                new_branch(brs, section);
+        } else {
+            end = find_char_or_comment(start, '=');
+            if (*end != '=') {
+                fprintf(stderr, "%s: expected name = value on line %d\n",
+                        fname, line_number);
+                exit(EXIT_FAILURE);
+            }
+            *end = '\0';
+            name = rstrip(start);
+            value = lskip(end + 1);
+            end = find_char_or_comment(value, '\0');
+            if (*end == ';')
+                *end = '\0';
+            rstrip(value);
+
+            branch_handler(section, name, value, brs);
+        }
+    }
+    fclose(fp);
+
+    if (brs->start_year < 0) {
+        fprintf(stderr, "The branches file needs a start_year\n");
+        exit(EXIT_FAILURE);
+    }
+    if (brs->nbranches == 0) {
+        fprintf(stderr, "The branches file doesn't list any branches\n");
+        exit(EXIT_FAILURE);
+    }
+    if (brs->jobs < 1) {
+        fprintf(stderr, "Branch jobs must be >= 1\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return;
+}
+
+static void branch_handler(const char *section, const char *name,
+                           char *value, branch_setup *brs) {
+    branch          *br = NULL;
+    const reg_field *fld = NULL;
+
+    #define MATCH(s, n) strcasecmp(section, s) == 0 && strcasecmp(name, n) == 0
+
+    if (MATCH("branches", "start_year")) {
+        brs->start_year = atoi(value);
+        return;
+    } else if (MATCH("branches", "jobs")) {
+        brs->jobs = atoi(value);
+        return;
+    } else if (MATCH("branches", "spin_up")) {
+        brs->spin_up = (strcasecmp(value, "true") == 0);
+        return;
+    } else if (strcasecmp(section, "branches") == 0 ||
+               brs->nbranches == 0) {
+        fprintf(stderr, "Unknown branches option [%s] %s\n", section, name);
+        exit(EXIT_FAILURE);
+    }
+
+    br = &brs->items[brs->nbranches - 1];
+    if (set_forcing_view(&br->fv, name, value))
+        return;
+
+    if ((fld = registry_lookup_key(name)) == NULL) {
+        fprintf(stderr, "Unknown key %s in branch %s, expected forcing.* or "
+                "section.key, e.g. params.g1\n", name, br->name);
+        exit(EXIT_FAILURE);
+    }
+    if (strcasecmp(name, "files.met_fname") == 0 ||
+        strcasecmp(name, "files.cfg_fname") == 0 ||
+        strcasecmp(name, "control.sub_daily") == 0 ||
+        strcasecmp(name, "control.water_balance") == 0 ||
+        strcasecmp(name, "control.output_format") == 0) {
+        fprintf(stderr, "%s can't be changed in a branch\n", name);
+        exit(EXIT_FAILURE);
+    }
+    add_override(br->ol, fld, value);
+
+    return;
+}
+
+static void new_branch(branch_setup *brs, const char *name) {
+    branch *br = NULL;
+    int     i;
+
+    for (i = 0; i < brs->nbranches; i++) {
+        if (strcasecmp(brs->items[i].name, name) == 0) {
+            fprintf(stderr, "Branch %s is listed twice\n", name);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (brs->nbranches == brs->max_branches) {
+        brs->max_branches = (brs->max_branches == 0) ? 8 :
+                            brs->max_branches * 2;
+        brs->items = realloc(brs->items, brs->max_branches * sizeof(branch));
+        if (brs->items == NULL) {
+            fprintf(stderr, "realloc failed growing branch list\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    br = &brs->items[brs->nbranches];
+    strncpy0(br->name, (char *)name, sizeof(br->name));
+    br->ol = new_override_list();
+    init_forcing_view(&br->fv);
+    brs->nbranches++;
+
+    return;
+}
+
+static FILE *private_copy(FILE *fp) {
+    /* copy of a file read with pread, which leaves the shared offset alone */
+    FILE   *copy = NULL;
+    char    buf[BUFSIZ];
+    off_t   offset = 0;
+    ssize_t n;
+
+    if ((copy = tmpfile()) == NULL) {
+        fprintf(stderr, "Error creating a copy of the param file\n");
+        exit(EXIT_FAILURE);
+    }
+    while ((n = pread(fileno(fp), buf, sizeof(buf), offset)) > 0) {
+        fwrite(buf, 1, (size_t)n, copy);
+        offset += n;
+    }
+    if (n < 0) {
+        fprintf(stderr, "Error copying the param file\n");
+        exit(EXIT_FAILURE);
+    }
+    rewind(copy);
+
+    return (copy);
+}
+
+static void free_branches(branch_setup *brs) {
+    int i;
+
+    for (i = 0; i < brs->nbranches; i++)
+        free_override_list(brs->items[i].ol);
+    free(brs->items);
+    free(brs);
+
+    return;
+}
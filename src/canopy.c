@@ -34,30 +34,62 @@ void canopy(canopy_wk *cw, control *c, fluxes *f, met_arrays *ma, met *m,
 
         - The logic broadly follows MAESTRA code, with some restructuring.
 
+        The day is split into canopy_start_day, canopy_half_hour and
+        canopy_end_day so that the embedding API can step it one half-hour
+        at a time (gday_step_halfhour). With control.canopy_kernel = batched
+        a bucket model day is solved in one go instead (canopy_batch.c).
+        Otherwise the daytime half-hours come from the index built with the
+        solar stores, and a night half-hour that follows another skips
+        everything but the water balance (canopy_night_half_hour).
+
         References
         ----------
         * Wang & Leuning (1998) Agricultural & Forest Meterorology, 91, 89-111.
         * Dai et al. (2004) Journal of Climate, 17, 2281-2299.
         * De Pury & Farquhar (1997) PCE, 20, 537-557.
     */
-    int    hod, iter = 0, itermax = 100, dummy=0, sunlight_hrs;
-    int    debug = TRUE;
-    double doy, year, dummy2=0.0, previous_sw, current_sw, gsv;
-    double previous_cs, current_cs, relk;
+    int  hod, night;
+    long k;
+
+    canopy_start_day(cw, c, f, p, s);
+
+    if (c->canopy_kernel != CANOPY_SCALAR && c->water_balance == BUCKET) {
+        canopy_batched_day(cw, c, f, ma, m, nr, p, s);
+    } else if (c->hour_idx + c->num_hlf_hrs <= cw->num_indexed) {
+        /* loop through the day, the sun's up at daytime[k] next */
+        k = first_daytime(cw, c->hour_idx);
+        night = FALSE;
+        for (hod = 0; hod < c->num_hlf_hrs; hod++) {
+            if (k < cw->num_daytime && cw->daytime[k] == c->hour_idx) {
+                canopy_half_hour(cw, c, f, ma, m, nr, p, s, hod);
+                night = FALSE;
+                k++;
+            } else if (night) {
+                canopy_night_half_hour(cw, c, f, ma, m, nr, p, s, hod);
+            } else {
+                canopy_half_hour(cw, c, f, ma, m, nr, p, s, hod);
+                night = TRUE;
+            }
+        }
+    } else {
+        /* loop through the day */
+        for (hod = 0; hod < c->num_hlf_hrs; hod++) {
+            canopy_half_hour(cw, c, f, ma, m, nr, p, s, hod);
+        }
+    }
 
-    // Hydraulic conductance of the entire soil-to-leaf pathway
-    // - this is only used in hydraulics, so set it to zero.
-    // (mmol m–2 s–1 MPa–1)
-    double ktot = 0.0;
+    canopy_end_day(c, f, p, s, c->num_hlf_hrs);
+
+    return;
+}
+
+void canopy_start_day(canopy_wk *cw, control *c, fluxes *f, params *p,
+                      state *s) {
+    /* zero the day's sums, before the first half-hour */
+    double relk;
 
-    /* loop through the day */
     zero_carbon_day_fluxes(f);
     zero_water_day_fluxes(f);
-    previous_sw = s->pawater_topsoil + s->pawater_root;
-    previous_cs = s->canopy_store;
-    sunlight_hrs = 0;
-    doy = ma->doy[c->hour_idx];
-    year = ma->year[c->hour_idx];
 
     // reset plant water store to yesterday's value
     if (c->water_store) {
@@ -70,118 +102,324 @@ void canopy(canopy_wk *cw, control *c, fluxes *f, met_arrays *ma, met *m,
         cw->plant_k = p->kp;
     }
 
-    for (hod = 0; hod < c->num_hlf_hrs; hod++) {
-        unpack_met_data(c, f, ma, m, hod, dummy2);
-
-        //if (year >= 2004.0 && year <=2005.0) {
-        //    m->rain = 0.0;
-        //}
-
-        /* calculates diffuse frac from half-hourly incident radiation */
-        unpack_solar_geometry(cw, c);
+    return;
+}
 
-        /* Is the sun up? */
-        if (cw->elevation > 0.0 && m->par > 20.0) {
-            calculate_absorbed_radiation(cw, p, s, m->par);
-            calculate_top_of_canopy_leafn(cw, p, s);
-            calc_leaf_to_canopy_scalar(cw, p, s);
+void canopy_half_hour(canopy_wk *cw, control *c, fluxes *f, met_arrays *ma,
+                      met *m, nrutil *nr, params *p, state *s, int hod) {
+    /* the half-hour at c->hour_idx in the met arrays */
+    double doy, year, dummy2 = 0.0;
 
-            /* sunlit / shaded loop */
-            for (cw->ileaf = 0; cw->ileaf < NUM_LEAVES; cw->ileaf++) {
+    doy = ma->doy[c->hour_idx];
+    year = ma->year[c->hour_idx];
 
-                /* initialise values of Tleaf, Cs, dleaf at the leaf surface */
-                initialise_leaf_surface(cw, m);
+    unpack_met_data(c, f, ma, m, hod, dummy2);
 
-                /* Leaf temperature loop */
-                while (TRUE) {
+    //if (year >= 2004.0 && year <=2005.0) {
+    //    m->rain = 0.0;
+    //}
 
-                    if (c->ps_pathway == C3) {
-                        photosynthesis_C3(c, cw, m, p, s);
-                    } else {
-                        /* Nothing implemented */
-                        fprintf(stderr, "C4 photosynthesis not implemented\n");
-                        exit(EXIT_FAILURE);
-                    }
+    /* calculates diffuse frac from half-hourly incident radiation */
+    unpack_solar_geometry(cw, c);
 
-                    if (cw->an_leaf[cw->ileaf] > 1E-04) {
+    /* Is the sun up? */
+    if (cw->elevation > 0.0 && m->par > 20.0) {
+        calculate_top_of_canopy_leafn(cw, p, s);
+        if (c->ofp_trace != NULL)
+            write_canopy_trace(cw, c, f, m, s, year, doy, hod);
+        canopy_leaves(cw, c, f, m, p, s, year, doy, hod);
+    } else {
+        canopy_night(cw, c, m, s, hod);
+    }
 
-                        if (c->water_balance == HYDRAULICS) {
-                            // Ensure transpiration does not exceed Emax, if it
-                            // does we recalculate gs and An
-                            calculate_emax(c, cw, f, m, p, s, &ktot);
-                        }
+    canopy_finish_half_hour(cw, c, f, m, nr, p, s, hod, year, doy);
 
-                        /* Calculate new Cs, dleaf, Tleaf */
-                        solve_leaf_energy_balance(c, cw, f, m, p, s, ktot);
+    return;
+}
 
-                    } else {
-                        break;
-                    }
+void canopy_leaves(canopy_wk *cw, control *c, fluxes *f, met *m, params *p,
+                   state *s, double year, double doy, int hod) {
+    /*
+        The sunlit and shaded leaf solves for a daytime half-hour, from the
+        forcing in m, the solar geometry and cw->N0. Split out of
+        canopy_half_hour so canopy_bench can replay captured half-hours
+        through exactly the same code.
+    */
+    int    warm, converged;
+    double tleaf_prev = 0.0, resid_prev = 0.0;
 
-                    if (iter >= itermax) {
-                        fprintf(stderr, "No convergence in canopy loop:\n");
-                        exit(EXIT_FAILURE);
-                    } else if (fabs(cw->tleaf[cw->ileaf] - cw->tleaf_new) < 0.02) {
-                        break;
-                    }
+    // Hydraulic conductance of the entire soil-to-leaf pathway and the
+    // supply it allows - only used in hydraulics, so set them to zero.
+    // (mmol m–2 s–1 MPa–1, mmol m-2 s-1)
+    double ktot = 0.0, e_supply = 0.0;
 
-                    /* Update temperature & do another iteration */
-                    cw->tleaf[cw->ileaf] = cw->tleaf_new;
-                    iter++;
-                } /* end of leaf temperature loop */
+    calculate_absorbed_radiation(cw, p, s, m->par);
+    calc_leaf_to_canopy_scalar(cw, p, s);
 
+    /* the soil and plant don't change within the half-hour */
+    if (c->water_balance == HYDRAULICS)
+        e_supply = calculate_water_supply(cw, f, p, s, &ktot);
 
-            } /* end of sunlit/shaded leaf loop */
+    /* sunlit / shaded loop */
+    for (cw->ileaf = 0; cw->ileaf < NUM_LEAVES; cw->ileaf++) {
 
+        /* initialise values of Tleaf, Cs, dleaf at the leaf surface */
+        warm = c->warm_start && cw->warm[cw->ileaf];
+        if (warm) {
+            warm_start_leaf_surface(cw, m);
         } else {
+            initialise_leaf_surface(cw, m);
+        }
+        converged = FALSE;
+
+        /* Leaf temperature loop, each leaf gets c->leaf_itermax goes */
+        cw->iter = 0;
+        while (TRUE) {
+
+            if (c->ps_pathway == C3) {
+                photosynthesis_C3(c, cw, m, p, s);
+            } else {
+                /* Nothing implemented */
+                fprintf(stderr, "C4 photosynthesis not implemented\n");
+                exit(EXIT_FAILURE);
+            }
 
-            zero_hourly_fluxes(cw);
+            if (cw->an_leaf[cw->ileaf] > 1E-04) {
 
-            /* set tleaf to tair during the night */
-            cw->tleaf[SUNLIT] = m->tair;
-            cw->tleaf[SHADED] = m->tair;
+                if (c->water_balance == HYDRAULICS) {
+                    // Ensure transpiration does not exceed Emax, if it
+                    // does we recalculate gs and An
+                    calculate_emax(cw, m, p, e_supply);
+                }
 
-            /*
-            ** pre-dawn soil water potential (MPa), clearly one should link this
-            ** the actual sun-rise :). Here 10 = 5 am, 10 is num_half_hr
-            **/
-            if (c->water_balance == HYDRAULICS && hod == 10) {
-                s->predawn_swp = s->weighted_swp;
-                /*_calc_soil_water_potential(c, p, s);*/
+                /* Calculate new Cs, dleaf, Tleaf */
+                solve_leaf_energy_balance(c, cw, f, m, p, s, ktot);
 
+            } else {
+                break;
             }
 
-        }
+            if (fabs(cw->tleaf[cw->ileaf] - cw->tleaf_new) < 0.02) {
+                converged = TRUE;
+                break;
+            } else if (cw->iter >= c->leaf_itermax) {
+                leaf_not_converged(cw, year, doy, hod);
+                break;
+            }
 
+            /* Update temperature & do another iteration */
+            cw->tleaf[cw->ileaf] = next_leaf_temperature(c,
+                                        cw->tleaf[cw->ileaf],
+                                        cw->tleaf_new, cw->iter,
+                                        &tleaf_prev, &resid_prev);
+            cw->iter++;
+        } /* end of leaf temperature loop */
 
-        scale_leaf_to_canopy(c, cw, s);
-        if (c->water_balance == HYDRAULICS && hod == 24) {
-            s->midday_lwp = cw->lwp_canopy;
-            s->midday_xwp = cw->xylem_psi;
-        }
-        sum_hourly_carbon_fluxes(cw, f, p);
-
-        // We need to remove the et_deficit which will come from the
-        // plant storage from the water we need to extract from the soil.
-        // We will add this back later to the transpiration output.
-        if (c->water_balance == HYDRAULICS && c->water_store) {
-            cw->trans_canopy -= cw->trans_deficit_canopy ;
-            if (cw->trans_canopy < 0.0) {
-                cw->trans_canopy = 0.0;
-            }
+        cw->leaf_iter[cw->ileaf] = cw->iter;
+        cw->leaf_solves[warm]++;
+        cw->leaf_passes[warm] += cw->iter + 1;
+        if (c->warm_start)
+            keep_leaf_surface(cw, m, converged);
+
+    } /* end of sunlit/shaded leaf loop */
+
+    return;
+}
+
+double next_leaf_temperature(control *c, double tleaf, double tleaf_new,
+                             int iter, double *tleaf_prev,
+                             double *resid_prev) {
+    /*
+        The leaf temperature to try next. The energy balance turns a guess
+        T into tleaf_new = g(T), and the leaf temperature is the root of
+        F(T) = g(T) - T.
+
+        fixed_point takes g(T) as it is (the MAESTRA iteration). secant steps
+        to where the line through the last two (T, F) pairs crosses zero,
+        which converges superlinearly rather than linearly. The first
+        iteration has no line yet and takes the fixed point step, as does any
+        secant step that looks wrong: F falls with T (the 1/4 in tleaf_new
+        damps g), so the step must have the sign of F, and it shouldn't be
+        more than 10 times the fixed point one.
+
+        tleaf_prev and resid_prev carry the last pair between calls.
+    */
+    double resid, step, next;
+
+    resid = tleaf_new - tleaf;
+    next = tleaf_new;
+
+    if (c->leaf_solver == LEAF_SECANT && iter > 0) {
+        step = -resid * (tleaf - *tleaf_prev) / (resid - *resid_prev);
+        if (step * resid > 0.0 && fabs(step) < 10.0 * fabs(resid))
+            next = tleaf + step;
+    }
+    *tleaf_prev = tleaf;
+    *resid_prev = resid;
+
+    return (next);
+}
+
+void leaf_not_converged(canopy_wk *cw, double year, double doy, int hod) {
+    /*
+        Out of leaf temperature iterations, keep the last estimate and carry
+        on rather than stop the run. Reported the first time only, run_sim
+        prints the count at the end.
+    */
+    if (cw->nonconverged == 0)
+        fprintf(stderr, "Leaf temperature not converged in %d iterations "
+                "(year %d, doy %d, half-hour %d), keeping the last "
+                "estimate\n", cw->iter, (int)year, (int)doy, hod);
+    cw->nonconverged++;
+
+    return;
+}
+
+void print_leaf_solves(FILE *fp, canopy_wk *cw) {
+    /* how the leaf temperature solves went, cold and warm started */
+    long n = cw->leaf_solves[0] + cw->leaf_solves[1];
+    long passes = cw->leaf_passes[0] + cw->leaf_passes[1];
+    int  k;
+
+    fprintf(fp, "leaf temperature solves: %ld, %.3f passes each", n,
+            n > 0 ? (double)passes / n : 0.0);
+    for (k = 0; k < 2; k++)
+        fprintf(fp, "; %s started %ld, %.3f each", k ? "warm" : "cold",
+                cw->leaf_solves[k], cw->leaf_solves[k] > 0 ?
+                (double)cw->leaf_passes[k] / cw->leaf_solves[k] : 0.0);
+    fprintf(fp, "\n");
+
+    return;
+}
+
+void canopy_night_half_hour(canopy_wk *cw, control *c, fluxes *f,
+                            met_arrays *ma, met *m, nrutil *nr, params *p,
+                            state *s, int hod) {
+    /*
+        A night half-hour straight after another (the daytime index says so,
+        see fill_up_solar_arrays). canopy_night has already zeroed the
+        leaves and nothing in the water balance touches them, so the canopy
+        sums come out as they did last half-hour: skip the solar geometry,
+        the scaling up and the carbon sums (all + 0), and keep
+        trans_canopy as already adjusted for the plant water store. That
+        leaves the forcing, the leaf temperature and the water balance.
+    */
+    double doy, year;
+
+    doy = ma->doy[c->hour_idx];
+    year = ma->year[c->hour_idx];
+
+    unpack_met_data(c, f, ma, m, hod, 0.0);
+
+    cw->tleaf[SUNLIT] = m->tair;
+    cw->tleaf[SHADED] = m->tair;
+
+    if (c->water_balance == HYDRAULICS && hod == 10) {
+        s->predawn_swp = s->weighted_swp;
+    }
+    if (c->water_balance == HYDRAULICS && hod == 24) {
+        s->midday_lwp = cw->lwp_canopy;
+        s->midday_xwp = cw->xylem_psi;
+    }
+
+    canopy_water_balance(cw, c, f, m, nr, p, s, hod, year, doy);
+
+    return;
+}
+
+long first_daytime(canopy_wk *cw, long hour_idx) {
+    /* where the daytime index reaches hour_idx, by bisection */
+    long lo = 0, hi = cw->num_daytime, mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (cw->daytime[mid] < hour_idx)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return (lo);
+}
+
+void canopy_night(canopy_wk *cw, control *c, met *m, state *s, int hod) {
+    /* the sun is down, or too low to bother with */
+
+    zero_hourly_fluxes(cw);
+
+    /* set tleaf to tair during the night */
+    cw->tleaf[SUNLIT] = m->tair;
+    cw->tleaf[SHADED] = m->tair;
+
+    /* nothing to warm start the morning from */
+    cw->warm[SUNLIT] = FALSE;
+    cw->warm[SHADED] = FALSE;
+
+    /*
+    ** pre-dawn soil water potential (MPa), clearly one should link this
+    ** the actual sun-rise :). Here 10 = 5 am, 10 is num_half_hr
+    **/
+    if (c->water_balance == HYDRAULICS && hod == 10) {
+        s->predawn_swp = s->weighted_swp;
+        /*_calc_soil_water_potential(c, p, s);*/
+
+    }
+
+    return;
+}
+
+void canopy_finish_half_hour(canopy_wk *cw, control *c, fluxes *f, met *m,
+                             nrutil *nr, params *p, state *s, int hod,
+                             double year, double doy) {
+    /* the leaf fluxes are solved, on to the canopy sums and water balance */
+
+    scale_leaf_to_canopy(c, cw, s);
+    if (c->water_balance == HYDRAULICS && hod == 24) {
+        s->midday_lwp = cw->lwp_canopy;
+        s->midday_xwp = cw->xylem_psi;
+    }
+    sum_hourly_carbon_fluxes(cw, f, p);
+
+    // We need to remove the et_deficit which will come from the
+    // plant storage from the water we need to extract from the soil.
+    // We will add this back later to the transpiration output.
+    if (c->water_balance == HYDRAULICS && c->water_store) {
+        cw->trans_canopy -= cw->trans_deficit_canopy ;
+        if (cw->trans_canopy < 0.0) {
+            cw->trans_canopy = 0.0;
         }
+    }
+
+    canopy_water_balance(cw, c, f, m, nr, p, s, hod, year, doy);
+
+    return;
+}
 
-        calculate_water_balance_sub_daily(c, cw, f, m, nr, p, s, dummy,
-                                          cw->trans_canopy, cw->omega_canopy,
-                                          cw->rnet_canopy,
-                                          cw->trans_deficit_canopy, year, doy);
+void canopy_water_balance(canopy_wk *cw, control *c, fluxes *f, met *m,
+                          nrutil *nr, params *p, state *s, int hod,
+                          double year, double doy) {
+    /* the half-hour's water balance and outputs, then on to the next one */
+    int dummy = 0;
 
-        if (c->print_options == SUBDAILY && c->spin_up == FALSE) {
+    calculate_water_balance_sub_daily(c, cw, f, m, nr, p, s, dummy,
+                                      cw->trans_canopy, cw->omega_canopy,
+                                      cw->rnet_canopy,
+                                      cw->trans_deficit_canopy, year, doy);
+
+    if (c->print_options == SUBDAILY && c->spin_up == FALSE) {
+        if (c->output_ascii)
             write_subdaily_outputs_ascii(c, cw, year, doy, hod);
-        }
-        c->hour_idx++;
-        sunlight_hrs++;
-    } /* end of hour loop */
+        else
+            write_subdaily_outputs_binary(c, cw, s, year, doy, hod);
+    }
+    c->hour_idx++;
+
+    return;
+}
+
+void canopy_end_day(control *c, fluxes *f, params *p, state *s,
+                    int sunlight_hrs) {
+    /* after the last half-hour of the day */
 
     /* work out average omega for the day over sunlight hours */
     f->omega /= sunlight_hrs;
@@ -197,19 +435,6 @@ void canopy(canopy_wk *cw, control *c, fluxes *f, met_arrays *ma, met *m,
         s->wtfac_root = 1.0;
     }
 
-    //current_sw = s->pawater_topsoil + s->pawater_root;
-    //current_cs = s->canopy_store;
-    //check_water_balance(c, f, s, previous_sw, current_sw, previous_cs,
-    //                    current_cs, year, doy);
-
-    //if (debug) {
-    //    current_sw = s->pawater_topsoil + s->pawater_root;
-    //    check_water_balance(c, f, previous_sw, current_sw);
-    //}
-
-    //if (c->pdebug) {
-    //    exit(1);
-    //}
     return;
 }
 
@@ -272,7 +497,7 @@ double calc_leaf_net_rad(params *p, state *s, double tair, double vpd,
     Tk = tair + DEG_TO_KELVIN;
 
     /* Isothermal net radiation (Leuning et al. 1995, Appendix) */
-    ea = calc_sat_water_vapour_press(tair) - vpd;
+    ea = temp_response(p, TT_SAT_VP, tair) - vpd;
 
     /* catch for AWAP diurnal stuff until I better connect VPD and Tair */
     if (ea < 0.0) {
@@ -399,6 +624,45 @@ void initialise_leaf_surface(canopy_wk *cw, met *m) {
     cw->Cs = m->Ca;
 }
 
+void warm_start_leaf_surface(canopy_wk *cw, met *m) {
+    /*
+        Start from the leaf's solution of the last half-hour instead, moved
+        with the air: the VPD difference and the CO2 drawdown are kept as
+        they were, the leaf to air temperature difference scaled with the
+        absorbed radiation (which moves it more than anything). Scaling it
+        takes 0.1-0.2 passes a solve off keeping it as it was.
+
+        A leaf only keeps a solution once it has had an energy balance, so
+        warm_apar > 0.
+    */
+    int    idx = cw->ileaf;
+    double dtleaf;
+
+    dtleaf = (cw->warm_tleaf[idx] - cw->warm_tair[idx]) * cw->apar_leaf[idx] /
+             cw->warm_apar[idx];
+    cw->tleaf[idx] = m->tair + dtleaf;
+    cw->dleaf = MAX(0.0, m->vpd + (cw->warm_dleaf[idx] - cw->warm_vpd[idx]));
+    cw->Cs = m->Ca + (cw->warm_Cs[idx] - cw->warm_Ca[idx]);
+}
+
+void keep_leaf_surface(canopy_wk *cw, met *m, int converged) {
+    /*
+        The leaf's solution, for warm_start_leaf_surface next half-hour. A
+        leaf that didn't converge (or had no energy balance, An <= 0) starts
+        from the air again.
+    */
+    int idx = cw->ileaf;
+
+    cw->warm[idx] = converged;
+    cw->warm_tleaf[idx] = cw->tleaf[idx];
+    cw->warm_dleaf[idx] = cw->dleaf;
+    cw->warm_Cs[idx] = cw->Cs;
+    cw->warm_apar[idx] = cw->apar_leaf[idx];
+    cw->warm_tair[idx] = m->tair;
+    cw->warm_vpd[idx] = m->vpd;
+    cw->warm_Ca[idx] = m->Ca;
+}
+
 void calc_leaf_to_canopy_scalar(canopy_wk *cw, params *p, state *s) {
     /*
         Calculate scalar to transform beam/diffuse leaf Vcmax, Jmax and Rd values
@@ -428,20 +692,16 @@ void calc_leaf_to_canopy_scalar(canopy_wk *cw, params *p, state *s) {
 
 
 
-void calculate_emax(control *c, canopy_wk *cw, fluxes *f, met *m, params *p,
-                    state *s, double *ktot) {
+double calculate_water_supply(canopy_wk *cw, fluxes *f, params *p, state *s,
+                              double *ktot) {
 
     // Assumption that during the day transpiration cannot exceed a maximum
-    // value, Emax (e_supply). At this point we've reached a leaf water
-    // potential minimum. Once this point is reached transpiration, gs and A
-    // are reclulated
+    // value, Emax (e_supply), set by the soil-to-leaf pathway, see
+    // calculate_emax.
     //
     // Reference:
     // * Duursma et al. 2008, Tree Physiology 28, 265–276
 
-    double e_supply, e_demand, gsv, frac;
-    int    idx = cw->ileaf;
-
     // Hydraulic conductance of the entire soil-to-leaf pathway
     // (mmol m–2 s–1 MPa–1)
     *ktot = 1.0 / (f->total_soil_resist + 1.0 / cw->plant_k);
@@ -451,15 +711,34 @@ void calculate_emax(control *c, canopy_wk *cw, fluxes *f, met *m, params *p,
     // conductance of the soil-to-leaf pathway and leaf & soil water potentials.
     // Transpiration is limited in the perfectly isohydric case above the
     // critical threshold for embolism given by min_lwp.
-    e_supply = MAX(0.0, *ktot * (s->weighted_swp - p->min_lwp));
+    return (MAX(0.0, *ktot * (s->weighted_swp - p->min_lwp)));
+}
+
+void calculate_emax(canopy_wk *cw, met *m, params *p, double e_supply) {
+
+    // Once transpiration would exceed Emax (e_supply, from
+    // calculate_water_supply) we've reached a leaf water potential minimum,
+    // gs is set by the supply and An re-solved for that gs. Called every
+    // leaf temperature iteration, cw->emax_checks and cw->emax_limited count
+    // how often the limit bites.
+    //
+    // Reference:
+    // * Duursma et al. 2008, Tree Physiology 28, 265–276
+
+    double e_demand, gsv, vpd_frac;
+    int    idx = cw->ileaf;
+
+    vpd_frac = m->vpd / m->press;
 
     // Leaf transpiration (mmol m-2 s-1), i.e. ignoring boundary layer effects!
-    e_demand = MOL_2_MMOL * (m->vpd / m->press) * cw->gsc_leaf[idx] * GSVGSC;
+    e_demand = MOL_2_MMOL * vpd_frac * cw->gsc_leaf[idx] * GSVGSC;
 
+    cw->emax_checks++;
     if (e_demand > e_supply) {
+        cw->emax_limited++;
 
         // Calculate gs (mol m-2 s-1) given supply (Emax)
-        gsv = MMOL_2_MOL * e_supply / (m->vpd / m->press);
+        gsv = MMOL_2_MOL * e_supply / vpd_frac;
         cw->gsc_leaf[idx] = gsv / GSVGSC;
 
         // gs cannot be lower than minimum (cuticular conductance)
@@ -472,9 +751,8 @@ void calculate_emax(control *c, canopy_wk *cw, fluxes *f, met *m, params *p,
         cw->fwsoil_leaf[idx] = e_supply / e_demand;
         //cw->fwsoil_leaf[idx] = exp(p->g1 * s->predawn_swp);
 
-        // Re-solve An for the new gs
-        photosynthesis_C3_emax(c, cw, m, p, s, cw->apar_leaf[idx],
-                               cw->fwsoil_leaf[idx]);
+        // Re-solve An for the new gs, from this pass's photosynthesis terms
+        photosynthesis_C3_emax(cw);
 
     } else {
 
@@ -488,9 +766,8 @@ void calculate_emax(control *c, canopy_wk *cw, fluxes *f, met *m, params *p,
     // this will be 0 as gsv will have been recalculated from the supply. There
     // will only be a deficit when the soil is empty and cuticular conductance
     // has taken over.
-    cw->trans_deficit_leaf[idx] = MAX(0.0,
-                                      (m->vpd / m->press) * gsv * MOL_2_MMOL -\
-                                       e_supply);
+    cw->trans_deficit_leaf[idx] = MAX(0.0, vpd_frac * gsv * MOL_2_MMOL -
+                                           e_supply);
     return;
 }
 
@@ -523,6 +800,7 @@ void unpack_solar_geometry(canopy_wk *cw, control *c) {
     cw->cos_zenith = cw->cz_store[c->hour_idx];
     cw->elevation = cw->ele_store[c->hour_idx];
     cw->diffuse_frac = cw->df_store[c->hour_idx];
+    cw->direct_frac = 1.0 - cw->diffuse_frac;
 
     return;
 }
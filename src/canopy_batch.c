@@ -0,0 +1,340 @@
+/* ============================================================================
+* Batched canopy kernel (control.canopy_kernel = batched)
+*
+* The same coupled photosynthesis, stomatal conductance and leaf energy
+* balance as the half-hour loop in canopy.c, but solved for a whole day at
+* once. Each daytime (half-hour, leaf) pair is a lane in a canopy_lanes
+* structure of arrays and every lane is iterated to convergence together
+* under an active mask:
+*
+*   1. gather - the day's forcing and absorbed radiation into the lanes, the
+*               radiation for all the daytime half-hours at once (see
+*               canopy_radiation_lanes in radiation.c)
+*   2. solve  - photosynthesis then the energy balance across all lanes,
+*               until no lane is left iterating
+*   3. scatter - the lanes back into canopy_wk, half-hour by half-hour, for
+*               the water balance and the outputs as before
+*
+* The temperature functions (exp/pow) are called per lane, the rest of each
+* pass is branch-free arithmetic down the arrays, which gcc vectorises given
+* the flags in the Makefile (-fno-math-errno -fno-trapping-math -mavx2).
+*
+* In BUCKET mode nothing the leaves depend on changes within the day, so the
+* results are identical to the half-hour loop. The hydraulics change the
+* soil water and the leaf water potential between half-hours and always use
+* the half-hour loop.
+*
+* canopy_kernel = batched_float runs the same solver in single precision.
+* gday --compare-float runs the forcing with both and reports how far the
+* daily GPP and transpiration move, which is the check to make before using
+* it for a new site or parameter set.
+*
+* =========================================================================== */
+#include "canopy_batch.h"
+
+static void solve_in_float(control *, params *, state *, canopy_lanes *);
+static void report_difference(FILE *, const char *, double *, double *, int,
+                              long);
+
+
+void canopy_batched_day(canopy_wk *cw, control *c, fluxes *f, met_arrays *ma,
+                        met *m, nrutil *nr, params *p, state *s) {
+    /* the day's half-hours, from c->hour_idx, as canopy_half_hour would */
+    canopy_lanes    lanes;
+    radiation_lanes rad;
+    int             hod, i, j, idx, start = c->hour_idx;
+    int             first[MAX_RADIATION_LANES], hours[MAX_RADIATION_LANES];
+    double          N0, prev_N0, doy, year;
+
+    if (c->num_hlf_hrs > MAX_RADIATION_LANES) {
+        fprintf(stderr, "Batched canopy kernel handles 48 half-hours\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Gather: the daytime half-hours' sun, then their absorbed radiation */
+    rad.n = 0;
+    for (hod = 0; hod < c->num_hlf_hrs; hod++) {
+        i = start + hod;
+        first[hod] = -1;
+        if (cw->ele_store[i] > 0.0 && ma->par[i] > 20.0) {
+            j = rad.n++;
+            hours[j] = hod;
+            rad.cos_zenith[j] = cw->cz_store[i];
+            rad.diffuse_frac[j] = cw->df_store[i];
+            rad.direct_frac[j] = 1.0 - cw->df_store[i];
+            rad.par[j] = ma->par[i];
+        }
+    }
+    canopy_radiation_lanes(p, s, &rad);
+
+    /*
+        The leaf N is fixed for the day, worked out on canopy_wk and put back
+        so the night half-hours before the first daytime one see yesterday's,
+        as in the half-hour loop
+    */
+    prev_N0 = cw->N0;
+    calculate_top_of_canopy_leafn(cw, p, s);
+    N0 = cw->N0;
+    cw->N0 = prev_N0;
+
+    lanes.n = 0;
+    for (j = 0; j < rad.n; j++) {
+        hod = hours[j];
+        first[hod] = lanes.n;
+        c->hour_idx = start + hod;
+        if (c->ofp_trace != NULL)
+            write_canopy_trace_lanes(cw, c, f, ma, s, N0, hod);
+        for (idx = 0; idx < NUM_LEAVES; idx++) {
+            i = lanes.n++;
+            lanes.tair[i] = ma->tair[c->hour_idx];
+            lanes.vpd[i] = ma->vpd[c->hour_idx] * KPA_2_PA;
+            lanes.Ca[i] = ma->co2[c->hour_idx];
+            lanes.press[i] = ma->press[c->hour_idx] * KPA_2_PA;
+            lanes.wind[i] = ma->wind[c->hour_idx];
+            lanes.apar[i] = rad.apar[idx][j];
+            lanes.scalex[i] = rad.scalex[idx][j];
+            lanes.N0[i] = N0;
+        }
+    }
+    c->hour_idx = start;
+
+    solve_canopy_lanes(c, p, s, &lanes);
+
+    /* Scatter: canopy_wk ends each half-hour as the half-hour loop leaves it */
+    for (hod = 0; hod < c->num_hlf_hrs; hod++) {
+        doy = ma->doy[c->hour_idx];
+        year = ma->year[c->hour_idx];
+
+        unpack_met_data(c, f, ma, m, hod, 0.0);
+        unpack_solar_geometry(cw, c);
+
+        if (first[hod] >= 0) {
+            j = first[hod] / NUM_LEAVES;
+            cw->kb = rad.kb[j];
+            for (idx = 0; idx < NUM_LEAVES; idx++) {
+                i = first[hod] + idx;
+
+                cw->iter = lanes.iter[i];
+                cw->leaf_solves[0]++;
+                cw->leaf_passes[0] += lanes.iter[i] + 1;
+                if (lanes.stalled[i])
+                    leaf_not_converged(cw, year, doy, hod);
+
+                cw->apar_leaf[idx] = lanes.apar[i];
+                cw->lai_leaf[idx] = rad.lai_leaf[idx][j];
+                cw->scalex[idx] = lanes.scalex[i];
+                cw->N0 = lanes.N0[i];
+
+                cw->tleaf[idx] = lanes.tleaf[i];
+                cw->an_leaf[idx] = lanes.an[i];
+                cw->gsc_leaf[idx] = lanes.gsc[i];
+                if (lanes.rd_set[i])
+                    cw->rd_leaf[idx] = lanes.rd[i];
+                if (lanes.checks[i] > 0) {
+                    cw->trans_leaf[idx] = lanes.trans[i];
+                    cw->omega_leaf[idx] = lanes.omega[i];
+                    cw->rnet_leaf[idx] = lanes.rnet[i];
+                    cw->tleaf_new = lanes.tleaf_new[i];
+                }
+                cw->Cs = lanes.Cs[i];
+                cw->dleaf = lanes.dleaf[i];
+            }
+            cw->ileaf = NUM_LEAVES;
+        } else {
+            canopy_night(cw, c, m, s, hod);
+        }
+
+        canopy_finish_half_hour(cw, c, f, m, nr, p, s, hod, year, doy);
+    }
+
+    return;
+}
+
+void solve_canopy_lanes(control *c, params *p, state *s, canopy_lanes *l) {
+    /* the lanes through the solver c->canopy_kernel asks for */
+
+    if (c->canopy_kernel == CANOPY_BATCHED_FLOAT) {
+        solve_in_float(c, p, s, l);
+    } else {
+        canopy_lanes_solve(c, p, s, l);
+    }
+
+    return;
+}
+
+static void solve_in_float(control *c, params *p, state *s, canopy_lanes *l) {
+    /* the lanes through the single precision solver and back */
+    canopy_lanes_float fl;
+    int                i;
+
+    fl.n = l->n;
+    for (i = 0; i < l->n; i++) {
+        fl.tair[i] = l->tair[i];
+        fl.vpd[i] = l->vpd[i];
+        fl.Ca[i] = l->Ca[i];
+        fl.press[i] = l->press[i];
+        fl.wind[i] = l->wind[i];
+        fl.apar[i] = l->apar[i];
+        fl.scalex[i] = l->scalex[i];
+        fl.N0[i] = l->N0[i];
+    }
+
+    canopy_lanes_solve_float(c, p, s, &fl);
+
+    for (i = 0; i < l->n; i++) {
+        l->rnet[i] = fl.rnet[i];
+        l->tleaf[i] = fl.tleaf[i];
+        l->Cs[i] = fl.Cs[i];
+        l->dleaf[i] = fl.dleaf[i];
+        l->an[i] = fl.an[i];
+        l->rd[i] = fl.rd[i];
+        l->gsc[i] = fl.gsc[i];
+        l->trans[i] = fl.trans[i];
+        l->omega[i] = fl.omega[i];
+        l->tleaf_new[i] = fl.tleaf_new[i];
+        l->rd_set[i] = fl.rd_set[i];
+        l->checks[i] = fl.checks[i];
+        l->iter[i] = fl.iter[i];
+        l->stalled[i] = fl.stalled[i];
+    }
+
+    return;
+}
+
+void compare_canopy_precision(canopy_wk *cw, control *c, fluxes *f,
+                              fast_spinup *fs, met_arrays *ma, met *m,
+                              params *p, state *s, nrutil *nr) {
+    /*
+        Run the forcing with the double and the single precision kernels and
+        report the differences in the daily GPP and transpiration
+    */
+    const char     *names[2] = {"gpp", "transpiration"};
+    const int       kernels[2] = {CANOPY_BATCHED, CANOPY_BATCHED_FLOAT};
+    model_base     *base = NULL;
+    output_capture  oc;
+    double         *buf[2], secs[2];
+    int             col[2], i, k, print_options;
+    clock_t         start;
+
+    if (c->sub_daily == FALSE || c->water_balance != BUCKET) {
+        fprintf(stderr, "--compare-float needs the sub-daily BUCKET model, "
+                "the only one using the batched canopy kernel\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < 2; i++) {
+        for (col[i] = 0; col[i] < NDAILY_OUTPUTS; col[i]++) {
+            if (strcmp(daily_output_names[col[i]], names[i]) == 0)
+                break;
+        }
+        if ((buf[i] = malloc(c->total_num_days * 2 * sizeof(double))) == NULL) {
+            fprintf(stderr, "malloc failed allocating comparison outputs\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* both runs start from the same (spun-up, if -s) state */
+    print_options = c->print_options;
+    if (c->spin_up) {
+        run_model(cw, c, f, fs, ma, m, p, s, nr);
+        c->spin_up = FALSE;
+    }
+    base = save_model_base(cw, c, f, fs, p, s);
+
+    for (k = 0; k < 2; k++) {
+        restore_model_base(base, cw, c, f, fs, p, s);
+        c->canopy_kernel = kernels[k];
+        c->print_options = NONE;
+
+        oc.nout = 2;
+        oc.col = col;
+        oc.buf = buf[k];
+        oc.max_days = c->total_num_days;
+        oc.ndays = 0;
+        c->capture = &oc;
+
+        start = clock();
+        run_model(cw, c, f, fs, ma, m, p, s, nr);
+        secs[k] = (double)(clock() - start) / CLOCKS_PER_SEC;
+        c->capture = NULL;
+    }
+
+    fprintf(stdout, "canopy kernel, float against double, %ld days\n",
+            MIN(oc.ndays, oc.max_days));
+    fprintf(stdout, "%-14s %13s %13s %13s %13s\n", "", "mean",
+            "max abs diff", "mean abs diff", "max rel diff");
+    for (i = 0; i < 2; i++)
+        report_difference(stdout, names[i], buf[0], buf[1], i,
+                          MIN(oc.ndays, oc.max_days));
+    fprintf(stdout, "run time (s): double %.2f, float %.2f\n", secs[0],
+            secs[1]);
+
+    restore_model_base(base, cw, c, f, fs, p, s);
+    c->print_options = print_options;
+
+    free(buf[0]);
+    free(buf[1]);
+    free(base);
+
+    return;
+}
+
+static void report_difference(FILE *fp, const char *name, double *ref,
+                              double *val, int i, long ndays) {
+    /*
+        Differences in column i over the days where both runs are finite,
+        relative ones against the day's double value when it isn't ~zero
+    */
+    double sum = 0.0, sum_diff = 0.0, max_diff = 0.0, max_rel = 0.0, d;
+    long   j, n = 0;
+
+    for (j = 0; j < ndays; j++) {
+        if (!isfinite(ref[j*2+i]) || !isfinite(val[j*2+i]))
+            continue;
+        d = fabs(val[j*2+i] - ref[j*2+i]);
+        sum += ref[j*2+i];
+        sum_diff += d;
+        max_diff = MAX(max_diff, d);
+        if (fabs(ref[j*2+i]) > 1E-06)
+            max_rel = MAX(max_rel, d / fabs(ref[j*2+i]));
+        n++;
+    }
+
+    if (n == 0) {
+        fprintf(fp, "%-14s no finite days to compare\n", name);
+    } else {
+        fprintf(fp, "%-14s %13.4e %13.4e %13.4e %13.4e", name, sum / n,
+                max_diff, sum_diff / n, max_rel);
+        if (n < ndays)
+            fprintf(fp, " (%ld days not finite)", ndays - n);
+        fprintf(fp, "\n");
+    }
+
+    return;
+}
+
+/* the solver, in double... */
+#define REAL       double
+#define R(x)       ((double)(x))
+#define LANE_SQRT  sqrt
+#define LANES      canopy_lanes
+#define LANE_FN(f) f
+#include "canopy_lanes_solve.h"
+#undef REAL
+#undef R
+#undef LANE_SQRT
+#undef LANES
+#undef LANE_FN
+
+/* ...and in float */
+#define REAL       float
+#define R(x)       ((float)(x))
+#define LANE_SQRT  sqrtf
+#define LANES      canopy_lanes_float
+#define LANE_FN(f) f##_float
+#include "canopy_lanes_solve.h"
+#undef REAL
+#undef R
+#undef LANE_SQRT
+#undef LANES
+#undef LANE_FN
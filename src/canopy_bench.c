@@ -0,0 +1,341 @@
+/* ============================================================================
+* canopy_bench: replay a canopy trace through the leaf solves
+*
+* Set canopy_trace_fname in [files] and a sub-daily run records the inputs
+* of every daytime half-hour (see canopy_trace.c). This feeds them back
+* through the same code the model runs - canopy_leaves, or a day's lanes at
+* a time through the batched kernels - with the parameters and control
+* options of a .cfg file, so changes to the canopy can be timed on the
+* forcing a site actually sees rather than on a whole model run.
+*
+*   canopy_bench -p site.cfg [-n repeats] [--set sec.key=val] trace.bin
+*
+* The first pass over the trace counts the leaf temperature iterations, the
+* repeats after it are timed. Reported are the time per leaf solve (both
+* leaves of a half-hour, with their absorbed radiation and scaling, divided
+* by two) and histograms of the photosynthesis passes each solve took.
+*
+* NOTES:
+*   --set works as it does for gday, e.g. --set control.leaf_solver=secant
+*   to compare the solvers on the same half-hours. The kernel is the .cfg's
+*   canopy_kernel, whichever one recorded the trace, so
+*   --set control.canopy_kernel=batched_float times the float kernel on a
+*   trace from a scalar run. As in the model, the hydraulics always take the
+*   half-hour loop. The trace keeps the water balance it was written with
+*   and the .cfg must agree.
+*
+* =========================================================================== */
+#include <time.h>
+#include "gday.h"
+#include "canopy.h"
+
+/* VPD bands (kPa) the passes are broken down by */
+#define NUM_VPD_BANDS 4
+
+static void   bench_usage(char **);
+static double replay(canopy_wk *, control *, fluxes *, met *, params *,
+                     state *, canopy_trace_rec *, long, long *, long *,
+                     long *);
+static double replay_lanes(canopy_wk *, control *, fluxes *, met *, params *,
+                           state *, canopy_trace_rec *, long, long *, long *,
+                           long *);
+static void   reset_counts(canopy_wk *);
+
+
+int main(int argc, char **argv) {
+
+    control  c;
+    canopy_wk cw, counted;
+    fluxes   f;
+    met      m;
+    params   p;
+    state    s;
+    override_list *ovr = NULL;
+    canopy_trace_rec *recs = NULL;
+    FILE    *fp = NULL;
+    char    *trace_fname = NULL;
+    const char *band_names[NUM_VPD_BANDS] = {"< 1", "1-2", "2-3", ">= 3"};
+    long     nrecs = 0, max_recs = 0, nsolves, i, k;
+    long    *hist = NULL;
+    long     band_solves[NUM_VPD_BANDS], band_passes[NUM_VPD_BANDS];
+    int      repeats = 10, water_balance, r, nhist, lanes;
+    double   secs;
+    double (*pass)(canopy_wk *, control *, fluxes *, met *, params *, state *,
+                   canopy_trace_rec *, long, long *, long *, long *);
+
+    memset(&cw, 0, sizeof(canopy_wk));
+    memset(&m, 0, sizeof(met));
+    initialise_control(&c);
+    initialise_params(&p);
+    initialise_fluxes(&f);
+    initialise_state(&s);
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            snprintf(c.cfg_path, STRING_LENGTH, "%s", argv[++i]);
+            strcpy(c.cfg_fname, c.cfg_path);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            repeats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--set") == 0 && i + 1 < argc) {
+            if (ovr == NULL)
+                ovr = new_override_list();
+            parse_set_arg(ovr, argv[++i]);
+        } else if (argv[i][0] != '-' && trace_fname == NULL) {
+            trace_fname = argv[i];
+        } else {
+            bench_usage(argv);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (trace_fname == NULL || strcmp(c.cfg_path, "*NOT SET*") == 0 ||
+        repeats < 1) {
+        bench_usage(argv);
+        exit(EXIT_FAILURE);
+    }
+
+    if (parse_ini_file(&c, &p, &s) != 0) {
+        fprintf(stderr, "Error reading %s\n", c.cfg_path);
+        exit(EXIT_FAILURE);
+    }
+    fclose(c.ifp);
+    c.ifp = NULL;
+    if (ovr != NULL)
+        apply_overrides(ovr, &c, &p, &s);
+    if (check_flags(&c) > 0)
+        exit(EXIT_FAILURE);
+    if (c.sub_daily == FALSE) {
+        fprintf(stderr, "%s isn't a sub-daily model\n", c.cfg_path);
+        exit(EXIT_FAILURE);
+    }
+    derive_params(&c, &p);
+
+    fp = open_canopy_trace_read(trace_fname, &water_balance);
+    if (water_balance != c.water_balance) {
+        fprintf(stderr, "%s was written with water_balance %d, %s uses %d\n",
+                trace_fname, water_balance, c.cfg_path, c.water_balance);
+        exit(EXIT_FAILURE);
+    }
+    while (TRUE) {
+        if (nrecs == max_recs) {
+            max_recs = max_recs ? 2 * max_recs : 4096;
+            recs = realloc(recs, max_recs * sizeof(canopy_trace_rec));
+            if (recs == NULL) {
+                fprintf(stderr, "malloc failed reading the canopy trace\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (read_canopy_trace(fp, trace_fname, &recs[nrecs]) == FALSE)
+            break;
+        nrecs++;
+    }
+    fclose(fp);
+    if (nrecs == 0) {
+        fprintf(stderr, "No half-hours in %s\n", trace_fname);
+        exit(EXIT_FAILURE);
+    }
+
+    /* passes = iterations + 1, from 1 to leaf_itermax + 1, per leaf */
+    nhist = c.leaf_itermax + 1;
+    if ((hist = calloc(NUM_LEAVES * nhist, sizeof(long))) == NULL) {
+        fprintf(stderr, "malloc failed allocating the histogram\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(band_solves, 0, sizeof(band_solves));
+    memset(band_passes, 0, sizeof(band_passes));
+
+    /* the batched kernels as canopy_batched_day would use them */
+    lanes = c.canopy_kernel != CANOPY_SCALAR && c.water_balance == BUCKET;
+    pass = lanes ? replay_lanes : replay;
+
+    /* counted, untimed */
+    pass(&cw, &c, &f, &m, &p, &s, recs, nrecs, hist, band_solves,
+         band_passes);
+    counted = cw;
+    nsolves = cw.leaf_solves[0] + cw.leaf_solves[1];
+
+    secs = 0.0;
+    for (r = 0; r < repeats; r++)
+        secs += pass(&cw, &c, &f, &m, &p, &s, recs, nrecs, NULL, NULL, NULL);
+
+    printf("%s: %ld half-hours, %d timed repeats, %s kernel\n", trace_fname,
+           nrecs, repeats, !lanes ? "scalar" :
+           c.canopy_kernel == CANOPY_BATCHED_FLOAT ? "batched_float" :
+           "batched");
+    printf("%.1f ns per leaf solve, %.3f ms per pass over the trace\n",
+           secs * 1E9 / ((double)nsolves * repeats),
+           secs * 1E3 / repeats);
+    print_leaf_solves(stdout, &counted);
+    if (c.water_balance == HYDRAULICS)
+        printf("Emax limited %ld of %ld An/gs checks\n",
+               counted.emax_limited, counted.emax_checks);
+    printf("not converged in %d iterations: %d\n", c.leaf_itermax,
+           counted.nonconverged);
+
+    printf("\npasses   sunlit   shaded\n");
+    for (k = 0; k < nhist; k++) {
+        if (hist[k] + hist[nhist + k] > 0)
+            printf("%6ld %8ld %8ld\n", k + 1, hist[k], hist[nhist + k]);
+    }
+
+    printf("\nVPD (kPa)  solves  passes each\n");
+    for (k = 0; k < NUM_VPD_BANDS; k++) {
+        printf("%-9s %7ld  %.3f\n", band_names[k], band_solves[k],
+               band_solves[k] > 0 ?
+               (double)band_passes[k] / band_solves[k] : 0.0);
+    }
+
+    free(hist);
+    free(recs);
+    if (ovr != NULL)
+        free_override_list(ovr);
+
+    return (EXIT_SUCCESS);
+}
+
+static double replay(canopy_wk *cw, control *c, fluxes *f, met *m,
+                     params *p, state *s, canopy_trace_rec *recs, long nrecs,
+                     long *hist, long *band_solves, long *band_passes) {
+    /*
+        One pass over the trace, returns the CPU seconds it took. The leaf
+        counters start from zero each pass (bar nonconverged, so
+        leaf_not_converged only reports the first); hist and the bands, when
+        given, get each solve's passes. The warm start only carries over between
+        half-hours that followed on in the run, as canopy_night would have
+        cleared it otherwise.
+    */
+    clock_t start;
+    long    i;
+    int     leaf, band, nhist = c->leaf_itermax + 1;
+    double  prev_year = -1.0, prev_doy = -1.0, prev_hod = -1.0;
+
+    reset_counts(cw);
+
+    start = clock();
+    for (i = 0; i < nrecs; i++) {
+        if (recs[i].year != prev_year || recs[i].doy != prev_doy ||
+            recs[i].hod != prev_hod + 1.0) {
+            cw->warm[SUNLIT] = FALSE;
+            cw->warm[SHADED] = FALSE;
+        }
+        prev_year = recs[i].year;
+        prev_doy = recs[i].doy;
+        prev_hod = recs[i].hod;
+
+        apply_canopy_trace(&recs[i], cw, f, m, s);
+        canopy_leaves(cw, c, f, m, p, s, recs[i].year, recs[i].doy,
+                      (int)recs[i].hod);
+
+        if (hist != NULL) {
+            band = MIN(NUM_VPD_BANDS - 1,
+                       MAX(0, (int)(recs[i].vpd * PA_2_KPA)));
+            for (leaf = 0; leaf < NUM_LEAVES; leaf++) {
+                hist[leaf * nhist + cw->leaf_iter[leaf]]++;
+                band_solves[band]++;
+                band_passes[band] += cw->leaf_iter[leaf] + 1;
+            }
+        }
+    }
+
+    return ((double)(clock() - start) / CLOCKS_PER_SEC);
+}
+
+static double replay_lanes(canopy_wk *cw, control *c, fluxes *f, met *m,
+                           params *p, state *s, canopy_trace_rec *recs,
+                           long nrecs, long *hist, long *band_solves,
+                           long *band_passes) {
+    /*
+        replay for the batched kernels: each day's records are gathered into
+        the lanes, their radiation worked out together and the lanes solved
+        at once, as canopy_batched_day does in the model. Only the day's
+        first record is applied to the model state, nothing else in it
+        changes within a day in BUCKET mode.
+    */
+    static canopy_lanes lanes;
+    radiation_lanes rad;
+    clock_t start;
+    long    i, j, end;
+    int     k, leaf, lane, band, nhist = c->leaf_itermax + 1;
+
+    reset_counts(cw);
+
+    start = clock();
+    for (i = 0; i < nrecs; i = end) {
+        for (end = i + 1; end < nrecs && end - i < MAX_RADIATION_LANES &&
+             recs[end].year == recs[i].year && recs[end].doy == recs[i].doy;
+             end++)
+            ;
+        apply_canopy_trace(&recs[i], cw, f, m, s);
+
+        rad.n = 0;
+        for (j = i; j < end; j++) {
+            k = rad.n++;
+            rad.cos_zenith[k] = recs[j].cos_zenith;
+            rad.diffuse_frac[k] = recs[j].diffuse_frac;
+            rad.direct_frac[k] = 1.0 - recs[j].diffuse_frac;
+            rad.par[k] = recs[j].par;
+        }
+        canopy_radiation_lanes(p, s, &rad);
+
+        lanes.n = 0;
+        for (j = i; j < end; j++) {
+            for (leaf = 0; leaf < NUM_LEAVES; leaf++) {
+                lane = lanes.n++;
+                lanes.tair[lane] = recs[j].tair;
+                lanes.vpd[lane] = recs[j].vpd;
+                lanes.Ca[lane] = recs[j].Ca;
+                lanes.press[lane] = recs[j].press;
+                lanes.wind[lane] = recs[j].wind;
+                lanes.apar[lane] = rad.apar[leaf][j - i];
+                lanes.scalex[lane] = rad.scalex[leaf][j - i];
+                lanes.N0[lane] = recs[j].N0;
+            }
+        }
+        solve_canopy_lanes(c, p, s, &lanes);
+
+        for (j = i; j < end; j++) {
+            band = MIN(NUM_VPD_BANDS - 1,
+                       MAX(0, (int)(recs[j].vpd * PA_2_KPA)));
+            for (leaf = 0; leaf < NUM_LEAVES; leaf++) {
+                lane = (j - i) * NUM_LEAVES + leaf;
+                cw->leaf_solves[0]++;
+                cw->leaf_passes[0] += lanes.iter[lane] + 1;
+                if (lanes.stalled[lane])
+                    leaf_not_converged(cw, recs[j].year, recs[j].doy,
+                                       (int)recs[j].hod);
+                if (hist != NULL) {
+                    hist[leaf * nhist + lanes.iter[lane]]++;
+                    band_solves[band]++;
+                    band_passes[band] += lanes.iter[lane] + 1;
+                }
+            }
+        }
+    }
+
+    return ((double)(clock() - start) / CLOCKS_PER_SEC);
+}
+
+static void reset_counts(canopy_wk *cw) {
+    /* the leaf counters, bar nonconverged, from zero for a pass */
+
+    cw->emax_checks = 0;
+    cw->emax_limited = 0;
+    cw->leaf_solves[0] = cw->leaf_solves[1] = 0;
+    cw->leaf_passes[0] = cw->leaf_passes[1] = 0;
+
+    return;
+}
+
+static void bench_usage(char **argv) {
+
+    fprintf(stderr, "\nUsage: %s -p fname [options] trace\n", argv[0]);
+    fprintf(stderr, "\nReplays a canopy trace (files.canopy_trace_fname) "
+            "through the leaf solves.\n");
+    fprintf(stderr, "\n[-p       fname\t] Param file (.ini/.cfg) the trace "
+            "is replayed with.]\n");
+    fprintf(stderr, "[-n     repeats\t] Timed passes over the trace, "
+            "default 10.]\n");
+    fprintf(stderr, "[--set sec.key=val\t] Override a .cfg value, can be "
+            "repeated.]\n");
+
+    return;
+}
@@ -0,0 +1,197 @@
+/* ============================================================================
+* Canopy input trace
+*
+* Records what the leaf solves (canopy_leaves) are given for every daytime
+* half-hour of a run, so canopy_bench can replay the real forcing - drought
+* days, high VPD and all - through the canopy without running the rest of
+* the model. Written when canopy_trace_fname is set in [files].
+*
+* Layout (native byte order):
+*   char     magic[8]        "GDAYCTRC"
+*   uint32   version
+*   uint32   nfields         doubles per record
+*   uint32   water_balance   of the run that wrote it
+*   records, nfields x double each, see canopy_trace_rec
+*
+* NOTES:
+*   The batched kernels write the same records from the met arrays
+*   (write_canopy_trace_lanes), so a trace doesn't depend on the kernel that
+*   recorded it. Anything not in the record (the parameters) comes from the
+*   .cfg file the trace is replayed with.
+*
+* =========================================================================== */
+#include <stdint.h>
+#include "canopy_trace.h"
+
+static void put_canopy_trace(control *, canopy_trace_rec *);
+
+
+void open_canopy_trace(control *c) {
+    /* open c->canopy_trace_fname and write the header */
+    uint32_t version = CANOPY_TRACE_VERSION;
+    uint32_t nfields = CANOPY_TRACE_NFIELDS;
+    uint32_t water_balance = c->water_balance;
+
+    if ((c->ofp_trace = fopen(c->canopy_trace_fname, "wb")) == NULL) {
+        fprintf(stderr, "Error opening canopy trace %s for write\n",
+                c->canopy_trace_fname);
+        exit(EXIT_FAILURE);
+    }
+    fwrite(CANOPY_TRACE_MAGIC, 1, 8, c->ofp_trace);
+    fwrite(&version, sizeof(uint32_t), 1, c->ofp_trace);
+    fwrite(&nfields, sizeof(uint32_t), 1, c->ofp_trace);
+    fwrite(&water_balance, sizeof(uint32_t), 1, c->ofp_trace);
+
+    return;
+}
+
+void close_canopy_trace(control *c) {
+
+    if (c->ofp_trace == NULL)
+        return;
+
+    if (ferror(c->ofp_trace) || fclose(c->ofp_trace) != 0) {
+        fprintf(stderr, "Error writing canopy trace %s\n",
+                c->canopy_trace_fname);
+        exit(EXIT_FAILURE);
+    }
+    c->ofp_trace = NULL;
+
+    return;
+}
+
+void write_canopy_trace(canopy_wk *cw, control *c, fluxes *f, met *m,
+                        state *s, double year, double doy, int hod) {
+    /* one record, called once cw->N0 is set for the half-hour */
+    canopy_trace_rec r;
+
+    r.year = year;
+    r.doy = doy;
+    r.hod = (double)hod;
+    r.tair = m->tair;
+    r.vpd = m->vpd;
+    r.Ca = m->Ca;
+    r.press = m->press;
+    r.wind = m->wind;
+    r.par = m->par;
+    r.cos_zenith = cw->cos_zenith;
+    r.elevation = cw->elevation;
+    r.diffuse_frac = cw->diffuse_frac;
+    r.lai = s->lai;
+    r.N0 = cw->N0;
+    r.wtfac_root = s->wtfac_root;
+    r.weighted_swp = s->weighted_swp;
+    r.total_soil_resist = f->total_soil_resist;
+    r.plant_k = cw->plant_k;
+    put_canopy_trace(c, &r);
+
+    return;
+}
+
+void write_canopy_trace_lanes(canopy_wk *cw, control *c, fluxes *f,
+                              met_arrays *ma, state *s, double N0, int hod) {
+    /*
+        The record write_canopy_trace would give the half-hour at
+        c->hour_idx, for the batched kernel, which doesn't unpack the met or
+        set cw->N0 until it scatters the lanes back
+    */
+    canopy_trace_rec r;
+    int i = c->hour_idx;
+
+    r.year = ma->year[i];
+    r.doy = ma->doy[i];
+    r.hod = (double)hod;
+    r.tair = ma->tair[i];
+    r.vpd = ma->vpd[i] * KPA_2_PA;
+    r.Ca = ma->co2[i];
+    r.press = ma->press[i] * KPA_2_PA;
+    r.wind = ma->wind[i];
+    r.par = ma->par[i];
+    r.cos_zenith = cw->cz_store[i];
+    r.elevation = cw->ele_store[i];
+    r.diffuse_frac = cw->df_store[i];
+    r.lai = s->lai;
+    r.N0 = N0;
+    r.wtfac_root = s->wtfac_root;
+    r.weighted_swp = s->weighted_swp;
+    r.total_soil_resist = f->total_soil_resist;
+    r.plant_k = cw->plant_k;
+    put_canopy_trace(c, &r);
+
+    return;
+}
+
+static void put_canopy_trace(control *c, canopy_trace_rec *r) {
+
+    fwrite(r, sizeof(double), CANOPY_TRACE_NFIELDS, c->ofp_trace);
+
+    return;
+}
+
+FILE *open_canopy_trace_read(const char *fname, int *water_balance) {
+    /*
+        Open a trace and check its header, returns the file positioned at
+        the first record and the water balance it was written with
+    */
+    FILE    *fp = NULL;
+    char     magic[8];
+    uint32_t hdr[3];
+
+    if ((fp = fopen(fname, "rb")) == NULL) {
+        fprintf(stderr, "Error opening canopy trace %s\n", fname);
+        exit(EXIT_FAILURE);
+    }
+    if (fread(magic, 1, 8, fp) != 8 ||
+        memcmp(magic, CANOPY_TRACE_MAGIC, 8) != 0 ||
+        fread(hdr, sizeof(uint32_t), 3, fp) != 3) {
+        fprintf(stderr, "%s isn't a canopy trace\n", fname);
+        exit(EXIT_FAILURE);
+    }
+    if (hdr[0] != CANOPY_TRACE_VERSION || hdr[1] != CANOPY_TRACE_NFIELDS) {
+        fprintf(stderr, "Canopy trace %s is version %u with %u fields, "
+                "expected version %d with %d\n", fname, hdr[0], hdr[1],
+                CANOPY_TRACE_VERSION, (int)CANOPY_TRACE_NFIELDS);
+        exit(EXIT_FAILURE);
+    }
+    *water_balance = (int)hdr[2];
+
+    return (fp);
+}
+
+int read_canopy_trace(FILE *fp, const char *fname, canopy_trace_rec *r) {
+    /* the next record, FALSE at the end of the trace */
+    size_t n = fread(r, sizeof(double), CANOPY_TRACE_NFIELDS, fp);
+
+    if (n == 0 && feof(fp))
+        return (FALSE);
+    if (n != CANOPY_TRACE_NFIELDS) {
+        fprintf(stderr, "Truncated canopy trace %s\n", fname);
+        exit(EXIT_FAILURE);
+    }
+
+    return (TRUE);
+}
+
+void apply_canopy_trace(canopy_trace_rec *r, canopy_wk *cw, fluxes *f,
+                        met *m, state *s) {
+    /* put a record back where canopy_leaves expects to find it */
+
+    m->tair = r->tair;
+    m->vpd = r->vpd;
+    m->Ca = r->Ca;
+    m->press = r->press;
+    m->wind = r->wind;
+    m->par = r->par;
+    cw->cos_zenith = r->cos_zenith;
+    cw->elevation = r->elevation;
+    cw->diffuse_frac = r->diffuse_frac;
+    cw->direct_frac = 1.0 - r->diffuse_frac;
+    s->lai = r->lai;
+    cw->N0 = r->N0;
+    s->wtfac_root = r->wtfac_root;
+    s->weighted_swp = r->weighted_swp;
+    f->total_soil_resist = r->total_soil_resist;
+    cw->plant_k = r->plant_k;
+
+    return;
+}
@@ -0,0 +1,475 @@
+/* ============================================================================
+* Pre-flight validation of the inputs (--check)
+*
+* gday --check -p fname.cfg reads the .cfg file (plus any --set overrides and
+* state snapshot) and reports everything it can find wrong with it, without
+* loading the forcing or running anything:
+*
+*   - keys the registry doesn't know, which a normal run silently ignores.
+*     Only a warning, as the shipped .cfg files still carry keys (e.g.
+*     bretrans, kext) which this version of the code doesn't read
+*   - values outside their physical range, and inconsistent pairs of them
+*   - combinations of flags the model can't run
+*   - input files that can't be read, output directories that can't be written
+*   - a met file that doesn't match the cfg, i.e. the wrong number of columns
+*     for the time step, or years which don't hold 365/366 days (x 48 for
+*     sub-daily runs) or don't follow on from one another
+*
+* Everything goes to stderr, and the exit status is non-zero if there were any
+* problems (warnings don't count), so batch jobs can be screened before they
+* are queued.
+*
+* NOTES:
+*   The ranges are deliberately loose, they catch typos and unit mix-ups
+*   rather than judge the calibration. Values < -900 are "not set" and
+*   skipped.
+*
+* =========================================================================== */
+#include "check_config.h"
+
+static const param_range ranges[] = {
+    {"params.albedo",            RANGE_FRACTION, 0.0, 0.0},
+    {"params.alpha_c4",          RANGE_FRACTION, 0.0, 0.0},
+    {"params.alpha_j",           RANGE_FRACTION, 0.0, 0.0},
+    {"params.c_alloc_bmax",      RANGE_FRACTION, 0.0, 0.0},
+    {"params.c_alloc_bmin",      RANGE_FRACTION, 0.0, 0.0},
+    {"params.c_alloc_cmax",      RANGE_FRACTION, 0.0, 0.0},
+    {"params.c_alloc_fmax",      RANGE_FRACTION, 0.0, 0.0},
+    {"params.c_alloc_fmin",      RANGE_FRACTION, 0.0, 0.0},
+    {"params.c_alloc_rmax",      RANGE_FRACTION, 0.0, 0.0},
+    {"params.c_alloc_rmin",      RANGE_FRACTION, 0.0, 0.0},
+    {"params.cfracts",           RANGE_FRACTION, 0.0, 0.0},
+    {"params.cretrans",          RANGE_FRACTION, 0.0, 0.0},
+    {"params.cue",               RANGE_FRACTION, 0.0, 0.0},
+    {"params.direct_frac",       RANGE_FRACTION, 0.0, 0.0},
+    {"params.fhw",               RANGE_FRACTION, 0.0, 0.0},
+    {"params.finesoil",          RANGE_FRACTION, 0.0, 0.0},
+    {"params.fracteaten",        RANGE_FRACTION, 0.0, 0.0},
+    {"params.fractup_soil",      RANGE_FRACTION, 0.0, 0.0},
+    {"params.fretrans",          RANGE_FRACTION, 0.0, 0.0},
+    {"params.growth_efficiency", RANGE_FRACTION, 0.0, 0.0},
+    {"params.intercep_frac",     RANGE_FRACTION, 0.0, 0.0},
+    {"params.ligroot",           RANGE_FRACTION, 0.0, 0.0},
+    {"params.ligshoot",          RANGE_FRACTION, 0.0, 0.0},
+    {"params.root_exu_CUE",      RANGE_FRACTION, 0.0, 0.0},
+    {"params.rretrans",          RANGE_FRACTION, 0.0, 0.0},
+    {"params.theta",             RANGE_FRACTION, 0.0, 0.0},
+    {"params.wretrans",          RANGE_FRACTION, 0.0, 0.0},
+    {"params.bdecay",            RANGE_NONNEG,   0.0, 0.0},
+    {"params.crdecay",           RANGE_NONNEG,   0.0, 0.0},
+    {"params.fdecay",            RANGE_NONNEG,   0.0, 0.0},
+    {"params.fdecaydry",         RANGE_NONNEG,   0.0, 0.0},
+    {"params.gs_min",            RANGE_NONNEG,   0.0, 0.0},
+    {"params.kdec1",             RANGE_NONNEG,   0.0, 0.0},
+    {"params.kdec2",             RANGE_NONNEG,   0.0, 0.0},
+    {"params.kdec3",             RANGE_NONNEG,   0.0, 0.0},
+    {"params.kdec4",             RANGE_NONNEG,   0.0, 0.0},
+    {"params.kdec5",             RANGE_NONNEG,   0.0, 0.0},
+    {"params.kdec6",             RANGE_NONNEG,   0.0, 0.0},
+    {"params.kdec7",             RANGE_NONNEG,   0.0, 0.0},
+    {"params.kn",                RANGE_NONNEG,   0.0, 0.0},
+    {"params.nmax",              RANGE_NONNEG,   0.0, 0.0},
+    {"params.nuptakez",          RANGE_NONNEG,   0.0, 0.0},
+    {"params.rateloss",          RANGE_NONNEG,   0.0, 0.0},
+    {"params.rateuptake",        RANGE_NONNEG,   0.0, 0.0},
+    {"params.rdecay",            RANGE_NONNEG,   0.0, 0.0},
+    {"params.rdecaydry",         RANGE_NONNEG,   0.0, 0.0},
+    {"params.retransmob",        RANGE_NONNEG,   0.0, 0.0},
+    {"params.sapturnover",       RANGE_NONNEG,   0.0, 0.0},
+    {"params.wdecay",            RANGE_NONNEG,   0.0, 0.0},
+    {"params.density",           RANGE_POSITIVE, 0.0, 0.0},
+    {"params.g1",                RANGE_POSITIVE, 0.0, 0.0},
+    {"params.kc25",              RANGE_POSITIVE, 0.0, 0.0},
+    {"params.ko25",              RANGE_POSITIVE, 0.0, 0.0},
+    {"params.oi",                RANGE_POSITIVE, 0.0, 0.0},
+    {"params.rooting_depth",     RANGE_POSITIVE, 0.0, 0.0},
+    {"params.sla",               RANGE_POSITIVE, 0.0, 0.0},
+    {"params.soil_layers",       RANGE_POSITIVE, 0.0, 0.0},
+    {"params.topsoil_depth",     RANGE_POSITIVE, 0.0, 0.0},
+    {"params.disturbance_doy",   RANGE_BETWEEN,  1.0, 366.0},
+    {"params.lad",               RANGE_BETWEEN, -1.0, 1.0},
+    {"params.latitude",          RANGE_BETWEEN, -90.0, 90.0},
+    {"params.longitude",         RANGE_BETWEEN, -180.0, 360.0},
+    {NULL,                       0,              0.0, 0.0}
+};
+
+/* soil types get_soil_fracs knows about */
+static const char *soil_types[] = {
+    "sand", "loamy_sand", "sandy_loam", "loam", "silty_loam",
+    "sandy_clay_loam", "clay_loam", "silty_clay_loam", "sandy_clay",
+    "silty_clay", "clay", NULL
+};
+
+static int  problem(const char *, ...);
+static void check_files(control *);
+static void check_outputs(control *);
+static void check_ranges(control *, params *, state *);
+static void check_soils(control *, params *);
+static void check_met(control *);
+static void check_met_year(control *, int, int, int);
+static void check_readable(control *, const char *, const char *);
+static void check_writable(control *, const char *, const char *);
+static double field_value(const reg_field *, control *, params *, state *);
+
+
+int check_config(control *c, params *p, state *s) {
+    /*
+        Run every check on the parsed .cfg file, returns the number of
+        problems found (including those parse_ini_file counted)
+    */
+    int nerrors;
+
+    /* --set may name the files */
+    if (c->ovr != NULL)
+        apply_overrides(c->ovr, c, p, s);
+    check_files(c);
+
+    /* judge the values the run would start from, where --set still beats
+       the snapshot */
+    if (strcmp(c->init_state_fname, "*NOT SET*") != 0 &&
+        access(c->init_state_fname, R_OK) == 0) {
+        read_state_snapshot(c, p, s);
+        if (c->ovr != NULL) {
+            nerrors = c->check_errors;      /* already counted */
+            apply_overrides(c->ovr, c, p, s);
+            c->check_errors = nerrors;
+        }
+    }
+
+    c->check_errors += check_flags(c);
+    check_outputs(c);
+    check_ranges(c, p, s);
+    check_soils(c, p);
+    check_met(c);
+
+    if (c->temp_tables && c->sub_daily) {
+        build_temp_tables(c, p, &p->derived.tt);
+        print_temp_table_errors(stderr, &p->derived.tt);
+    }
+
+    fprintf(stderr, "%s: %d problem%s, %d warning%s\n", c->cfg_path,
+            c->check_errors, c->check_errors == 1 ? "" : "s",
+            c->check_warnings, c->check_warnings == 1 ? "" : "s");
+
+    return (c->check_errors);
+}
+
+int check_flags(control *c) {
+    /*
+        Combinations of flags the model can't run, returns how many there
+        are. Called before a run too, so it fails before the forcing is
+        loaded rather than part way through.
+    */
+    int n = 0;
+
+    if (c->water_balance == HYDRAULICS && c->sub_daily == FALSE)
+        n += problem("You can't run the hydraulics model with daily flag");
+    if (c->ps_pathway == C4 && c->sub_daily)
+        n += problem("C4 photosynthesis isn't implemented for the "
+                     "sub-daily canopy");
+    if (c->output_format == NCEAS &&
+        (c->sub_daily || c->output_ascii == FALSE))
+        n += problem("NCEAS output needs a daily time step and ascii "
+                     "output");
+    if ((c->output_format == ARROW || c->output_format == NETCDF) &&
+        c->print_options != DAILY && c->spin_up == FALSE)
+        n += problem("Arrow/NetCDF output is only implemented for daily "
+                     "prints");
+    if (c->output_format == NETCDF && netcdf_available() == FALSE)
+        n += problem("NetCDF output not compiled in, rebuild with "
+                     "-DHAVE_NETCDF");
+    if (c->output_format == NETCDF &&
+        (c->netcdf_site < 0 || c->netcdf_site >= c->netcdf_nsites))
+        n += problem("netcdf_site must be between 0 and netcdf_nsites - 1");
+    if (c->output_format == NETCDF && c->netcdf_chunk_days < 1)
+        n += problem("netcdf_chunk_days must be at least 1");
+    if (c->temp_tables && !(c->temp_table_step >= TEMP_TABLE_MIN_STEP &&
+                            c->temp_table_step <= 10.0))
+        n += problem("temp_table_step must be between %g and 10 deg C",
+                     TEMP_TABLE_MIN_STEP);
+    if (c->warm_start && c->canopy_kernel != CANOPY_SCALAR &&
+        c->water_balance == BUCKET)
+        n += problem("warm_start needs the half-hour loop, the batched "
+                     "canopy kernel solves the half-hours together");
+    if (strcmp(c->canopy_trace_fname, "*NOT SET*") != 0 &&
+        c->sub_daily == FALSE)
+        n += problem("canopy_trace_fname needs the sub-daily model");
+    if (c->sub_daily && c->leaf_itermax < 1)
+        n += problem("leaf_itermax must be at least 1");
+
+    return (n);
+}
+
+static int problem(const char *fmt, ...) {
+    /* one line per problem, returns 1 so callers can count them */
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+
+    return (1);
+}
+
+static void check_files(control *c) {
+    /* the inputs the run would open */
+
+    check_readable(c, "met file", c->met_fname);
+    if (strcmp(c->init_state_fname, "*NOT SET*") != 0)
+        check_readable(c, "state snapshot", c->init_state_fname);
+    if (strcmp(c->overrides_fname, "*NOT SET*") != 0)
+        check_readable(c, "overrides file", c->overrides_fname);
+    if (strcmp(c->sweep_fname, "*NOT SET*") != 0)
+        check_readable(c, "sweep file", c->sweep_fname);
+    if (strcmp(c->branches_fname, "*NOT SET*") != 0)
+        check_readable(c, "branches file", c->branches_fname);
+    if (strcmp(c->experiment_fname, "*NOT SET*") != 0)
+        check_readable(c, "experiment file", c->experiment_fname);
+
+    return;
+}
+
+static void check_outputs(control *c) {
+    /* the outputs open_run_outputs/write_final_state would create */
+
+    if (c->spin_up == FALSE &&
+        (c->print_options == DAILY || c->print_options == SUBDAILY)) {
+        check_writable(c, "out_fname", c->out_fname);
+        if (c->output_ascii == FALSE)
+            check_writable(c, "out_fname_hdr", c->out_fname_hdr);
+    }
+    if (c->spin_up == FALSE && c->print_options == SUBDAILY) {
+        check_writable(c, "out_subdaily_fname", c->out_subdaily_fname);
+        if (c->output_ascii == FALSE)
+            check_writable(c, "out_subdaily_fname_hdr",
+                           c->out_subdaily_fname_hdr);
+    }
+    if (c->spin_up || c->print_options == END)
+        check_writable(c, "out_param_fname", c->out_param_fname);
+    if (strcmp(c->out_state_fname, "*NOT SET*") != 0)
+        check_writable(c, "out_state_fname", c->out_state_fname);
+    if (c->spin_up == FALSE &&
+        strcmp(c->canopy_trace_fname, "*NOT SET*") != 0)
+        check_writable(c, "canopy_trace_fname", c->canopy_trace_fname);
+
+    return;
+}
+
+static void check_readable(control *c, const char *what, const char *fname) {
+
+    if (access(fname, R_OK) != 0)
+        c->check_errors += problem("Can't read %s %s", what, fname);
+
+    return;
+}
+
+static void check_writable(control *c, const char *what, const char *fname) {
+    /* the file needn't exist, but its directory must */
+    char  dir[STRING_LENGTH];
+    char *slash = NULL;
+
+    strncpy0(dir, (char *)fname, sizeof(dir));
+    if ((slash = strrchr(dir, '/')) == NULL)
+        strcpy(dir, ".");
+    else if (slash == dir)
+        slash[1] = '\0';
+    else
+        *slash = '\0';
+
+    if (access(dir, W_OK) != 0)
+        c->check_errors += problem("Can't write %s %s, directory %s "
+                                   "missing or read-only", what, fname, dir);
+
+    return;
+}
+
+static double field_value(const reg_field *fld, control *c, params *p,
+                          state *s) {
+    void *ptr = registry_ptr(fld, c, p, s);
+
+    if (fld->type == REG_DOUBLE)
+        return (*(double *)ptr);
+    return ((double)*(int *)ptr);
+}
+
+static void check_ranges(control *c, params *p, state *s) {
+    /* the ranges table, the state pools and a few pairs of params */
+    const param_range *r = NULL;
+    const reg_field   *fld = NULL;
+    double             value;
+    int                i, bad;
+
+    for (r = ranges; r->key != NULL; r++) {
+        if ((fld = registry_lookup_key(r->key)) == NULL) {
+            /* a stale entry in the table above, not the user's fault */
+            fprintf(stderr, "check_config: no such key %s\n", r->key);
+            continue;
+        }
+        value = field_value(fld, c, p, s);
+        if (value < -900.0)
+            continue;
+
+        switch (r->kind) {
+        case RANGE_FRACTION:
+            if ((bad = (value < 0.0 || value > 1.0)))
+                problem("%s = %g, should be between 0 and 1", r->key,
+                        value);
+            break;
+        case RANGE_NONNEG:
+            if ((bad = (value < 0.0)))
+                problem("%s = %g, can't be negative", r->key, value);
+            break;
+        case RANGE_POSITIVE:
+            if ((bad = (value <= 0.0)))
+                problem("%s = %g, should be > 0", r->key, value);
+            break;
+        default:
+            if ((bad = (value < r->lo || value > r->hi)))
+                problem("%s = %g, should be between %g and %g", r->key,
+                        value, r->lo, r->hi);
+            break;
+        }
+        c->check_errors += bad;
+    }
+
+    /* pools, amounts and ages can't be negative */
+    for (i = 0; i < registry_nfields(); i++) {
+        fld = registry_field(i);
+        if (fld->section != REG_STATE || fld->type != REG_DOUBLE)
+            continue;
+        value = field_value(fld, c, p, s);
+        if (value < 0.0 && value > -900.0)
+            c->check_errors += problem("state.%s = %g, can't be negative",
+                                       fld->name, value);
+    }
+
+    if (p->c_alloc_fmin > p->c_alloc_fmax)
+        c->check_errors += problem("params.c_alloc_fmin > c_alloc_fmax");
+    if (p->c_alloc_rmin > p->c_alloc_rmax)
+        c->check_errors += problem("params.c_alloc_rmin > c_alloc_rmax");
+    if (p->c_alloc_bmin > p->c_alloc_bmax)
+        c->check_errors += problem("params.c_alloc_bmin > c_alloc_bmax");
+    if (p->topsoil_depth > p->rooting_depth)
+        c->check_errors += problem("params.topsoil_depth (%g) is deeper "
+                                   "than rooting_depth (%g)",
+                                   p->topsoil_depth, p->rooting_depth);
+
+    return;
+}
+
+static void check_soils(control *c, params *p) {
+    /* soil types, or the soil water params if they are given instead */
+    const char **t = NULL;
+    int          need_types, top_ok = FALSE, root_ok = FALSE;
+
+    need_types = c->calc_sw_params || c->water_balance == HYDRAULICS ||
+                 p->ctheta_topsoil < -900.0;
+    if (need_types) {
+        for (t = soil_types; *t != NULL; t++) {
+            top_ok |= strcmp(p->topsoil_type, *t) == 0;
+            root_ok |= strcmp(p->rootsoil_type, *t) == 0;
+        }
+        if (!top_ok)
+            c->check_errors += problem("Unknown params.topsoil_type %s",
+                                       p->topsoil_type);
+        if (!root_ok)
+            c->check_errors += problem("Unknown params.rootsoil_type %s",
+                                       p->rootsoil_type);
+    }
+
+    if (c->calc_sw_params == FALSE) {
+        if (p->theta_wp_topsoil > -900.0 &&
+            !(p->theta_wp_topsoil < p->theta_fc_topsoil &&
+              p->theta_fc_topsoil <= p->theta_sp_topsoil))
+            c->check_errors += problem("params.theta_wp_topsoil < "
+                                       "theta_fc_topsoil <= theta_sp_topsoil "
+                                       "doesn't hold");
+        if (p->theta_wp_root > -900.0 &&
+            !(p->theta_wp_root < p->theta_fc_root &&
+              p->theta_fc_root <= p->theta_sp_root))
+            c->check_errors += problem("params.theta_wp_root < "
+                                       "theta_fc_root <= theta_sp_root "
+                                       "doesn't hold");
+    }
+
+    return;
+}
+
+static void check_met(control *c) {
+    /*
+        Scan the met file the way read_daily_met_data/read_subdaily_met_data
+        would read it, without storing anything
+    */
+    FILE  *fp = NULL;
+    char   line[STRING_LENGTH];
+    char  *ch = NULL;
+    int    ncols, nvars = c->sub_daily ? 13 : 21;
+    int    steps = c->sub_daily ? c->num_hlf_hrs : 1;
+    int    year, first_year = 0, prev_year = 0, nrecs = 0, nyears = 0;
+    int    lineno = 0;
+
+    if ((fp = fopen(c->met_fname, "r")) == NULL)
+        return;     /* check_files has already said so */
+
+    while (fgets(line, STRING_LENGTH, fp) != NULL) {
+        lineno++;
+        if (*line == '#')
+            continue;
+
+        if (nyears == 0) {
+            /* the time step must match the cfg */
+            for (ncols = 1, ch = line; *ch != '\0'; ch++)
+                ncols += (*ch == ',');
+            if (ncols != nvars) {
+                c->check_errors += problem("Met file %s has %d columns, a %s "
+                                           "run expects %d", c->met_fname,
+                                           ncols, c->sub_daily ? "sub-daily" :
+                                           "daily", nvars);
+                fclose(fp);
+                return;
+            }
+        }
+
+        year = (int)atof(line);
+        if (nyears == 0 || year != prev_year) {
+            if (nyears > 0) {
+                check_met_year(c, prev_year, nrecs, steps);
+                if (year != prev_year + 1)
+                    c->check_errors += problem("Met file %s line %d: %d "
+                                               "doesn't follow on from %d",
+                                               c->met_fname, lineno, year,
+                                               prev_year);
+            } else {
+                first_year = year;
+            }
+            prev_year = year;
+            nrecs = 0;
+            nyears++;
+        }
+        nrecs++;
+    }
+    fclose(fp);
+
+    if (nyears == 0) {
+        c->check_errors += problem("Met file %s holds no data", c->met_fname);
+    } else {
+        check_met_year(c, prev_year, nrecs, steps);
+        fprintf(stderr, "%s: %d years, %d-%d\n", c->met_fname, nyears,
+                first_year, prev_year);
+    }
+
+    return;
+}
+
+static void check_met_year(control *c, int year, int nrecs, int steps) {
+    /* run_sim steps through 365/366 days, whatever the file holds */
+    int expected = (is_leap_year(year) ? 366 : 365) * steps;
+
+    if (nrecs != expected)
+        c->check_errors += problem("Met file %s: %d has %d records, the "
+                                   "model steps through %d", c->met_fname,
+                                   year, nrecs, expected);
+
+    return;
+}
@@ -0,0 +1,85 @@
+/* ============================================================================
+* Derived parameters
+*
+* Quantities which only depend on the params (and control flags), worked out
+* once per parameter set before a run rather than at the start of every
+* run_sim call:
+*
+*   - the rate constants per day, the .cfg file gives them per year. These
+*     used to be divided in place at the start of run_sim and multiplied back
+*     at the end, which drifted over the thousands of spin-up cycles.
+*   - the soil texture fractions and the soil water params derived from them
+*     (Cosby et al. 1984; Landsberg and Waring 1997), unless they are given.
+*   - the leaf temperature response tables, when control.temp_tables is set
+*     (see temp_tables.c).
+*
+* The params the run reads are then left alone, apart from the handful the
+* model updates itself (e.g. previous_ncd). Anything that sets a param through
+* the registry clears p->derived.valid so they are worked out again.
+*
+* =========================================================================== */
+#include "derived_params.h"
+
+
+void derive_params(control *c, params *p) {
+    derived_params *d = &p->derived;
+
+    d->rateuptake = p->rateuptake / NDAYS_IN_YR;
+    d->rateloss = p->rateloss / NDAYS_IN_YR;
+    d->retransmob = p->retransmob / NDAYS_IN_YR;
+    d->fdecay = p->fdecay / NDAYS_IN_YR;
+    d->fdecaydry = p->fdecaydry / NDAYS_IN_YR;
+    d->crdecay = p->crdecay / NDAYS_IN_YR;
+    d->rdecay = p->rdecay / NDAYS_IN_YR;
+    d->rdecaydry = p->rdecaydry / NDAYS_IN_YR;
+    d->bdecay = p->bdecay / NDAYS_IN_YR;
+    d->wdecay = p->wdecay / NDAYS_IN_YR;
+    d->sapturnover = p->sapturnover / NDAYS_IN_YR;
+    d->kdec1 = p->kdec1 / NDAYS_IN_YR;
+    d->kdec2 = p->kdec2 / NDAYS_IN_YR;
+    d->kdec3 = p->kdec3 / NDAYS_IN_YR;
+    d->kdec4 = p->kdec4 / NDAYS_IN_YR;
+    d->kdec5 = p->kdec5 / NDAYS_IN_YR;
+    d->kdec6 = p->kdec6 / NDAYS_IN_YR;
+    d->kdec7 = p->kdec7 / NDAYS_IN_YR;
+    d->nuptakez = p->nuptakez / NDAYS_IN_YR;
+    d->nmax = p->nmax / NDAYS_IN_YR;
+
+    /* site params not known, so derive them based on Cosby et al */
+    if (c->calc_sw_params || c->water_balance == HYDRAULICS) {
+        get_soil_fracs(p->topsoil_type, d->fsoil_top);
+        get_soil_fracs(p->rootsoil_type, d->fsoil_root);
+    }
+
+    if (c->calc_sw_params) {
+        /* top soil */
+        calc_soil_params(d->fsoil_top, &p->theta_fc_topsoil,
+                         &p->theta_wp_topsoil, &p->theta_sp_topsoil,
+                         &p->b_topsoil, &p->psi_sat_topsoil);
+
+        /* Plant available water in top soil (mm) */
+        p->wcapac_topsoil = p->topsoil_depth  *\
+                            (p->theta_fc_topsoil - p->theta_wp_topsoil);
+        /* Root zone */
+        calc_soil_params(d->fsoil_root, &p->theta_fc_root, &p->theta_wp_root,
+                         &p->theta_sp_root, &p->b_root, &p->psi_sat_root);
+
+        /* Plant available water in rooting zone (mm) */
+        p->wcapac_root = p->rooting_depth * \
+                            (p->theta_fc_root - p->theta_wp_root);
+    }
+
+    /* calculate Landsberg and Waring SW modifier parameters if not
+       specified by the user based on a site calibration */
+    if (p->ctheta_topsoil < -900.0 && p->ntheta_topsoil  < -900.0 &&
+        p->ctheta_root < -900.0 && p->ntheta_root < -900.0) {
+        get_soil_params(p->topsoil_type, &p->ctheta_topsoil, &p->ntheta_topsoil);
+        get_soil_params(p->rootsoil_type, &p->ctheta_root, &p->ntheta_root);
+    }
+
+    build_temp_tables(c, p, &d->tt);
+
+    d->valid = TRUE;
+
+    return;
+}
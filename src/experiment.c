@@ -0,0 +1,260 @@
+/* ============================================================================
+* Multi-phase experiments
+*
+* gday -p base.cfg --experiment duke.ini
+*
+* runs a list of phases back to back, e.g. spin-up, the industrial period and
+* then the experiment itself, handing the state from one phase to the next in
+* memory rather than through a written .cfg file and a new gday process
+*
+*   [spinup]
+*   spin_up = true
+*   files.met_fname = met_data/DUKE_met_data_equilibrium_50_yrs.csv
+*   files.out_param_fname = params/duke_spunup.cfg
+*   control.spinup_method = brute
+*   forcing.co2 = 285.0
+*   state.shoot = 0.001
+*
+*   [industrial]
+*   files.met_fname = met_data/DUKE_met_data_industrial_to_present.csv
+*   params.sla = 4.4
+*
+*   [experiment]
+*   files.met_fname = met_data/DUKE_met_data_amb_co2.csv
+*   files.out_fname = outputs/duke_amb.csv
+*   control.print_options = daily
+*
+* A section per phase, run in the order listed. Each phase starts from the
+* param file with the overrides (section.key, as for --set) of all earlier
+* phases applied, the state variables handed over from the end of the previous
+* phase and then its own overrides on top, i.e. the same as writing the final
+* state to a .cfg file and running from that. The forcing is the phase's met
+* file, with any forcing.* changes (see branches.c) applied over the whole
+* phase, and the outputs are set with the usual files.* and
+* control.print_options keys.
+*
+* NOTES:
+*   The handed over state isn't rounded by being written out as text, so
+*   results can differ from a chain of gday runs in the last few digits.
+*
+* =========================================================================== */
+#include "experiment.h"
+
+static void read_experiment_file(const char *, experiment *);
+static void new_phase(experiment *, const char *);
+static void carry_state(model_base *, control *, params *, state *);
+static int  changes_forcing(forcing_view *);
+static void free_experiment(experiment *);
+
+
+void run_experiment(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
+                    met_arrays *ma, met *m, params *p, state *s, nrutil *nr) {
+    /*
+        Run the phases in c->experiment_fname one after another
+    */
+    experiment    *expt = NULL;
+    phase         *ph = NULL;
+    model_base    *base = NULL, *last = NULL;
+    override_list *ol = NULL;
+    control        loaded;
+    char          *prog[] = {"gday", NULL};
+    int            i, j, modified = FALSE;
+
+    if ((expt = calloc(1, sizeof(experiment))) == NULL) {
+        fprintf(stderr, "malloc failed allocating experiment\n");
+        exit(EXIT_FAILURE);
+    }
+    read_experiment_file(c->experiment_fname, expt);
+
+    base = save_model_base(cw, c, f, fs, p, s);
+
+    /* overrides of every phase so far, --set values first */
+    ol = copy_override_list(c->ovr);
+
+    /* the met data main read, kept while the phases share it */
+    loaded = *c;
+
+    for (i = 0; i < expt->nphases; i++) {
+        ph = &expt->items[i];
+        fprintf(stderr, "Phase %s\n", ph->name);
+
+        restore_model_base(base, cw, c, f, fs, p, s);
+        apply_overrides(ol, c, p, s);
+        if (last != NULL)
+            carry_state(last, c, p, s);
+        apply_overrides(ph->ol, c, p, s);
+        for (j = 0; j < ph->ol->num; j++)
+            add_override(ol, ph->ol->items[j].fld, ph->ol->items[j].value);
+        c->ovr = ol;
+        c->spin_up = ph->spin_up;
+        if (strcmp(ph->fv.met_fname, "*NOT SET*") != 0)
+            strcpy(c->met_fname, ph->fv.met_fname);
+
+        if (modified || c->sub_daily != loaded.sub_daily ||
+            strcmp(c->met_fname, loaded.met_fname) != 0) {
+            free_met_data(&loaded, ma);
+            if (c->sub_daily)
+                read_subdaily_met_data(prog, c, ma);
+            else
+                read_daily_met_data(prog, c, ma);
+            loaded = *c;
+        } else {
+            c->num_years = loaded.num_years;
+            c->total_num_days = loaded.total_num_days;
+        }
+        adjust_forcing(ma, 0, c->sub_daily ? c->total_num_days * 48 :
+                       c->total_num_days, &ph->fv);
+        modified = changes_forcing(&ph->fv);
+
+        run_model(cw, c, f, fs, ma, m, p, s, nr);
+
+        free(last);
+        last = save_model_base(cw, c, f, fs, p, s);
+    }
+
+    /* leave things as main set them up, bar the met data it has to free */
+    restore_model_base(base, cw, c, f, fs, p, s);
+    c->sub_daily = loaded.sub_daily;
+    strcpy(c->met_fname, loaded.met_fname);
+
+    free_override_list(ol);
+    free(last);
+    free(base);
+    free_experiment(expt);
+
+    return;
+}
+
+static void carry_state(model_base *last, control *c, params *p, state *s) {
+    /*
+        The variables a final state .cfg file would hold (RESTART in
+        param_fields.h), as the previous phase left them
+    */
+    const reg_field *fld = NULL;
+    int              i;
+
+    for (i = 0; i < registry_nfields(); i++) {
+        fld = registry_field(i);
+        if (fld->flags & REG_RESTART)
+            memcpy(registry_ptr(fld, c, p, s),
+                   registry_ptr(fld, &last->c, &last->p, &last->s),
+                   fld->size);
+    }
+
+    return;
+}
+
+static int changes_forcing(forcing_view *fv) {
+    return (fv->co2 >= 0.0 || fv->co2_add != 0.0 || fv->rain_scale != 1.0 ||
+            fv->ndep_add != 0.0);
+}
+
+static void read_experiment_file(const char *fname, experiment *expt) {
+    /* same flavour of .ini file as the param file */
+    FILE            *fp = NULL;
+    phase           *ph = NULL;
+    const reg_field *fld = NULL;
+    char             line[STRING_LENGTH];
+    char            *start, *end, *name, *value;
+    int              line_number = 0;
+
+    expt->nphases = 0;
+    expt->max_phases = 0;
+    expt->items = NULL;
+
+    if ((fp = fopen(fname, "r")) == NULL) {
+        fprintf(stderr, "Error opening experiment file %s\n", fname);
+        exit(EXIT_FAILURE);
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        start = lskip(rstrip(line));
+        if (*start == '\0' || *start == ';' || *start == '#') {
+            continue;
+        } else if (*start == '[') {
+            end = find_char_or_comment(start + 1, ']');
+            if (*end != ']') {
+                fprintf(stderr, "%s: no ']' on line %d\n", fname,
+                        line_number);
+                exit(EXIT_FAILURE);
+            }
+            *end = '\0';
+            new_phase(expt, start + 1);
+            ph = &expt->items[expt->nphases - 1];
+            continue;
+        }
+
+        end = find_char_or_comment(start, '=');
+        if (*end != '=') {
+            fprintf(stderr, "%s: expected name = value on line %d\n", fname,
+                    line_number);
+            exit(EXIT_FAILURE);
+        }
+        *end = '\0';
+        name = rstrip(start);
+        value = lskip(end + 1);
+        end = find_char_or_comment(value, '\0');
+        if (*end == ';')
+            *end = '\0';
+        rstrip(value);
+
+        if (ph == NULL) {
+            fprintf(stderr, "%s: %s is outside of a [phase] on line %d\n",
+                    fname, name, line_number);
+            exit(EXIT_FAILURE);
+        } else if (strcasecmp(name, "spin_up") == 0) {
+            ph->spin_up = (strcasecmp(value, "true") == 0);
+        } else if (!set_forcing_view(&ph->fv, name, value)) {
+            if ((fld = registry_lookup_key(name)) == NULL ||
+                strcasecmp(name, "files.cfg_fname") == 0) {
+                fprintf(stderr, "Unknown key %s in phase %s, expected "
+                        "spin_up, forcing.* or section.key, e.g. "
+                        "params.g1\n", name, ph->name);
+                exit(EXIT_FAILURE);
+            }
+            add_override(ph->ol, fld, value);
+        }
+    }
+    fclose(fp);
+
+    if (expt->nphases == 0) {
+        fprintf(stderr, "The experiment file doesn't list any phases\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return;
+}
+
+static void new_phase(experiment *expt, const char *name) {
+    phase *ph = NULL;
+
+    if (expt->nphases == expt->max_phases) {
+        expt->max_phases = (expt->max_phases == 0) ? 8 : expt->max_phases * 2;
+        expt->items = realloc(expt->items, expt->max_phases * sizeof(phase));
+        if (expt->items == NULL) {
+            fprintf(stderr, "realloc failed growing phase list\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    ph = &expt->items[expt->nphases];
+    strncpy0(ph->name, (char *)name, sizeof(ph->name));
+    ph->spin_up = FALSE;
+    ph->ol = new_override_list();
+    init_forcing_view(&ph->fv);
+    expt->nphases++;
+
+    return;
+}
+
+static void free_experiment(experiment *expt) {
+    int i;
+
+    for (i = 0; i < expt->nphases; i++)
+        free_override_list(expt->items[i].ol);
+    free(expt->items);
+    free(expt);
+
+    return;
+}
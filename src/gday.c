@@ -20,6 +20,8 @@
 
 #include "gday.h"
 
+/* the Python/R bindings and libgday embed the model without main */
+#ifndef GDAY_LIBRARY
 int main(int argc, char **argv)
 {
     int error = 0;
@@ -118,9 +120,113 @@ int main(int argc, char **argv)
         exit(EXIT_FAILURE);
     }
 
-    /* House keeping! */
-    if (c->water_balance == HYDRAULICS && c->sub_daily == FALSE) {
-        fprintf(stderr, "You can't run the hydraulics model with daily flag\n");
+    if (c->check) {
+        /* report everything wrong with the inputs, but don't run */
+        exit(check_config(c, p, s) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    /*
+        Command line overrides (--set) beat both the .cfg file and the
+        snapshot, so they go on before it is read (they may name it) and
+        again after, as check_config does
+    */
+    if (c->ovr != NULL) {
+        apply_overrides(c->ovr, c, p, s);
+    }
+
+    /* Start from a binary state snapshot rather than the .cfg state? */
+    read_state_snapshot(c, p, s);
+
+    if (c->ovr != NULL) {
+        apply_overrides(c->ovr, c, p, s);
+    }
+
+    /* fail before the forcing is loaded, not after */
+    if (check_flags(c) > 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    if (c->sub_daily) {
+        read_subdaily_met_data(argv, c, ma);
+    } else {
+        read_daily_met_data(argv, c, ma);
+    }
+
+    if ((strcmp(c->sweep_fname, "*NOT SET*") != 0) +
+        (strcmp(c->overrides_fname, "*NOT SET*") != 0) +
+        (strcmp(c->branches_fname, "*NOT SET*") != 0) +
+        (strcmp(c->experiment_fname, "*NOT SET*") != 0) +
+        c->compare_float > 1) {
+        fprintf(stderr, "Use only one of --sweep, --overrides, --branches, "
+                "--experiment and --compare-float\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (strcmp(c->experiment_fname, "*NOT SET*") != 0) {
+        /* spin-up, historical, experiment... phases in one go */
+        run_experiment(cw, c, f, fs, ma, m, p, s, nr);
+    } else if (strcmp(c->branches_fname, "*NOT SET*") != 0) {
+        /* shared years once, then one forked run per treatment */
+        run_branches(cw, c, f, fs, ma, m, p, s, nr);
+    } else if (strcmp(c->sweep_fname, "*NOT SET*") != 0) {
+        /* sampled members, summarised by their annual diagnostics */
+        run_sweep(cw, c, f, fs, ma, m, p, s, nr);
+    } else if (c->compare_float) {
+        /* the batched canopy kernel in double and float, side by side */
+        compare_canopy_precision(cw, c, f, fs, ma, m, p, s, nr);
+    } else if (strcmp(c->overrides_fname, "*NOT SET*") != 0) {
+        /* one run per row of the overrides file, sharing the parsed inputs */
+        run_ensemble(cw, c, f, fs, ma, m, p, s, nr);
+    } else {
+        run_model(cw, c, f, fs, ma, m, p, s, nr);
+    }
+
+    /* clean up */
+    fclose(c->ifp);
+    free_met_data(c, ma);
+    if (c->ovr != NULL) {
+        free_override_list(c->ovr);
+    }
+    free(s->day_length);
+    free(cw);
+    free(c);
+    free(ma);
+    free(m);
+    free(p);
+    free(s);
+    free(f);
+    free(fs);
+
+    exit(EXIT_SUCCESS);
+}
+#endif /* GDAY_LIBRARY */
+
+void run_model(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
+               met_arrays *ma, met *m, params *p, state *s, nrutil *nr) {
+    /* one complete run (or spin-up) of the model over the met forcing */
+
+    setup_run(cw, c, f, ma, p, s, nr);
+
+    if (c->spin_up) {
+        spin_up_pools(cw, c, f, fs, ma, m, p, s, nr);
+    } else {
+        run_sim(cw, c, f, fs, ma, m, p, s, nr);
+    }
+
+    close_output_files(c);
+    free_run(cw, c, f, p, s, nr);
+
+    return;
+}
+
+void setup_run(canopy_wk *cw, control *c, fluxes *f, met_arrays *ma,
+               params *p, state *s, nrutil *nr) {
+    /*
+        Per-run house keeping and allocations, i.e. everything which depends
+        on the params rather than just the met forcing
+    */
+    /* overrides may have changed the flags since main checked them */
+    if (check_flags(c) > 0) {
         exit(EXIT_FAILURE);
     }
 
@@ -136,121 +242,276 @@ int main(int argc, char **argv)
     }
 
     if (c->sub_daily) {
-        read_subdaily_met_data(argv, c, ma);
         fill_up_solar_arrays(cw, c, ma, p);
-    } else {
-        read_daily_met_data(argv, c, ma);
+    } else if (c->assim_model == MATE && c->ps_pathway == C3) {
+        /* filled by run_sim, once for however many times round it goes */
+        if ((c->mate = calloc(1, sizeof(mate_table))) == NULL) {
+            fprintf(stderr, "malloc failed allocating MATE terms\n");
+            exit(EXIT_FAILURE);
+        }
     }
 
+    return;
+}
 
-    if (c->spin_up) {
-        spin_up_pools(cw, c, f, fs, ma, m, p, s, nr);
-    } else {
-        run_sim(cw, c, f, fs, ma, m, p, s, nr);
+void open_run_outputs(control *c, met_arrays *ma, params *p) {
+    /* open the output files print_options asks for and write their headers */
+
+    if (c->print_options == SUBDAILY && c->spin_up == FALSE) {
+        /* open the 30 min outputs file and the daily output files */
+        open_output_file(c, c->out_subdaily_fname, &(c->ofp_sd));
+        open_output_file(c, c->out_fname, &(c->ofp));
+
+        if (c->output_ascii) {
+            write_output_subdaily_header(c, &(c->ofp_sd));
+            write_output_header(c, &(c->ofp));
+        } else {
+            open_output_file(c, c->out_subdaily_fname_hdr, &(c->ofp_sd_hdr));
+            write_output_subdaily_header(c, &(c->ofp_sd_hdr));
+            open_output_file(c, c->out_fname_hdr, &(c->ofp_hdr));
+            write_output_header(c, &(c->ofp_hdr));
+        }
+    } else if (c->print_options == DAILY && c->spin_up == FALSE &&
+               c->output_format == NETCDF) {
+        /* NetCDF manages its own file, an ensemble passes in the one its
+           members share */
+        if (c->nw == NULL)
+            c->nw = open_netcdf_output(c, ma);
+        netcdf_set_site(c->nw, c->netcdf_site, (int)ma->year[0],
+                        p->latitude, p->longitude);
+    } else if (c->print_options == DAILY && c->spin_up == FALSE) {
+        /* Daily outputs */
+        open_output_file(c, c->out_fname, &(c->ofp));
+
+        if (c->output_format == ARROW) {
+            c->aw = arrow_open(c->ofp, daily_output_names, NDAILY_OUTPUTS,
+                               c->arrow_batch_days, c->arrow_codec,
+                               c->git_code_ver);
+        } else if (c->output_ascii && c->output_format == NCEAS) {
+            write_output_header_nceas(c, &(c->ofp));
+        } else if (c->output_ascii) {
+            write_output_header(c, &(c->ofp));
+        } else {
+            open_output_file(c, c->out_fname_hdr, &(c->ofp_hdr));
+            write_output_header(c, &(c->ofp_hdr));
+        }
+    } else if (c->print_options == END && c->spin_up == FALSE &&
+               c->brs == NULL) {
+        /* Final state + param file, each branch writes its own */
+        open_output_file(c, c->out_param_fname, &(c->ofp));
     }
 
-    /* clean up */
-    fclose(c->ofp);
-    if (c->print_options == SUBDAILY ) {
+    if (c->spin_up == FALSE &&
+        strcmp(c->canopy_trace_fname, "*NOT SET*") != 0)
+        open_canopy_trace(c);
+
+    return;
+}
+
+netcdf_writer *open_netcdf_output(control *c, met_arrays *ma) {
+    /* the daily NetCDF file, with room for c->netcdf_nsites sites */
+    return (netcdf_open(c->out_fname, daily_output_names,
+                        daily_output_long_names, daily_output_units,
+                        NDAILY_OUTPUTS, c->netcdf_nsites,
+                        c->netcdf_chunk_days, c->netcdf_deflate,
+                        (int)ma->year[0], c->git_code_ver));
+}
+
+void close_output_files(control *c) {
+
+    if (c->aw != NULL) {
+        arrow_close(c->aw);
+        c->aw = NULL;
+    }
+    if (c->nw != NULL) {
+        /* a shared file stays open for the next member */
+        if (c->nw->shared)
+            netcdf_flush(c->nw);
+        else
+            netcdf_close(c->nw);
+        c->nw = NULL;
+    } else if (c->ofp != NULL) {
+        fclose(c->ofp);
+    }
+    c->ofp = NULL;
+    if (c->print_options == SUBDAILY && c->ofp_sd != NULL) {
         fclose(c->ofp_sd);
+        c->ofp_sd = NULL;
+        if (c->output_ascii == FALSE && c->ofp_sd_hdr != NULL) {
+            fclose(c->ofp_sd_hdr);
+            c->ofp_sd_hdr = NULL;
+        }
     }
-    fclose(c->ifp);
-    if (c->output_ascii == FALSE) {
+    if (c->output_ascii == FALSE && c->ofp_hdr != NULL) {
         fclose(c->ofp_hdr);
+        c->ofp_hdr = NULL;
     }
+    close_canopy_trace(c);
+
+    return;
+}
+
+void free_run(canopy_wk *cw, control *c, fluxes *f, params *p, state *s,
+              nrutil *nr) {
+    /* undo setup_run */
 
-    free(cw);
-    free(c);
-    free(ma->year);
-    free(ma->tair);
-    free(ma->rain);
-    free(ma->tsoil);
-    free(ma->co2);
-    free(ma->ndep);
-    free(ma->wind);
-    free(ma->press);
-    free(ma->par);
     if (c->sub_daily) {
-        free(ma->vpd);
-        free(ma->doy);
         free(cw->cz_store);
         free(cw->ele_store);
         free(cw->df_store);
+        free(cw->daytime);
+    }
+    if (c->mate != NULL) {
+        free(c->mate->buf);
+        free(c->mate);
+        c->mate = NULL;
+    }
 
-        /* Clean up hydraulics */
-        if (c->water_balance == HYDRAULICS) {
-            free(f->soil_conduct);
-            free(f->swp);
-            free(f->soilR);
-            free(f->fraction_uptake);
-            free(f->ppt_gain);
-            free(f->water_loss);
-            free(f->water_gain);
-            free(f->est_evap);
-            free(s->water_frac);
-            free(s->wetting_bot);
-            free(s->wetting_top);
-            free(p->potA);
-            free(p->potB);
-            free(p->cond1);
-            free(p->cond2);
-            free(p->cond3);
-            free(p->porosity);
-            free(p->field_capacity);
-            free(s->thickness);
-            free(s->root_mass);
-            free(s->root_length);
-            free(s->layer_depth);
-
-
-            free_dvector(nr->y, 1, nr->N);
-            free_dvector(nr->ystart, 1, nr->N);
-            free_dvector(nr->dydx, 1, nr->N);
-			free_dvector(nr->yscal, 1, nr->N);
-            free_dvector(nr->xp, 1, nr->kmax);
-            free_dmatrix(nr->yp, 1, nr->N, 1, nr->kmax);
-            free_dvector(nr->ytemp, 1, nr->N);
-        	free_dvector(nr->ak6, 1, nr->N);
-        	free_dvector(nr->ak5, 1, nr->N);
-        	free_dvector(nr->ak4, 1, nr->N);
-        	free_dvector(nr->ak3, 1, nr->N);
-        	free_dvector(nr->ak2, 1, nr->N);
-            free_dvector(nr->yerr, 1, nr->N);
-        }
-
-    } else {
-        free(ma->prjday);
-        free(ma->tam);
-        free(ma->tpm);
-        free(ma->tmin);
-        free(ma->tmax);
-        free(ma->vpd_am);
-        free(ma->vpd_pm);
-        free(ma->wind_am);
-        free(ma->wind_pm);
-        free(ma->par_am);
-        free(ma->par_pm);
+    /* Clean up hydraulics */
+    if (c->water_balance == HYDRAULICS) {
+        free(f->soil_conduct);
+        free(f->swp);
+        free(f->soilR);
+        free(f->fraction_uptake);
+        free(f->ppt_gain);
+        free(f->water_loss);
+        free(f->water_gain);
+        free(f->est_evap);
+        free(s->water_frac);
+        free(s->wetting_bot);
+        free(s->wetting_top);
+        free(p->potA);
+        free(p->potB);
+        free(p->cond1);
+        free(p->cond2);
+        free(p->cond3);
+        free(p->porosity);
+        free(p->field_capacity);
+        free(s->thickness);
+        free(s->root_mass);
+        free(s->root_length);
+        free(s->layer_depth);
+
+        free_dvector(nr->y, 1, nr->N);
+        free_dvector(nr->ystart, 1, nr->N);
+        free_dvector(nr->dydx, 1, nr->N);
+        free_dvector(nr->yscal, 1, nr->N);
+        free_dvector(nr->xp, 1, nr->kmax);
+        free_dmatrix(nr->yp, 1, nr->N, 1, nr->kmax);
+        free_dvector(nr->ytemp, 1, nr->N);
+        free_dvector(nr->ak6, 1, nr->N);
+        free_dvector(nr->ak5, 1, nr->N);
+        free_dvector(nr->ak4, 1, nr->N);
+        free_dvector(nr->ak3, 1, nr->N);
+        free_dvector(nr->ak2, 1, nr->N);
+        free_dvector(nr->yerr, 1, nr->N);
     }
-    free(s->day_length);
-    free(ma);
-    free(m);
-    free(p);
-    free(s);
-    free(f);
-    free(fs);
 
-    exit(EXIT_SUCCESS);
+    return;
 }
 
 void run_sim(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
              met_arrays *ma, met *m, params *p, state *s, nrutil *nr) {
+    /*
+        Step through the met forcing. The pieces (start_sim, start_year,
+        start_day, end_day, end_year, end_sim) are shared with the stepping
+        calls in the embedding API, which push the forcing in a day or a
+        half-hour at a time instead.
+    */
+    sim_loop sl;
+    int      nyr, doy;
+    double   year;
+
+    start_sim(cw, c, f, fs, ma, p, s, &sl);
+    if (c->mate != NULL && c->mate->ndays == 0)
+        build_mate_table(c, ma, p);
+
+    /* ====================== **
+    **   Y E A R    L O O P   **
+    ** ====================== */
+    c->day_idx = 0;
+    c->hour_idx = 0;
 
-    int    nyr, doy, window_size, i, dummy = 0;
-    int    fire_found = FALSE;;
-    int    num_disturbance_yrs = 0;
 
-    double fdecay, rdecay, current_limitation, nitfac, year;
-    int   *disturbance_yrs = NULL;
+
+    for (nyr = 0; nyr < c->num_years; nyr++) {
+
+        if (c->sub_daily) {
+            year = ma->year[c->hour_idx];
+        } else {
+            year = ma->year[c->day_idx];
+        }
+
+        /* treatment branches carry on from here, see branches.c */
+        if (c->brs != NULL && (int)year == c->brs->start_year &&
+            fork_branches(cw, c, ma, p, s) == BRANCH_PARENT)
+            break;
+
+        start_year(c, f, ma, p, s, &sl, year);
+
+        /* =================== **
+        **   D A Y   L O O P   **
+        ** =================== */
+        for (doy = 0; doy < c->num_days; doy++) {
+
+            //if (year == 2001 && doy+1 == 230) {
+            //    c->pdebug = TRUE;
+            //}
+
+            start_day(c, f, fs, ma, m, p, s, &sl, doy);
+
+            calc_day_growth(cw, c, f, fs, ma, m, nr, p, s, s->day_length[doy],
+                            doy, sl.fdecay, sl.rdecay);
+
+            end_day(cw, c, f, fs, ma, m, p, s, &sl, doy);
+            /* ======================= **
+            **   E N D   O F   D A Y   **
+            ** ======================= */
+        }
+
+        end_year(c, f, p, s);
+    }
+    /* ========================= **
+    **   E N D   O F   Y E A R   **
+    ** ========================= */
+    end_sim(c, p, s, &sl);
+
+    /* the counts are also there to gday_read, as leaf_nonconverged etc. */
+    if (c->verbose) {
+        if (cw->nonconverged > 1)
+            fprintf(stderr, "Leaf temperature not converged %d times, raise "
+                    "control.leaf_itermax or try leaf_solver = secant\n",
+                    cw->nonconverged);
+        if (c->warm_start)
+            print_leaf_solves(stderr, cw);
+        if (c->water_balance == HYDRAULICS && cw->emax_checks > 0)
+            fprintf(stderr, "Emax limited %ld of %ld leaf photosynthesis "
+                    "passes (%.1f%%)\n", cw->emax_limited, cw->emax_checks,
+                    100.0 * cw->emax_limited / cw->emax_checks);
+    }
+
+    return;
+
+
+}
+
+void start_sim(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
+               met_arrays *ma, params *p, state *s, sim_loop *sl) {
+    /* set up the state and the running means before the first day */
+    int    i;
+    double nitfac;
+
+    sl->disturbance_yrs = NULL;
+    sl->num_disturbance_yrs = 0;
+    sl->year = -999.9;
+    cw->nonconverged = 0;
+    cw->emax_checks = 0;
+    cw->emax_limited = 0;
+    for (i = 0; i < NUM_LEAVES; i++) {
+        cw->leaf_solves[i] = 0;
+        cw->leaf_passes[i] = 0;
+        cw->warm[i] = FALSE;
+    }
 
     if (c->deciduous_model) {
         /* Are we reading in last years average growing season? */
@@ -273,43 +534,18 @@ void run_sim(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
     }
 
     /* Setup output file */
-    if (c->print_options == SUBDAILY && c->spin_up == FALSE) {
-        /* open the 30 min outputs file and the daily output files */
-        open_output_file(c, c->out_subdaily_fname, &(c->ofp_sd));
-        open_output_file(c, c->out_fname, &(c->ofp));
-
-        if (c->output_ascii) {
-            write_output_subdaily_header(c, &(c->ofp_sd));
-            write_output_header(c, &(c->ofp));
-        } else {
-            fprintf(stderr, "Nothing implemented for sub-daily binary\n");
-            exit(EXIT_FAILURE);
-        }
-    } else if (c->print_options == DAILY && c->spin_up == FALSE) {
-        /* Daily outputs */
-        open_output_file(c, c->out_fname, &(c->ofp));
-
-        if (c->output_ascii) {
-            write_output_header(c, &(c->ofp));
-        } else {
-            open_output_file(c, c->out_fname_hdr, &(c->ofp_hdr));
-            write_output_header(c, &(c->ofp_hdr));
-        }
-    } else if (c->print_options == END && c->spin_up == FALSE) {
-        /* Final state + param file */
-        open_output_file(c, c->out_param_fname, &(c->ofp));
-    }
+    open_run_outputs(c, ma, p);
 
     /*
      * Window size = root lifespan in days...
      * For deciduous species window size is set as the length of the
      * growing season in the main part of the code
      */
-    window_size = (int)(1.0 / p->rdecay * NDAYS_IN_YR);
-    sma_obj *hw = sma(SMA_NEW, window_size).handle;
+    sl->window_size = (int)(1.0 / p->rdecay * NDAYS_IN_YR);
+    sl->hw = sma(SMA_NEW, sl->window_size).handle;
     if (s->prev_sma > -900) {
-        for (i = 0; i < window_size; i++) {
-            sma(SMA_ADD, hw, s->prev_sma);
+        for (i = 0; i < sl->window_size; i++) {
+            sma(SMA_ADD, sl->hw, s->prev_sma);
         }
     }
     /* Set up SMA
@@ -321,17 +557,16 @@ void run_sim(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
         s->prev_sma = 1.0;
 
     /*
-     * Params are defined in per year, needs to be per day. Important this is
-     * done here as rate constants elsewhere in the code are assumed to be in
-     * units of days not years
+     * Params are defined in per year, needs to be per day. The per day rate
+     * constants (and the soil params) are worked out once per parameter set,
+     * the code elsewhere reads those from p->derived
      */
-    correct_rate_constants(p, FALSE);
+    if (!p->derived.valid)
+        derive_params(c, p);
     day_end_calculations(c, p, s, -99, TRUE);
 
     if (c->sub_daily) {
         initialise_soils_sub_daily(c, f, p, s);
-    } else {
-        initialise_soils_day(c, f, p, s);
     }
 
     if (c->fixed_lai) {
@@ -383,226 +618,231 @@ void run_sim(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
     }
 
     if (c->disturbance) {
-        if ((disturbance_yrs = (int *)calloc(1, sizeof(int))) == NULL) {
+        if ((sl->disturbance_yrs = (int *)calloc(1, sizeof(int))) == NULL) {
             fprintf(stderr,"Error allocating space for disturbance_yrs\n");
     		exit(EXIT_FAILURE);
         }
-        figure_out_years_with_disturbances(c, ma, p, &disturbance_yrs,
-                                           &num_disturbance_yrs);
+        figure_out_years_with_disturbances(c, ma, p, &sl->disturbance_yrs,
+                                           &sl->num_disturbance_yrs);
     }
 
+    return;
+}
 
-    /* ====================== **
-    **   Y E A R    L O O P   **
-    ** ====================== */
-    c->day_idx = 0;
-    c->hour_idx = 0;
-
-
-
-    for (nyr = 0; nyr < c->num_years; nyr++) {
-
-        if (c->sub_daily) {
-            year = ma->year[c->hour_idx];
-        } else {
-            year = ma->year[c->day_idx];
-        }
-        if (is_leap_year(year))
-            c->num_days = 366;
-        else
-            c->num_days = 365;
+void start_year(control *c, fluxes *f, met_arrays *ma, params *p, state *s,
+                sim_loop *sl, double year) {
+    int i;
 
-        calculate_daylength(s, c->num_days, p->latitude);
+    sl->year = year;
+    if (is_leap_year(year))
+        c->num_days = 366;
+    else
+        c->num_days = 365;
 
-        if (c->deciduous_model) {
-            phenology(c, f, ma, p, s);
+    calculate_daylength(s, c->num_days, p->latitude);
 
-            /* Change window size to length of growing season */
-            sma(SMA_FREE, hw);
-            hw = sma(SMA_NEW, p->growing_seas_len).handle;
-            if (s->prev_sma > -900) {
-                for (i = 0; i < p->growing_seas_len; i++) {
-                    sma(SMA_ADD, hw, s->prev_sma);
-                }
+    if (c->deciduous_model) {
+        phenology(c, f, ma, p, s);
+
+        /* Change window size to length of growing season */
+        sma(SMA_FREE, sl->hw);
+        sl->hw = sma(SMA_NEW, p->growing_seas_len).handle;
+        if (s->prev_sma > -900) {
+            for (i = 0; i < p->growing_seas_len; i++) {
+                sma(SMA_ADD, sl->hw, s->prev_sma);
             }
-
-            zero_stuff(c, s);
         }
-        /* =================== **
-        **   D A Y   L O O P   **
-        ** =================== */
-        for (doy = 0; doy < c->num_days; doy++) {
-
-            //if (year == 2001 && doy+1 == 230) {
-            //    c->pdebug = TRUE;
-            //}
 
+        zero_stuff(c, s);
+    }
 
-            if (! c->sub_daily) {
-                unpack_met_data(c, f, ma, m, dummy, s->day_length[doy]);
-            }
+    return;
+}
 
-            calculate_litterfall(c, f, fs, p, s, doy, &fdecay, &rdecay);
-
-            if (c->disturbance && p->disturbance_doy == doy+1) {
-                /* Fire Disturbance? */
-                fire_found = FALSE;
-                fire_found = check_for_fire(c, f, p, s, year, disturbance_yrs,
-                                            num_disturbance_yrs);
-
-                if (fire_found) {
-                    fire(c, f, p, s);
-                    /*
-                     * This will only work for evergreen, but that is fine
-                     * this should be removed after KSCO is done
-                     */
-                    sma(SMA_FREE, hw);
-                    hw = sma(SMA_NEW, window_size).handle;
-                    if (s->prev_sma > -900) {
-                        for (i = 0; i < window_size; i++) {
-                            sma(SMA_ADD, hw, s->prev_sma);
-                        }
-                    }
-                }
-            } else if (c->hurricane &&
-                p->hurricane_yr == year &&
-                p->hurricane_doy == doy) {
+void start_day(control *c, fluxes *f, fast_spinup *fs, met_arrays *ma, met *m,
+               params *p, state *s, sim_loop *sl, int doy) {
+    /* everything before the day's production, doy counts from 0 */
+    int i, dummy = 0, fire_found = FALSE;
 
-                /* Hurricane? */
-                hurricane(f, p, s);
-            }
+    if (! c->sub_daily) {
+        unpack_met_data(c, f, ma, m, dummy, s->day_length[doy]);
+    }
 
+    calculate_litterfall(c, f, fs, p, s, doy, &sl->fdecay, &sl->rdecay);
 
-            calc_day_growth(cw, c, f, fs, ma, m, nr, p, s, s->day_length[doy],
-                            doy, fdecay, rdecay);
-
-            //printf("%d %f %f\n", doy, f->gpp*100, s->lai);
-            calculate_csoil_flows(c, f, fs, p, s, m->tsoil, doy);
-            calculate_nsoil_flows(c, f, p, s, doy);
-
-            /* update stress SMA */
-            if (c->deciduous_model && s->leaf_out_days[doy] > 0.0) {
-                 /*
-                  * Allocation is annually for deciduous "tree" model, but we
-                  * need to keep a check on stresses during the growing season
-                  * and the LAI figure out limitations during leaf growth period.
-                  * This also applies for deciduous grasses, need to do the
-                  * growth stress calc for grasses here too.
-                  */
-                current_limitation = calculate_growth_stress_limitation(p, s);
-                sma(SMA_ADD, hw, current_limitation);
-                s->prev_sma = sma(SMA_MEAN, hw).sma;
-            } else if (c->deciduous_model == FALSE) {
-                current_limitation = calculate_growth_stress_limitation(p, s);
-                sma(SMA_ADD, hw, current_limitation);
-                s->prev_sma = sma(SMA_MEAN, hw).sma;
-            }
+    if (c->disturbance && p->disturbance_doy == doy+1) {
+        /* Fire Disturbance? */
+        fire_found = FALSE;
+        fire_found = check_for_fire(c, f, p, s, sl->year, sl->disturbance_yrs,
+                                    sl->num_disturbance_yrs);
 
+        if (fire_found) {
+            fire(c, f, p, s);
             /*
-             * if grazing took place need to reset "stress" running mean
-             * calculation for grasses
+             * This will only work for evergreen, but that is fine
+             * this should be removed after KSCO is done
              */
-            if (c->grazing == 2 && p->disturbance_doy == doy+1) {
-                sma(SMA_FREE, hw);
-                hw = sma(SMA_NEW, p->growing_seas_len).handle;
+            sma(SMA_FREE, sl->hw);
+            sl->hw = sma(SMA_NEW, sl->window_size).handle;
+            if (s->prev_sma > -900) {
+                for (i = 0; i < sl->window_size; i++) {
+                    sma(SMA_ADD, sl->hw, s->prev_sma);
+                }
             }
+        }
+    } else if (c->hurricane &&
+        p->hurricane_yr == sl->year &&
+        p->hurricane_doy == doy) {
 
-            /* Turn off all N calculations */
-            if (c->ncycle == FALSE)
-                reset_all_n_pools_and_fluxes(f, s);
-
-            /* calculate C:N ratios and increment annual flux sum */
-            day_end_calculations(c, p, s, c->num_days, FALSE);
+        /* Hurricane? */
+        hurricane(f, p, s);
+    }
 
-            if (c->print_options == SUBDAILY && c->spin_up == FALSE) {
-                write_daily_outputs_ascii(c, cw, f, s, year, doy+1);
-            } else if (c->print_options == DAILY && c->spin_up == FALSE) {
-                if(c->output_ascii)
-                    write_daily_outputs_ascii(c, cw, f, s, year, doy+1);
-                else
-                    write_daily_outputs_binary(c, f, s, year, doy+1);
-            }
+    return;
+}
 
-            // Step 2: Store the time-varying variables
-            if (c->spinup_method == SAS) {
-                fs->npp_ss += f->npp;
-                fs->ndays ++;
-                fs->shoot_nc += s->shootn / s->shoot;
-                fs->root_nc += s->rootn / s->root;
-                fs->branch_nc += s->branchn / s->branch;
-                if (s->croot > 0.0) {
-                    fs->croot_nc += s->crootn / s->croot;
-                } else {
-                    fs->croot_nc = 0.0;
-                }
-                fs->stem_nc += s->stemn / s->stem;
-                if (s->stemnmob > 0.0) {
-                    fs->stemnmob_ratio += s->stemnmob / s->stem;
-                } else {
-                    fs->stemnmob_ratio = 0.0;
-                }
-                if (s->stemnimm > 0.0) {
-                    fs->stemnimm_ratio += s->stemnimm / s->stem;
-                } else {
-                    fs->stemnimm_ratio = 0.0;
-                }
+void end_day(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
+             met_arrays *ma, met *m, params *p, state *s, sim_loop *sl,
+             int doy) {
+    /* soil flows, stress running mean and outputs, after the production */
+    double current_limitation, year = sl->year;
+
+    //printf("%d %f %f\n", doy, f->gpp*100, s->lai);
+    calculate_csoil_flows(c, f, fs, p, s, m->tsoil, doy);
+    calculate_nsoil_flows(c, f, p, s, doy);
+
+    /* update stress SMA */
+    if (c->deciduous_model && s->leaf_out_days[doy] > 0.0) {
+         /*
+          * Allocation is annually for deciduous "tree" model, but we
+          * need to keep a check on stresses during the growing season
+          * and the LAI figure out limitations during leaf growth period.
+          * This also applies for deciduous grasses, need to do the
+          * growth stress calc for grasses here too.
+          */
+        current_limitation = calculate_growth_stress_limitation(p, s);
+        sma(SMA_ADD, sl->hw, current_limitation);
+        s->prev_sma = sma(SMA_MEAN, sl->hw).sma;
+    } else if (c->deciduous_model == FALSE) {
+        current_limitation = calculate_growth_stress_limitation(p, s);
+        sma(SMA_ADD, sl->hw, current_limitation);
+        s->prev_sma = sma(SMA_MEAN, sl->hw).sma;
+    }
 
-                if (s->metabsoil > 0.0) {
-                    fs->metablsoil_nc += s->metabsoiln / s->metabsoil;
-                } else {
-                    fs->metablsoil_nc += 0.0;
-                }
+    /*
+     * if grazing took place need to reset "stress" running mean
+     * calculation for grasses
+     */
+    if (c->grazing == 2 && p->disturbance_doy == doy+1) {
+        sma(SMA_FREE, sl->hw);
+        sl->hw = sma(SMA_NEW, p->growing_seas_len).handle;
+    }
 
-                if (s->metabsurf > 0.0) {
-                    fs->metabsurf_nc += s->metabsurfn / s->metabsurf;
-                } else {
-                    fs->metabsurf_nc += 0.0;
-                }
+    /* Turn off all N calculations */
+    if (c->ncycle == FALSE)
+        reset_all_n_pools_and_fluxes(f, s);
+
+    /* calculate C:N ratios and increment annual flux sum */
+    day_end_calculations(c, p, s, c->num_days, FALSE);
+
+    if (c->diag != NULL)
+        record_diagnostics(c->diag, c, cw, f, s, (int)year, doy+1);
+    if (c->capture != NULL)
+        capture_daily_outputs(c->capture, c, cw, f, s, (int)year, doy+1);
+
+    if ((c->print_options == SUBDAILY ||
+         c->print_options == DAILY) && c->spin_up == FALSE) {
+        if (c->output_format == ARROW)
+            write_daily_outputs_arrow(c, cw, f, s, year, doy+1);
+        else if (c->output_format == NETCDF)
+            write_daily_outputs_netcdf(c, cw, f, s, year, doy+1);
+        else if (c->output_format == NCEAS)
+            write_daily_outputs_nceas(c, f, ma, s, year, doy+1);
+        else if(c->output_ascii)
+            write_daily_outputs_ascii(c, cw, f, s, year, doy+1);
+        else
+            write_daily_outputs_binary(c, cw, f, s, year, doy+1);
+    }
 
-                fs->structsoil_nc += s->structsoiln / s->structsoil;
-                fs->structsurf_nc += s->structsurfn / s->structsurf;
-                fs->activesoil_nc += s->activesoiln / s->activesoil;
-                fs->slowsoil_nc += s->slowsoiln / s->slowsoil;
-                fs->passivesoil_nc += s->passivesoiln / s->passivesoil;
-            }
-            c->day_idx++;
-            /* ======================= **
-            **   E N D   O F   D A Y   **
-            ** ======================= */
+    // Step 2: Store the time-varying variables
+    if (c->spinup_method == SAS) {
+        fs->npp_ss += f->npp;
+        fs->ndays ++;
+        fs->shoot_nc += s->shootn / s->shoot;
+        fs->root_nc += s->rootn / s->root;
+        fs->branch_nc += s->branchn / s->branch;
+        if (s->croot > 0.0) {
+            fs->croot_nc += s->crootn / s->croot;
+        } else {
+            fs->croot_nc = 0.0;
+        }
+        fs->stem_nc += s->stemn / s->stem;
+        if (s->stemnmob > 0.0) {
+            fs->stemnmob_ratio += s->stemnmob / s->stem;
+        } else {
+            fs->stemnmob_ratio = 0.0;
+        }
+        if (s->stemnimm > 0.0) {
+            fs->stemnimm_ratio += s->stemnimm / s->stem;
+        } else {
+            fs->stemnimm_ratio = 0.0;
         }
 
-
-        /* Allocate stored C&N for the following year */
-        if (c->deciduous_model) {
-            calculate_average_alloc_fractions(f, s, p->growing_seas_len);
-            allocate_stored_c_and_n(f, p, s);
+        if (s->metabsoil > 0.0) {
+            fs->metablsoil_nc += s->metabsoiln / s->metabsoil;
+        } else {
+            fs->metablsoil_nc += 0.0;
         }
 
-        // Adjust rooting distribution at the end of the year to account for
-        // growth of new roots. It is debatable when this should be done. I've
-        // picked the year end for computation reasons and probably because
-        // plants wouldn't do this as dynamcially as on a daily basis. Probably
-        if (c->water_balance == HYDRAULICS) {
-            update_roots(c, p, s);
+        if (s->metabsurf > 0.0) {
+            fs->metabsurf_nc += s->metabsurfn / s->metabsurf;
+        } else {
+            fs->metabsurf_nc += 0.0;
         }
+
+        fs->structsoil_nc += s->structsoiln / s->structsoil;
+        fs->structsurf_nc += s->structsurfn / s->structsurf;
+        fs->activesoil_nc += s->activesoiln / s->activesoil;
+        fs->slowsoil_nc += s->slowsoiln / s->slowsoil;
+        fs->passivesoil_nc += s->passivesoiln / s->passivesoil;
     }
-    /* ========================= **
-    **   E N D   O F   Y E A R   **
-    ** ========================= */
-    correct_rate_constants(p, TRUE);
+    c->day_idx++;
 
-    if (c->print_options == END && c->spin_up == FALSE) {
-        write_final_state(c, p, s);
+    return;
+}
+
+void end_year(control *c, fluxes *f, params *p, state *s) {
+
+    /* Allocate stored C&N for the following year */
+    if (c->deciduous_model) {
+        calculate_average_alloc_fractions(f, s, p->growing_seas_len);
+        allocate_stored_c_and_n(f, p, s);
     }
 
-    sma(SMA_FREE, hw);
-    if (c->disturbance) {
-        free(disturbance_yrs);
+    // Adjust rooting distribution at the end of the year to account for
+    // growth of new roots. It is debatable when this should be done. I've
+    // picked the year end for computation reasons and probably because
+    // plants wouldn't do this as dynamcially as on a daily basis. Probably
+    if (c->water_balance == HYDRAULICS) {
+        update_roots(c, p, s);
     }
 
     return;
+}
+
+void end_sim(control *c, params *p, state *s, sim_loop *sl) {
+
+    if (c->print_options == END && c->spin_up == FALSE && c->brs == NULL) {
+        write_final_state(c, p, s);
+        write_state_snapshot(c, p, s);
+    }
 
+    sma(SMA_FREE, sl->hw);
+    if (c->disturbance) {
+        free(sl->disturbance_yrs);
+    }
 
+    return;
 }
 
 void spin_up_pools(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
@@ -678,6 +918,7 @@ void spin_up_pools(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
     }
 
     write_final_state(c, p, s);
+    write_state_snapshot(c, p, s);
 
     return;
 }
@@ -933,8 +1174,27 @@ void clparser(int argc, char **argv, control *c) {
 
     for (i = 1; i < argc; i++) {
         if (*argv[i] == '-') {
-            if (!strncasecmp(argv[i], "-p", 2)) {
-			    strcpy(c->cfg_fname, argv[++i]);
+            if (!strcasecmp(argv[i], "--set")) {
+                if (c->ovr == NULL)
+                    c->ovr = new_override_list();
+                parse_set_arg(c->ovr, argv[++i]);
+            } else if (!strcasecmp(argv[i], "--overrides")) {
+                strcpy(c->overrides_fname, argv[++i]);
+            } else if (!strcasecmp(argv[i], "--sweep")) {
+                strcpy(c->sweep_fname, argv[++i]);
+            } else if (!strcasecmp(argv[i], "--branches")) {
+                strcpy(c->branches_fname, argv[++i]);
+            } else if (!strcasecmp(argv[i], "--experiment")) {
+                strcpy(c->experiment_fname, argv[++i]);
+            } else if (!strcasecmp(argv[i], "--check")) {
+                c->check = TRUE;
+            } else if (!strcasecmp(argv[i], "--compare-float")) {
+                c->compare_float = TRUE;
+            } else if (!strcasecmp(argv[i], "--verbose")) {
+                c->verbose = TRUE;
+            } else if (!strncasecmp(argv[i], "-p", 2)) {
+			    strcpy(c->cfg_path, argv[++i]);
+			    strcpy(c->cfg_fname, c->cfg_path);
             } else if (!strncasecmp(argv[i], "-s", 2)) {
                 c->spin_up = TRUE;
             } else if (!strncasecmp(argv[i], "-ver", 4)) {
@@ -966,6 +1226,15 @@ void usage(char **argv) {
     fprintf(stderr, "[-ver          \t] Print the git hash tag.]\n");
     fprintf(stderr, "[-p       fname\t] Location of parameter file (.ini/.cfg).]\n");
     fprintf(stderr, "[-s            \t] Spin-up GDAY, when it the model is finished it will print the final state to the param file.]\n");
+    fprintf(stderr, "[--check       \t] Validate the param file, met file and options, then exit without running.]\n");
+    fprintf(stderr, "[--compare-float\t] Run the batched canopy kernel in double then float and report the daily GPP/transpiration differences.]\n");
+    fprintf(stderr, "[--verbose     \t] Print the leaf solver counts (iterations, non-converged, Emax limited) at the end of each run.]\n");
+    fprintf(stderr, "\n++Overrides/ensembles:\n" );
+    fprintf(stderr, "[--set sec.key=val\t] Override a .cfg value, e.g. --set params.g1=4.2, can be repeated.]\n");
+    fprintf(stderr, "[--overrides fname\t] CSV file, one ensemble member per row applied on top of the param file.]\n");
+    fprintf(stderr, "[--sweep fname   \t] LHS/Sobol parameter sweep, writes a summary of annual diagnostics per member.]\n");
+    fprintf(stderr, "[--branches fname\t] Run the shared years once, then fork a run per treatment branch.]\n");
+    fprintf(stderr, "[--experiment fname\t] Run the phases (spin-up, historical, ...) listed in fname back to back.]\n");
     fprintf(stderr, "\n++Print this message:\n" );
     fprintf(stderr, "[-u/-h         \t] usage/help]\n");
 
@@ -1011,57 +1280,6 @@ void zero_fast_spinup_stuff(fast_spinup *fs) {
 }
 
 
-void correct_rate_constants(params *p, int output) {
-    /* adjust rate constants for the number of days in years */
-
-    if (output) {
-        p->rateuptake *= NDAYS_IN_YR;
-        p->rateloss *= NDAYS_IN_YR;
-        p->retransmob *= NDAYS_IN_YR;
-        p->fdecay *= NDAYS_IN_YR;
-        p->fdecaydry *= NDAYS_IN_YR;
-        p->crdecay *= NDAYS_IN_YR;
-        p->rdecay *= NDAYS_IN_YR;
-        p->rdecaydry *= NDAYS_IN_YR;
-        p->bdecay *= NDAYS_IN_YR;
-        p->wdecay *= NDAYS_IN_YR;
-        p->sapturnover *= NDAYS_IN_YR;
-        p->kdec1 *= NDAYS_IN_YR;
-        p->kdec2 *= NDAYS_IN_YR;
-        p->kdec3 *= NDAYS_IN_YR;
-        p->kdec4 *= NDAYS_IN_YR;
-        p->kdec5 *= NDAYS_IN_YR;
-        p->kdec6 *= NDAYS_IN_YR;
-        p->kdec7 *= NDAYS_IN_YR;
-        p->nuptakez *= NDAYS_IN_YR;
-        p->nmax *= NDAYS_IN_YR;
-    } else {
-        p->rateuptake /= NDAYS_IN_YR;
-        p->rateloss /= NDAYS_IN_YR;
-        p->retransmob /= NDAYS_IN_YR;
-        p->fdecay /= NDAYS_IN_YR;
-        p->fdecaydry /= NDAYS_IN_YR;
-        p->crdecay /= NDAYS_IN_YR;
-        p->rdecay /= NDAYS_IN_YR;
-        p->rdecaydry /= NDAYS_IN_YR;
-        p->bdecay /= NDAYS_IN_YR;
-        p->wdecay /= NDAYS_IN_YR;
-        p->sapturnover /= NDAYS_IN_YR;
-        p->kdec1 /= NDAYS_IN_YR;
-        p->kdec2 /= NDAYS_IN_YR;
-        p->kdec3 /= NDAYS_IN_YR;
-        p->kdec4 /= NDAYS_IN_YR;
-        p->kdec5 /= NDAYS_IN_YR;
-        p->kdec6 /= NDAYS_IN_YR;
-        p->kdec7 /= NDAYS_IN_YR;
-        p->nuptakez /= NDAYS_IN_YR;
-        p->nmax /= NDAYS_IN_YR;
-    }
-
-    return;
-}
-
-
 void reset_all_n_pools_and_fluxes(fluxes *f, state *s) {
     /*
         If the N-Cycle is turned off the way I am implementing this is to
@@ -1300,8 +1518,8 @@ void fill_up_solar_arrays(canopy_wk *cw, control *c, met_arrays *ma, params *p)
     // an array which we can then access during spinup to save processing time
 
     int    nyr, doy, hod;
-    long   ntimesteps = c->total_num_days * 48;
-    double year, sw_rad;
+    long   ntimesteps = c->total_num_days * 48, i, n;
+    double year;
 
     cw->cz_store = malloc(ntimesteps * sizeof(double));
     if (cw->cz_store == NULL) {
@@ -1330,16 +1548,49 @@ void fill_up_solar_arrays(canopy_wk *cw, control *c, met_arrays *ma, params *p)
             c->num_days = 365;
         for (doy = 0; doy < c->num_days; doy++) {
             for (hod = 0; hod < c->num_hlf_hrs; hod++) {
-                calculate_solar_geometry(cw, p, doy, hod);
-                sw_rad = ma->par[c->hour_idx] * PAR_2_SW; /* W m-2 */
-                get_diffuse_frac(cw, doy, sw_rad);
-                cw->cz_store[c->hour_idx] = cw->cos_zenith;
-                cw->ele_store[c->hour_idx] = cw->elevation;
-                cw->df_store[c->hour_idx] = cw->diffuse_frac;
+                store_solar_geometry(cw, p, doy, hod, ma->par[c->hour_idx],
+                                     c->hour_idx);
                 c->hour_idx++;
             }
         }
     }
+
+    /*
+        Index the daytime half-hours (canopy_half_hour's test for the sun
+        being up) so that canopy() can run the nights in between on the
+        cheap, see canopy_night_half_hour
+    */
+    cw->num_indexed = c->hour_idx;
+    n = 0;
+    for (i = 0; i < cw->num_indexed; i++) {
+        if (cw->ele_store[i] > 0.0 && ma->par[i] > 20.0)
+            n++;
+    }
+    cw->daytime = malloc(MAX(n, 1) * sizeof(long));
+    if (cw->daytime == NULL) {
+        fprintf(stderr, "malloc failed allocating daytime index\n");
+        exit(EXIT_FAILURE);
+    }
+    cw->num_daytime = 0;
+    for (i = 0; i < cw->num_indexed; i++) {
+        if (cw->ele_store[i] > 0.0 && ma->par[i] > 20.0)
+            cw->daytime[cw->num_daytime++] = i;
+    }
+
     return;
 
 }
+
+void store_solar_geometry(canopy_wk *cw, params *p, int doy, int hod,
+                          double par, long idx) {
+    /* one half-hour's solar geometry, into slot idx of the stores */
+    double sw_rad = par * PAR_2_SW; /* W m-2 */
+
+    calculate_solar_geometry(cw, p, doy, hod);
+    get_diffuse_frac(cw, doy, sw_rad);
+    cw->cz_store[idx] = cw->cos_zenith;
+    cw->ele_store[idx] = cw->elevation;
+    cw->df_store[idx] = cw->diffuse_frac;
+
+    return;
+}
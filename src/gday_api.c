@@ -0,0 +1,703 @@
+/* ============================================================================
+* Embedding API
+*
+* The model as a library: open a .cfg file once, point the forcing at the
+* caller's arrays, then run as often as needed with the daily outputs going
+* straight into the caller's buffer. No met, output or state files are
+* touched after gday_open. See gday_api.h for the calls, and python/ and R/
+* for the bindings built on it.
+*
+* NOTES:
+*   Each model keeps the setup as it was after gday_open (a model_base, as
+*   --overrides and --sweep use) and every run starts from a fresh copy of
+*   it. The met arrays are shared, never written, which is what lets clones
+*   run in parallel over one copy of the forcing.
+*
+* =========================================================================== */
+#include <stddef.h>
+#include <stdarg.h>
+#include "gday.h"
+#include "gday_api.h"
+
+/* which time step a met column belongs to */
+#define MET_DAILY 1
+#define MET_SUBDAILY 2
+#define MET_BOTH 3
+
+typedef struct {
+    const char *name;           /* as in the met file header */
+    size_t      offset;         /* of the array in met_arrays */
+    int         when;
+} met_column;
+
+static const met_column met_columns[] = {
+    {"year",    offsetof(met_arrays, year),    MET_BOTH},
+    {"doy",     offsetof(met_arrays, prjday),  MET_DAILY},
+    {"doy",     offsetof(met_arrays, doy),     MET_SUBDAILY},
+    {"rain",    offsetof(met_arrays, rain),    MET_BOTH},
+    {"par",     offsetof(met_arrays, par),     MET_SUBDAILY},
+    {"tair",    offsetof(met_arrays, tair),    MET_BOTH},
+    {"tsoil",   offsetof(met_arrays, tsoil),   MET_BOTH},
+    {"vpd",     offsetof(met_arrays, vpd),     MET_SUBDAILY},
+    {"co2",     offsetof(met_arrays, co2),     MET_BOTH},
+    {"ndep",    offsetof(met_arrays, ndep),    MET_BOTH},
+    {"nfix",    offsetof(met_arrays, nfix),    MET_BOTH},
+    {"wind",    offsetof(met_arrays, wind),    MET_BOTH},
+    {"press",   offsetof(met_arrays, press),   MET_BOTH},
+    {"tam",     offsetof(met_arrays, tam),     MET_DAILY},
+    {"tpm",     offsetof(met_arrays, tpm),     MET_DAILY},
+    {"tmin",    offsetof(met_arrays, tmin),    MET_DAILY},
+    {"tmax",    offsetof(met_arrays, tmax),    MET_DAILY},
+    {"tday",    offsetof(met_arrays, tday),    MET_DAILY},
+    {"vpd_am",  offsetof(met_arrays, vpd_am),  MET_DAILY},
+    {"vpd_pm",  offsetof(met_arrays, vpd_pm),  MET_DAILY},
+    {"wind_am", offsetof(met_arrays, wind_am), MET_DAILY},
+    {"wind_pm", offsetof(met_arrays, wind_pm), MET_DAILY},
+    {"par_am",  offsetof(met_arrays, par_am),  MET_DAILY},
+    {"par_pm",  offsetof(met_arrays, par_pm),  MET_DAILY},
+    {NULL,      0,                             0}
+};
+
+/* half-hourly canopy values gday_read knows */
+typedef struct {
+    const char *name;
+    size_t      offset;         /* of the value in canopy_wk */
+} canopy_value;
+
+static const canopy_value canopy_values[] = {
+    {"an_canopy",    offsetof(canopy_wk, an_canopy)},
+    {"rd_canopy",    offsetof(canopy_wk, rd_canopy)},
+    {"gsc_canopy",   offsetof(canopy_wk, gsc_canopy)},
+    {"apar_canopy",  offsetof(canopy_wk, apar_canopy)},
+    {"trans_canopy", offsetof(canopy_wk, trans_canopy)},
+    {"rnet_canopy",  offsetof(canopy_wk, rnet_canopy)},
+    {"omega_canopy", offsetof(canopy_wk, omega_canopy)},
+    {"lwp_canopy",   offsetof(canopy_wk, lwp_canopy)},
+    {"tleaf_sunlit", offsetof(canopy_wk, tleaf[SUNLIT])},
+    {"tleaf_shaded", offsetof(canopy_wk, tleaf[SHADED])},
+    {NULL,           0}
+};
+
+/* and the leaf solver counts, since the run (or stepped run) started */
+static const canopy_value canopy_counts[] = {
+    {"leaf_solves_cold",  offsetof(canopy_wk, leaf_solves[0])},
+    {"leaf_solves_warm",  offsetof(canopy_wk, leaf_solves[1])},
+    {"leaf_passes_cold",  offsetof(canopy_wk, leaf_passes[0])},
+    {"leaf_passes_warm",  offsetof(canopy_wk, leaf_passes[1])},
+    {"emax_checks",       offsetof(canopy_wk, emax_checks)},
+    {"emax_limited",      offsetof(canopy_wk, emax_limited)},
+    {NULL,                0}
+};
+
+/* records in the stepping met buffer, one day */
+#define STEP_RECORDS 48
+#define NMET_COLUMNS (sizeof(met_columns) / sizeof(met_columns[0]) - 1)
+
+struct gday_model {
+    model_base  base;           /* what every run starts from */
+    canopy_wk   cw;
+    control     c;
+    fluxes      f;
+    fast_spinup fs;
+    params      p;
+    state       s;
+    met_arrays  ma;
+    met         m;
+    nrutil      nr;
+    double     *day_length;
+    int         owns_met;       /* ma was read by gday_load_met */
+    long        nforcing;       /* records in each met array, 0 = unset */
+    int         nout;
+    int        *col;            /* selected daily outputs */
+    char        error[STRING_LENGTH];
+
+    /* a stepped run, between gday_begin and gday_end */
+    int         stepping;
+    sim_loop    sl;
+    met_arrays  step_ma;        /* points into step_met */
+    double      step_met[NMET_COLUMNS][STEP_RECORDS];
+    int         year;           /* of the last step, -1 before the first */
+    int         doy;
+    int         hod;
+    double      prev_topsoil;   /* water stores at the start of the day */
+    double      prev_rootzone;
+    int         have_day;       /* daily holds a completed day */
+    double      daily[NDAILY_OUTPUTS];
+};
+
+static int    fail(gday_model *, const char *, ...);
+static int    when_now(gday_model *);
+static double **met_array(met_arrays *, const met_column *);
+static int    count_years(gday_model *);
+static int    enter_day(gday_model *, int, int);
+static void   finish_day(gday_model *);
+
+
+gday_model *gday_open(const char *cfg_fname) {
+    /*
+        Parse the .cfg file (and any state snapshot it names), NULL if it
+        can't be read. Nothing is written, so the output and spin-up options
+        are switched off.
+    */
+    gday_model *g = NULL;
+    model_base *base = NULL;
+    int         i;
+
+    if ((g = calloc(1, sizeof(gday_model))) == NULL)
+        return (NULL);
+    if ((g->day_length = calloc(366, sizeof(double))) == NULL ||
+        (g->col = malloc(NDAILY_OUTPUTS * sizeof(int))) == NULL) {
+        gday_close(g);
+        return (NULL);
+    }
+
+    initialise_control(&g->c);
+    initialise_params(&g->p);
+    initialise_fluxes(&g->f);
+    initialise_state(&g->s);
+    initialise_nrutil(&g->nr);
+    g->s.day_length = g->day_length;
+
+    snprintf(g->c.cfg_path, STRING_LENGTH, "%s", cfg_fname);
+    strcpy(g->c.cfg_fname, g->c.cfg_path);
+    if (access(g->c.cfg_path, R_OK) != 0 ||
+        parse_ini_file(&g->c, &g->p, &g->s) != 0) {
+        gday_close(g);
+        return (NULL);
+    }
+    fclose(g->c.ifp);
+    g->c.ifp = NULL;
+    strcpy(g->c.git_code_ver, build_git_sha);
+    read_state_snapshot(&g->c, &g->p, &g->s);
+
+    g->c.print_options = NONE;
+    g->c.output_format = NATIVE;
+    g->c.spin_up = FALSE;
+    if (check_flags(&g->c) > 0) {
+        gday_close(g);
+        return (NULL);
+    }
+
+    g->nout = NDAILY_OUTPUTS;
+    for (i = 0; i < NDAILY_OUTPUTS; i++)
+        g->col[i] = i;
+
+    base = save_model_base(&g->cw, &g->c, &g->f, &g->fs, &g->p, &g->s);
+    g->base = *base;
+    free(base);
+
+    return (g);
+}
+
+int gday_api_version(void) {
+    return (GDAY_API_VERSION);
+}
+
+gday_model *gday_clone(const gday_model *g) {
+    /* an independent copy, sharing (but not owning) the forcing */
+    gday_model *copy = NULL;
+
+    if (g->stepping)
+        return (NULL);
+    if ((copy = malloc(sizeof(gday_model))) == NULL)
+        return (NULL);
+    *copy = *g;
+    copy->day_length = calloc(366, sizeof(double));
+    copy->col = malloc(NDAILY_OUTPUTS * sizeof(int));
+    if (copy->day_length == NULL || copy->col == NULL) {
+        free(copy->day_length);
+        free(copy->col);
+        free(copy);
+        return (NULL);
+    }
+    memcpy(copy->col, g->col, g->nout * sizeof(int));
+    copy->base.s.day_length = copy->day_length;
+    copy->owns_met = FALSE;
+
+    return (copy);
+}
+
+void gday_close(gday_model *g) {
+
+    if (g == NULL)
+        return;
+    if (g->stepping)
+        gday_end(g);
+    if (g->owns_met)
+        free_met_data(&g->base.c, &g->ma);
+    free(g->day_length);
+    free(g->col);
+    free(g);
+
+    return;
+}
+
+const char *gday_error(const gday_model *g) {
+    return (g->error);
+}
+
+int gday_set(gday_model *g, const char *key, const char *value) {
+    /* change a .cfg value for the runs that follow */
+    const reg_field *fld = NULL;
+
+    if ((fld = registry_lookup_key(key)) == NULL)
+        return (fail(g, "Unknown key %s, expected section.key", key));
+    if (g->nforcing > 0 && strcmp(fld->name, "sub_daily") == 0)
+        return (fail(g, "Set control.sub_daily before the forcing"));
+    if (!registry_set(fld, value, &g->base.c, &g->base.p, &g->base.s))
+        return (fail(g, "Unknown %s option: %s", fld->name, value));
+    if (check_flags(&g->base.c) > 0)
+        return (fail(g, "%s = %s gives flags the model can't run", key,
+                     value));
+
+    return (0);
+}
+
+int gday_get(const gday_model *g, const char *key, char *buf, int len) {
+    /* the value as it would appear in the .cfg file */
+    const reg_field *fld = NULL;
+    gday_model      *gm = (gday_model *)g;
+
+    if ((fld = registry_lookup_key(key)) == NULL)
+        return (fail(gm, "Unknown key %s, expected section.key", key));
+    registry_format(fld, buf, len, &gm->base.c, &gm->base.p, &gm->base.s);
+
+    return (0);
+}
+
+int gday_set_forcing(gday_model *g, const char *name, const double *values,
+                     long n) {
+    /* point one met column at the caller's array */
+    const met_column *mc = NULL;
+    int               when = when_now(g);
+
+    if (g->owns_met)
+        return (fail(g, "Forcing was read by gday_load_met"));
+    if (g->nforcing > 0 && n != g->nforcing)
+        return (fail(g, "%s has %ld values, the other met columns %ld", name,
+                     n, g->nforcing));
+
+    for (mc = met_columns; mc->name != NULL; mc++) {
+        if (strcmp(mc->name, name) == 0 && (mc->when & when))
+            break;
+    }
+    if (mc->name == NULL)
+        return (fail(g, "%s isn't a %s met column", name,
+                     g->base.c.sub_daily ? "sub-daily" : "daily"));
+
+    *met_array(&g->ma, mc) = (double *)values;
+    g->nforcing = n;
+
+    return (0);
+}
+
+int gday_load_met(gday_model *g) {
+    /* read files.met_fname, as a normal run would */
+    char *argv[] = {"gday", NULL};
+
+    gday_clear_forcing(g);
+
+    if (g->base.c.sub_daily)
+        read_subdaily_met_data(argv, &g->base.c, &g->ma);
+    else
+        read_daily_met_data(argv, &g->base.c, &g->ma);
+    g->owns_met = TRUE;
+    g->nforcing = g->base.c.total_num_days;
+    if (g->base.c.sub_daily)
+        g->nforcing *= g->base.c.num_hlf_hrs;
+
+    return (0);
+}
+
+void gday_clear_forcing(gday_model *g) {
+    /* no forcing, as after gday_open */
+
+    if (g->owns_met)
+        free_met_data(&g->base.c, &g->ma);
+    memset(&g->ma, 0, sizeof(met_arrays));
+    g->owns_met = FALSE;
+    g->nforcing = 0;
+
+    return;
+}
+
+long gday_ndays(const gday_model *g) {
+    if (g->base.c.sub_daily)
+        return (g->nforcing / g->base.c.num_hlf_hrs);
+    return (g->nforcing);
+}
+
+int gday_num_daily_outputs(void) {
+    return (NDAILY_OUTPUTS);
+}
+
+const char *gday_daily_output_name(int i) {
+    if (i < 0 || i >= NDAILY_OUTPUTS)
+        return (NULL);
+    return (daily_output_names[i]);
+}
+
+int gday_select_outputs(gday_model *g, const char **names, int n) {
+    /*
+        keep only these daily outputs, in this order. Every name is looked
+        up before any is kept, so a bad list leaves the selection as it was
+    */
+    int i, j, col[NDAILY_OUTPUTS];
+
+    if (n < 1 || n > NDAILY_OUTPUTS)
+        return (fail(g, "Between 1 and %d outputs can be selected, not %d",
+                     NDAILY_OUTPUTS, n));
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < NDAILY_OUTPUTS; j++) {
+            if (strcmp(names[i], daily_output_names[j]) == 0)
+                break;
+        }
+        if (j == NDAILY_OUTPUTS)
+            return (fail(g, "Unknown output %s", names[i]));
+        col[i] = j;
+    }
+    memcpy(g->col, col, n * sizeof(int));
+    g->nout = n;
+
+    return (0);
+}
+
+int gday_noutputs(const gday_model *g) {
+    return (g->nout);
+}
+
+const char *gday_output_name(const gday_model *g, int i) {
+    if (i < 0 || i >= g->nout)
+        return (NULL);
+    return (daily_output_names[g->col[i]]);
+}
+
+long gday_run(gday_model *g, double *out, long max_days) {
+    /* one run over the whole forcing, from the saved setup */
+    output_capture    oc;
+    const met_column *mc = NULL;
+    int               when = when_now(g);
+
+    if (g->stepping)
+        return (fail(g, "A stepped run is under way, call gday_end first"));
+    if (g->nforcing == 0)
+        return (fail(g, "No forcing, call gday_set_forcing or gday_load_met"));
+    for (mc = met_columns; mc->name != NULL; mc++) {
+        if ((mc->when & when) && *met_array(&g->ma, mc) == NULL)
+            return (fail(g, "Met column %s hasn't been set", mc->name));
+    }
+    if (g->base.c.sub_daily && g->nforcing % g->base.c.num_hlf_hrs != 0)
+        return (fail(g, "Sub-daily forcing isn't a whole number of days"));
+    if (max_days < gday_ndays(g))
+        return (fail(g, "Output buffer holds %ld days, the run is %ld",
+                     max_days, gday_ndays(g)));
+
+    restore_model_base(&g->base, &g->cw, &g->c, &g->f, &g->fs, &g->p, &g->s);
+    g->c.print_options = NONE;
+    g->c.output_format = NATIVE;
+    g->c.spin_up = FALSE;
+    g->c.total_num_days = gday_ndays(g);
+    if (count_years(g) != 0)
+        return (-1);
+
+    oc.nout = g->nout;
+    oc.col = g->col;
+    oc.buf = out;
+    oc.max_days = max_days;
+    oc.ndays = 0;
+    g->c.capture = &oc;
+
+    run_model(&g->cw, &g->c, &g->f, &g->fs, &g->ma, &g->m, &g->p, &g->s,
+              &g->nr);
+    g->c.capture = NULL;
+
+    return (oc.ndays);
+}
+
+int gday_begin(gday_model *g) {
+    /* start a stepped run from the saved setup */
+    size_t i;
+
+    if (g->stepping)
+        return (fail(g, "A stepped run is under way, call gday_end first"));
+    if (g->base.c.deciduous_model)
+        return (fail(g, "Deciduous phenology needs the whole year's forcing, "
+                        "it can't be stepped"));
+    if (g->base.c.disturbance)
+        return (fail(g, "Disturbances need the whole forcing, they can't be "
+                        "stepped"));
+    if (g->base.c.num_hlf_hrs > STEP_RECORDS)
+        return (fail(g, "Stepping holds %d half-hours a day, not %d",
+                     STEP_RECORDS, g->base.c.num_hlf_hrs));
+
+    restore_model_base(&g->base, &g->cw, &g->c, &g->f, &g->fs, &g->p, &g->s);
+    g->c.print_options = NONE;
+    g->c.output_format = NATIVE;
+    g->c.spin_up = FALSE;
+
+    /* one day of forcing at a time, the solar geometry a day at a time */
+    memset(&g->step_ma, 0, sizeof(met_arrays));
+    for (i = 0; i < NMET_COLUMNS; i++)
+        *met_array(&g->step_ma, &met_columns[i]) = g->step_met[i];
+    g->c.total_num_days = 1;
+    g->c.num_years = 0;
+
+    setup_run(&g->cw, &g->c, &g->f, &g->step_ma, &g->p, &g->s, &g->nr);
+    start_sim(&g->cw, &g->c, &g->f, &g->fs, &g->step_ma, &g->p, &g->s,
+              &g->sl);
+    g->year = -1;
+    g->doy = 0;
+    g->hod = g->c.num_hlf_hrs - 1;
+    g->have_day = FALSE;
+    g->stepping = TRUE;
+
+    return (0);
+}
+
+int gday_step_day(gday_model *g, const gday_met_day *met) {
+    /* advance a daily model by one day */
+    met_arrays *ma = &g->step_ma;
+    int         doy = met->doy - 1;
+
+    if (!g->stepping)
+        return (fail(g, "Call gday_begin before stepping"));
+    if (g->c.sub_daily)
+        return (fail(g, "A sub_daily model steps by gday_step_halfhour"));
+    if (enter_day(g, met->year, met->doy) != 0)
+        return (-1);
+
+    ma->year[0] = met->year;
+    ma->prjday[0] = met->doy;
+    ma->tair[0] = met->tair;
+    ma->rain[0] = met->rain;
+    ma->tsoil[0] = met->tsoil;
+    ma->tam[0] = met->tam;
+    ma->tpm[0] = met->tpm;
+    ma->tmin[0] = met->tmin;
+    ma->tmax[0] = met->tmax;
+    ma->tday[0] = met->tday;
+    ma->vpd_am[0] = met->vpd_am;
+    ma->vpd_pm[0] = met->vpd_pm;
+    ma->co2[0] = met->co2;
+    ma->ndep[0] = met->ndep;
+    ma->nfix[0] = met->nfix;
+    ma->wind[0] = met->wind;
+    ma->press[0] = met->press;
+    ma->wind_am[0] = met->wind_am;
+    ma->wind_pm[0] = met->wind_pm;
+    ma->par_am[0] = met->par_am;
+    ma->par_pm[0] = met->par_pm;
+
+    g->c.day_idx = 0;
+    start_day(&g->c, &g->f, &g->fs, ma, &g->m, &g->p, &g->s, &g->sl, doy);
+    calc_day_growth(&g->cw, &g->c, &g->f, &g->fs, ma, &g->m, &g->nr, &g->p,
+                    &g->s, g->s.day_length[doy], doy, g->sl.fdecay,
+                    g->sl.rdecay);
+    finish_day(g);
+
+    return (0);
+}
+
+int gday_step_halfhour(gday_model *g, const gday_met_halfhour *met) {
+    /* advance a sub_daily model by one half-hour */
+    met_arrays *ma = &g->step_ma;
+    int         doy = met->doy - 1, hod = met->hod;
+    int         nhh = g->c.num_hlf_hrs;
+
+    if (!g->stepping)
+        return (fail(g, "Call gday_begin before stepping"));
+    if (!g->c.sub_daily)
+        return (fail(g, "A daily model steps by gday_step_day"));
+    if (hod != (g->hod + 1) % nhh)
+        return (fail(g, "Half-hour %d follows %d, expected %d", hod, g->hod,
+                     (g->hod + 1) % nhh));
+
+    if (hod == 0) {
+        if (enter_day(g, met->year, met->doy) != 0)
+            return (-1);
+        ma->year[0] = met->year;
+        g->c.day_idx = 0;
+        start_day(&g->c, &g->f, &g->fs, ma, &g->m, &g->p, &g->s, &g->sl,
+                  doy);
+        g->prev_topsoil = g->s.pawater_topsoil;
+        g->prev_rootzone = g->s.pawater_root;
+        canopy_start_day(&g->cw, &g->c, &g->f, &g->p, &g->s);
+    } else if (met->year != g->year || met->doy != g->doy) {
+        return (fail(g, "Half-hour %d of %d/%d part way through %d/%d", hod,
+                     met->year, met->doy, g->year, g->doy));
+    }
+
+    ma->year[hod] = met->year;
+    ma->doy[hod] = met->doy;
+    ma->rain[hod] = met->rain;
+    ma->par[hod] = met->par;
+    ma->tair[hod] = met->tair;
+    ma->tsoil[hod] = met->tsoil;
+    ma->vpd[hod] = met->vpd;
+    ma->co2[hod] = met->co2;
+    ma->ndep[hod] = met->ndep;
+    ma->nfix[hod] = met->nfix;
+    ma->wind[hod] = met->wind;
+    ma->press[hod] = met->press;
+    store_solar_geometry(&g->cw, &g->p, doy, hod, met->par, hod);
+
+    g->c.hour_idx = hod;
+    canopy_half_hour(&g->cw, &g->c, &g->f, ma, &g->m, &g->nr, &g->p, &g->s,
+                     hod);
+    g->hod = hod;
+    if (hod < nhh - 1)
+        return (0);
+
+    canopy_end_day(&g->c, &g->f, &g->p, &g->s, nhh);
+    finish_day_growth(&g->c, &g->f, &g->fs, &g->m, &g->p, &g->s,
+                      g->s.day_length[doy], doy, g->sl.fdecay, g->sl.rdecay,
+                      g->prev_topsoil, g->prev_rootzone);
+    finish_day(g);
+
+    return (1);
+}
+
+int gday_end(gday_model *g) {
+    /* finish a stepped run, the year end if the last day was the last */
+
+    if (!g->stepping)
+        return (fail(g, "No stepped run to end"));
+    if (g->year >= 0 && g->doy == (is_leap_year(g->year) ? 366 : 365) &&
+        g->hod == g->c.num_hlf_hrs - 1)
+        end_year(&g->c, &g->f, &g->p, &g->s);
+    end_sim(&g->c, &g->p, &g->s, &g->sl);
+    close_output_files(&g->c);
+    free_run(&g->cw, &g->c, &g->f, &g->p, &g->s, &g->nr);
+    g->stepping = FALSE;
+
+    return (0);
+}
+
+int gday_read(const gday_model *g, const char *name, double *value) {
+    /* see gday_api.h for the names */
+    const canopy_value *cv = NULL;
+    const reg_field    *fld = NULL;
+    gday_model         *gm = (gday_model *)g;
+    control            *c = g->stepping ? &gm->c : &gm->base.c;
+    params             *p = g->stepping ? &gm->p : &gm->base.p;
+    state              *s = g->stepping ? &gm->s : &gm->base.s;
+    void               *ptr = NULL;
+    int                 i;
+
+    for (cv = canopy_values; cv->name != NULL; cv++) {
+        if (strcmp(cv->name, name) == 0) {
+            *value = *(double *)((char *)&g->cw + cv->offset);
+            return (0);
+        }
+    }
+    for (cv = canopy_counts; cv->name != NULL; cv++) {
+        if (strcmp(cv->name, name) == 0) {
+            *value = (double)*(long *)((char *)&g->cw + cv->offset);
+            return (0);
+        }
+    }
+    if (strcmp(name, "leaf_nonconverged") == 0) {
+        *value = (double)g->cw.nonconverged;
+        return (0);
+    }
+    for (i = 0; i < NDAILY_OUTPUTS; i++) {
+        if (strcmp(daily_output_names[i], name) == 0) {
+            if (!g->have_day)
+                return (fail(gm, "%s: no day has been completed", name));
+            *value = g->daily[i];
+            return (0);
+        }
+    }
+
+    if ((fld = registry_lookup_key(name)) == NULL)
+        return (fail(gm, "Unknown name %s", name));
+    ptr = registry_ptr(fld, c, p, s);
+    if (fld->type == REG_DOUBLE)
+        *value = *(double *)ptr;
+    else if (fld->type == REG_STRING)
+        return (fail(gm, "%s isn't a number", name));
+    else
+        *value = (double)*(int *)ptr;
+
+    return (0);
+}
+
+static int enter_day(gday_model *g, int year, int doy) {
+    /* check the day follows on from the last, starting a year if need be */
+    int ndays = is_leap_year(year) ? 366 : 365;
+
+    if (doy < 1 || doy > ndays)
+        return (fail(g, "Day %d of %d is out of range", doy, year));
+    if (g->year >= 0 &&
+        !(year == g->year && doy == g->doy + 1) &&
+        !(year == g->year + 1 && doy == 1 &&
+          g->doy == (is_leap_year(g->year) ? 366 : 365)))
+        return (fail(g, "%d/%d doesn't follow %d/%d", year, doy, g->year,
+                     g->doy));
+
+    if (year != g->year) {
+        if (g->year >= 0)
+            end_year(&g->c, &g->f, &g->p, &g->s);
+        start_year(&g->c, &g->f, &g->step_ma, &g->p, &g->s, &g->sl, year);
+    }
+    g->year = year;
+    g->doy = doy;
+
+    return (0);
+}
+
+static void finish_day(gday_model *g) {
+    /* the rest of the day, and keep its outputs for gday_read */
+
+    end_day(&g->cw, &g->c, &g->f, &g->fs, &g->step_ma, &g->m, &g->p, &g->s,
+            &g->sl, g->doy - 1);
+    pack_daily_outputs(&g->c, &g->cw, &g->f, &g->s, g->year, g->doy,
+                       g->daily);
+    g->have_day = TRUE;
+
+    return;
+}
+
+static int when_now(gday_model *g) {
+    return (g->base.c.sub_daily ? MET_SUBDAILY : MET_DAILY);
+}
+
+static double **met_array(met_arrays *ma, const met_column *mc) {
+    return ((double **)((char *)ma + mc->offset));
+}
+
+static int count_years(gday_model *g) {
+    /*
+        The model steps through whole years, check the forcing holds them
+        and count them, as read_daily_met_data does
+    */
+    long   i, start = 0, n = g->nforcing;
+    long   steps = g->c.sub_daily ? g->c.num_hlf_hrs : 1;
+    double *year = g->ma.year;
+    int    expected;
+
+    g->c.num_years = 0;
+    for (i = 1; i <= n; i++) {
+        if (i < n && year[i] == year[start])
+            continue;
+        expected = is_leap_year((int)year[start]) ? 366 : 365;
+        if (i - start != expected * steps)
+            return (fail(g, "Forcing year %d has %ld records, expected %ld",
+                         (int)year[start], i - start, expected * steps));
+        g->c.num_years++;
+        start = i;
+    }
+
+    return (0);
+}
+
+static int fail(gday_model *g, const char *fmt, ...) {
+    /* keep the message for gday_error */
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(g->error, sizeof(g->error), fmt, args);
+    va_end(args);
+
+    return (-1);
+}
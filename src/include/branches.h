@@ -0,0 +1,35 @@
+#ifndef BRANCHES_H
+#define BRANCHES_H
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "gday.h"
+
+/* what fork_branches returns to run_sim */
+#define BRANCH_PARENT 0
+#define BRANCH_CHILD 1
+
+typedef struct {
+    char                  name[STRING_LENGTH];
+    struct override_list *ol;
+    forcing_view          fv;
+} branch;
+
+typedef struct branch_setup {
+    int     start_year;     /* first year which differs between branches */
+    int     jobs;           /* branches running at once */
+    int     spin_up;
+    int     nbranches;
+    int     max_branches;
+    branch *items;
+} branch_setup;
+
+void run_branches(canopy_wk *, control *, fluxes *, fast_spinup *,
+                  met_arrays *, met *, params *, state *, nrutil *);
+int  fork_branches(canopy_wk *, control *, met_arrays *, params *, state *);
+void init_forcing_view(forcing_view *);
+int  set_forcing_view(forcing_view *, const char *, const char *);
+void adjust_forcing(met_arrays *, long, long, forcing_view *);
+
+#endif /* BRANCHES_H */
@@ -13,14 +13,38 @@
 #include "utilities.h"
 #include "radiation.h"
 #include "photosynthesis.h"
+#include "canopy_batch.h"
+#include "canopy_trace.h"
 
 /* C stuff */
 void    initialise_leaf_surface(canopy_wk *, met *);
+void    warm_start_leaf_surface(canopy_wk *, met *);
+void    keep_leaf_surface(canopy_wk *, met *, int);
 void    zero_carbon_day_fluxes(fluxes *);
 void    zero_hourly_fluxes(canopy_wk *);
 void    update_daily_carbon_fluxes(fluxes *, params *, double, double);
 void    canopy(canopy_wk *, control *, fluxes *, met_arrays *, met *,
                nrutil *nr, params *, state *);
+void    canopy_start_day(canopy_wk *, control *, fluxes *, params *,
+                         state *);
+void    canopy_half_hour(canopy_wk *, control *, fluxes *, met_arrays *, met *,
+                         nrutil *, params *, state *, int);
+void    canopy_leaves(canopy_wk *, control *, fluxes *, met *, params *,
+                      state *, double, double, int);
+double  next_leaf_temperature(control *, double, double, int, double *,
+                              double *);
+void    leaf_not_converged(canopy_wk *, double, double, int);
+void    print_leaf_solves(FILE *, canopy_wk *);
+void    canopy_night_half_hour(canopy_wk *, control *, fluxes *, met_arrays *,
+                               met *, nrutil *, params *, state *, int);
+long    first_daytime(canopy_wk *, long);
+void    canopy_night(canopy_wk *, control *, met *, state *, int);
+void    canopy_finish_half_hour(canopy_wk *, control *, fluxes *, met *,
+                                nrutil *, params *, state *, int, double,
+                                double);
+void    canopy_water_balance(canopy_wk *, control *, fluxes *, met *,
+                             nrutil *, params *, state *, int, double, double);
+void    canopy_end_day(control *, fluxes *, params *, state *, int);
 void    solve_leaf_energy_balance(control *, canopy_wk *, fluxes *, met *,
                                   params *, state *, double);
 void    sum_hourly_carbon_fluxes(canopy_wk *, fluxes *, params *);
@@ -32,6 +56,7 @@ void    unpack_solar_geometry(canopy_wk *, control *);
 /* SPA stuff */
 
 double  calc_lwp(fluxes *, state *, double, double);
-void  calculate_emax(control *, canopy_wk *, fluxes *, met *, params *,
-                     state *, double *);
+double  calculate_water_supply(canopy_wk *, fluxes *, params *, state *,
+                               double *);
+void    calculate_emax(canopy_wk *, met *, params *, double);
 #endif /* CANOPY_H */
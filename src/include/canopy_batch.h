@@ -0,0 +1,98 @@
+#ifndef CANOPY_BATCH_H
+#define CANOPY_BATCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "gday.h"
+#include "constants.h"
+#include "canopy.h"
+#include "radiation.h"
+#include "photosynthesis.h"
+#include "water_balance.h"
+
+/* every daytime half-hour of a day, sunlit and shaded */
+#define MAX_CANOPY_LANES (48 * NUM_LEAVES)
+
+/*
+    One lane per (half-hour, leaf) work item, each quantity an array over the
+    lanes so the kernel loops run straight down them. REAL is double, or
+    float for canopy_kernel = batched_float, which packs twice the lanes into
+    each vector.
+*/
+#define CANOPY_LANES(REAL) struct { \
+    int    n;                           /* lanes in use */                    \
+                                                                              \
+    /* forcing and absorbed radiation */                                      \
+    REAL   tair[MAX_CANOPY_LANES];      /* deg C */                           \
+    REAL   vpd[MAX_CANOPY_LANES];       /* Pa */                              \
+    REAL   Ca[MAX_CANOPY_LANES];        /* umol mol-1 */                      \
+    REAL   press[MAX_CANOPY_LANES];     /* Pa */                              \
+    REAL   wind[MAX_CANOPY_LANES];      /* m s-1 */                           \
+    REAL   apar[MAX_CANOPY_LANES];      /* umol m-2 s-1 */                    \
+    REAL   scalex[MAX_CANOPY_LANES];    /* single leaf to canopy scalar */    \
+    REAL   N0[MAX_CANOPY_LANES];        /* top of canopy N (g N m-2) */       \
+                                                                              \
+    /* fixed for the lane's half-hour, worked out once */                     \
+    REAL   rnet[MAX_CANOPY_LANES];      /* leaf net radiation (W m-2) */      \
+    REAL   gradn[MAX_CANOPY_LANES];     /* radiation conductance */           \
+    REAL   gbhu[MAX_CANOPY_LANES];      /* forced convection conductance */   \
+    REAL   lambda[MAX_CANOPY_LANES];                                          \
+    REAL   gamma[MAX_CANOPY_LANES];                                           \
+    REAL   slope[MAX_CANOPY_LANES];                                           \
+                                                                              \
+    /* temperature dependent terms, per pass */                               \
+    REAL   gamma_star[MAX_CANOPY_LANES];                                      \
+    REAL   km[MAX_CANOPY_LANES];                                              \
+    REAL   jmax[MAX_CANOPY_LANES];                                            \
+    REAL   vcmax[MAX_CANOPY_LANES];                                           \
+    REAL   gbhf[MAX_CANOPY_LANES];      /* free convection conductance */     \
+                                                                              \
+    /* leaf surface, iterated */                                              \
+    REAL   tleaf[MAX_CANOPY_LANES];                                           \
+    REAL   Cs[MAX_CANOPY_LANES];                                              \
+    REAL   dleaf[MAX_CANOPY_LANES];     /* Pa */                              \
+    REAL   tleaf_prev[MAX_CANOPY_LANES]; /* last (Tleaf, residual), secant */ \
+    REAL   resid_prev[MAX_CANOPY_LANES];                                      \
+                                                                              \
+    /* this pass, worked out for every lane and kept for the active ones */   \
+    REAL   pass_an[MAX_CANOPY_LANES];                                         \
+    REAL   pass_rd[MAX_CANOPY_LANES];                                         \
+    REAL   pass_gsc[MAX_CANOPY_LANES];                                        \
+    REAL   pass_trans[MAX_CANOPY_LANES];                                      \
+    REAL   pass_omega[MAX_CANOPY_LANES];                                      \
+    REAL   pass_tleaf[MAX_CANOPY_LANES];                                      \
+    REAL   pass_Cs[MAX_CANOPY_LANES];                                         \
+    REAL   pass_dleaf[MAX_CANOPY_LANES];                                      \
+    int    pass_normal[MAX_CANOPY_LANES];                                     \
+                                                                              \
+    /* results, as the canopy_wk leaf values */                               \
+    REAL   an[MAX_CANOPY_LANES];                                              \
+    REAL   rd[MAX_CANOPY_LANES];                                              \
+    REAL   gsc[MAX_CANOPY_LANES];                                             \
+    REAL   trans[MAX_CANOPY_LANES];                                           \
+    REAL   omega[MAX_CANOPY_LANES];                                           \
+    REAL   tleaf_new[MAX_CANOPY_LANES];                                       \
+    int    rd_set[MAX_CANOPY_LANES];    /* rd worked out at least once */     \
+    int    checks[MAX_CANOPY_LANES];    /* energy balance passes */           \
+    int    iter[MAX_CANOPY_LANES];      /* leaf temperature iterations */     \
+    int    stalled[MAX_CANOPY_LANES];   /* ran out of iterations */           \
+    int    active[MAX_CANOPY_LANES];    /* still iterating */                 \
+}
+
+typedef CANOPY_LANES(double) canopy_lanes;
+typedef CANOPY_LANES(float)  canopy_lanes_float;
+
+void canopy_batched_day(canopy_wk *, control *, fluxes *, met_arrays *, met *,
+                        nrutil *, params *, state *);
+void compare_canopy_precision(canopy_wk *, control *, fluxes *, fast_spinup *,
+                              met_arrays *, met *, params *, state *,
+                              nrutil *);
+void solve_canopy_lanes(control *, params *, state *, canopy_lanes *);
+void canopy_lanes_solve(control *, params *, state *, canopy_lanes *);
+void canopy_lanes_solve_float(control *, params *, state *,
+                              canopy_lanes_float *);
+
+#endif /* CANOPY_BATCH_H */
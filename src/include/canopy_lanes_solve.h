@@ -0,0 +1,248 @@
+/*
+    The batched canopy kernel's solver, included by canopy_batch.c once per
+    precision with
+
+        REAL         double or float
+        R(x)         x as a REAL, so float arithmetic stays float
+        LANE_SQRT    sqrt or sqrtf
+        LANES        canopy_lanes or canopy_lanes_float
+        LANE_FN(f)   f's name for this precision
+
+    The functions it calls per lane (temperature responses, conductances,
+    net radiation) stay double, they aren't in the vectorised loops.
+*/
+
+static inline REAL LANE_FN(lane_quad)(REAL a, REAL b, REAL c, int large,
+                                      int *error) {
+    /*
+        quad() in photosynthesis.c, written without branches so that it
+        inlines into the lane loops and they still vectorise
+    */
+    REAL   d, root;
+    int    linear, none;
+
+    d = (b * b) - R(4.0) * a * c;
+    linear = (a == R(0.0)) & (b > R(0.0));
+    none = (a == R(0.0)) & (b == R(0.0));
+
+    root = large ? (-b + LANE_SQRT(d)) / (R(2.0) * a) :
+                   (-b - LANE_SQRT(d)) / (R(2.0) * a);
+    root = none ? R(0.0) : root;
+    root = linear ? -c / b : root;
+    *error = (d < R(0.0)) | (none & (c != R(0.0)));
+
+    return (root);
+}
+
+static inline int LANE_FN(lane_solve_ci)(REAL g0, REAL gs_over_a, REAL rd,
+                                         REAL Cs, REAL gamma_star, REAL gamma,
+                                         REAL beta, REAL *Ci) {
+    /* solve_ci() in photosynthesis.c, for the lane loops */
+    int    error;
+    REAL   A, B, C, arg1, arg2, arg3;
+
+    A = g0 + gs_over_a * (gamma - rd);
+
+    arg1 = (R(1.0) - Cs * gs_over_a) * (gamma - rd);
+    arg2 = g0 * (beta - Cs);
+    arg3 = gs_over_a * (gamma * gamma_star + beta * rd);
+    B = arg1 + arg2 - arg3;
+
+    arg1 = -(R(1.0) - Cs * gs_over_a);
+    arg2 = (gamma * gamma_star + beta * rd);
+    arg3 = g0 * beta * Cs;
+    C = arg1 * arg2 - arg3;
+
+    *Ci = LANE_FN(lane_quad)(A, B, C, TRUE, &error);
+
+    return (error);
+}
+
+void LANE_FN(canopy_lanes_solve)(control *c, params *p, state *s, LANES *l) {
+    /*
+        Iterate every lane's leaf temperature to convergence, following
+        photosynthesis_C3 and solve_leaf_energy_balance. A lane drops out
+        of the mask when An isn't > 1E-04 (no energy balance that pass, NaN
+        included), when Tleaf changes by less than 0.02 deg C or when it is
+        out of iterations (stalled). Tleaf steps as next_leaf_temperature
+        has it, the same as the half-hour loop.
+    */
+    int    i, n = l->n, nactive, normal;
+    REAL   g0 = R(1E-09); /* numerical issues, don't use zero */
+    REAL   rd, jmax, vcmax, J, Vj, A, B, C, dleaf_kpa, gs_over_a, Ci, Ac, Aj;
+    REAL   an, gbh, gh, gbv, gsv, gv, gbc, LE, trans, epsilon, Tdiff;
+    REAL   theta = p->theta, alpha_j = p->alpha_j;
+    REAL   g1 = p->g1 * s->wtfac_root;
+    double sw_rad, jmax_t, vcmax_t, tleaf_prev, resid_prev;
+    int    error;
+
+    /* half-hour constants and the initial leaf surface */
+    for (i = 0; i < n; i++) {
+        sw_rad = l->apar[i] * PAR_2_SW; /* W m-2 */
+        l->rnet[i] = calc_leaf_net_rad(p, s, l->tair[i], l->vpd[i], sw_rad);
+        l->gradn[i] = calc_radiation_conductance(l->tair[i]);
+        l->gbhu[i] = calc_bdn_layer_forced_conduct(l->tair[i], l->press[i],
+                                                   l->wind[i], p->leaf_width);
+        l->lambda[i] = calc_latent_heat_of_vapourisation(l->tair[i]);
+        l->gamma[i] = calc_pyschrometric_constant(l->press[i], l->lambda[i]);
+        l->slope[i] = temp_response(p, TT_SLOPE, l->tair[i]);
+
+        l->tleaf[i] = l->tair[i];
+        l->dleaf[i] = l->vpd[i];
+        l->Cs[i] = l->Ca[i];
+        l->gbhf[i] = R(0.0);
+        l->an[i] = R(0.0);
+        l->rd[i] = R(0.0);
+        l->gsc[i] = R(0.0);
+        l->trans[i] = R(0.0);
+        l->omega[i] = R(0.0);
+        l->tleaf_new[i] = l->tair[i];
+        l->rd_set[i] = FALSE;
+        l->checks[i] = 0;
+        l->iter[i] = 0;
+        l->stalled[i] = FALSE;
+        l->active[i] = TRUE;
+    }
+    nactive = n;
+
+    while (nactive > 0) {
+
+        /* temperature dependent terms */
+        for (i = 0; i < n; i++) {
+            if (l->active[i]) {
+                l->gamma_star[i] = temp_response(p, TT_GAMMA_STAR,
+                                                 l->tleaf[i]);
+                l->km[i] = temp_response(p, TT_KM, l->tleaf[i]);
+                calculate_jmaxt_vcmaxt(c, p, s, l->N0[i], l->tleaf[i],
+                                       &jmax_t, &vcmax_t);
+                l->jmax[i] = jmax_t;
+                l->vcmax[i] = vcmax_t;
+            }
+        }
+
+        /* photosynthesis and Medlyn gs, worked out for every lane */
+        for (i = 0; i < n; i++) {
+            rd = R(0.015) * l->vcmax[i];
+            vcmax = l->vcmax[i] * l->scalex[i];
+            jmax = l->jmax[i] * l->scalex[i];
+            rd *= l->scalex[i];
+
+            /* electron transport rate */
+            A = theta;
+            B = -(alpha_j * l->apar[i] + jmax);
+            C = alpha_j * l->apar[i] * jmax;
+            J = LANE_FN(lane_quad)(A, B, C, FALSE, &error);
+            Vj = J / R(4.0);
+
+            normal = !((jmax <= R(0.0)) | (vcmax <= R(0.0)) | isnan(J));
+
+            dleaf_kpa = l->dleaf[i] * R(PA_2_KPA);
+            dleaf_kpa = (dleaf_kpa < R(0.05)) ? R(0.05) : dleaf_kpa;
+            gs_over_a = (R(1.0) + g1 / LANE_SQRT(dleaf_kpa)) / l->Cs[i];
+
+            error = LANE_FN(lane_solve_ci)(g0, gs_over_a, rd, l->Cs[i],
+                                           l->gamma_star[i], vcmax, l->km[i],
+                                           &Ci);
+            Ac = (error | (Ci <= R(0.0)) | (Ci > l->Cs[i])) ? R(0.0) :
+                 vcmax * (Ci - l->gamma_star[i]) / (Ci + l->km[i]);
+
+            LANE_FN(lane_solve_ci)(g0, gs_over_a, rd, l->Cs[i],
+                                   l->gamma_star[i], Vj,
+                                   R(2.0) * l->gamma_star[i], &Ci);
+            Aj = Vj * (Ci - l->gamma_star[i]) /
+                 (Ci + R(2.0) * l->gamma_star[i]);
+
+            /* below light compensation point? */
+            Aj = (Aj - rd < R(1E-6)) ? Vj * (l->Cs[i] - l->gamma_star[i]) /
+                                       (l->Cs[i] + R(2.0) *
+                                        l->gamma_star[i]) : Aj;
+
+            an = normal ? MIN(Ac, Aj) - rd : -rd;
+            l->pass_an[i] = an;
+            l->pass_rd[i] = rd;
+            l->pass_gsc[i] = normal ? MAX(g0, g0 + gs_over_a * an) : g0;
+            l->pass_normal[i] = normal;
+        }
+
+        /* leaf energy balance, the lanes still photosynthesising need it */
+        for (i = 0; i < n; i++) {
+            if (l->active[i] && l->pass_an[i] > R(1E-04)) {
+                l->gbhf[i] = calc_bdn_layer_free_conduct(l->tair[i],
+                                                         l->tleaf[i],
+                                                         l->press[i],
+                                                         p->leaf_width);
+            }
+        }
+        for (i = 0; i < n; i++) {
+            gbh = l->gbhu[i] + l->gbhf[i];
+            gh = R(2.0) * (gbh + l->gradn[i]);
+            gbv = R(GBVGBH) * gbh;
+            gsv = R(GSVGSC) * l->pass_gsc[i];
+            gv = (gbv * gsv) / (gbv + gsv);
+            gbc = gbh / R(GBHGBC);
+
+            /* Penman-Monteith, as penman_monteith() */
+            LE = (gv > R(0.0)) ? (l->slope[i] * l->rnet[i] + l->vpd[i] * gh *
+                                  R(CP) * R(MASS_AIR)) /
+                                 (l->slope[i] + l->gamma[i] * gh / gv) :
+                                 R(0.0);
+            trans = MAX(R(0.0), LE / l->lambda[i]);
+            epsilon = l->slope[i] / l->gamma[i];
+
+            /* new Cs, dleaf & tleaf */
+            Tdiff = (l->rnet[i] - LE) / (R(CP) * R(MASS_AIR) * gh);
+            l->pass_trans[i] = trans;
+            l->pass_omega[i] = (R(1.0) + epsilon) /
+                               (R(1.0) + epsilon + gbv / gsv);
+            l->pass_tleaf[i] = l->tair[i] + Tdiff / R(4.0);
+            l->pass_Cs[i] = l->Ca[i] - l->pass_an[i] / gbc;
+            l->pass_dleaf[i] = trans * l->press[i] / gv;
+        }
+
+        /* keep the pass for the active lanes, converged? */
+        nactive = 0;
+        for (i = 0; i < n; i++) {
+            if (l->active[i] == FALSE)
+                continue;
+
+            l->an[i] = l->pass_an[i];
+            l->gsc[i] = l->pass_gsc[i];
+            if (l->pass_normal[i]) {
+                l->rd[i] = l->pass_rd[i];
+                l->rd_set[i] = TRUE;
+            }
+            if (!(l->an[i] > R(1E-04))) {
+                l->active[i] = FALSE;
+                continue;
+            }
+
+            l->trans[i] = l->pass_trans[i];
+            l->omega[i] = l->pass_omega[i];
+            l->tleaf_new[i] = l->pass_tleaf[i];
+            l->Cs[i] = l->pass_Cs[i];
+            l->dleaf[i] = l->pass_dleaf[i];
+            l->checks[i]++;
+
+            if (fabs(l->tleaf[i] - l->tleaf_new[i]) < R(0.02)) {
+                l->active[i] = FALSE;
+            } else if (l->iter[i] >= c->leaf_itermax) {
+                l->active[i] = FALSE;
+                l->stalled[i] = TRUE;
+            } else {
+                /* Update temperature & do another iteration */
+                tleaf_prev = l->tleaf_prev[i];
+                resid_prev = l->resid_prev[i];
+                l->tleaf[i] = next_leaf_temperature(c, l->tleaf[i],
+                                                    l->tleaf_new[i],
+                                                    l->iter[i], &tleaf_prev,
+                                                    &resid_prev);
+                l->tleaf_prev[i] = tleaf_prev;
+                l->resid_prev[i] = resid_prev;
+                l->iter[i]++;
+                nactive++;
+            }
+        }
+    }
+
+    return;
+}
@@ -0,0 +1,53 @@
+#ifndef CANOPY_TRACE_H
+#define CANOPY_TRACE_H
+
+#include "gday.h"
+
+#define CANOPY_TRACE_MAGIC "GDAYCTRC"
+#define CANOPY_TRACE_VERSION 1
+
+/*
+    What canopy_leaves sees of one daytime half-hour. All doubles, so a
+    record is written and read as CANOPY_TRACE_NFIELDS of them.
+*/
+typedef struct {
+    double year;
+    double doy;
+    double hod;                 /* half-hour of the day, 0-47 */
+
+    /* met */
+    double tair;                /* deg C */
+    double vpd;                 /* Pa */
+    double Ca;                  /* umol mol-1 */
+    double press;               /* Pa */
+    double wind;                /* m s-1 */
+    double par;                 /* umol m-2 s-1 */
+
+    /* solar geometry */
+    double cos_zenith;
+    double elevation;           /* degrees */
+    double diffuse_frac;
+
+    /* canopy and soil */
+    double lai;                 /* m2 m-2 */
+    double N0;                  /* top of canopy N (g N m-2) */
+    double wtfac_root;          /* root zone water stress (-) */
+    double weighted_swp;        /* MPa */
+    double total_soil_resist;   /* hydraulics: soil resistance */
+    double plant_k;             /* hydraulics: plant conductance */
+} canopy_trace_rec;
+
+#define CANOPY_TRACE_NFIELDS (sizeof(canopy_trace_rec) / sizeof(double))
+
+void    open_canopy_trace(control *);
+void    close_canopy_trace(control *);
+void    write_canopy_trace(canopy_wk *, control *, fluxes *, met *, state *,
+                           double, double, int);
+void    write_canopy_trace_lanes(canopy_wk *, control *, fluxes *,
+                                 met_arrays *, state *, double, int);
+FILE   *open_canopy_trace_read(const char *, int *);
+int     read_canopy_trace(FILE *, const char *, canopy_trace_rec *);
+void    apply_canopy_trace(canopy_trace_rec *, canopy_wk *, fluxes *, met *,
+                           state *);
+
+#endif /* CANOPY_TRACE_H */
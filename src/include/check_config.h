@@ -0,0 +1,25 @@
+#ifndef CHECK_CONFIG_H
+#define CHECK_CONFIG_H
+
+#include <stdarg.h>
+#include <unistd.h>
+#include "gday.h"
+#include "temp_tables.h"
+
+/* kinds of range check */
+#define RANGE_FRACTION 0
+#define RANGE_NONNEG 1
+#define RANGE_POSITIVE 2
+#define RANGE_BETWEEN 3
+
+typedef struct {
+    const char *key;        /* section.key */
+    int         kind;
+    double      lo;         /* RANGE_BETWEEN only */
+    double      hi;
+} param_range;
+
+int  check_config(control *, params *, state *);
+int  check_flags(control *);
+
+#endif /* CHECK_CONFIG_H */
@@ -0,0 +1,10 @@
+#ifndef DERIVED_PARAMS_H
+#define DERIVED_PARAMS_H
+
+#include "gday.h"
+#include "water_balance.h"
+#include "temp_tables.h"
+
+void derive_params(control *, params *);
+
+#endif /* DERIVED_PARAMS_H */
@@ -0,0 +1,22 @@
+#ifndef EXPERIMENT_H
+#define EXPERIMENT_H
+
+#include "gday.h"
+
+typedef struct {
+    char                  name[STRING_LENGTH];
+    int                   spin_up;
+    struct override_list *ol;
+    forcing_view          fv;
+} phase;
+
+typedef struct {
+    int    nphases;
+    int    max_phases;
+    phase *items;
+} experiment;
+
+void run_experiment(canopy_wk *, control *, fluxes *, fast_spinup *,
+                    met_arrays *, met *, params *, state *, nrutil *);
+
+#endif /* EXPERIMENT_H */
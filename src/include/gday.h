@@ -52,6 +52,13 @@
 #define SUBDAILY 0
 #define DAILY 1
 #define END 2
+#define NONE 3
+
+/* daily output file format */
+#define NATIVE 0
+#define NCEAS 1
+#define ARROW 2
+#define NETCDF 3
 
 /* Texture identifiers */
 #define SILT 0
@@ -62,6 +69,15 @@
 #define BUCKET 0
 #define HYDRAULICS 1
 
+/* sub-daily canopy kernel: the half-hour loop or a day of lanes at once */
+#define CANOPY_SCALAR 0
+#define CANOPY_BATCHED 1
+#define CANOPY_BATCHED_FLOAT 2
+
+/* leaf temperature solver */
+#define LEAF_FIXED_POINT 0
+#define LEAF_SECANT 1
+
 /* Drainage options for SPA */
 #define GRAVITY 0
 #define CASCADING 1
@@ -91,30 +107,72 @@
 #include "plant_growth.h"
 #include "litter_production.h"
 #include "write_output_file.h"
+#include "write_arrow_file.h"
+#include "write_netcdf_file.h"
+#include "state_snapshot.h"
+#include "param_registry.h"
+#include "overrides.h"
+#include "sweep.h"
+#include "branches.h"
+#include "experiment.h"
 #include "read_param_file.h"
 #include "read_met_file.h"
 #include "disturbance.h"
 #include "phenology.h"
 #include "soils.h"
+#include "derived_params.h"
+#include "check_config.h"
+#include "canopy_batch.h"
+#include "canopy_trace.h"
 #include "version.h"
 #include "rkck.h"
 #include "rkqs.h"
 
 
+/* what run_sim carries from one day to the next, besides the model state */
+typedef struct {
+    sma_obj *hw;                /* growth stress running mean */
+    int      window_size;
+    int     *disturbance_yrs;
+    int      num_disturbance_yrs;
+    double   fdecay;            /* today's foliage & root turnover */
+    double   rdecay;
+    double   year;              /* the year being run */
+} sim_loop;
+
 void   clparser(int, char **, control *);
 void   usage(char **);
 
 void   run_sim(canopy_wk *, control *, fluxes *, fast_spinup *, met_arrays *,
                met *, params *p, state *, nrutil *);
+void   start_sim(canopy_wk *, control *, fluxes *, fast_spinup *,
+                 met_arrays *, params *, state *, sim_loop *);
+void   start_year(control *, fluxes *, met_arrays *, params *, state *,
+                  sim_loop *, double);
+void   start_day(control *, fluxes *, fast_spinup *, met_arrays *, met *,
+                 params *, state *, sim_loop *, int);
+void   end_day(canopy_wk *, control *, fluxes *, fast_spinup *, met_arrays *,
+               met *, params *, state *, sim_loop *, int);
+void   end_year(control *, fluxes *, params *, state *);
+void   end_sim(control *, params *, state *, sim_loop *);
+void   run_model(canopy_wk *, control *, fluxes *, fast_spinup *,
+                 met_arrays *, met *, params *, state *, nrutil *);
+void   setup_run(canopy_wk *, control *, fluxes *, met_arrays *, params *,
+                 state *, nrutil *);
+void   open_run_outputs(control *, met_arrays *, params *);
+netcdf_writer *open_netcdf_output(control *, met_arrays *);
+void   close_output_files(control *);
+void   free_run(canopy_wk *, control *, fluxes *, params *, state *,
+                nrutil *);
 void   spin_up_pools(canopy_wk *, control *, fluxes *, fast_spinup *,
                      met_arrays *, met *, params *p, state *, nrutil *);
-void   correct_rate_constants(params *, int output);
 void   reset_all_n_pools_and_fluxes(fluxes *, state *);
 void   zero_stuff(control *, state *);
 void   day_end_calculations(control *, params *, state *, int, int);
 void   unpack_met_data(control *, fluxes *f, met_arrays *, met *, int, double);
 void   allocate_numerical_libs_stuff(nrutil *);
 void   fill_up_solar_arrays(canopy_wk *, control *, met_arrays *, params *);
+void   store_solar_geometry(canopy_wk *, params *, int, int, double, long);
 void   zero_fast_spinup_stuff(fast_spinup *);
 void   sas_spinup(canopy_wk *, control *, fluxes *, fast_spinup *,
                      met_arrays *, met *, params *p, state *, nrutil *);
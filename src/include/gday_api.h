@@ -0,0 +1,119 @@
+#ifndef GDAY_API_H
+#define GDAY_API_H
+
+/*
+    Embedding API, for running the model from another program (the Python
+    and R bindings) without files in between. Self-contained: include this,
+    not gday.h.
+
+    A gday_model holds everything one run needs. gday_run always starts from
+    the state the model was opened with (plus any gday_set changes), so
+    repeated runs, e.g. in a calibration loop, are independent of each other.
+
+    Threads: different models (e.g. clones of one another) can be run in
+    parallel, a single model can't. A model can't be cloned part way
+    through a stepped run. gday_open isn't thread-safe, open the
+    models first. The core still exits the process on fatal errors (bad
+    input it can't recover from, failed allocations), run gday --check on
+    the .cfg file first to weed those out.
+
+    Functions returning int give 0 on success and -1 on failure, when
+    gday_error says why.
+*/
+
+/*
+    Bumped whenever a call or one of the structs below changes, so a host
+    built against one version can check the library it's linked to.
+*/
+#define GDAY_API_VERSION 2
+
+typedef struct gday_model gday_model;
+
+int         gday_api_version(void);
+
+gday_model *gday_open(const char *cfg_fname);
+gday_model *gday_clone(const gday_model *);
+void        gday_close(gday_model *);
+const char *gday_error(const gday_model *);
+
+/* .cfg values, key is section.key, e.g. "params.g1" */
+int         gday_set(gday_model *, const char *key, const char *value);
+int         gday_get(const gday_model *, const char *key, char *buf,
+                     int len);
+
+/*
+    Forcing, one array per met file column, named as in the met file header
+    (year, doy, tair, ...). The arrays are used in place, not copied, so must
+    outlive the model and its clones. Setting a column again points it at
+    the new array. gday_load_met reads files.met_fname instead.
+    gday_clear_forcing drops the lot, so forcing of a different length can
+    be set; it frees what gday_load_met read, so the model's clones must be
+    closed first.
+*/
+int         gday_set_forcing(gday_model *, const char *name,
+                             const double *values, long n);
+int         gday_load_met(gday_model *);
+void        gday_clear_forcing(gday_model *);
+long        gday_ndays(const gday_model *);
+
+/* daily outputs, all of them until gday_select_outputs says otherwise */
+int         gday_num_daily_outputs(void);
+const char *gday_daily_output_name(int);
+int         gday_select_outputs(gday_model *, const char **names, int n);
+int         gday_noutputs(const gday_model *);
+const char *gday_output_name(const gday_model *, int);
+
+/*
+    Run over the forcing, out receives gday_ndays() x gday_noutputs()
+    doubles, row (day) major. Returns the number of days, -1 on failure.
+*/
+long        gday_run(gday_model *, double *out, long max_days);
+
+/*
+    Stepping, for coupling to a host model which owns the time loop and
+    pushes the forcing in one step at a time. gday_begin starts a run from
+    the saved setup (as gday_run does), then each call advances it by one
+    day, or one half-hour for a sub_daily model. Steps must follow on from
+    each other (the half-hours of a day in order, days consecutive, years
+    may start mid-way); gday_end finishes the run. Deciduous phenology and
+    disturbances need the whole year's forcing up front, so can't be
+    stepped.
+
+    The met structs hold one record of the met file, in its units.
+    gday_step_halfhour returns 1 when the step completed a day, 0 when it
+    didn't, -1 on failure.
+*/
+typedef struct {
+    int    year;
+    int    doy;                 /* 1-365/366 */
+    double tair, rain, tsoil, tam, tpm, tmin, tmax, tday, vpd_am, vpd_pm;
+    double co2, ndep, nfix, wind, press, wind_am, wind_pm, par_am, par_pm;
+} gday_met_day;
+
+typedef struct {
+    int    year;
+    int    doy;                 /* 1-365/366 */
+    int    hod;                 /* half-hour of the day, 0-47 */
+    double rain, par, tair, tsoil, vpd, co2, ndep, nfix, wind, press;
+} gday_met_halfhour;
+
+int         gday_begin(gday_model *);
+int         gday_step_day(gday_model *, const gday_met_day *);
+int         gday_step_halfhour(gday_model *, const gday_met_halfhour *);
+int         gday_end(gday_model *);
+
+/*
+    One value of the running model, by name:
+      - a daily output (gday_daily_output_name), for the last day completed
+      - a half-hourly canopy flux of the last half-hour: an_canopy,
+        rd_canopy, gsc_canopy, apar_canopy, trans_canopy, rnet_canopy,
+        omega_canopy, lwp_canopy, tleaf_sunlit, tleaf_shaded
+      - the leaf solver counts since the run began: leaf_solves_cold,
+        leaf_solves_warm, leaf_passes_cold, leaf_passes_warm,
+        leaf_nonconverged, emax_checks, emax_limited (what gday --verbose
+        prints)
+      - a numeric .cfg value as section.key, e.g. state.shoot, as it is now
+*/
+int         gday_read(const gday_model *, const char *name, double *value);
+
+#endif /* GDAY_API_H */
@@ -0,0 +1,47 @@
+#ifndef OVERRIDES_H
+#define OVERRIDES_H
+
+#include "gday.h"
+
+/* longest row in an overrides file */
+#define OVR_LINE_LENGTH 65536
+
+typedef struct {
+    const reg_field *fld;
+    char            *value;
+} override;
+
+typedef struct override_list {
+    int       num;
+    int       max;
+    override *items;
+} override_list;
+
+/* everything a run starts from, see save_model_base */
+typedef struct {
+    canopy_wk   cw;
+    control     c;
+    fluxes      f;
+    fast_spinup fs;
+    params      p;
+    state       s;
+} model_base;
+
+override_list *new_override_list(void);
+override_list *copy_override_list(override_list *);
+void           free_override_list(override_list *);
+void           add_override(override_list *, const reg_field *, const char *);
+void           parse_set_arg(override_list *, const char *);
+void           apply_overrides(override_list *, control *, params *, state *);
+const char    *find_override(override_list *, const char *, const char *);
+void           tag_output_fnames(control *, override_list *, const char *);
+void           copy_output_fnames(control *, control *);
+model_base    *save_model_base(canopy_wk *, control *, fluxes *, fast_spinup *,
+                               params *, state *);
+void           restore_model_base(model_base *, canopy_wk *, control *,
+                                  fluxes *, fast_spinup *, params *, state *);
+void           run_ensemble(canopy_wk *, control *, fluxes *, fast_spinup *,
+                            met_arrays *, met *, params *, state *,
+                            nrutil *);
+
+#endif /* OVERRIDES_H */
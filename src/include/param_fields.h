@@ -0,0 +1,306 @@
+#ifndef PARAM_FIELDS_H
+#define PARAM_FIELDS_H
+
+/*
+    Every control, param and state variable that can be set from the .cfg
+    file, one line each:
+
+        X(section, key in the .cfg file, struct member, type, flags)
+
+    [git], [files] and [control] live in the control structure, [params] in
+    params and [state] in state. An ENUM member "foo" takes its accepted
+    strings from the table foo_opts in param_registry.c. RESTART marks the
+    variables that are carried over between runs, i.e. written back by
+    write_final_state and saved in a state snapshot.
+
+    Adding a line here is all that's needed to make a new variable readable
+    from the .cfg file.
+*/
+#define GDAY_PARAM_FIELDS(X) \
+    /* [git] */                                                                 \
+    X(GIT,     git_hash,               git_hash,               STRING, 0)       \
+    /* [files] */                                                               \
+    X(FILES,   cfg_fname,              cfg_fname,              STRING, 0)       \
+    X(FILES,   met_fname,              met_fname,              STRING, 0)       \
+    X(FILES,   out_fname,              out_fname,              STRING, 0)       \
+    X(FILES,   out_subdaily_fname,     out_subdaily_fname,     STRING, 0)       \
+    X(FILES,   out_fname_hdr,          out_fname_hdr,          STRING, 0)       \
+    X(FILES,   out_subdaily_fname_hdr, out_subdaily_fname_hdr, STRING, 0)       \
+    X(FILES,   out_param_fname,        out_param_fname,        STRING, 0)       \
+    X(FILES,   out_state_fname,        out_state_fname,        STRING, 0)       \
+    X(FILES,   init_state_fname,       init_state_fname,       STRING, 0)       \
+    X(FILES,   canopy_trace_fname,     canopy_trace_fname,     STRING, 0)       \
+    /* [control] */                                                             \
+    X(CONTROL, adjust_rtslow,          adjust_rtslow,          BOOL,   0)       \
+    X(CONTROL, alloc_model,            alloc_model,            ENUM,   0)       \
+    X(CONTROL, arrow_batch_days,       arrow_batch_days,       INT,    0)       \
+    X(CONTROL, arrow_compression,      arrow_codec,            ENUM,   0)       \
+    X(CONTROL, assim_model,            assim_model,            ENUM,   0)       \
+    X(CONTROL, calc_sw_params,         calc_sw_params,         BOOL,   0)       \
+    X(CONTROL, canopy_kernel,          canopy_kernel,          ENUM,   0)       \
+    X(CONTROL, deciduous_model,        deciduous_model,        BOOL,   0)       \
+    X(CONTROL, disturbance,            disturbance,            BOOL,   0)       \
+    X(CONTROL, exudation,              exudation,              BOOL,   0)       \
+    X(CONTROL, fixed_lai,              fixed_lai,              BOOL,   0)       \
+    X(CONTROL, fixed_stem_nc,          fixed_stem_nc,          BOOL,   0)       \
+    X(CONTROL, fixleafnc,              fixleafnc,              BOOL,   0)       \
+    X(CONTROL, grazing,                grazing,                INT,    0)       \
+    X(CONTROL, gs_model,               gs_model,               ENUM,   0)       \
+    X(CONTROL, hurricane,              hurricane,              BOOL,   0)       \
+    X(CONTROL, leaf_itermax,           leaf_itermax,           INT,    0)       \
+    X(CONTROL, leaf_solver,            leaf_solver,            ENUM,   0)       \
+    X(CONTROL, model_optroot,          model_optroot,          BOOL,   0)       \
+    X(CONTROL, modeljm,                modeljm,                INT,    0)       \
+    X(CONTROL, ncycle,                 ncycle,                 BOOL,   0)       \
+    X(CONTROL, netcdf_chunk_days,      netcdf_chunk_days,      INT,    0)       \
+    X(CONTROL, netcdf_deflate,         netcdf_deflate,         INT,    0)       \
+    X(CONTROL, netcdf_nsites,          netcdf_nsites,          INT,    0)       \
+    X(CONTROL, netcdf_site,            netcdf_site,            INT,    0)       \
+    X(CONTROL, nuptake_model,          nuptake_model,          INT,    0)       \
+    X(CONTROL, output_ascii,           output_ascii,           BOOL,   0)       \
+    X(CONTROL, output_format,          output_format,          ENUM,   0)       \
+    X(CONTROL, passiveconst,           passiveconst,           BOOL,   0)       \
+    X(CONTROL, print_options,          print_options,          ENUM,   0)       \
+    X(CONTROL, ps_pathway,             ps_pathway,             ENUM,   0)       \
+    X(CONTROL, respiration_model,      respiration_model,      ENUM,   0)       \
+    X(CONTROL, soil_drainage,          soil_drainage,          ENUM,   0)       \
+    X(CONTROL, spinup_method,          spinup_method,          ENUM,   0)       \
+    X(CONTROL, strfloat,               strfloat,               INT,    0)       \
+    X(CONTROL, sub_daily,              sub_daily,              BOOL,   0)       \
+    X(CONTROL, sw_stress_model,        sw_stress_model,        INT,    0)       \
+    X(CONTROL, temp_table_step,        temp_table_step,        DOUBLE, 0)       \
+    X(CONTROL, temp_tables,            temp_tables,            BOOL,   0)       \
+    X(CONTROL, use_eff_nc,             use_eff_nc,             INT,    0)       \
+    X(CONTROL, warm_start,             warm_start,             BOOL,   0)       \
+    X(CONTROL, water_balance,          water_balance,          ENUM,   0)       \
+    X(CONTROL, water_store,            water_store,            BOOL,   0)       \
+    X(CONTROL, water_stress,           water_stress,           BOOL,   0)       \
+    /* [params] */                                                              \
+    X(PARAMS,  a0rhizo,                a0rhizo,                DOUBLE, 0)       \
+    X(PARAMS,  a1rhizo,                a1rhizo,                DOUBLE, 0)       \
+    X(PARAMS,  actncmax,               actncmax,               DOUBLE, 0)       \
+    X(PARAMS,  actncmin,               actncmin,               DOUBLE, 0)       \
+    X(PARAMS,  adapt,                  adapt,                  DOUBLE, 0)       \
+    X(PARAMS,  ageold,                 ageold,                 DOUBLE, 0)       \
+    X(PARAMS,  ageyoung,               ageyoung,               DOUBLE, 0)       \
+    X(PARAMS,  albedo,                 albedo,                 DOUBLE, 0)       \
+    X(PARAMS,  alpha_c4,               alpha_c4,               DOUBLE, 0)       \
+    X(PARAMS,  alpha_j,                alpha_j,                DOUBLE, 0)       \
+    X(PARAMS,  b_root,                 b_root,                 DOUBLE, 0)       \
+    X(PARAMS,  b_topsoil,              b_topsoil,              DOUBLE, 0)       \
+    X(PARAMS,  bdecay,                 bdecay,                 DOUBLE, 0)       \
+    X(PARAMS,  branch0,                branch0,                DOUBLE, 0)       \
+    X(PARAMS,  branch1,                branch1,                DOUBLE, 0)       \
+    X(PARAMS,  c_alloc_bmax,           c_alloc_bmax,           DOUBLE, 0)       \
+    X(PARAMS,  c_alloc_bmin,           c_alloc_bmin,           DOUBLE, 0)       \
+    X(PARAMS,  c_alloc_cmax,           c_alloc_cmax,           DOUBLE, 0)       \
+    X(PARAMS,  c_alloc_fmax,           c_alloc_fmax,           DOUBLE, 0)       \
+    X(PARAMS,  c_alloc_fmin,           c_alloc_fmin,           DOUBLE, 0)       \
+    X(PARAMS,  c_alloc_rmax,           c_alloc_rmax,           DOUBLE, 0)       \
+    X(PARAMS,  c_alloc_rmin,           c_alloc_rmin,           DOUBLE, 0)       \
+    X(PARAMS,  capac,                  capac,                  DOUBLE, 0)       \
+    X(PARAMS,  cfracts,                cfracts,                DOUBLE, 0)       \
+    X(PARAMS,  crdecay,                crdecay,                DOUBLE, 0)       \
+    X(PARAMS,  cretrans,               cretrans,               DOUBLE, 0)       \
+    X(PARAMS,  croot0,                 croot0,                 DOUBLE, 0)       \
+    X(PARAMS,  croot1,                 croot1,                 DOUBLE, 0)       \
+    X(PARAMS,  ctheta_root,            ctheta_root,            DOUBLE, 0)       \
+    X(PARAMS,  ctheta_topsoil,         ctheta_topsoil,         DOUBLE, 0)       \
+    X(PARAMS,  cue,                    cue,                    DOUBLE, 0)       \
+    X(PARAMS,  d0,                     d0,                     DOUBLE, 0)       \
+    X(PARAMS,  d0x,                    d0x,                    DOUBLE, 0)       \
+    X(PARAMS,  d1,                     d1,                     DOUBLE, 0)       \
+    X(PARAMS,  delsj,                  delsj,                  DOUBLE, 0)       \
+    X(PARAMS,  density,                density,                DOUBLE, 0)       \
+    X(PARAMS,  direct_frac,            direct_frac,            DOUBLE, 0)       \
+    X(PARAMS,  displace_ratio,         displace_ratio,         DOUBLE, 0)       \
+    X(PARAMS,  disturbance_doy,        disturbance_doy,        INT,    0)       \
+    X(PARAMS,  dz0v_dh,                dz0v_dh,                DOUBLE, 0)       \
+    X(PARAMS,  eac,                    eac,                    DOUBLE, 0)       \
+    X(PARAMS,  eag,                    eag,                    DOUBLE, 0)       \
+    X(PARAMS,  eaj,                    eaj,                    DOUBLE, 0)       \
+    X(PARAMS,  eao,                    eao,                    DOUBLE, 0)       \
+    X(PARAMS,  eav,                    eav,                    DOUBLE, 0)       \
+    X(PARAMS,  edj,                    edj,                    DOUBLE, 0)       \
+    X(PARAMS,  faecescn,               faecescn,               DOUBLE, 0)       \
+    X(PARAMS,  faecesn,                faecesn,                DOUBLE, 0)       \
+    X(PARAMS,  fdecay,                 fdecay,                 DOUBLE, 0)       \
+    X(PARAMS,  fdecaydry,              fdecaydry,              DOUBLE, 0)       \
+    X(PARAMS,  fhw,                    fhw,                    DOUBLE, 0)       \
+    X(PARAMS,  finesoil,               finesoil,               DOUBLE, 0)       \
+    X(PARAMS,  fix_lai,                fix_lai,                DOUBLE, 0)       \
+    X(PARAMS,  fracfaeces,             fracfaeces,             DOUBLE, 0)       \
+    X(PARAMS,  fracteaten,             fracteaten,             DOUBLE, 0)       \
+    X(PARAMS,  fractosoil,             fractosoil,             DOUBLE, 0)       \
+    X(PARAMS,  fractup_soil,           fractup_soil,           DOUBLE, 0)       \
+    X(PARAMS,  fretrans,               fretrans,               DOUBLE, 0)       \
+    X(PARAMS,  g1,                     g1,                     DOUBLE, 0)       \
+    X(PARAMS,  gamstar25,              gamstar25,              DOUBLE, 0)       \
+    X(PARAMS,  growth_efficiency,      growth_efficiency,      DOUBLE, 0)       \
+    X(PARAMS,  gs_min,                 gs_min,                 DOUBLE, 0)       \
+    X(PARAMS,  height0,                height0,                DOUBLE, 0)       \
+    X(PARAMS,  height1,                height1,                DOUBLE, 0)       \
+    X(PARAMS,  heighto,                heighto,                DOUBLE, 0)       \
+    X(PARAMS,  htpower,                htpower,                DOUBLE, 0)       \
+    X(PARAMS,  intercep_frac,          intercep_frac,          DOUBLE, 0)       \
+    X(PARAMS,  jmax,                   jmax,                   DOUBLE, 0)       \
+    X(PARAMS,  jmaxna,                 jmaxna,                 DOUBLE, 0)       \
+    X(PARAMS,  jmaxnb,                 jmaxnb,                 DOUBLE, 0)       \
+    X(PARAMS,  jv_intercept,           jv_intercept,           DOUBLE, 0)       \
+    X(PARAMS,  jv_slope,               jv_slope,               DOUBLE, 0)       \
+    X(PARAMS,  kc25,                   kc25,                   DOUBLE, 0)       \
+    X(PARAMS,  kdec1,                  kdec1,                  DOUBLE, 0)       \
+    X(PARAMS,  kdec2,                  kdec2,                  DOUBLE, 0)       \
+    X(PARAMS,  kdec3,                  kdec3,                  DOUBLE, 0)       \
+    X(PARAMS,  kdec4,                  kdec4,                  DOUBLE, 0)       \
+    X(PARAMS,  kdec5,                  kdec5,                  DOUBLE, 0)       \
+    X(PARAMS,  kdec6,                  kdec6,                  DOUBLE, 0)       \
+    X(PARAMS,  kdec7,                  kdec7,                  DOUBLE, 0)       \
+    X(PARAMS,  kn,                     kn,                     DOUBLE, 0)       \
+    X(PARAMS,  ko25,                   ko25,                   DOUBLE, 0)       \
+    X(PARAMS,  kp,                     kp,                     DOUBLE, 0)       \
+    X(PARAMS,  kq10,                   kq10,                   DOUBLE, 0)       \
+    X(PARAMS,  kr,                     kr,                     DOUBLE, 0)       \
+    X(PARAMS,  lad,                    lad,                    DOUBLE, 0)       \
+    X(PARAMS,  lai_closed,             lai_closed,             DOUBLE, 0)       \
+    X(PARAMS,  latitude,               latitude,               DOUBLE, 0)       \
+    X(PARAMS,  layer_thickness,        layer_thickness,        DOUBLE, 0)       \
+    X(PARAMS,  leafsap0,               leafsap0,               DOUBLE, 0)       \
+    X(PARAMS,  leafsap1,               leafsap1,               DOUBLE, 0)       \
+    X(PARAMS,  ligfaeces,              ligfaeces,              DOUBLE, 0)       \
+    X(PARAMS,  ligroot,                ligroot,                DOUBLE, 0)       \
+    X(PARAMS,  ligshoot,               ligshoot,               DOUBLE, 0)       \
+    X(PARAMS,  liteffnc,               liteffnc,               DOUBLE, 0)       \
+    X(PARAMS,  longitude,              longitude,              DOUBLE, 0)       \
+    X(PARAMS,  max_depth,              max_depth,              DOUBLE, 0)       \
+    X(PARAMS,  max_intercep_lai,       max_intercep_lai,       DOUBLE, 0)       \
+    X(PARAMS,  measurement_temp,       measurement_temp,       DOUBLE, 0)       \
+    X(PARAMS,  min_lwp,                min_lwp,                DOUBLE, 0)       \
+    X(PARAMS,  ncbnew,                 ncbnew,                 DOUBLE, 0)       \
+    X(PARAMS,  ncbnewz,                ncbnewz,                DOUBLE, 0)       \
+    X(PARAMS,  nccnew,                 nccnew,                 DOUBLE, 0)       \
+    X(PARAMS,  nccnewz,                nccnewz,                DOUBLE, 0)       \
+    X(PARAMS,  ncmaxfold,              ncmaxfold,              DOUBLE, 0)       \
+    X(PARAMS,  ncmaxfyoung,            ncmaxfyoung,            DOUBLE, 0)       \
+    X(PARAMS,  ncmaxr,                 ncmaxr,                 DOUBLE, 0)       \
+    X(PARAMS,  ncrfac,                 ncrfac,                 DOUBLE, 0)       \
+    X(PARAMS,  ncwimm,                 ncwimm,                 DOUBLE, 0)       \
+    X(PARAMS,  ncwimmz,                ncwimmz,                DOUBLE, 0)       \
+    X(PARAMS,  ncwnew,                 ncwnew,                 DOUBLE, 0)       \
+    X(PARAMS,  ncwnewz,                ncwnewz,                DOUBLE, 0)       \
+    X(PARAMS,  nf_crit,                nf_crit,                DOUBLE, 0)       \
+    X(PARAMS,  nf_min,                 nf_min,                 DOUBLE, 0)       \
+    X(PARAMS,  nmax,                   nmax,                   DOUBLE, 0)       \
+    X(PARAMS,  nmin,                   nmin,                   DOUBLE, 0)       \
+    X(PARAMS,  nmin0,                  nmin0,                  DOUBLE, 0)       \
+    X(PARAMS,  nmincrit,               nmincrit,               DOUBLE, 0)       \
+    X(PARAMS,  ntheta_root,            ntheta_root,            DOUBLE, 0)       \
+    X(PARAMS,  ntheta_topsoil,         ntheta_topsoil,         DOUBLE, 0)       \
+    X(PARAMS,  nuptakez,               nuptakez,               DOUBLE, 0)       \
+    X(PARAMS,  oi,                     oi,                     DOUBLE, 0)       \
+    X(PARAMS,  p50,                    p50,                    DOUBLE, 0)       \
+    X(PARAMS,  passivesoilnz,          passivesoilnz,          DOUBLE, 0)       \
+    X(PARAMS,  passivesoilz,           passivesoilz,           DOUBLE, 0)       \
+    X(PARAMS,  passncmax,              passncmax,              DOUBLE, 0)       \
+    X(PARAMS,  passncmin,              passncmin,              DOUBLE, 0)       \
+    X(PARAMS,  plc_shape,              plc_shape,              DOUBLE, 0)       \
+    X(PARAMS,  prescribed_leaf_NC,     prescribed_leaf_NC,     DOUBLE, 0)       \
+    X(PARAMS,  previous_ncd,           previous_ncd,           DOUBLE, RESTART) \
+    X(PARAMS,  prime_y,                prime_y,                DOUBLE, 0)       \
+    X(PARAMS,  prime_z,                prime_z,                DOUBLE, 0)       \
+    X(PARAMS,  psi_sat_root,           psi_sat_root,           DOUBLE, 0)       \
+    X(PARAMS,  psi_sat_topsoil,        psi_sat_topsoil,        DOUBLE, 0)       \
+    X(PARAMS,  qs,                     qs,                     DOUBLE, 0)       \
+    X(PARAMS,  r0,                     r0,                     DOUBLE, 0)       \
+    X(PARAMS,  rateloss,               rateloss,               DOUBLE, 0)       \
+    X(PARAMS,  rateuptake,             rateuptake,             DOUBLE, 0)       \
+    X(PARAMS,  rdecay,                 rdecay,                 DOUBLE, 0)       \
+    X(PARAMS,  rdecaydry,              rdecaydry,              DOUBLE, 0)       \
+    X(PARAMS,  resp_coeff,             resp_coeff,             DOUBLE, 0)       \
+    X(PARAMS,  retransmob,             retransmob,             DOUBLE, 0)       \
+    X(PARAMS,  rfmult,                 rfmult,                 DOUBLE, 0)       \
+    X(PARAMS,  root_density,           root_density,           DOUBLE, 0)       \
+    X(PARAMS,  root_exu_CUE,           root_exu_CUE,           DOUBLE, 0)       \
+    X(PARAMS,  root_k,                 root_k,                 DOUBLE, 0)       \
+    X(PARAMS,  root_radius,            root_radius,            DOUBLE, 0)       \
+    X(PARAMS,  root_resist,            root_resist,            DOUBLE, 0)       \
+    X(PARAMS,  rooting_depth,          rooting_depth,          DOUBLE, 0)       \
+    X(PARAMS,  rootsoil_type,          rootsoil_type,          STRING, 0)       \
+    X(PARAMS,  rretrans,               rretrans,               DOUBLE, 0)       \
+    X(PARAMS,  sapturnover,            sapturnover,            DOUBLE, 0)       \
+    X(PARAMS,  sla,                    sla,                    DOUBLE, 0)       \
+    X(PARAMS,  slamax,                 slamax,                 DOUBLE, 0)       \
+    X(PARAMS,  slazero,                slazero,                DOUBLE, 0)       \
+    X(PARAMS,  slowncmax,              slowncmax,              DOUBLE, 0)       \
+    X(PARAMS,  slowncmin,              slowncmin,              DOUBLE, 0)       \
+    X(PARAMS,  soil_layers,            soil_layers,            INT,    0)       \
+    X(PARAMS,  store_transfer_len,     store_transfer_len,     DOUBLE, 0)       \
+    X(PARAMS,  structcn,               structcn,               DOUBLE, 0)       \
+    X(PARAMS,  structrat,              structrat,              DOUBLE, 0)       \
+    X(PARAMS,  targ_sens,              targ_sens,              DOUBLE, 0)       \
+    X(PARAMS,  theta,                  theta,                  DOUBLE, 0)       \
+    X(PARAMS,  theta_fc_root,          theta_fc_root,          DOUBLE, 0)       \
+    X(PARAMS,  theta_fc_topsoil,       theta_fc_topsoil,       DOUBLE, 0)       \
+    X(PARAMS,  theta_sp_root,          theta_sp_root,          DOUBLE, 0)       \
+    X(PARAMS,  theta_sp_topsoil,       theta_sp_topsoil,       DOUBLE, 0)       \
+    X(PARAMS,  theta_wp_root,          theta_wp_root,          DOUBLE, 0)       \
+    X(PARAMS,  theta_wp_topsoil,       theta_wp_topsoil,       DOUBLE, 0)       \
+    X(PARAMS,  topsoil_depth,          topsoil_depth,          DOUBLE, 0)       \
+    X(PARAMS,  topsoil_type,           topsoil_type,           STRING, 0)       \
+    X(PARAMS,  vcmax,                  vcmax,                  DOUBLE, 0)       \
+    X(PARAMS,  vcmaxna,                vcmaxna,                DOUBLE, 0)       \
+    X(PARAMS,  vcmaxnb,                vcmaxnb,                DOUBLE, 0)       \
+    X(PARAMS,  watdecaydry,            watdecaydry,            DOUBLE, 0)       \
+    X(PARAMS,  watdecaywet,            watdecaywet,            DOUBLE, 0)       \
+    X(PARAMS,  wcapac_root,            wcapac_root,            DOUBLE, 0)       \
+    X(PARAMS,  wcapac_topsoil,         wcapac_topsoil,         DOUBLE, 0)       \
+    X(PARAMS,  wdecay,                 wdecay,                 DOUBLE, 0)       \
+    X(PARAMS,  wetloss,                wetloss,                DOUBLE, 0)       \
+    X(PARAMS,  wretrans,               wretrans,               DOUBLE, 0)       \
+    X(PARAMS,  z0h_z0m,                z0h_z0m,                DOUBLE, 0)       \
+    /* [state] */                                                               \
+    X(STATE,   activesoil,             activesoil,             DOUBLE, RESTART) \
+    X(STATE,   activesoiln,            activesoiln,            DOUBLE, RESTART) \
+    X(STATE,   age,                    age,                    DOUBLE, RESTART) \
+    X(STATE,   avg_albranch,           avg_albranch,           DOUBLE, RESTART) \
+    X(STATE,   avg_alcroot,            avg_alcroot,            DOUBLE, RESTART) \
+    X(STATE,   avg_alleaf,             avg_alleaf,             DOUBLE, RESTART) \
+    X(STATE,   avg_alroot,             avg_alroot,             DOUBLE, RESTART) \
+    X(STATE,   avg_alstem,             avg_alstem,             DOUBLE, RESTART) \
+    X(STATE,   branch,                 branch,                 DOUBLE, RESTART) \
+    X(STATE,   branchn,                branchn,                DOUBLE, RESTART) \
+    X(STATE,   canht,                  canht,                  DOUBLE, RESTART) \
+    X(STATE,   croot,                  croot,                  DOUBLE, RESTART) \
+    X(STATE,   crootn,                 crootn,                 DOUBLE, RESTART) \
+    X(STATE,   cstore,                 cstore,                 DOUBLE, RESTART) \
+    X(STATE,   inorgn,                 inorgn,                 DOUBLE, RESTART) \
+    X(STATE,   lai,                    lai,                    DOUBLE, RESTART) \
+    X(STATE,   metabsoil,              metabsoil,              DOUBLE, RESTART) \
+    X(STATE,   metabsoiln,             metabsoiln,             DOUBLE, RESTART) \
+    X(STATE,   metabsurf,              metabsurf,              DOUBLE, RESTART) \
+    X(STATE,   metabsurfn,             metabsurfn,             DOUBLE, RESTART) \
+    X(STATE,   nstore,                 nstore,                 DOUBLE, RESTART) \
+    X(STATE,   passivesoil,            passivesoil,            DOUBLE, RESTART) \
+    X(STATE,   passivesoiln,           passivesoiln,           DOUBLE, RESTART) \
+    X(STATE,   pawater_root,           pawater_root,           DOUBLE, RESTART) \
+    X(STATE,   pawater_topsoil,        pawater_topsoil,        DOUBLE, RESTART) \
+    X(STATE,   prev_sma,               prev_sma,               DOUBLE, RESTART) \
+    X(STATE,   root,                   root,                   DOUBLE, RESTART) \
+    X(STATE,   root_depth,             root_depth,             DOUBLE, RESTART) \
+    X(STATE,   rootn,                  rootn,                  DOUBLE, RESTART) \
+    X(STATE,   sapwood,                sapwood,                DOUBLE, RESTART) \
+    X(STATE,   shoot,                  shoot,                  DOUBLE, RESTART) \
+    X(STATE,   shootn,                 shootn,                 DOUBLE, RESTART) \
+    X(STATE,   sla,                    sla,                    DOUBLE, RESTART) \
+    X(STATE,   slowsoil,               slowsoil,               DOUBLE, RESTART) \
+    X(STATE,   slowsoiln,              slowsoiln,              DOUBLE, RESTART) \
+    X(STATE,   stem,                   stem,                   DOUBLE, RESTART) \
+    X(STATE,   stemn,                  stemn,                  DOUBLE, RESTART) \
+    X(STATE,   stemnimm,               stemnimm,               DOUBLE, RESTART) \
+    X(STATE,   stemnmob,               stemnmob,               DOUBLE, RESTART) \
+    X(STATE,   structsoil,             structsoil,             DOUBLE, RESTART) \
+    X(STATE,   structsoiln,            structsoiln,            DOUBLE, RESTART) \
+    X(STATE,   structsurf,             structsurf,             DOUBLE, RESTART) \
+    X(STATE,   structsurfn,            structsurfn,            DOUBLE, RESTART)
+
+#endif /* PARAM_FIELDS_H */
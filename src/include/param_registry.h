@@ -0,0 +1,55 @@
+#ifndef PARAM_REGISTRY_H
+#define PARAM_REGISTRY_H
+
+#include <stddef.h>
+
+/* sections of the .cfg file */
+#define REG_GIT 0
+#define REG_FILES 1
+#define REG_CONTROL 2
+#define REG_PARAMS 3
+#define REG_STATE 4
+#define REG_NSECTIONS 5
+
+/* variable types */
+#define REG_DOUBLE 0
+#define REG_INT 1
+#define REG_BOOL 2
+#define REG_ENUM 3
+#define REG_STRING 4
+
+/* flags */
+#define REG_RESTART 1
+
+typedef struct {
+    const char *name;
+    int         value;
+} reg_option;
+
+typedef struct {
+    int               section;
+    const char       *name;
+    int               type;
+    size_t            offset;
+    size_t            size;         /* buffer length for strings */
+    const reg_option *opts;         /* accepted strings for enums */
+    int               flags;
+} reg_field;
+
+/* after the types above, which the other headers pulled in by gday.h use */
+#include "gday.h"
+#include "param_fields.h"
+
+const reg_field *registry_lookup(const char *, const char *);
+const reg_field *registry_lookup_key(const char *);
+const reg_field *registry_field(int);
+int              registry_nfields(void);
+int              registry_section(const char *);
+const char      *registry_section_name(int);
+void            *registry_ptr(const reg_field *, control *, params *, state *);
+int              registry_set(const reg_field *, const char *, control *,
+                              params *, state *);
+void             registry_format(const reg_field *, char *, size_t,
+                                 control *, params *, state *);
+
+#endif /* PARAM_REGISTRY_H */
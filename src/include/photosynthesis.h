@@ -4,6 +4,7 @@
 #include "gday.h"
 #include "constants.h"
 #include "utilities.h"
+#include "temp_tables.h"
 
 /* Sub-daily funcs */
 void   photosynthesis_C3(control *, canopy_wk *, met *m, params *, state *);
@@ -11,12 +12,11 @@ int    calc_electron_transport_rate(params *, double, double, double *,
                                     double *);
 int    solve_ci(double, double, double, double, double, double, double,
                 double *);
-void   photosynthesis_C3_emax(control *, canopy_wk *, met *m, params *,
-                              state *, double, double);
+void   photosynthesis_C3_emax(canopy_wk *);
 double calc_co2_compensation_point(params *, double);
 double calculate_michaelis_menten(params *, double);
-void   calculate_jmaxt_vcmaxt(control *, canopy_wk *, params *, state *,
-                              double, double *, double *);
+void   calculate_jmaxt_vcmaxt(control *, params *, state *, double, double,
+                              double *, double *);
 double arrhenius(double, double, double, double);
 double peaked_arrhenius(double, double, double, double, double, double);
 double calc_leaf_day_respiration(double, double);
@@ -24,8 +24,27 @@ double quad(double, double, double, bool, int *);
 
 
 /* Daily funcs */
+
+/* morning and afternoon halves of the day, indexing mate_table */
+#define AM 0
+#define PM 1
+
+/* the forcing-only MATE terms for every day, see build_mate_table */
+typedef struct mate_table {
+    long    ndays;                  /* days held, from day_idx 0, 0 = none */
+    double  peak_j;                 /* Jmax peaked Arrhenius, at 25 degC */
+    double *gamma_star[2];          /* CO2 compensation point, am & pm */
+    double *km[2];                  /* Michaelis-Menten coefficient */
+    double *arrh_v[2];              /* Vcmax Arrhenius factor */
+    double *arrh_j[2];              /* Jmax Arrhenius factor */
+    double *peak_den[2];            /* Jmax high temperature inhibition */
+    double *sqrt_vpd[2];            /* sqrt(VPD), kPa^0.5 */
+    double *buf;                    /* all of the above */
+} mate_table;
+
 void   mate_C3_photosynthesis(control *, fluxes *, met *, params *,
                               state *, double, double);
+void   build_mate_table(control *, met_arrays *, params *);
 
 double  calculate_top_of_canopy_n(params *, state *, double);
 double  calculate_co2_compensation_point(params *, double, double);
@@ -34,8 +53,12 @@ double  peaked_arrh(double, double, double, double, double, double);
 double  calculate_michaelis_menten_parameter(params *, double, double);
 void    calculate_jmax_and_vcmax(control *, params *, state *, double, double,
                                  double *, double *, double);
+void    jmax_and_vcmax_from_terms(control *, params *, state *, double, double,
+                                  double, double, double, double, double *,
+                                  double *);
 void    adj_for_low_temp(double *, double);
 double  calculate_ci(control *, params *, state *, double, double);
+double  ci_from_sqrt_vpd(control *, params *, state *, double, double);
 double  calculate_quantum_efficiency(params *, double ci, double);
 double  assim(double, double, double, double);
 double  epsilon(params *, double, double, double, double);
@@ -18,6 +18,9 @@
 void    calc_day_growth(canopy_wk *, control *, fluxes *, fast_spinup *,
                         met_arrays *ma, met *, nrutil *, params *, state *,
                         double, int, double, double);
+void    finish_day_growth(control *, fluxes *, fast_spinup *, met *, params *,
+                          state *, double, int, double, double, double,
+                          double);
 void    carbon_allocation(control *, fluxes *, params *, state *,
                                                      double, int);
 void    calc_carbon_allocation_fracs(control *c, fluxes *, fast_spinup *,
@@ -11,6 +11,26 @@
 #include "constants.h"
 #include "utilities.h"
 
+/* every half-hour of a day */
+#define MAX_RADIATION_LANES 48
+
+/* a day's daytime half-hours, see canopy_radiation_lanes */
+typedef struct {
+    int    n;
+
+    /* in: sun and PAR */
+    double cos_zenith[MAX_RADIATION_LANES];
+    double direct_frac[MAX_RADIATION_LANES];
+    double diffuse_frac[MAX_RADIATION_LANES];
+    double par[MAX_RADIATION_LANES];                  /* umol m-2 s-1 */
+
+    /* out: as calculate_absorbed_radiation etc. leave canopy_wk */
+    double kb[MAX_RADIATION_LANES];
+    double apar[NUM_LEAVES][MAX_RADIATION_LANES];
+    double lai_leaf[NUM_LEAVES][MAX_RADIATION_LANES];
+    double scalex[NUM_LEAVES][MAX_RADIATION_LANES];
+} radiation_lanes;
+
 /* utilities */
 double day_angle(int);
 void   calculate_solar_geometry(canopy_wk *, params *, double, double);
@@ -21,6 +41,7 @@ void   spitters(canopy_wk *, int, double);
 double calc_extra_terrestrial_rad(double, double);
 double estimate_clearness(double, double);
 void   calculate_absorbed_radiation(canopy_wk *, params *, state *, double);
+void   canopy_radiation_lanes(params *, state *, radiation_lanes *);
 double calculate_solar_noon(double, double);
 double calculate_hour_angle(double, double);
 double psi_func(double, double);
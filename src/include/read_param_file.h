@@ -3,10 +3,12 @@
 
 #include "gday.h"
 #include "utilities.h"
+#include "write_output_file.h"
 
 
 
 int  parse_ini_file(control *, params *, state *);
+int  known_key(const char *, const char *);
 int  handler(char *, char *, char *, control *, params *, state *);
 
 #endif /* READ_PARAM_H */
@@ -0,0 +1,12 @@
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include "gday.h"
+
+#define SNAPSHOT_MAGIC "GDAYSNAP"
+#define SNAPSHOT_VERSION 1
+
+void write_state_snapshot(control *, params *, state *);
+void read_state_snapshot(control *, params *, state *);
+
+#endif /* STATE_SNAPSHOT_H */
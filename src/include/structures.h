@@ -8,17 +8,34 @@ typedef struct {
     FILE *ofp;
     FILE *ofp_sd;
     FILE *ofp_hdr;
+    FILE *ofp_sd_hdr;
+    FILE *ofp_trace;
+    char  cfg_path[STRING_LENGTH];
     char  cfg_fname[STRING_LENGTH];
     char  met_fname[STRING_LENGTH];
     char  out_fname[STRING_LENGTH];
     char  out_subdaily_fname[STRING_LENGTH];
     char  out_fname_hdr[STRING_LENGTH];
+    char  out_subdaily_fname_hdr[STRING_LENGTH];
     char  out_param_fname[STRING_LENGTH];
+    char  out_state_fname[STRING_LENGTH];
+    char  init_state_fname[STRING_LENGTH];
+    char  canopy_trace_fname[STRING_LENGTH];
+    char  overrides_fname[STRING_LENGTH];
+    struct override_list *ovr;
+    char  sweep_fname[STRING_LENGTH];
+    struct sweep_diag *diag;
+    char  branches_fname[STRING_LENGTH];
+    struct branch_setup *brs;
+    char  experiment_fname[STRING_LENGTH];
+    struct output_capture *capture;
+    struct mate_table *mate;
     char  git_hash[STRING_LENGTH];
     int   adjust_rtslow;
     int   alloc_model;
     int   assim_model;
     int   calc_sw_params;
+    int   canopy_kernel;
     int   deciduous_model;
     int   disturbance;
     int   fixed_stem_nc;
@@ -26,12 +43,23 @@ typedef struct {
     int   fixleafnc;
     int   grazing;
     int   gs_model;
+    int   leaf_itermax;
+    int   leaf_solver;
     int   model_optroot;
     int   modeljm;
     int   ncycle;
     int   num_years;
     int   nuptake_model;
     int   output_ascii;
+    int   output_format;
+    int   arrow_codec;
+    int   arrow_batch_days;
+    struct arrow_writer *aw;
+    int   netcdf_nsites;
+    int   netcdf_site;
+    int   netcdf_deflate;
+    int   netcdf_chunk_days;
+    struct netcdf_writer *nw;
     int   passiveconst;
     int   print_options;
     int   ps_pathway;
@@ -47,9 +75,17 @@ typedef struct {
     char  git_code_ver[STRING_LENGTH];
     int   spin_up;
     int   PRINT_GIT;
+    int   check;
+    int   compare_float;
+    int   verbose;
+    int   check_errors;
+    int   check_warnings;
     int   hurricane;
     int   exudation;
     int   sub_daily;
+    int   temp_tables;
+    int   warm_start;
+    double temp_table_step;
     int   num_hlf_hrs;
     long  hour_idx;
     long  day_idx;
@@ -166,6 +202,55 @@ typedef struct {
     double midday_xwp;     // MPa
 } state;
 
+/* leaf temperature response tables, see temp_tables.c */
+#define TEMP_TABLE_TMIN -50.0       /* deg C */
+#define TEMP_TABLE_TMAX 70.0
+#define TEMP_TABLE_MIN_STEP 0.05
+#define TEMP_TABLE_MAX_POINTS 2401  /* (TMAX - TMIN) / MIN_STEP + 1 */
+#define TEMP_TABLE_NUM 6
+
+typedef struct {
+    int    on;
+    int    n;                                   /* points per table */
+    double step;                                /* deg C */
+    double max_err[TEMP_TABLE_NUM];             /* relative, at the midpoints */
+    double v[TEMP_TABLE_NUM][TEMP_TABLE_MAX_POINTS];
+} temp_tables;
+
+/* quantities derived from the params, see derived_params.c */
+typedef struct {
+    int    valid;           /* FALSE once a param changes */
+
+    /* rate constants per day, the .cfg values are per year */
+    double rateuptake;
+    double rateloss;
+    double retransmob;
+    double fdecay;
+    double fdecaydry;
+    double crdecay;
+    double rdecay;
+    double rdecaydry;
+    double bdecay;
+    double wdecay;
+    double sapturnover;
+    double kdec1;
+    double kdec2;
+    double kdec3;
+    double kdec4;
+    double kdec5;
+    double kdec6;
+    double kdec7;
+    double nuptakez;
+    double nmax;
+
+    /* fractions of silt, sand and clay of the soil types */
+    double fsoil_top[3];
+    double fsoil_root[3];
+
+    /* sub-daily canopy temperature responses */
+    temp_tables tt;
+} derived_params;
+
 typedef struct {
     double a0rhizo; /* minimum allocation to rhizodeposition [0.0-0.1] */
     double a1rhizo; /* slope of allocation to rhizodeposition [0.2-1] */
@@ -380,6 +465,7 @@ typedef struct {
     double *field_capacity;
     int     wetting;         /* number of wetting layers */
 
+    derived_params derived;
 
 } params;
 
@@ -418,6 +504,15 @@ typedef struct {
 
 } met_arrays;
 
+/* changes to the met forcing, see branches.c */
+typedef struct {
+    char   met_fname[STRING_LENGTH];    /* replaces the forcing */
+    double co2;                         /* fixed CO2, < 0 = met file */
+    double co2_add;
+    double rain_scale;
+    double ndep_add;
+} forcing_view;
+
 
 typedef struct {
 
@@ -677,6 +772,21 @@ typedef struct {
     double diffuse_frac;    /* Fraction of incident rad which is diffuse (-) */
     double direct_frac;     /* Fraction of incident rad which is beam (-) */
     double tleaf_new;       /* new leaf temperature (deg C) */
+    int    iter;            /* iterations of the last leaf temperature solve */
+    int    leaf_iter[2];    /* and of the half-hour's sunlit and shaded ones */
+    int    nonconverged;    /* leaf solves that hit leaf_itermax this run */
+    long   emax_checks;     /* hydraulics: An/gs checked against Emax */
+    long   emax_limited;    /* and re-solved for the supply-limited gs */
+    long   leaf_solves[2];  /* leaf temperature solves, cold (0) and warm (1) */
+    long   leaf_passes[2];  /* photosynthesis passes over those solves */
+    int    warm[2];         /* last half-hour's leaf solution is usable */
+    double warm_tleaf[2];   /* and that solution, Tleaf (deg C) */
+    double warm_Cs[2];      /* Cs (umol mol-1) */
+    double warm_apar[2];    /* apar (umol m-2 s-1) */
+    double warm_dleaf[2];   /* dleaf (Pa) */
+    double warm_tair[2];    /* the half-hour's air temperature (deg C) */
+    double warm_vpd[2];     /* vpd (Pa) */
+    double warm_Ca[2];      /* CO2 (umol mol-1) */
     double dleaf;           /* leaf VPD (Pa) */
     double Cs;              /* CO2 conc at the leaf surface (umol mol-1) */
     double kb;              /* beam radiation ext coeff of canopy */
@@ -684,6 +794,9 @@ typedef struct {
     double *cz_store;       /* Array to hold coz zenith angles */
     double *ele_store;      /* Array to hold elevations */
     double *df_store;       /* Array to hold diffuse fractions */
+    long   *daytime;        /* the half-hours the canopy is lit, in order */
+    long   num_daytime;     /* entries in daytime */
+    long   num_indexed;     /* half-hours daytime was built over */
 
     // Used in the hydraulics calculations when water is limiting //
     double ts_Cs;           // Temporary variable to store Cs //
@@ -691,7 +804,7 @@ typedef struct {
     double ts_km;           // Temporary variable to store km //
     double ts_gamma_star;   // Temporary variable to store gamma_star //
     double ts_rd;           // Temporary variable to store rd //
-    double ts_jmax;         // Temporary variable to store jmax //
+    double ts_Vj;           // Temporary variable to store Vj //
 
     // Capacitance stuff
     double plant_k;
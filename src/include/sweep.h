@@ -0,0 +1,47 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+#include "gday.h"
+
+/* sampling designs */
+#define LHS 0
+#define SOBOL 1
+
+/* parameter distributions */
+#define UNIFORM 0
+#define LOGUNIFORM 1
+#define NORMAL 2
+
+/* how the daily values are reduced to an annual one */
+#define AGG_SUM 0
+#define AGG_MEAN 1
+#define AGG_MIN 2
+#define AGG_MAX 3
+
+/* where each member's spin-up comes from */
+#define SPIN_NONE 0
+#define SPIN_SHARED 1
+#define SPIN_EACH 2
+
+/* Sobol direction numbers are tabulated for this many dimensions */
+#define SOBOL_MAX_DIM 21
+
+typedef struct sweep_diag {
+    int      ndiag;
+    int     *col;           /* index into daily_output_names */
+    int     *agg;           /* AGG_* */
+    double  *acc;           /* this year so far */
+    int      ndays;
+    int      year;          /* year being accumulated, -1 = none yet */
+    int      nyears;
+    int      max_years;
+    double **annual;        /* [ndiag][max_years] */
+} sweep_diag;
+
+void run_sweep(canopy_wk *, control *, fluxes *, fast_spinup *,
+               met_arrays *, met *, params *, state *, nrutil *);
+void record_diagnostics(sweep_diag *, control *, canopy_wk *, fluxes *,
+                        state *, int, int);
+
+#endif /* SWEEP_H */
@@ -0,0 +1,23 @@
+#ifndef TEMP_TABLES_H
+#define TEMP_TABLES_H
+
+#include <math.h>
+
+#include "gday.h"
+#include "photosynthesis.h"
+#include "water_balance.h"
+
+/* the tabulated responses */
+#define TT_GAMMA_STAR 0     /* CO2 compensation point (umol mol-1) */
+#define TT_KM 1             /* Michaelis-Menten coefficient (umol mol-1) */
+#define TT_VCMAX 2          /* Vcmax / Vcmax25 */
+#define TT_JMAX 3           /* Jmax / Jmax25 */
+#define TT_SAT_VP 4         /* saturation vapour pressure (Pa) */
+#define TT_SLOPE 5          /* slope of the sat. vapour pressure curve */
+
+void   build_temp_tables(control *, params *, temp_tables *);
+double temp_response(params *, int, double);
+double exact_temp_response(params *, int, double);
+void   print_temp_table_errors(FILE *, temp_tables *);
+
+#endif /* TEMP_TABLES_H */
@@ -4,8 +4,8 @@
 #include "gday.h"
 #include "constants.h"
 #include "utilities.h"
+#include "temp_tables.h"
 
-void    initialise_soils_day(control *, fluxes *, params *, state *);
 void    calculate_water_balance(control *, fluxes *, met *, params *,
                                 state *, int, double, double, double);
 void    update_water_storage(control *, fluxes *, params *, state *, double,
@@ -37,7 +37,7 @@ double  calc_slope_of_sat_vapour_pressure_curve(double);
 void    _calc_soil_water_potential(control *, params *, state *);
 double  calc_sw_modifier(double, double, double);
 
-double *get_soil_fracs(char *);
+void    get_soil_fracs(char *, double *);
 double  calc_beta(double, double, double, double, double);
 void    get_soil_params(char *, double *, double *);
 void    calc_soil_params(double *, double *, double *,
@@ -0,0 +1,40 @@
+#ifndef WRITE_ARROW_H
+#define WRITE_ARROW_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Body compression, values match the Arrow CompressionType enum */
+#define ARROW_UNCOMPRESSED -1
+#define ARROW_LZ4 0
+#define ARROW_ZSTD 1
+
+typedef struct arrow_block {
+    int64_t offset;
+    int32_t meta_len;
+    int64_t body_len;
+} arrow_block;
+
+typedef struct arrow_writer {
+    FILE         *fp;
+    int64_t       offset;     /* bytes written to fp so far */
+    int           ncols;
+    int           batch_rows;
+    int           nrows;      /* rows buffered in the current batch */
+    int           codec;
+    char        **names;
+    char         *git_ver;
+    double      **cols;       /* [ncols][batch_rows] */
+    arrow_block  *blocks;
+    int           nblocks;
+    int           max_blocks;
+} arrow_writer;
+
+arrow_writer *arrow_open(FILE *, const char **, int, int, int, const char *);
+void          arrow_write_row(arrow_writer *, const double *);
+void          arrow_close(arrow_writer *);
+int           arrow_codec_available(int);
+
+#endif /* WRITE_ARROW_H */
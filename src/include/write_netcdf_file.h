@@ -0,0 +1,34 @@
+#ifndef WRITE_NETCDF_H
+#define WRITE_NETCDF_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct netcdf_writer {
+    int      ncid;
+    int      nvars;
+    int     *varids;
+    int      lat_var;
+    int      lon_var;
+    int      time_var;
+    int      nsites;
+    int      site;          /* site (0-based) being written, -1 = none yet */
+    int      start_year;    /* time origin, every site has to share it */
+    int      shared;        /* held open across runs (an ensemble's sites) */
+    int      chunk_days;    /* days buffered before a write, = time chunk */
+    int      ndays;         /* days in the buffer */
+    long     t0;            /* time index of the first buffered day */
+    double **buf;           /* [nvars][chunk_days] */
+} netcdf_writer;
+
+netcdf_writer *netcdf_open(const char *, const char **, const char **,
+                           const char **, int, int, int, int, int,
+                           const char *);
+void           netcdf_set_site(netcdf_writer *, int, int, double, double);
+void           netcdf_write_row(netcdf_writer *, long, const double *);
+void           netcdf_flush(netcdf_writer *);
+void           netcdf_close(netcdf_writer *);
+int            netcdf_available(void);
+
+#endif /* WRITE_NETCDF_H */
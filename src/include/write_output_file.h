@@ -5,13 +5,42 @@
 #include "gday.h"
 #include "utilities.h"
 
+#define NDAILY_OUTPUTS 119
+
+extern const char *daily_output_names[NDAILY_OUTPUTS];
+extern const char *daily_output_units[NDAILY_OUTPUTS];
+extern const char *daily_output_long_names[NDAILY_OUTPUTS];
+
+/* daily outputs kept in memory rather than written, see gday_api.c */
+typedef struct output_capture {
+    int     nout;
+    int    *col;            /* index into daily_output_names */
+    double *buf;            /* max_days x nout, row major */
+    long    max_days;
+    long    ndays;
+} output_capture;
+
 void  open_output_file(control *, char *, FILE **);
 void  write_output_subdaily_header(control *, FILE **);
 void  write_output_header(control *, FILE **);
+void  pack_daily_outputs(control *, canopy_wk *, fluxes *, state *, int, int,
+                          double *);
 void  write_daily_outputs_ascii(control *, canopy_wk *, fluxes *, state *, int,
                                 int);
-void  write_daily_outputs_binary(control *, fluxes *, state *, int, int);
+void  write_daily_outputs_arrow(control *, canopy_wk *, fluxes *, state *, int,
+                                int);
+void  write_daily_outputs_netcdf(control *, canopy_wk *, fluxes *, state *, int,
+                                 int);
+void  write_daily_outputs_binary(control *, canopy_wk *, fluxes *, state *,
+                                 int, int);
+void  capture_daily_outputs(output_capture *, control *, canopy_wk *,
+                            fluxes *, state *, int, int);
+void  write_output_header_nceas(control *, FILE **);
+void  write_daily_outputs_nceas(control *, fluxes *, met_arrays *, state *, int,
+                                int);
 void  write_subdaily_outputs_ascii(control *, canopy_wk *, double, double, int);
+void  write_subdaily_outputs_binary(control *, canopy_wk *, state *, double,
+                                    double, int);
 int   write_final_state(control *, params *p, state *);
 int   ohandler(char *, char *, char *, control *, params *p, state *, int *);
 
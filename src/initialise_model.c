@@ -12,33 +12,65 @@ void initialise_control(control *c) {
     c->ifp = NULL;
     c->ofp = NULL;
     c->ofp_hdr = NULL;
+    c->ofp_sd = NULL;
+    c->ofp_sd_hdr = NULL;
+    c->ofp_trace = NULL;
+    strcpy(c->cfg_path, "*NOT SET*");  /* the -p file, [files] cfg_fname can name another */
     strcpy(c->cfg_fname, "*NOT SET*");
     strcpy(c->met_fname, "*NOT SET*");
     strcpy(c->out_fname, "*NOT SET*");
     strcpy(c->out_subdaily_fname, "*NOT SET*");
     strcpy(c->out_fname_hdr, "*NOT SET*");
+    strcpy(c->out_subdaily_fname_hdr, "*NOT SET*");
     strcpy(c->out_param_fname, "*NOT SET*");
+    strcpy(c->out_state_fname, "*NOT SET*");
+    strcpy(c->init_state_fname, "*NOT SET*");
+    strcpy(c->canopy_trace_fname, "*NOT SET*");
+    strcpy(c->overrides_fname, "*NOT SET*");
+    c->ovr = NULL;
+    strcpy(c->sweep_fname, "*NOT SET*");
+    c->diag = NULL;
+    c->capture = NULL;
+    c->mate = NULL;
+    strcpy(c->branches_fname, "*NOT SET*");
+    c->brs = NULL;
+    strcpy(c->experiment_fname, "*NOT SET*");
 
     c->alloc_model = ALLOMETRIC;    /* C allocation scheme: FIXED, GRASSES, ALLOMETRIC */
     c->assim_model = MATE;          /* Photosynthesis model: BEWDY (not coded :p) or MATE */
     c->calc_sw_params = FALSE;      /* false=user supplies field capacity and wilting point, true=calculate them based on cosby et al. */
+    c->canopy_kernel = CANOPY_SCALAR; /* sub-daily canopy: scalar=half-hour loop, batched=a day of half-hours at once (bucket only), batched_float=the same in single precision */
     c->deciduous_model = FALSE;     /* evergreen_model=False, deciduous_model=True */
     c->fixed_stem_nc = TRUE;        /* False=vary stem N:C with foliage, True=fixed stem N:C */
     c->fixed_lai = FALSE;           /* Fix LAI */
     c->fixleafnc = FALSE;           /* fixed leaf N C ? */
     c->grazing = 0;                 /* Is foliage grazed? 0=No, 1=daily, 2=annual and then set disturbance_doy=doy */
     c->gs_model = MEDLYN;           /* Stomatal conductance model, currently only this one is implemented */
+    c->leaf_itermax = 100;          /* sub-daily canopy: leaf temperature iterations allowed per leaf and half-hour */
+    c->leaf_solver = LEAF_FIXED_POINT; /* leaf temperature solver: fixed_point=damped energy balance iteration, secant=secant steps on its residual */
     c->model_optroot = FALSE;       /* Ross's optimal root model...not sure if this works yet...0=off, 1=on */
     c->modeljm = 2;                 /* modeljm=0, Jmax and Vcmax parameters are read in, modeljm=1, parameters are calculated from leaf N content, modeljm=2, Vcmax is calculated from leaf N content but Jmax is related to Vcmax */
     c->ncycle = TRUE;               /* Nitrogen cycle on or off? */
     c->nuptake_model = 2;           /* 0=constant uptake, 1=func of N inorgn, 2=depends on rate of soil N availability */
     c->output_ascii = TRUE;         /* If this is false you get a binary file as an output. */
+    c->output_format = NATIVE;      /* Daily ascii columns: NATIVE=gday, NCEAS=FACE model-data intercomparison format, ARROW=Arrow IPC (feather) file */
+    c->arrow_codec = ARROW_UNCOMPRESSED; /* Arrow buffer compression: none, lz4 or zstd */
+    c->arrow_batch_days = 365;      /* days per Arrow record batch */
+    c->aw = NULL;
+    c->netcdf_nsites = 1;           /* sites in the NetCDF output file */
+    c->netcdf_site = 0;             /* site slot this run writes, site 0 creates the file */
+    c->netcdf_deflate = 4;          /* NetCDF deflate level, 0 = off */
+    c->netcdf_chunk_days = 365;     /* NetCDF time chunk, days buffered per write */
+    c->nw = NULL;
     c->passiveconst = FALSE;        /* hold passive pool at passivesoil */
     c->print_options = DAILY;       /* DAILY=every timestep, END=end of run */
     c->ps_pathway = C3;             /* Photosynthetic pathway, c3/c4 */
     c->respiration_model = FIXED;   /* Plant respiration ... Fixed, vary  */
     c->strfloat = 0;                /* Structural pool input N:C varies=1, fixed=0 */
     c->sw_stress_model = 1;         /* JULES type linear stress func, or Landsberg and Waring non-linear func */
+    c->temp_tables = FALSE;         /* sub-daily canopy: interpolate the leaf temperature responses rather than evaluate them */
+    c->temp_table_step = 0.1;       /* spacing of those tables (deg C) */
+    c->warm_start = FALSE;          /* sub-daily canopy: start each leaf from the last half-hour's solution rather than from the air */
     c->use_eff_nc = 0;              /* use constant leaf n:c for  metfrac s */
     c->water_stress = TRUE;         /* water stress modifier turned on=TRUE (default)...ability to turn off to test things without drought stress = FALSE */
     c->water_balance = 0;            /* Water calculations: 0=simple 2 layered bucket; 1=SPA-style hydraulics */
@@ -51,6 +83,11 @@ void initialise_control(control *c) {
     c->num_days = 0;                /* Number of days in a year: 365/366 */
     c->total_num_days = 0;          /* Total number of days  */
     c->PRINT_GIT = FALSE;           /* print the git hash to the cmd line and exit? Called from cmd line parsar */
+    c->check = FALSE;               /* validate the inputs and exit (--check) */
+    c->compare_float = FALSE;       /* float vs double kernel (--compare-float) */
+    c->verbose = FALSE;             /* leaf solver counts after each run (--verbose) */
+    c->check_errors = 0;            /* problems --check has found so far */
+    c->check_warnings = 0;          /* ...and things it thinks are suspect */
 
     c->sub_daily = FALSE;           /* Run at daily or 30 minute timestep */
     c->num_hlf_hrs = 48;
@@ -188,6 +225,7 @@ void initialise_params(params *p) {
     p->passncmin = 0.1;
     p->prescribed_leaf_NC = 0.03;
     p->previous_ncd = 35.0;
+    p->derived.valid = FALSE;
     p->psi_sat_root = -999.9;
     p->psi_sat_topsoil = -999.9;
     p->p50 = -3.0;        // xylem pressure where 50% of the conductivity is lost
@@ -24,8 +24,10 @@ void calculate_litterfall(control *c, fluxes *f, fast_spinup *fs,
 
     /* Leaf/root litter rates are higher during dry periods and therefore is
     dependent on soil water content */
-    *fdecay = decay_in_dry_soils(p->fdecay, p->fdecaydry, p, s);
-    *rdecay = decay_in_dry_soils(p->rdecay, p->rdecaydry, p, s);
+    *fdecay = decay_in_dry_soils(p->derived.fdecay, p->derived.fdecaydry,
+                                 p, s);
+    *rdecay = decay_in_dry_soils(p->derived.rdecay, p->derived.rdecaydry,
+                                 p, s);
 
     /* litter N:C ratios, roots and shoot */
     ncflit = s->shootnc * (1.0 - p->fretrans);
@@ -33,10 +35,10 @@ void calculate_litterfall(control *c, fluxes *f, fast_spinup *fs,
 
     /* C litter production */
     f->deadroots = *rdecay * s->root;
-    f->deadcroots = p->crdecay * s->croot;
-    f->deadstems = p->wdecay * s->stem;
-    f->deadbranch = p->bdecay * s->branch;
-    f->deadsapwood = (p->wdecay + p->sapturnover) * s->sapwood;
+    f->deadcroots = p->derived.crdecay * s->croot;
+    f->deadstems = p->derived.wdecay * s->stem;
+    f->deadbranch = p->derived.bdecay * s->branch;
+    f->deadsapwood = (p->derived.wdecay + p->derived.sapturnover) * s->sapwood;
 
 
     if (c->deciduous_model)
@@ -51,9 +53,9 @@ void calculate_litterfall(control *c, fluxes *f, fast_spinup *fs,
             fs->loss[LF] += *fdecay;
 
         fs->loss[LR] += *rdecay;
-        fs->loss[LCR] += p->crdecay;
-        fs->loss[LB] += p->bdecay;
-        fs->loss[LW] += p->wdecay;
+        fs->loss[LCR] += p->derived.crdecay;
+        fs->loss[LB] += p->derived.bdecay;
+        fs->loss[LW] += p->derived.wdecay;
     }
 
     /* N litter production */
@@ -62,11 +64,13 @@ void calculate_litterfall(control *c, fluxes *f, fast_spinup *fs,
     /* Assuming fraction is retranslocated before senescence, i.e. a fracion
        of nutrients is stored within the plant */
     f->deadrootn = f->deadroots * ncrlit;
-    f->deadcrootn = p->crdecay * s->crootn * (1.0 - p->cretrans);
-    f->deadbranchn = p->bdecay * s->branchn * (1.0 - p->bretrans);
+    f->deadcrootn = p->derived.crdecay * s->crootn *
+                    (1.0 - p->cretrans);
+    f->deadbranchn = p->derived.bdecay * s->branchn *
+                     (1.0 - p->bretrans);
 
     /* N in stemwood litter - only mobile n is retranslocated */
-    f->deadstemn = p->wdecay * (s->stemnimm + s->stemnmob * \
+    f->deadstemn = p->derived.wdecay * (s->stemnimm + s->stemnmob * \
                     (1.0 - p->wretrans));
 
     /* Animal grazing? */
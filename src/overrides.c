@@ -0,0 +1,459 @@
+/* ============================================================================
+* Parameter overrides and ensembles
+*
+* Overrides replace values read from the .cfg file without writing a new one,
+* either from the command line:
+*
+*   gday -p base.cfg --set params.g1=4.2 --set control.ncycle=false
+*
+* or from a CSV file holding one ensemble member per row:
+*
+*   gday -p base.cfg --overrides members.csv
+*
+* where the header row names the variables as section.key, e.g.
+*
+*   member,params.g1,params.sla,control.ncycle
+*   low,2.5,4.4,true
+*   high,5.0,5.6,false
+*
+* The .cfg file and the met forcing are only read once, each member starts
+* from a copy of that base setup with its row applied on top. A "member"
+* column is optional, it is used to tag the output file names (e.g.
+* outputs/run_low.csv), otherwise the row number is used. A file name given
+* in the row itself is left untouched, one given with --set is tagged.
+*
+* Each member can read its own met file, so the rows can be sites, e.g.
+*
+*   member,files.met_fname,params.latitude,params.longitude
+*   cell_0412,met/cell_0412.csv,-33.6,150.7
+*
+* With NetCDF output the members aren't written to tagged files but to one
+* file, a site each: member k (from 0) is site netcdf_site + k, unless its
+* row gives a netcdf_site, and the file is made big enough to hold them all.
+*
+* NOTES:
+*   --set overrides apply to all members, values in the row win.
+*   The time step is shared by all members so files.cfg_fname and
+*   control.sub_daily can't be set per member. A met file is only read again
+*   when a member's differs from the last one read.
+*   Overridden values are carried over when the final state is written back
+*   to a .cfg file (print_options = end or spin-up).
+*
+* =========================================================================== */
+#include "overrides.h"
+
+/* the files a run writes, see tag_output_fnames */
+static const char *output_fnames[] = {
+    "out_fname", "out_fname_hdr", "out_subdaily_fname",
+    "out_subdaily_fname_hdr", "out_param_fname", "out_state_fname",
+    "canopy_trace_fname"
+};
+
+static const reg_field *required_key(const char *);
+static int              split_row(char *, char **, int);
+static void             tag_fname(char *, const char *);
+
+
+override_list *new_override_list(void) {
+    override_list *ol = NULL;
+
+    if ((ol = malloc(sizeof(override_list))) == NULL) {
+        fprintf(stderr, "malloc failed allocating override list\n");
+        exit(EXIT_FAILURE);
+    }
+    ol->num = 0;
+    ol->max = 0;
+    ol->items = NULL;
+
+    return (ol);
+}
+
+void free_override_list(override_list *ol) {
+    int i;
+
+    for (i = 0; i < ol->num; i++)
+        free(ol->items[i].value);
+    free(ol->items);
+    free(ol);
+
+    return;
+}
+
+void add_override(override_list *ol, const reg_field *fld, const char *value) {
+    /* set a variable to value, replacing any earlier override of it */
+    int i;
+
+    for (i = 0; i < ol->num; i++) {
+        if (ol->items[i].fld == fld) {
+            free(ol->items[i].value);
+            ol->items[i].value = strdup(value);
+            return;
+        }
+    }
+
+    if (ol->num == ol->max) {
+        ol->max = (ol->max == 0) ? 16 : ol->max * 2;
+        ol->items = realloc(ol->items, ol->max * sizeof(override));
+        if (ol->items == NULL) {
+            fprintf(stderr, "realloc failed growing override list\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    ol->items[ol->num].fld = fld;
+    if ((ol->items[ol->num].value = strdup(value)) == NULL) {
+        fprintf(stderr, "strdup failed storing override\n");
+        exit(EXIT_FAILURE);
+    }
+    ol->num++;
+
+    return;
+}
+
+void parse_set_arg(override_list *ol, const char *arg) {
+    /* section.key=value from the command line */
+    char  key[STRING_LENGTH];
+    char *eq = NULL;
+
+    if (arg == NULL || strlen(arg) >= sizeof(key) ||
+        (eq = strchr(arg, '=')) == NULL) {
+        fprintf(stderr, "--set expects section.key=value, got: %s\n",
+                arg == NULL ? "nothing" : arg);
+        exit(EXIT_FAILURE);
+    }
+    strncpy0(key, (char *)arg, (size_t)(eq - arg) + 1);
+
+    add_override(ol, required_key(rstrip(key)), eq + 1);
+
+    return;
+}
+
+void apply_overrides(override_list *ol, control *c, params *p, state *s) {
+    int i;
+
+    for (i = 0; i < ol->num; i++) {
+        if (!registry_set(ol->items[i].fld, ol->items[i].value, c, p, s)) {
+            fprintf(stderr, "Unknown %s option: %s\n",
+                    ol->items[i].fld->name, ol->items[i].value);
+            if (c->check == FALSE)
+                exit(EXIT_FAILURE);
+            c->check_errors++;
+        }
+    }
+
+    return;
+}
+
+const char *find_override(override_list *ol, const char *section,
+                          const char *name) {
+    /* the overriding value of section/name, NULL if it isn't overridden */
+    const reg_field *fld = NULL;
+    int              i;
+
+    if (ol == NULL || (fld = registry_lookup(section, name)) == NULL)
+        return (NULL);
+
+    for (i = 0; i < ol->num; i++) {
+        if (ol->items[i].fld == fld)
+            return (ol->items[i].value);
+    }
+
+    return (NULL);
+}
+
+override_list *copy_override_list(override_list *ol) {
+    /* a new list holding the same overrides, empty if ol is NULL */
+    override_list *copy = new_override_list();
+    int            i;
+
+    if (ol != NULL) {
+        for (i = 0; i < ol->num; i++)
+            add_override(copy, ol->items[i].fld, ol->items[i].value);
+    }
+
+    return (copy);
+}
+
+void tag_output_fnames(control *c, override_list *ol, const char *tag) {
+    /*
+        Add tag to the output file names so members don't overwrite each
+        other. ol holds what the member sets itself (its row or branch), a
+        name it sets is left alone; names from --set are shared and tagged
+    */
+    int i;
+
+    for (i = 0; i < (int)ARRAY_SIZE(output_fnames); i++) {
+        if (find_override(ol, "files", output_fnames[i]) == NULL)
+            tag_fname((char *)registry_ptr(registry_lookup("files",
+                                                           output_fnames[i]),
+                                           c, NULL, NULL), tag);
+    }
+
+    return;
+}
+
+void copy_output_fnames(control *c, control *from) {
+    /* undo tag_output_fnames, taking the names back from a copy of c */
+    const reg_field *fld = NULL;
+    int              i;
+
+    for (i = 0; i < (int)ARRAY_SIZE(output_fnames); i++) {
+        fld = registry_lookup("files", output_fnames[i]);
+        strcpy((char *)registry_ptr(fld, c, NULL, NULL),
+               (char *)registry_ptr(fld, from, NULL, NULL));
+    }
+
+    return;
+}
+
+model_base *save_model_base(canopy_wk *cw, control *c, fluxes *f,
+                            fast_spinup *fs, params *p, state *s) {
+    /*
+        Copy of the model setup that runs can be restarted from. Only the
+        structures are copied: the met arrays are shared and anything that
+        setup_run allocates is set up again for each run.
+    */
+    model_base *base = NULL;
+
+    if ((base = malloc(sizeof(model_base))) == NULL) {
+        fprintf(stderr, "malloc failed allocating model base\n");
+        exit(EXIT_FAILURE);
+    }
+    base->cw = *cw;
+    base->c = *c;
+    base->f = *f;
+    base->fs = *fs;
+    base->p = *p;
+    base->s = *s;
+
+    return (base);
+}
+
+void restore_model_base(model_base *base, canopy_wk *cw, control *c,
+                        fluxes *f, fast_spinup *fs, params *p, state *s) {
+    *cw = base->cw;
+    *c = base->c;
+    *f = base->f;
+    *fs = base->fs;
+    *p = base->p;
+    *s = base->s;
+
+    return;
+}
+
+void run_ensemble(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
+                  met_arrays *ma, met *m, params *p, state *s, nrutil *nr) {
+    /*
+        Run the model once per row of c->overrides_fname, each run starting
+        from the setup as it was after reading the .cfg file
+    */
+    FILE             *fp = NULL;
+    char             *line = NULL, *start = NULL, **cells = NULL;
+    char              tag[STRING_LENGTH];
+    char             *prog[] = {"gday", NULL};
+    const reg_field **cols = NULL;
+    override_list    *ol = NULL, *row = NULL;
+    int               i, ncols, ncells, member_col = -1, nmember = 0;
+    int               nmembers = 0, nsites;
+    long              body;
+    model_base       *base = NULL;
+    control           loaded;
+    netcdf_writer    *nw = NULL;
+
+    if ((fp = fopen(c->overrides_fname, "r")) == NULL) {
+        fprintf(stderr, "Error opening overrides file %s\n",
+                c->overrides_fname);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((line = malloc(OVR_LINE_LENGTH)) == NULL) {
+        fprintf(stderr, "malloc failed allocating overrides line\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* header, section.key per column */
+    do {
+        if (fgets(line, OVR_LINE_LENGTH, fp) == NULL) {
+            fprintf(stderr, "Overrides file %s is empty\n",
+                    c->overrides_fname);
+            exit(EXIT_FAILURE);
+        }
+        start = lskip(rstrip(line));
+    } while (*start == '\0' || *start == '#');
+
+    ncols = 1;
+    for (i = 0; start[i] != '\0'; i++) {
+        if (start[i] == ',')
+            ncols++;
+    }
+    cells = malloc(ncols * sizeof(char *));
+    cols = malloc(ncols * sizeof(reg_field *));
+    if (cells == NULL || cols == NULL) {
+        fprintf(stderr, "malloc failed allocating overrides columns\n");
+        exit(EXIT_FAILURE);
+    }
+    split_row(start, cells, ncols);
+    for (i = 0; i < ncols; i++) {
+        if (strcasecmp(cells[i], "member") == 0) {
+            member_col = i;
+            cols[i] = NULL;
+            continue;
+        }
+        cols[i] = required_key(cells[i]);
+        if (strcasecmp(cells[i], "files.cfg_fname") == 0 ||
+            strcasecmp(cells[i], "control.sub_daily") == 0) {
+            fprintf(stderr, "%s can't be changed between ensemble members\n",
+                    cells[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* count the members, a NetCDF file needs a site for each */
+    body = ftell(fp);
+    while (fgets(line, OVR_LINE_LENGTH, fp) != NULL) {
+        start = lskip(rstrip(line));
+        if (*start != '\0' && *start != '#')
+            nmembers++;
+    }
+    fseek(fp, body, SEEK_SET);
+    nsites = MAX(c->netcdf_nsites, c->netcdf_site + nmembers);
+
+    /* everything each member starts from */
+    base = save_model_base(cw, c, f, fs, p, s);
+
+    /* the met data main read, kept until a member wants another file */
+    loaded = *c;
+
+    while (fgets(line, OVR_LINE_LENGTH, fp) != NULL) {
+        start = lskip(rstrip(line));
+        if (*start == '\0' || *start == '#')
+            continue;
+
+        nmember++;
+        ncells = split_row(start, cells, ncols);
+        if (ncells != ncols) {
+            fprintf(stderr, "%s: member %d has %d values, expected %d\n",
+                    c->overrides_fname, nmember, ncells, ncols);
+            exit(EXIT_FAILURE);
+        }
+
+        restore_model_base(base, cw, c, f, fs, p, s);
+
+        /* --set values first so the row can replace them */
+        ol = copy_override_list(base->c.ovr);
+        row = new_override_list();
+        sprintf(tag, "%d", nmember);
+        for (i = 0; i < ncols; i++) {
+            if (i == member_col) {
+                snprintf(tag, sizeof(tag), "%s", cells[i]);
+            } else {
+                add_override(ol, cols[i], cells[i]);
+                add_override(row, cols[i], cells[i]);
+            }
+        }
+        apply_overrides(ol, c, p, s);
+        c->ovr = ol;
+
+        if (strcmp(c->met_fname, loaded.met_fname) != 0) {
+            free_met_data(&loaded, ma);
+            if (c->sub_daily)
+                read_subdaily_met_data(prog, c, ma);
+            else
+                read_daily_met_data(prog, c, ma);
+            loaded = *c;
+        } else {
+            c->num_years = loaded.num_years;
+            c->total_num_days = loaded.total_num_days;
+        }
+
+        if (c->output_format == NETCDF && c->print_options == DAILY &&
+            c->spin_up == FALSE) {
+            /* a site of the one file, which stays open between members */
+            if (find_override(row, "control", "netcdf_site") == NULL)
+                c->netcdf_site = base->c.netcdf_site + nmember - 1;
+            c->netcdf_nsites = nsites;
+            if (nw == NULL) {
+                nw = open_netcdf_output(c, ma);
+                nw->shared = TRUE;
+            }
+            c->nw = nw;
+        }
+
+        tag_output_fnames(c, row, tag);
+        free_override_list(row);
+
+        fprintf(stderr, "Ensemble member %s\n", tag);
+
+        run_model(cw, c, f, fs, ma, m, p, s, nr);
+
+        free_override_list(ol);
+    }
+
+    if (nmember == 0) {
+        fprintf(stderr, "No ensemble members in %s\n", c->overrides_fname);
+        exit(EXIT_FAILURE);
+    }
+
+    if (nw != NULL)
+        netcdf_close(nw);
+
+    /* leave things as main set them up, bar the met data it has to free */
+    restore_model_base(base, cw, c, f, fs, p, s);
+    strcpy(c->met_fname, loaded.met_fname);
+
+    fclose(fp);
+    free(line);
+    free(cells);
+    free(cols);
+    free(base);
+
+    return;
+}
+
+static const reg_field *required_key(const char *key) {
+    /* section.key -> registry entry, unknown names are an error */
+    const reg_field *fld = NULL;
+
+    if ((fld = registry_lookup_key(key)) == NULL) {
+        fprintf(stderr, "Unknown parameter %s, expected section.key, e.g. "
+                "params.g1\n", key);
+        exit(EXIT_FAILURE);
+    }
+
+    return (fld);
+}
+
+static int split_row(char *row, char **cells, int max_cells) {
+    /* split a CSV row in place, returns the number of values found */
+    int   n = 0;
+    char *next = NULL;
+
+    while (row != NULL) {
+        if ((next = strchr(row, ',')) != NULL)
+            *next++ = '\0';
+        if (n < max_cells)
+            cells[n] = lskip(rstrip(row));
+        n++;
+        row = next;
+    }
+
+    return (n);
+}
+
+static void tag_fname(char *fname, const char *tag) {
+    /* outputs/run.csv -> outputs/run_<tag>.csv */
+    char  tmp[STRING_LENGTH];
+    char *dot = strrchr(fname, '.');
+    char *slash = strrchr(fname, '/');
+
+    if (strcmp(fname, "*NOT SET*") == 0)
+        return;
+
+    if (dot == NULL || (slash != NULL && dot < slash))
+        snprintf(tmp, sizeof(tmp), "%s_%s", fname, tag);
+    else
+        snprintf(tmp, sizeof(tmp), "%.*s_%s%s", (int)(dot - fname), fname,
+                 tag, dot);
+    strcpy(fname, tmp);
+
+    return;
+}
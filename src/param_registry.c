@@ -0,0 +1,345 @@
+/* ============================================================================
+* Registry of the variables that can be set from the .cfg file
+*
+* One table, generated from the X-macro list in param_fields.h, holds the
+* section, name, type and struct offset of every control, param and state
+* variable. Reading the .cfg file (handler), writing the final state back out
+* (ohandler) and the binary state snapshots all go through it, rather than
+* each keeping its own list.
+*
+* Lookups use a perfect hash over (section, lower-cased name), built the first
+* time it is needed: keys are first split into buckets and each bucket is then
+* given a displacement that sends all of its keys to distinct, empty slots
+* (hash and displace). A lookup is therefore two hashes and one string
+* compare, whatever the key.
+*
+* =========================================================================== */
+#include "param_registry.h"
+
+/* strings accepted by the ENUM variables, matched ignoring case. "*" stands
+   for anything not listed */
+static const reg_option alloc_model_opts[] = {
+    {"fixed", FIXED}, {"grasses", GRASSES}, {"allometric", ALLOMETRIC},
+    {NULL, 0}
+};
+static const reg_option arrow_codec_opts[] = {
+    {"none", ARROW_UNCOMPRESSED}, {"lz4", ARROW_LZ4}, {"zstd", ARROW_ZSTD},
+    {NULL, 0}
+};
+static const reg_option assim_model_opts[] = {
+    {"mate", MATE}, {"bewdy", BEWDY}, {NULL, 0}
+};
+static const reg_option canopy_kernel_opts[] = {
+    {"scalar", CANOPY_SCALAR}, {"batched", CANOPY_BATCHED},
+    {"batched_float", CANOPY_BATCHED_FLOAT}, {NULL, 0}
+};
+static const reg_option gs_model_opts[] = {
+    {"medlyn", MEDLYN}, {NULL, 0}
+};
+static const reg_option leaf_solver_opts[] = {
+    {"fixed_point", LEAF_FIXED_POINT}, {"secant", LEAF_SECANT}, {NULL, 0}
+};
+static const reg_option output_format_opts[] = {
+    {"native", NATIVE}, {"nceas", NCEAS}, {"arrow", ARROW},
+    {"feather", ARROW}, {"netcdf", NETCDF}, {NULL, 0}
+};
+static const reg_option print_options_opts[] = {
+    {"subdaily", SUBDAILY}, {"daily", DAILY}, {"end", END},
+    {"none", NONE}, {NULL, 0}
+};
+static const reg_option ps_pathway_opts[] = {
+    {"c3", C3}, {"c4", C4}, {NULL, 0}
+};
+static const reg_option respiration_model_opts[] = {
+    {"fixed", FIXED}, {"vary", VARY}, {NULL, 0}
+};
+static const reg_option soil_drainage_opts[] = {
+    {"gravity", GRAVITY}, {"cascading", CASCADING}, {NULL, 0}
+};
+static const reg_option spinup_method_opts[] = {
+    {"brute", BRUTE}, {"sas", SAS}, {NULL, 0}
+};
+static const reg_option water_balance_opts[] = {
+    {"bucket", BUCKET}, {"hydraulics", HYDRAULICS}, {"*", BUCKET},
+    {NULL, 0}
+};
+
+static const char *section_names[REG_NSECTIONS] = {
+    "git", "files", "control", "params", "state"
+};
+
+/* which structure each section lives in */
+#define REG_STRUCT_GIT control
+#define REG_STRUCT_FILES control
+#define REG_STRUCT_CONTROL control
+#define REG_STRUCT_PARAMS params
+#define REG_STRUCT_STATE state
+
+#define REG_OPTS_DOUBLE(m) NULL
+#define REG_OPTS_INT(m) NULL
+#define REG_OPTS_BOOL(m) NULL
+#define REG_OPTS_STRING(m) NULL
+#define REG_OPTS_ENUM(m) m##_opts
+
+#define RESTART REG_RESTART
+
+#define REG_FIELD(sec, key, member, type, flags)                            \
+    {REG_##sec, #key, REG_##type, offsetof(REG_STRUCT_##sec, member),       \
+     sizeof(((REG_STRUCT_##sec *)0)->member), REG_OPTS_##type(member),      \
+     flags},
+
+static const reg_field fields[] = {
+    GDAY_PARAM_FIELDS(REG_FIELD)
+};
+
+#define NFIELDS ((int)ARRAY_SIZE(fields))
+
+/* hash table, HASH_SIZE slots (a power of two >= NFIELDS) and HASH_BUCKETS
+   displacements */
+#define HASH_SIZE 512
+#define HASH_BUCKETS 256
+#define MAX_DISPLACE 65535
+
+static short          hash_slot[HASH_SIZE];
+static unsigned short hash_displace[HASH_BUCKETS];
+static int            hash_built = FALSE;
+
+static unsigned int hash_key(int, const char *, unsigned int);
+static void         build_hash(void);
+
+
+const reg_field *registry_lookup(const char *section, const char *name) {
+    /*
+        Find a variable by section and name (ignoring case), NULL if there
+        isn't one
+    */
+    int          sec, idx;
+    unsigned int b;
+
+    if ((sec = registry_section(section)) < 0)
+        return (NULL);
+
+    if (!hash_built)
+        build_hash();
+
+    b = hash_key(sec, name, 0) & (HASH_BUCKETS - 1);
+    idx = hash_slot[hash_key(sec, name, hash_displace[b]) & (HASH_SIZE - 1)];
+    if (idx < 0 || fields[idx].section != sec ||
+        strcasecmp(fields[idx].name, name) != 0)
+        return (NULL);
+
+    return (&fields[idx]);
+}
+
+const reg_field *registry_lookup_key(const char *key) {
+    /* as registry_lookup, for a "section.name" key, e.g. params.g1 */
+    char        section[STRING_LENGTH];
+    const char *dot = strchr(key, '.');
+
+    if (dot == NULL || (size_t)(dot - key) >= sizeof(section))
+        return (NULL);
+    strncpy0(section, (char *)key, (size_t)(dot - key) + 1);
+
+    return (registry_lookup(section, dot + 1));
+}
+
+const reg_field *registry_field(int i) {
+    /* i'th variable, in the order of param_fields.h */
+    if (i < 0 || i >= NFIELDS)
+        return (NULL);
+
+    return (&fields[i]);
+}
+
+int registry_nfields(void) {
+    return (NFIELDS);
+}
+
+int registry_section(const char *section) {
+    int i;
+
+    for (i = 0; i < REG_NSECTIONS; i++) {
+        if (strcasecmp(section, section_names[i]) == 0)
+            return (i);
+    }
+
+    return (-1);
+}
+
+const char *registry_section_name(int section) {
+    return (section_names[section]);
+}
+
+void *registry_ptr(const reg_field *fld, control *c, params *p, state *s) {
+    char *base;
+
+    if (fld->section == REG_PARAMS)
+        base = (char *)p;
+    else if (fld->section == REG_STATE)
+        base = (char *)s;
+    else
+        base = (char *)c;
+
+    return ((void *)(base + fld->offset));
+}
+
+int registry_set(const reg_field *fld, const char *value, control *c,
+                 params *p, state *s) {
+    /*
+        Parse value into the variable, returns FALSE if value isn't one of
+        the accepted strings of a BOOL/ENUM variable
+    */
+    void             *ptr = registry_ptr(fld, c, p, s);
+    const reg_option *opt = NULL;
+
+    /* whatever changed, the derived params may depend on it */
+    if (p != NULL)
+        p->derived.valid = FALSE;
+
+    switch (fld->type) {
+    case REG_DOUBLE:
+        *(double *)ptr = atof(value);
+        break;
+    case REG_INT:
+        *(int *)ptr = atoi(value);
+        break;
+    case REG_BOOL:
+        if (strcasecmp(value, "true") == 0)
+            *(int *)ptr = TRUE;
+        else if (strcasecmp(value, "false") == 0)
+            *(int *)ptr = FALSE;
+        else
+            return (FALSE);
+        break;
+    case REG_ENUM:
+        for (opt = fld->opts; opt->name != NULL; opt++) {
+            if (strcasecmp(value, opt->name) == 0 ||
+                strcmp(opt->name, "*") == 0) {
+                *(int *)ptr = opt->value;
+                break;
+            }
+        }
+        if (opt->name == NULL)
+            return (FALSE);
+        break;
+    case REG_STRING:
+        snprintf((char *)ptr, fld->size, "%s", value);
+        break;
+    }
+
+    return (TRUE);
+}
+
+void registry_format(const reg_field *fld, char *buf, size_t len,
+                     control *c, params *p, state *s) {
+    /* current value as it would appear in a .cfg file */
+    void             *ptr = registry_ptr(fld, c, p, s);
+    const reg_option *opt = NULL;
+
+    switch (fld->type) {
+    case REG_DOUBLE:
+        snprintf(buf, len, "%.10f", *(double *)ptr);
+        break;
+    case REG_INT:
+        snprintf(buf, len, "%d", *(int *)ptr);
+        break;
+    case REG_BOOL:
+        snprintf(buf, len, "%s", *(int *)ptr ? "true" : "false");
+        break;
+    case REG_ENUM:
+        snprintf(buf, len, "%d", *(int *)ptr);
+        for (opt = fld->opts; opt->name != NULL; opt++) {
+            if (opt->value == *(int *)ptr && strcmp(opt->name, "*") != 0) {
+                snprintf(buf, len, "%s", opt->name);
+                break;
+            }
+        }
+        break;
+    case REG_STRING:
+        snprintf(buf, len, "%s", (char *)ptr);
+        break;
+    }
+
+    return;
+}
+
+static unsigned int hash_key(int section, const char *name,
+                             unsigned int seed) {
+    /* FNV-1a over the section and the lower-cased name */
+    unsigned int h = 2166136261u + seed * 0x9e3779b9u;
+
+    h = (h ^ (unsigned int)section) * 16777619u;
+    while (*name) {
+        h = (h ^ (unsigned int)tolower((unsigned char)*name)) * 16777619u;
+        name++;
+    }
+
+    return (h);
+}
+
+static void build_hash(void) {
+    /*
+        Place the largest buckets first, trying displacements until all the
+        keys in a bucket land in distinct empty slots
+    */
+    int          i, j, k, nslot, size, max_size = 0, ok;
+    int          bucket[NFIELDS], bsize[HASH_BUCKETS];
+    unsigned int d, slot[NFIELDS];
+
+    if (NFIELDS > HASH_SIZE) {
+        fprintf(stderr, "Registry hash too small for %d fields\n", NFIELDS);
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < HASH_SIZE; i++)
+        hash_slot[i] = -1;
+    for (i = 0; i < HASH_BUCKETS; i++) {
+        hash_displace[i] = 0;
+        bsize[i] = 0;
+    }
+    for (i = 0; i < NFIELDS; i++) {
+        bucket[i] = hash_key(fields[i].section, fields[i].name, 0) &
+                    (HASH_BUCKETS - 1);
+        bsize[bucket[i]]++;
+        max_size = MAX(max_size, bsize[bucket[i]]);
+    }
+
+    for (size = max_size; size > 0; size--) {
+        for (i = 0; i < HASH_BUCKETS; i++) {
+            if (bsize[i] != size)
+                continue;
+
+            for (d = 1; d <= MAX_DISPLACE; d++) {
+                ok = TRUE;
+                nslot = 0;
+                for (j = 0; j < NFIELDS && ok; j++) {
+                    if (bucket[j] != i)
+                        continue;
+                    slot[nslot] = hash_key(fields[j].section, fields[j].name,
+                                           d) & (HASH_SIZE - 1);
+                    ok = hash_slot[slot[nslot]] < 0;
+                    for (k = 0; k < nslot && ok; k++)
+                        ok = slot[k] != slot[nslot];
+                    nslot++;
+                }
+                if (ok)
+                    break;
+            }
+            if (d > MAX_DISPLACE) {
+                fprintf(stderr, "Couldn't hash the registry, duplicate "
+                        "entry in param_fields.h?\n");
+                exit(EXIT_FAILURE);
+            }
+
+            hash_displace[i] = (unsigned short)d;
+            for (j = 0; j < NFIELDS; j++) {
+                if (bucket[j] == i)
+                    hash_slot[hash_key(fields[j].section, fields[j].name, d) &
+                              (HASH_SIZE - 1)] = (short)j;
+            }
+        }
+    }
+    hash_built = TRUE;
+
+    return;
+}
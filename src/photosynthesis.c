@@ -44,9 +44,9 @@ void photosynthesis_C3(control *c, canopy_wk *cw, met *m, params *p, state *s) {
     dleaf = cw->dleaf;
 
     // Calculate photosynthetic parameters from leaf temperature.
-    gamma_star = calc_co2_compensation_point(p, tleaf);
-    km = calculate_michaelis_menten(p, tleaf);
-    calculate_jmaxt_vcmaxt(c, cw, p, s, tleaf, &jmax, &vcmax);
+    gamma_star = temp_response(p, TT_GAMMA_STAR, tleaf);
+    km = temp_response(p, TT_KM, tleaf);
+    calculate_jmaxt_vcmaxt(c, p, s, cw->N0, tleaf, &jmax, &vcmax);
 
     // leaf respiration in the light, Collatz et al. 1991
     rd = 0.015 * vcmax;
@@ -114,7 +114,7 @@ void photosynthesis_C3(control *c, canopy_wk *cw, met *m, params *p, state *s) {
     if (c->water_balance == HYDRAULICS) {
         cw->ts_Cs = Cs;
         cw->ts_vcmax = vcmax;
-        cw->ts_jmax = jmax;
+        cw->ts_Vj = Vj;
         cw->ts_km = km;
         cw->ts_gamma_star = gamma_star;
         cw->ts_rd = rd;
@@ -182,15 +182,16 @@ int solve_ci(double g0, double gs_over_a, double rd, double Cs,
     return (error);
 }
 
-void photosynthesis_C3_emax(control *c, canopy_wk *cw, met *m, params *p,
-                            state *s, double par, double water_stress) {
+void photosynthesis_C3_emax(canopy_wk *cw) {
     //
     //  Calculate photosynthesis as above but for here we are resolving Ci and
-    //  A for a given gs (Jarvis style) to get the Emax solution.
+    //  A for a given gs (Jarvis style) to get the Emax solution. The
+    //  temperature dependent terms and the electron transport rate are the
+    //  ones photosynthesis_C3 just worked out for this pass.
     //
 
-    double gamma_star, km, jmax, vcmax, rd, Vj, gs;
-    double A, B, C, Ac, Aj, Cs, J;
+    double gamma_star, km, vcmax, rd, Vj, gs;
+    double A, B, C, Ac, Aj, Cs;
     int    idx, qudratic_error = FALSE, large_root;
 
     // Unpack calculated properties from first photosynthesis solution
@@ -200,12 +201,7 @@ void photosynthesis_C3_emax(control *c, canopy_wk *cw, met *m, params *p,
     km = cw->ts_km;
     gamma_star = cw->ts_gamma_star;
     rd = cw->ts_rd;
-    jmax = cw->ts_jmax;
-    qudratic_error = FALSE;
-    large_root = FALSE;
-    J = quad(p->theta, -(p->alpha_j * par + jmax),
-             p->alpha_j * par * jmax, large_root, &qudratic_error);
-    Vj = J / 4.0;
+    Vj = cw->ts_Vj;
     gs = cw->gsc_leaf[idx];
 
     /* Solution when Rubisco rate is limiting */
@@ -226,7 +222,6 @@ void photosynthesis_C3_emax(control *c, canopy_wk *cw, met *m, params *p,
     }
 
     // Solution when electron transport rate is limiting
-    A = 1.0 / gs;
     B = (rd - Vj) / gs - Cs - 2.0 * gamma_star;
     C = Vj * (Cs - gamma_star) - rd * (Cs + 2.0 * gamma_star);
 
@@ -300,7 +295,7 @@ double calculate_michaelis_menten(params *p, double tleaf) {
     return (Km);
 }
 
-void calculate_jmaxt_vcmaxt(control *c, canopy_wk *cw, params *p, state *s,
+void calculate_jmaxt_vcmaxt(control *c, params *p, state *s, double N0,
                             double tleaf, double *jmax, double *vcmax) {
     //
     //  Calculate the potential electron transport rate (Jmax) and the
@@ -310,6 +305,8 @@ void calculate_jmaxt_vcmaxt(control *c, canopy_wk *cw, params *p, state *s,
     //
     //  Parameters:
     //  ----------
+    //  N0 : float
+    //      top of canopy leaf N (g N m-2)
     //  tleaf : float
     //      air temperature (deg C)
     //  jmax : float
@@ -323,43 +320,35 @@ void calculate_jmaxt_vcmaxt(control *c, canopy_wk *cw, params *p, state *s,
     double upper_bound = 10.0;
     double tref = p->measurement_temp;
 
+    // The sunlit and shaded leaves share N0, the scaling to each leaf is
+    // applied by the caller (scalex)
     if (c->modeljm == 0) {
-        if (cw->ileaf == SUNLIT) {
-            *jmax = p->jmax;
-            *vcmax = p->vcmax;
+        *jmax = p->jmax;
+        *vcmax = p->vcmax;
+    } else {
+        if (c->modeljm == 1) {
+            vcmax25 = (p->vcmaxna * N0 + p->vcmaxnb);
+            jmax25 = (p->jmaxna * N0 + p->jmaxnb);
+        } else if (c->modeljm == 2) {
+            // NB when using the fixed JV reln, we only apply scalar to Vcmax
+            vcmax25 = (p->vcmaxna * N0 + p->vcmaxnb);
+            jmax25 = (p->jv_slope * vcmax25 - p->jv_intercept);
+        } else if (c->modeljm == 3) {
+            jmax25 = p->jmax;
+            vcmax25 = p->vcmax;
         } else {
-            *jmax = p->jmax;
-            *vcmax = p->vcmax;
+            fprintf(stderr, "You haven't set Jmax/Vcmax model: modeljm \n");
+            exit(EXIT_FAILURE);
         }
-    } else if (c->modeljm == 1) {
-        if (cw->ileaf == SUNLIT) {
-            vcmax25 = (p->vcmaxna * cw->N0 + p->vcmaxnb);
-            jmax25 = (p->jmaxna * cw->N0 + p->jmaxnb);
+
+        if (p->derived.tt.on) {
+            *vcmax = vcmax25 * temp_response(p, TT_VCMAX, tleaf);
+            *jmax = jmax25 * temp_response(p, TT_JMAX, tleaf);
         } else {
-            vcmax25 = (p->vcmaxna * cw->N0 + p->vcmaxnb);
-            jmax25 = (p->jmaxna * cw->N0 + p->jmaxnb);
+            *vcmax = arrhenius(vcmax25, p->eav, tleaf, tref);
+            *jmax = peaked_arrhenius(jmax25, p->eaj, tleaf, tref, p->delsj,
+                                     p->edj);
         }
-        *vcmax = arrhenius(vcmax25, p->eav, tleaf, tref);
-        *jmax = peaked_arrhenius(jmax25, p->eaj, tleaf, tref, p->delsj, p->edj);
-    } else if (c->modeljm == 2) {
-        // NB when using the fixed JV reln, we only apply scalar to Vcmax
-        if (cw->ileaf == SUNLIT) {
-            vcmax25 = (p->vcmaxna * cw->N0 + p->vcmaxnb);
-            jmax25 = (p->jv_slope * vcmax25 - p->jv_intercept);
-        } else {
-            vcmax25 = (p->vcmaxna * cw->N0 + p->vcmaxnb);
-            jmax25 = (p->jv_slope * vcmax25 - p->jv_intercept);
-        }
-        *vcmax = arrhenius(vcmax25, p->eav, tleaf, tref);
-        *jmax = peaked_arrhenius(jmax25, p->eaj, tleaf, tref, p->delsj, p->edj);
-    } else if (c->modeljm == 3) {
-        jmax25 = p->jmax;
-        vcmax25 = p->vcmax;
-        *vcmax = arrhenius(vcmax25, p->eav, tleaf, tref);
-        *jmax = peaked_arrhenius(jmax25, p->eaj, tleaf, tref, p->delsj, p->edj);
-    } else {
-        fprintf(stderr, "You haven't set Jmax/Vcmax model: modeljm \n");
-        exit(EXIT_FAILURE);
     }
 
     // reduce photosynthetic capacity with moisture stress
@@ -590,21 +579,44 @@ void mate_C3_photosynthesis(control *c, fluxes *f, met *m, params *p, state *s,
            ci_am, ci_pm, alpha_am, alpha_pm, ac_am, ac_pm, aj_am, aj_pm,
            asat_am, asat_pm, lue_am, lue_pm, lue_avg, conv;
     double mt = p->measurement_temp + DEG_TO_KELVIN;
+    mate_table *y = c->mate;
+    long        d = c->day_idx;
 
     /* Calculate mate params & account for temperature dependencies */
     N0 = calculate_top_of_canopy_n(p, s, ncontent);
 
-    gamma_star_am = calculate_co2_compensation_point(p, m->Tk_am, mt);
-    gamma_star_pm = calculate_co2_compensation_point(p, m->Tk_pm, mt);
+    if (y != NULL && d < y->ndays) {
+        /* the temperature and VPD terms were worked out up front */
+        gamma_star_am = y->gamma_star[AM][d];
+        gamma_star_pm = y->gamma_star[PM][d];
 
-    Km_am = calculate_michaelis_menten_parameter(p, m->Tk_am, mt);
-    Km_pm = calculate_michaelis_menten_parameter(p, m->Tk_pm, mt);
+        Km_am = y->km[AM][d];
+        Km_pm = y->km[PM][d];
 
-    calculate_jmax_and_vcmax(c, p, s, m->Tk_am, N0, &jmax_am, &vcmax_am, mt);
-    calculate_jmax_and_vcmax(c, p, s, m->Tk_pm, N0, &jmax_pm, &vcmax_pm, mt);
+        jmax_and_vcmax_from_terms(c, p, s, m->Tk_am, N0, y->arrh_j[AM][d],
+                                  y->peak_j, y->peak_den[AM][d],
+                                  y->arrh_v[AM][d], &jmax_am, &vcmax_am);
+        jmax_and_vcmax_from_terms(c, p, s, m->Tk_pm, N0, y->arrh_j[PM][d],
+                                  y->peak_j, y->peak_den[PM][d],
+                                  y->arrh_v[PM][d], &jmax_pm, &vcmax_pm);
 
-    ci_am = calculate_ci(c, p, s, m->vpd_am, m->Ca);
-    ci_pm = calculate_ci(c, p, s, m->vpd_pm, m->Ca);
+        ci_am = ci_from_sqrt_vpd(c, p, s, y->sqrt_vpd[AM][d], m->Ca);
+        ci_pm = ci_from_sqrt_vpd(c, p, s, y->sqrt_vpd[PM][d], m->Ca);
+    } else {
+        gamma_star_am = calculate_co2_compensation_point(p, m->Tk_am, mt);
+        gamma_star_pm = calculate_co2_compensation_point(p, m->Tk_pm, mt);
+
+        Km_am = calculate_michaelis_menten_parameter(p, m->Tk_am, mt);
+        Km_pm = calculate_michaelis_menten_parameter(p, m->Tk_pm, mt);
+
+        calculate_jmax_and_vcmax(c, p, s, m->Tk_am, N0, &jmax_am, &vcmax_am,
+                                 mt);
+        calculate_jmax_and_vcmax(c, p, s, m->Tk_pm, N0, &jmax_pm, &vcmax_pm,
+                                 mt);
+
+        ci_am = calculate_ci(c, p, s, m->vpd_am, m->Ca);
+        ci_pm = calculate_ci(c, p, s, m->vpd_pm, m->Ca);
+    }
 
     /* quantum efficiency calculated for C3 plants */
     alpha_am = calculate_quantum_efficiency(p, ci_am, gamma_star_am);
@@ -654,6 +666,67 @@ void mate_C3_photosynthesis(control *c, fluxes *f, met *m, params *p, state *s,
     return;
 }
 
+void build_mate_table(control *c, met_arrays *ma, params *p) {
+    /*
+        The terms of mate_C3_photosynthesis which only depend on the forcing
+        and the params, for every day of the forcing: Gamma*, Km, the
+        Arrhenius factors of Jmax and Vcmax and sqrt(VPD). Worked out once
+        per run, one loop per term down the days, so a spin-up going round
+        the forcing again and again doesn't redo them, and the daily call is
+        left with what depends on the state (leaf N, LAI, water stress).
+
+        Bit for bit what the daily call would work out, so the results don't
+        change. When nothing has been built (stepping through the embedding
+        API) the daily call works them out itself.
+    */
+    mate_table *y = c->mate;
+    double      mt = p->measurement_temp + DEG_TO_KELVIN, *Tk[2];
+    long        d, n = c->total_num_days;
+    int         k, j;
+
+    free(y->buf);
+    if ((y->buf = malloc(n * 14 * sizeof(double))) == NULL) {
+        fprintf(stderr, "malloc failed allocating MATE terms\n");
+        exit(EXIT_FAILURE);
+    }
+    for (k = 0, j = 0; k < 2; k++) {
+        y->gamma_star[k] = y->buf + n * j++;
+        y->km[k] = y->buf + n * j++;
+        y->arrh_v[k] = y->buf + n * j++;
+        y->arrh_j[k] = y->buf + n * j++;
+        y->peak_den[k] = y->buf + n * j++;
+        y->sqrt_vpd[k] = y->buf + n * j++;
+        Tk[k] = y->buf + n * j++;
+    }
+    y->ndays = n;
+    y->peak_j = 1.0 + exp((mt * p->delsj - p->edj) / (mt * RGAS));
+
+    for (d = 0; d < n; d++) {
+        Tk[AM][d] = ma->tam[d] + DEG_TO_KELVIN;
+        Tk[PM][d] = ma->tpm[d] + DEG_TO_KELVIN;
+        y->sqrt_vpd[AM][d] = sqrt(ma->vpd_am[d] * KPA_2_PA * PA_2_KPA);
+        y->sqrt_vpd[PM][d] = sqrt(ma->vpd_pm[d] * KPA_2_PA * PA_2_KPA);
+    }
+
+    for (k = 0; k < 2; k++) {
+        for (d = 0; d < n; d++)
+            y->gamma_star[k][d] = calculate_co2_compensation_point(p,
+                                                                Tk[k][d], mt);
+        for (d = 0; d < n; d++)
+            y->km[k][d] = calculate_michaelis_menten_parameter(p, Tk[k][d],
+                                                               mt);
+        for (d = 0; d < n; d++)
+            y->arrh_v[k][d] = arrh(mt, 1.0, p->eav, Tk[k][d]);
+        for (d = 0; d < n; d++)
+            y->arrh_j[k][d] = arrh(mt, 1.0, p->eaj, Tk[k][d]);
+        for (d = 0; d < n; d++)
+            y->peak_den[k][d] = 1.0 + exp((Tk[k][d] * p->delsj - p->edj) /
+                                          (Tk[k][d] * RGAS));
+    }
+
+    return;
+}
+
 double calculate_top_of_canopy_n(params *p, state *s, double ncontent)  {
 
     /*
@@ -823,6 +896,30 @@ void calculate_jmax_and_vcmax(control *c, params *p, state *s, double Tk,
         vcmax : float (umol/m2/sec)
             the maximum rate of electron transport at 25 degC
     */
+    double arrh_j, peak_j, peak_den, arrh_v;
+
+    /* the peaked Arrhenius function, in pieces, see peaked_arrh */
+    arrh_j = arrh(mt, 1.0, p->eaj, Tk);
+    peak_j = 1.0 + exp((mt * p->delsj - p->edj) / (mt * RGAS));
+    peak_den = 1.0 + exp((Tk * p->delsj - p->edj) / (Tk * RGAS));
+    arrh_v = arrh(mt, 1.0, p->eav, Tk);
+
+    jmax_and_vcmax_from_terms(c, p, s, Tk, N0, arrh_j, peak_j, peak_den,
+                              arrh_v, jmax, vcmax);
+
+    return;
+}
+
+void jmax_and_vcmax_from_terms(control *c, params *p, state *s, double Tk,
+                               double N0, double arrh_j, double peak_j,
+                               double peak_den, double arrh_v, double *jmax,
+                               double *vcmax) {
+    /*
+        Jmax and Vcmax, as calculate_jmax_and_vcmax, given the temperature
+        terms: the Arrhenius factors arrh(mt, 1.0, Ea, Tk) of each and the
+        1 + exp() terms of peaked_arrh for Jmax, at the measurement
+        temperature (peak_j) and at Tk (peak_den)
+    */
     double jmax25, vcmax25;
 
     *vcmax = 0.0;
@@ -836,30 +933,27 @@ void calculate_jmax_and_vcmax(control *c, params *p, state *s, double Tk,
         jmax25 = p->jmaxna * N0 + p->jmaxnb;
 
         /* this response is well-behaved for TLEAF < 0.0 */
-        *jmax = peaked_arrh(mt, jmax25, p->eaj, Tk,
-                            p->delsj, p->edj);
+        *jmax = jmax25 * arrh_j * peak_j / peak_den;
 
         /* the maximum rate of electron transport at 25 degC */
         vcmax25 = p->vcmaxna * N0 + p->vcmaxnb;
-        *vcmax = arrh(mt, vcmax25, p->eav, Tk);
+        *vcmax = vcmax25 * arrh_v;
     } else if (c->modeljm == 2) {
         vcmax25 = p->vcmaxna * N0 + p->vcmaxnb;
-        *vcmax = arrh(mt, vcmax25, p->eav, Tk);
+        *vcmax = vcmax25 * arrh_v;
 
         jmax25 = p->jv_slope * vcmax25 - p->jv_intercept;
-        *jmax = peaked_arrh(mt, jmax25, p->eaj, Tk, p->delsj,
-                               p->edj);
+        *jmax = jmax25 * arrh_j * peak_j / peak_den;
     } else if (c->modeljm == 3) {
         /* the maximum rate of electron transport at 25 degC */
         jmax25 = p->jmax;
 
         /* this response is well-behaved for TLEAF < 0.0 */
-        *jmax = peaked_arrh(mt, jmax25, p->eaj, Tk,
-                            p->delsj, p->edj);
+        *jmax = jmax25 * arrh_j * peak_j / peak_den;
 
         /* the maximum rate of electron transport at 25 degC */
         vcmax25 = p->vcmax;
-        *vcmax = arrh(mt, vcmax25, p->eav, Tk);
+        *vcmax = vcmax25 * arrh_v;
 
     }
 
@@ -922,11 +1016,17 @@ double calculate_ci(control *c, params *p, state *s, double vpd, double Ca) {
     * Medlyn, B. E. et al (2011) Global Change Biology, 17, 2134-2144.
     */
 
+    return (ci_from_sqrt_vpd(c, p, s, sqrt(vpd * PA_2_KPA), Ca));
+}
+
+double ci_from_sqrt_vpd(control *c, params *p, state *s, double sqrt_vpd,
+                        double Ca) {
+    /* calculate_ci, given sqrt(vpd) in kPa^0.5 */
     double g1w, cica, ci=0.0;
 
     if (c->gs_model == MEDLYN) {
         g1w = p->g1 * s->wtfac_root;
-        cica = g1w / (g1w + sqrt(vpd * PA_2_KPA));
+        cica = g1w / (g1w + sqrt_vpd);
         ci = cica * Ca;
     } else {
         prog_error("Only Belindas gs model is implemented", __LINE__);
@@ -1046,6 +1146,12 @@ double epsilon(params *p, double asat, double par, double alpha,
     double delta, q, integral_g, sinx, arg1, arg2, arg3, lue, h;
     int i;
 
+    /* sin(pi * i / 24) at the subinterval midpoints, i = 1, 3, ... 11 */
+    static const double sin_mid[6] = {
+        0.13052619222005157, 0.38268343236508978, 0.60876142900872066,
+        0.79335334029123517, 0.92387953251128674, 0.99144486137381038
+    };
+
     /* subintervals scalar, i.e. 6 intervals */
     delta = 0.16666666667;
 
@@ -1057,7 +1163,7 @@ double epsilon(params *p, double asat, double par, double alpha,
         q = M_PI * p->kext * alpha * par / (2.0 * h * asat);
         integral_g = 0.0;
         for (i = 1; i < 13; i+=2) {
-            sinx = sin(M_PI * i / 24.);
+            sinx = sin_mid[i/2];
             arg1 = sinx;
             arg2 = 1.0 + q * sinx;
             arg3 = (sqrt(pow((1.0 + q * sinx), 2) - 4.0 * p->theta * q * sinx));
@@ -25,10 +25,8 @@ void calc_day_growth(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
                      met_arrays *ma, met *m, nrutil *nr, params *p, state *s,
                      double day_length, int doy, double fdecay, double rdecay)
 {
-    double previous_topsoil_store, dummy=0.0,
-           previous_rootzone_store, nitfac, ncbnew, nccnew, ncwimm, ncwnew;
+    double previous_topsoil_store, dummy=0.0, previous_rootzone_store;
     double previous_sw, current_sw, previous_cs, current_cs, year;
-    int    recalc_wb;
 
     /* Store the previous days soil water store */
     previous_topsoil_store = s->pawater_topsoil;
@@ -53,6 +51,24 @@ void calc_day_growth(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
         //                    current_cs, year, doy);
     }
 
+    finish_day_growth(c, f, fs, m, p, s, day_length, doy, fdecay, rdecay,
+                      previous_topsoil_store, previous_rootzone_store);
+
+    return;
+}
+
+void finish_day_growth(control *c, fluxes *f, fast_spinup *fs, met *m,
+                       params *p, state *s, double day_length, int doy,
+                       double fdecay, double rdecay,
+                       double previous_topsoil_store,
+                       double previous_rootzone_store) {
+    /*
+        Allocate the day's C & N, once the day's production and water
+        balance are done (whole day or half-hour by half-hour)
+    */
+    double dummy=0.0, nitfac, ncbnew, nccnew, ncwimm, ncwnew;
+    int    recalc_wb;
+
     /* leaf N:C as a fraction of Ncmaxyoung, i.e. the max N:C ratio of
        foliage in young stand */
     nitfac = MIN(1.0, s->shootnc / p->ncmaxfyoung);
@@ -442,12 +458,13 @@ int nitrogen_allocation(control *c, fluxes *f, params *p, state *s,
         f->nuptake = f->nuptake * G_M2_2_TONNES_HA * YRS_IN_DAYS;
 
         /* covert from kg DM N m-2 to t ha-1 */
-        f->deadroots = p->rdecay * f->rabove * p->cfracts * KG_M2_2_TONNES_HA;
+        f->deadroots = p->derived.rdecay * f->rabove * p->cfracts *
+                       KG_M2_2_TONNES_HA;
         f->deadrootn = s->rootnc * (1.0 - p->rretrans) * f->deadroots;
     }
 
     /* Mineralised nitrogen lost from the system by volatilisation/leaching */
-    f->nloss = p->rateloss * s->inorgn;
+    f->nloss = p->derived.rateloss * s->inorgn;
 
     /* total nitrogen to allocate */
     ntot = MAX(0.0, f->nuptake + f->retrans);
@@ -902,12 +919,12 @@ void update_plant_state(control *c, fluxes *f, params *p, state *s,
         s->shootn += f->npleaf - fdecay * s->shootn - f->neaten;
     }
 
-    s->branchn += f->npbranch - p->bdecay * s->branchn;
+    s->branchn += f->npbranch - p->derived.bdecay * s->branchn;
     s->rootn += f->nproot - rdecay * s->rootn;
-    s->crootn += f->npcroot - p->crdecay * s->crootn;
-    s->stemnimm += f->npstemimm - p->wdecay * s->stemnimm;
-    s->stemnmob += (f->npstemmob - p->wdecay * s->stemnmob - p->retransmob *
-                    s->stemnmob);
+    s->crootn += f->npcroot - p->derived.crdecay * s->crootn;
+    s->stemnimm += f->npstemimm - p->derived.wdecay * s->stemnimm;
+    s->stemnmob += (f->npstemmob - p->derived.wdecay * s->stemnmob -
+                    p->derived.retransmob * s->stemnmob);
     s->stemn = s->stemnimm + s->stemnmob;
 
 
@@ -1194,10 +1211,10 @@ double nitrogen_retrans(control *c, fluxes *f, params *p, state *s,
     }
 
     rootretransn = p->rretrans * rdecay * s->rootn;
-    crootretransn = p->cretrans * p->crdecay * s->crootn;
-    branchretransn = p->bretrans * p->bdecay * s->branchn;
-    stemretransn = (p->wretrans * p->wdecay * s->stemnmob + p->retransmob *
-                    s->stemnmob);
+    crootretransn = p->cretrans * p->derived.crdecay * s->crootn;
+    branchretransn = p->bretrans * p->derived.bdecay * s->branchn;
+    stemretransn = (p->wretrans * p->derived.wdecay * s->stemnmob +
+                    p->derived.retransmob * s->stemnmob);
 
     /* store for NCEAS output */
     f->leafretransn = leafretransn;
@@ -1226,16 +1243,16 @@ double calculate_nuptake(control *c, params *p, state *s) {
 
     if (c->nuptake_model == 0) {
         /* Constant N uptake */
-        nuptake = p->nuptakez;
+        nuptake = p->derived.nuptakez;
     } else if (c->nuptake_model == 1) {
         /* evaluate nuptake : proportional to dynamic inorganic N pool */
-        nuptake = p->rateuptake * s->inorgn;
+        nuptake = p->derived.rateuptake * s->inorgn;
     } else if (c->nuptake_model == 2) {
         /* N uptake is a saturating function on root biomass following
            Dewar and McMurtrie, 1996. */
 
         /* supply rate of available mineral N */
-        U0 = p->rateuptake * s->inorgn;
+        U0 = p->derived.rateuptake * s->inorgn;
         Kr = p->kr;
         nuptake = MAX(U0 * s->root / (s->root + Kr), 0.0);
 
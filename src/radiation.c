@@ -101,10 +101,10 @@ void calculate_absorbed_radiation(canopy_wk *cw, params *p, state *s,
         * De Pury & Farquhar (1997) PCE, 20, 537-557.
         * Dai et al. (2004) Journal of Climate, 17, 2281-2299.
     */
-    double Ib, Id, scattered, shaded, beam, psi1, psi2, Gross, lai, lad;
-    double total_canopy_irradiance, arg1, arg2, arg3, rho_cd, rho_cb, omega;
+    double Ib, Id, psi1, psi2, Gross, lai, lad;
+    double arg1, arg2, arg3, rho_cd, rho_cb, omega;
     double k_dash_b, k_dash_d;
-    double cf1, cf2, cf3;
+    double cf_kb, cf_2kb, cf_d, cf_dkb, cf_b, cf_bkb;
 
     rho_cd = 0.036;             // canopy reflection coeffcient for diffuse PAR
     rho_cb = 0.029;              // canopy reflection coeffcient for direct PAR
@@ -132,36 +132,102 @@ void calculate_absorbed_radiation(canopy_wk *cw, params *p, state *s,
     Id = par * cw->diffuse_frac;
 
     // By substituting eq. B2 or B3 into Eq B1 and then integrating we get ...
+    // The sunlit and shaded terms share most of the B5 integrals, so each is
+    // worked out once
+    cf_kb = psi_func(cw->kb, lai);
+    cf_2kb = psi_func(2.0 * cw->kb, lai);
+    cf_d = psi_func(k_dash_d, lai);
+    cf_dkb = psi_func(k_dash_d + cw->kb, lai);
+    cf_b = psi_func(k_dash_b, lai);
+    cf_bkb = psi_func(k_dash_b + cw->kb, lai);
 
     // Direct or beam irradiance absorbed by sunlit fraction of the canopy
     // Eqn B3b
-    cf1 = psi_func(k_dash_d + cw->kb, lai);
-    cf2 = psi_func(k_dash_b + cw->kb, lai);
-    cf3 = psi_func(cw->kb, lai) - psi_func(2.0 * cw->kb, lai);
-
-    arg1 = Id * (1.0 - rho_cd) * k_dash_d * cf1;
-    arg2 = Ib * (1.0 - rho_cb) * k_dash_b * cf2;
-    arg3 = Ib * (1.0 - omega) * cw->kb * cf3;
+    arg1 = Id * (1.0 - rho_cd) * k_dash_d * cf_dkb;
+    arg2 = Ib * (1.0 - rho_cb) * k_dash_b * cf_bkb;
+    arg3 = Ib * (1.0 - omega) * cw->kb * (cf_kb - cf_2kb);
     cw->apar_leaf[SUNLIT] = arg1 + arg2 + arg3;
 
     // Diffuse irradiance absorbed by shaded fraction of the canopy
     // Eqn B4
-    cf1 = psi_func(k_dash_d, lai) - psi_func(k_dash_d + cw->kb, lai);
-    cf2 = psi_func(k_dash_b, lai) - psi_func(k_dash_b + cw->kb, lai);
-    cf3 = psi_func(cw->kb, lai) - psi_func(2.0 * cw->kb, lai);
-
-    arg1 = Id * (1.0 - rho_cd) * k_dash_d * cf1;
-    arg2 = Ib * (1.0 - rho_cb) * k_dash_b * cf2;
-    arg3 = Ib * (1.0 - omega) * cw->kb * cf3;
+    arg1 = Id * (1.0 - rho_cd) * k_dash_d * (cf_d - cf_dkb);
+    arg2 = Ib * (1.0 - rho_cb) * k_dash_b * (cf_b - cf_bkb);
     cw->apar_leaf[SHADED] = arg1 + arg2 - arg3;
 
     /* Calculate sunlit &shdaded LAI of the canopy - de P * F eqn 18*/
-    cw->lai_leaf[SUNLIT] = (1.0 - exp(-cw->kb * lai)) / cw->kb;
+    cw->lai_leaf[SUNLIT] = cf_kb;
     cw->lai_leaf[SHADED] = lai - cw->lai_leaf[SUNLIT];
 
     return;
 }
 
+void canopy_radiation_lanes(params *p, state *s, radiation_lanes *r) {
+    /*
+        calculate_absorbed_radiation and calc_leaf_to_canopy_scalar for r->n
+        daytime half-hours of one day at once, for the batched canopy
+        kernel.
+
+        Nothing but the sun moves within the day, so the Ross-Goudriaan
+        terms, the diffuse integral and the shaded scalar are worked out
+        once, leaving six exponentials per half-hour. Each stage is a loop
+        straight down the arrays. The results are bit for bit those of the
+        per half-hour functions.
+    */
+    double psi1, psi2, lai = s->lai, kn = p->kn;
+    double rho_cd = 0.036, rho_cb = 0.029, omega = 0.15, k_dash_d = 0.719;
+    double cf_d, cf_kn, Ib, Id, arg1, arg2, arg3;
+    double k_dash_b[MAX_RADIATION_LANES];
+    double cf_kb[MAX_RADIATION_LANES], cf_2kb[MAX_RADIATION_LANES];
+    double cf_dkb[MAX_RADIATION_LANES], cf_b[MAX_RADIATION_LANES];
+    double cf_bkb[MAX_RADIATION_LANES], cf_kbkn[MAX_RADIATION_LANES];
+    int    i;
+
+    // Fixed for the day
+    psi1 = 0.5 - 0.633 * p->lad;
+    psi2 = 0.877 * (1.0 - 2.0 * psi1);
+    cf_d = psi_func(k_dash_d, lai);
+    cf_kn = (1.0 - exp(-kn * lai)) / kn;
+
+    // Extinction coefficients
+    for (i = 0; i < r->n; i++) {
+        r->kb[i] = (psi1 + psi2 * r->cos_zenith[i]) / r->cos_zenith[i];
+        k_dash_b[i] = 0.46 / r->cos_zenith[i];
+    }
+
+    // The B5 integrals
+    for (i = 0; i < r->n; i++) {
+        cf_kb[i] = psi_func(r->kb[i], lai);
+        cf_2kb[i] = psi_func(2.0 * r->kb[i], lai);
+        cf_dkb[i] = psi_func(k_dash_d + r->kb[i], lai);
+        cf_b[i] = psi_func(k_dash_b[i], lai);
+        cf_bkb[i] = psi_func(k_dash_b[i] + r->kb[i], lai);
+        cf_kbkn[i] = (1.0 - exp(-(r->kb[i] + kn) * lai)) / (r->kb[i] + kn);
+    }
+
+    // Absorbed PAR, LAI and scalars, sunlit and shaded
+    for (i = 0; i < r->n; i++) {
+        Ib = r->par[i] * r->direct_frac[i];
+        Id = r->par[i] * r->diffuse_frac[i];
+
+        arg1 = Id * (1.0 - rho_cd) * k_dash_d * cf_dkb[i];
+        arg2 = Ib * (1.0 - rho_cb) * k_dash_b[i] * cf_bkb[i];
+        arg3 = Ib * (1.0 - omega) * r->kb[i] * (cf_kb[i] - cf_2kb[i]);
+        r->apar[SUNLIT][i] = arg1 + arg2 + arg3;
+
+        arg1 = Id * (1.0 - rho_cd) * k_dash_d * (cf_d - cf_dkb[i]);
+        arg2 = Ib * (1.0 - rho_cb) * k_dash_b[i] * (cf_b[i] - cf_bkb[i]);
+        r->apar[SHADED][i] = arg1 + arg2 - arg3;
+
+        r->lai_leaf[SUNLIT][i] = cf_kb[i];
+        r->lai_leaf[SHADED][i] = lai - cf_kb[i];
+
+        r->scalex[SUNLIT][i] = cf_kbkn[i];
+        r->scalex[SHADED][i] = cf_kn - cf_kbkn[i];
+    }
+
+    return;
+}
+
 double psi_func(double z, double lai) {
     /*
         B5 function from Wang and Leuning which integrates property passed via
@@ -310,3 +310,37 @@ void read_subdaily_met_data(char **argv, control *c, met_arrays *ma)
     fclose(fp);
     return;
 }
+
+void free_met_data(control *c, met_arrays *ma) {
+    /* undo read_daily_met_data/read_subdaily_met_data */
+
+    free(ma->year);
+    free(ma->tair);
+    free(ma->rain);
+    free(ma->tsoil);
+    free(ma->co2);
+    free(ma->ndep);
+    free(ma->nfix);
+    free(ma->wind);
+    free(ma->press);
+    free(ma->par);
+    if (c->sub_daily) {
+        free(ma->vpd);
+        free(ma->doy);
+    } else {
+        free(ma->prjday);
+        free(ma->tam);
+        free(ma->tpm);
+        free(ma->tmin);
+        free(ma->tmax);
+        free(ma->tday);
+        free(ma->vpd_am);
+        free(ma->vpd_pm);
+        free(ma->wind_am);
+        free(ma->wind_pm);
+        free(ma->par_am);
+        free(ma->par_pm);
+    }
+
+    return;
+}
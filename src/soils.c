@@ -162,25 +162,25 @@ void calculate_decay_rates(control *c, fluxes *f, fast_spinup *fs, params *p,
     lignin_cont_root = exp(-3.0 * p->ligroot);
 
     /* decay rate of surface structural pool */
-    p->decayrate[0] = p->kdec1 * lignin_cont_leaf * adfac;
+    p->decayrate[0] = p->derived.kdec1 * lignin_cont_leaf * adfac;
 
     /* decay rate of surface metabolic pool */
-    p->decayrate[1] = p->kdec2 * adfac;
+    p->decayrate[1] = p->derived.kdec2 * adfac;
 
     /* decay rate of soil structural pool */
-    p->decayrate[2] = p->kdec3 * lignin_cont_root * adfac;
+    p->decayrate[2] = p->derived.kdec3 * lignin_cont_root * adfac;
 
     /* decay rate of soil metabolic pool */
-    p->decayrate[3] = p->kdec4 * adfac;
+    p->decayrate[3] = p->derived.kdec4 * adfac;
 
     /* decay rate of active pool */
-    p->decayrate[4] = p->kdec5 * soil_text * adfac;
+    p->decayrate[4] = p->derived.kdec5 * soil_text * adfac;
 
     /* decay rate of slow pool */
-    p->decayrate[5] = p->kdec6 * adfac;
+    p->decayrate[5] = p->derived.kdec6 * adfac;
 
     /* decay rate of passive pool */
-    p->decayrate[6] = p->kdec7 * adfac;
+    p->decayrate[6] = p->derived.kdec7 * adfac;
 
     if (c->spinup_method == SAS) {
         fs->dr[0] += p->decayrate[0];
@@ -621,7 +621,7 @@ void calculate_nsoil_flows(control *c, fluxes *f, params *p, state *s,
         adjust_residence_time_of_slow_pool(f, p);
     } else {
         /* Need to correct units of rate constant */
-        f->rtslow = 1.0 / (p->kdec6 * NDAYS_IN_YR);
+        f->rtslow = 1.0 / (p->derived.kdec6 * NDAYS_IN_YR);
     }
 
     /* Update model soil N pools */
@@ -710,16 +710,16 @@ void adjust_residence_time_of_slow_pool(fluxes *f, params *p) {
 
     if (float_eq(f->factive, 0.0)) {
         /* Need to correct units of rate constant */
-        rt_slow_pool = 1.0 / (p->kdec6 * NDAYS_IN_YR);
+        rt_slow_pool = 1.0 / (p->derived.kdec6 * NDAYS_IN_YR);
     } else {
         rt_slow_pool = (1.0 / p->prime_y) / \
                         MAX(0.3, (f->factive / (f->factive + p->prime_z)));
 
         /* GDAY uses decay rates rather than residence times... */
-        p->kdec6 = 1.0 / rt_slow_pool;
+        p->derived.kdec6 = 1.0 / rt_slow_pool;
 
         /* rate constant needs to be per day inside GDAY */
-        p->kdec6 /= NDAYS_IN_YR;
+        p->derived.kdec6 /= NDAYS_IN_YR;
 
     }
 
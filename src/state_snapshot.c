@@ -0,0 +1,168 @@
+/* ============================================================================
+* Binary snapshot of the model state
+*
+* A faster, lossless alternative to writing the final state back into a copy
+* of the .cfg file (write_final_state). The snapshot carries the same
+* variables, but as raw doubles, so chaining phases (spin-up -> historical ->
+* experiment) doesn't round the pools to 10 d.p. or re-parse text at every
+* hand-off.
+*
+* Layout (native byte order):
+*   char     magic[8]        "GDAYSNAP"
+*   uint32   version
+*   uint32   nfields
+*   uint32   length of the git revision string, followed by the string
+*   nfields x {uint8 section, uint8 name length, name}   - field table
+*   nfields x double                                     - values
+*
+* NOTES:
+*   The variables are those flagged RESTART in param_fields.h. Fields are
+*   matched by name when reading, anything we don't recognise is skipped and
+*   anything missing keeps its value from the .cfg file. So variables can be
+*   added to the registry without breaking old snapshots.
+*
+* =========================================================================== */
+#include <stddef.h>
+#include <stdint.h>
+#include "state_snapshot.h"
+
+/* section codes stored in the field table */
+#define SNAP_STATE 0
+#define SNAP_PARAMS 1
+
+static void    snap_read(void *, size_t, FILE *, const char *);
+
+
+void write_state_snapshot(control *c, params *p, state *s) {
+    /*
+        Dump the state to c->out_state_fname, does nothing if no snapshot
+        file was asked for
+    */
+    FILE    *fp = NULL;
+    uint32_t version = SNAPSHOT_VERSION;
+    uint32_t nfields = 0;
+    uint32_t git_len = strlen(c->git_code_ver);
+    uint8_t  section, name_len;
+    int      i;
+    const reg_field *fld = NULL;
+
+    if (strcmp(c->out_state_fname, "*NOT SET*") == 0)
+        return;
+
+    if ((fp = fopen(c->out_state_fname, "wb")) == NULL) {
+        fprintf(stderr, "Error opening state snapshot %s for write\n",
+                c->out_state_fname);
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < registry_nfields(); i++) {
+        if (registry_field(i)->flags & REG_RESTART)
+            nfields++;
+    }
+
+    fwrite(SNAPSHOT_MAGIC, 1, 8, fp);
+    fwrite(&version, sizeof(uint32_t), 1, fp);
+    fwrite(&nfields, sizeof(uint32_t), 1, fp);
+    fwrite(&git_len, sizeof(uint32_t), 1, fp);
+    fwrite(c->git_code_ver, 1, git_len, fp);
+
+    for (i = 0; i < registry_nfields(); i++) {
+        fld = registry_field(i);
+        if (!(fld->flags & REG_RESTART))
+            continue;
+        section = (fld->section == REG_STATE) ? SNAP_STATE : SNAP_PARAMS;
+        name_len = (uint8_t)strlen(fld->name);
+        fwrite(&section, 1, 1, fp);
+        fwrite(&name_len, 1, 1, fp);
+        fwrite(fld->name, 1, name_len, fp);
+    }
+    for (i = 0; i < registry_nfields(); i++) {
+        fld = registry_field(i);
+        if (fld->flags & REG_RESTART)
+            fwrite(registry_ptr(fld, c, p, s), sizeof(double), 1, fp);
+    }
+
+    if (ferror(fp) || fclose(fp) != 0) {
+        fprintf(stderr, "Error writing state snapshot %s\n",
+                c->out_state_fname);
+        exit(EXIT_FAILURE);
+    }
+
+    return;
+}
+
+void read_state_snapshot(control *c, params *p, state *s) {
+    /*
+        Overwrite the initial state read from the .cfg file with the values
+        in c->init_state_fname, does nothing if no snapshot was given
+    */
+    FILE    *fp = NULL;
+    char     magic[8], name[256];
+    uint32_t version, nfields, git_len, i;
+    uint8_t  section, name_len;
+    const reg_field **index = NULL;
+    double   value;
+
+    if (strcmp(c->init_state_fname, "*NOT SET*") == 0)
+        return;
+
+    if ((fp = fopen(c->init_state_fname, "rb")) == NULL) {
+        fprintf(stderr, "Error opening state snapshot %s\n",
+                c->init_state_fname);
+        exit(EXIT_FAILURE);
+    }
+
+    snap_read(magic, 8, fp, c->init_state_fname);
+    if (memcmp(magic, SNAPSHOT_MAGIC, 8) != 0) {
+        fprintf(stderr, "%s is not a GDAY state snapshot\n",
+                c->init_state_fname);
+        exit(EXIT_FAILURE);
+    }
+    snap_read(&version, sizeof(uint32_t), fp, c->init_state_fname);
+    if (version != SNAPSHOT_VERSION) {
+        fprintf(stderr, "Unsupported state snapshot version %u in %s\n",
+                version, c->init_state_fname);
+        exit(EXIT_FAILURE);
+    }
+    snap_read(&nfields, sizeof(uint32_t), fp, c->init_state_fname);
+    snap_read(&git_len, sizeof(uint32_t), fp, c->init_state_fname);
+    if (fseek(fp, git_len, SEEK_CUR) != 0) {
+        fprintf(stderr, "Truncated state snapshot %s\n", c->init_state_fname);
+        exit(EXIT_FAILURE);
+    }
+
+    /* map the file's fields on to ours, NULL = unknown, skip */
+    if ((index = malloc(nfields * sizeof(reg_field *))) == NULL) {
+        fprintf(stderr, "malloc failed allocating snapshot index\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < nfields; i++) {
+        snap_read(&section, 1, fp, c->init_state_fname);
+        snap_read(&name_len, 1, fp, c->init_state_fname);
+        snap_read(name, name_len, fp, c->init_state_fname);
+        name[name_len] = '\0';
+
+        index[i] = registry_lookup((section == SNAP_STATE) ? "state" :
+                                   "params", name);
+        if (index[i] != NULL && !(index[i]->flags & REG_RESTART))
+            index[i] = NULL;
+    }
+
+    for (i = 0; i < nfields; i++) {
+        snap_read(&value, sizeof(double), fp, c->init_state_fname);
+        if (index[i] != NULL)
+            *(double *)registry_ptr(index[i], c, p, s) = value;
+    }
+
+    free(index);
+    fclose(fp);
+
+    return;
+}
+
+static void snap_read(void *buf, size_t n, FILE *fp, const char *fname) {
+    if (n > 0 && fread(buf, 1, n, fp) != n) {
+        fprintf(stderr, "Truncated state snapshot %s\n", fname);
+        exit(EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,675 @@
+/* ============================================================================
+* Parameter sweeps
+*
+* gday -p base.cfg --sweep sweep.ini
+*
+* draws samples of the parameters listed in the sweep file, runs the model
+* for each one in-process (see overrides.c, the base .cfg and met files are
+* only read once) and writes a one line summary of the requested annual
+* diagnostics per member, e.g.
+*
+*   [sweep]
+*   method = lhs                ; lhs or sobol
+*   samples = 100
+*   seed = 42
+*   spin_up = shared            ; none, shared or each
+*   summary_fname = outputs/sweep.csv
+*   summary_years = 10          ; average over the last 10 years, 0 = all
+*   diagnostics = gpp:sum, npp:sum, et:sum, lai:max
+*
+*   [ranges]
+*   params.g1 = uniform 2.0 6.0
+*   params.vcmaxna = loguniform 10.0 40.0
+*   params.sla = normal 4.4 0.5
+*
+* Diagnostics are any of the daily output variables, reduced to an annual
+* value by sum, mean (the default), min or max.
+*
+* With spin_up = shared the base setup is spun up once and every member
+* branches from that state, the spun up state is written to the output
+* file names tagged "spinup". With spin_up = each every member is spun up
+* with its own parameters first, writing to names tagged with its number.
+*
+* NOTES:
+*   Sobol points are digitally shifted with the seed and use the Joe & Kuo
+*   (2008) direction numbers, which are tabulated here for up to 21 params.
+*
+* =========================================================================== */
+#include "sweep.h"
+
+#define SWEEP_MAX_PARAMS 64
+
+typedef struct {
+    char             key[STRING_LENGTH];
+    const reg_field *fld;
+    int              dist;
+    double           a;
+    double           b;
+} sweep_param;
+
+typedef struct {
+    int         method;
+    int         nsamples;
+    uint64_t    seed;
+    int         spin_up;
+    int         summary_years;
+    char        summary_fname[STRING_LENGTH];
+    char        diagnostics[STRING_LENGTH];
+    int         nparams;
+    sweep_param params[SWEEP_MAX_PARAMS];
+} sweep_setup;
+
+/* Joe & Kuo (2008) new-joe-kuo-6.21201, dimensions 2..21 */
+static const struct {
+    int s;
+    int a;
+    int m[7];
+} sobol_dirs[SOBOL_MAX_DIM - 1] = {
+    {1, 0, {1}},                    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},              {3, 2, {1, 1, 1}},
+    {4, 1, {1, 1, 3, 3}},           {4, 4, {1, 3, 5, 13}},
+    {5, 2, {1, 1, 5, 5, 17}},       {5, 4, {1, 1, 5, 5, 5}},
+    {5, 7, {1, 1, 7, 11, 19}},      {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},      {5, 14, {1, 3, 5, 5, 31}},
+    {6, 1, {1, 3, 3, 9, 7, 49}},    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}}, {6, 19, {1, 1, 1, 15, 7, 5}},
+    {6, 22, {1, 3, 1, 15, 13, 25}}, {6, 25, {1, 1, 5, 5, 19, 61}},
+    {7, 1, {1, 3, 7, 11, 23, 15, 103}},
+    {7, 4, {1, 3, 7, 13, 13, 15, 69}}
+};
+
+static void        read_sweep_file(const char *, sweep_setup *);
+static void        sweep_handler(const char *, const char *, char *,
+                                 sweep_setup *);
+static sweep_diag *new_diagnostics(char *);
+static void        free_diagnostics(sweep_diag *);
+static void        close_year(sweep_diag *);
+static void        latin_hypercube(int, int, uint64_t *, double **);
+static void        sobol_points(int, int, uint64_t *, double **);
+static double      sample_value(sweep_param *, double);
+static double      inverse_normal(double);
+static uint64_t    splitmix64(uint64_t *);
+static double      rng_uniform(uint64_t *);
+
+
+void run_sweep(canopy_wk *cw, control *c, fluxes *f, fast_spinup *fs,
+               met_arrays *ma, met *m, params *p, state *s, nrutil *nr) {
+    /*
+        Run every member of the sweep described in c->sweep_fname
+    */
+    sweep_setup    *sw = NULL;
+    sweep_diag     *diag = NULL;
+    model_base     *base = NULL, *cfg = NULL;
+    override_list  *ol = NULL;
+    FILE           *ofp = NULL;
+    double        **u = NULL, *values = NULL, total;
+    uint64_t        rng;
+    char            tag[32], buf[64];
+    int             i, j, k, first, print_options;
+    const char     *agg_names[] = {"sum", "mean", "min", "max"};
+
+    if ((sw = calloc(1, sizeof(sweep_setup))) == NULL) {
+        fprintf(stderr, "malloc failed allocating sweep setup\n");
+        exit(EXIT_FAILURE);
+    }
+    read_sweep_file(c->sweep_fname, sw);
+    diag = new_diagnostics(sw->diagnostics);
+
+    /* samples in the unit hypercube */
+    rng = sw->seed;
+    u = malloc(sw->nsamples * sizeof(double *));
+    values = malloc(sw->nparams * sizeof(double));
+    if (u == NULL || values == NULL) {
+        fprintf(stderr, "malloc failed allocating sweep samples\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < sw->nsamples; i++) {
+        if ((u[i] = malloc(sw->nparams * sizeof(double))) == NULL) {
+            fprintf(stderr, "malloc failed allocating sweep samples\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (sw->method == SOBOL)
+        sobol_points(sw->nsamples, sw->nparams, &rng, u);
+    else
+        latin_hypercube(sw->nsamples, sw->nparams, &rng, u);
+
+    if ((ofp = fopen(sw->summary_fname, "w")) == NULL) {
+        fprintf(stderr, "Error opening sweep summary %s for write\n",
+                sw->summary_fname);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(ofp, "#Git_revision_code:%s\n", c->git_code_ver);
+    fprintf(ofp, "member");
+    for (j = 0; j < sw->nparams; j++)
+        fprintf(ofp, ",%s", sw->params[j].key);
+    for (j = 0; j < diag->ndiag; j++)
+        fprintf(ofp, ",%s_%s", daily_output_names[diag->col[j]],
+                agg_names[diag->agg[j]]);
+    fprintf(ofp, "\n");
+
+    print_options = c->print_options;
+    if (sw->spin_up == SPIN_SHARED) {
+        /* its final state goes to a file of its own, not a member's */
+        fprintf(stderr, "Shared spin-up for the sweep...\n");
+        cfg = save_model_base(cw, c, f, fs, p, s);
+        tag_output_fnames(c, NULL, "spinup");
+        c->spin_up = TRUE;
+        run_model(cw, c, f, fs, ma, m, p, s, nr);
+        copy_output_fnames(c, &cfg->c);
+        free(cfg);
+    }
+    c->spin_up = FALSE;
+    base = save_model_base(cw, c, f, fs, p, s);
+
+    for (i = 0; i < sw->nsamples; i++) {
+        restore_model_base(base, cw, c, f, fs, p, s);
+        sprintf(tag, "%d", i + 1);
+
+        ol = copy_override_list(base->c.ovr);
+        for (j = 0; j < sw->nparams; j++) {
+            values[j] = sample_value(&sw->params[j], u[i][j]);
+            if (sw->params[j].fld->type == REG_INT) {
+                /* the summary shows what the member ran with */
+                values[j] = floor(values[j] + 0.5);
+                snprintf(buf, sizeof(buf), "%d", (int)values[j]);
+            } else {
+                snprintf(buf, sizeof(buf), "%.10g", values[j]);
+            }
+            add_override(ol, sw->params[j].fld, buf);
+        }
+        apply_overrides(ol, c, p, s);
+        c->ovr = ol;
+
+        fprintf(stderr, "Sweep member %d of %d\n", i + 1, sw->nsamples);
+
+        /* e.g. a canopy trace, or the final state of its own spin-up */
+        tag_output_fnames(c, NULL, tag);
+
+        if (sw->spin_up == SPIN_EACH) {
+            c->spin_up = TRUE;
+            run_model(cw, c, f, fs, ma, m, p, s, nr);
+            c->spin_up = FALSE;
+        }
+
+        /* the member itself only feeds the summary */
+        c->print_options = NONE;
+        diag->year = -1;
+        diag->nyears = 0;
+        c->diag = diag;
+        run_model(cw, c, f, fs, ma, m, p, s, nr);
+        close_year(diag);
+        c->diag = NULL;
+
+        fprintf(ofp, "%d", i + 1);
+        for (j = 0; j < sw->nparams; j++)
+            fprintf(ofp, ",%.10g", values[j]);
+        first = 0;
+        if (sw->summary_years > 0 && sw->summary_years < diag->nyears)
+            first = diag->nyears - sw->summary_years;
+        for (j = 0; j < diag->ndiag; j++) {
+            total = 0.0;
+            for (k = first; k < diag->nyears; k++)
+                total += diag->annual[j][k];
+            fprintf(ofp, ",%.10f", (diag->nyears > first) ?
+                    total / (double)(diag->nyears - first) : -9999.9);
+        }
+        fprintf(ofp, "\n");
+        fflush(ofp);
+
+        free_override_list(ol);
+    }
+
+    restore_model_base(base, cw, c, f, fs, p, s);
+    c->print_options = print_options;
+
+    fclose(ofp);
+    for (i = 0; i < sw->nsamples; i++)
+        free(u[i]);
+    free(u);
+    free(values);
+    free(base);
+    free_diagnostics(diag);
+    free(sw);
+
+    return;
+}
+
+void record_diagnostics(sweep_diag *d, control *c, canopy_wk *cw, fluxes *f,
+                        state *s, int year, int doy) {
+    /* add today to the annual diagnostics, called at the end of each day */
+    double out[NDAILY_OUTPUTS];
+    double value;
+    int    i;
+
+    if (year != d->year) {
+        close_year(d);
+        d->year = year;
+    }
+
+    pack_daily_outputs(c, cw, f, s, year, doy, out);
+    for (i = 0; i < d->ndiag; i++) {
+        value = out[d->col[i]];
+        if (d->ndays == 0)
+            d->acc[i] = value;
+        else if (d->agg[i] == AGG_MIN)
+            d->acc[i] = MIN(d->acc[i], value);
+        else if (d->agg[i] == AGG_MAX)
+            d->acc[i] = MAX(d->acc[i], value);
+        else
+            d->acc[i] += value;
+    }
+    d->ndays++;
+
+    return;
+}
+
+static void close_year(sweep_diag *d) {
+    /* store the year being accumulated, if there is one */
+    int i;
+
+    if (d->ndays == 0)
+        return;
+
+    if (d->nyears == d->max_years) {
+        d->max_years = (d->max_years == 0) ? 64 : d->max_years * 2;
+        for (i = 0; i < d->ndiag; i++) {
+            d->annual[i] = realloc(d->annual[i],
+                                   d->max_years * sizeof(double));
+            if (d->annual[i] == NULL) {
+                fprintf(stderr, "realloc failed growing sweep diagnostics\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    for (i = 0; i < d->ndiag; i++) {
+        if (d->agg[i] == AGG_MEAN)
+            d->annual[i][d->nyears] = d->acc[i] / (double)d->ndays;
+        else
+            d->annual[i][d->nyears] = d->acc[i];
+    }
+    d->nyears++;
+    d->ndays = 0;
+
+    return;
+}
+
+static sweep_diag *new_diagnostics(char *list) {
+    /* "gpp:sum, lai:max, ..." */
+    sweep_diag *d = NULL;
+    char       *item = NULL, *next = NULL, *how = NULL;
+    int         i, n = 1;
+
+    for (i = 0; list[i] != '\0'; i++) {
+        if (list[i] == ',')
+            n++;
+    }
+
+    if ((d = calloc(1, sizeof(sweep_diag))) == NULL ||
+        (d->col = malloc(n * sizeof(int))) == NULL ||
+        (d->agg = malloc(n * sizeof(int))) == NULL ||
+        (d->acc = malloc(n * sizeof(double))) == NULL ||
+        (d->annual = calloc(n, sizeof(double *))) == NULL) {
+        fprintf(stderr, "malloc failed allocating sweep diagnostics\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (item = list; item != NULL; item = next) {
+        if ((next = strchr(item, ',')) != NULL)
+            *next++ = '\0';
+        item = lskip(rstrip(item));
+        if (*item == '\0')
+            continue;
+
+        d->agg[d->ndiag] = AGG_MEAN;
+        if ((how = strchr(item, ':')) != NULL) {
+            *how++ = '\0';
+            rstrip(item);
+            how = lskip(how);
+            if (strcasecmp(how, "sum") == 0)
+                d->agg[d->ndiag] = AGG_SUM;
+            else if (strcasecmp(how, "mean") == 0)
+                d->agg[d->ndiag] = AGG_MEAN;
+            else if (strcasecmp(how, "min") == 0)
+                d->agg[d->ndiag] = AGG_MIN;
+            else if (strcasecmp(how, "max") == 0)
+                d->agg[d->ndiag] = AGG_MAX;
+            else {
+                fprintf(stderr, "Unknown diagnostic aggregation: %s\n", how);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        d->col[d->ndiag] = -1;
+        for (i = 0; i < NDAILY_OUTPUTS; i++) {
+            if (strcasecmp(item, daily_output_names[i]) == 0) {
+                d->col[d->ndiag] = i;
+                break;
+            }
+        }
+        if (d->col[d->ndiag] < 0) {
+            fprintf(stderr, "Unknown diagnostic %s, expected one of the "
+                    "daily output variables\n", item);
+            exit(EXIT_FAILURE);
+        }
+        d->ndiag++;
+    }
+
+    if (d->ndiag == 0) {
+        fprintf(stderr, "The sweep file doesn't list any diagnostics\n");
+        exit(EXIT_FAILURE);
+    }
+    d->year = -1;
+
+    return (d);
+}
+
+static void free_diagnostics(sweep_diag *d) {
+    int i;
+
+    for (i = 0; i < d->ndiag; i++)
+        free(d->annual[i]);
+    free(d->annual);
+    free(d->col);
+    free(d->agg);
+    free(d->acc);
+    free(d);
+
+    return;
+}
+
+static void read_sweep_file(const char *fname, sweep_setup *sw) {
+    /* same flavour of .ini file as the param file */
+    FILE *fp = NULL;
+    char  line[STRING_LENGTH];
+    char  section[STRING_LENGTH] = "";
+    char *start, *end, *name, *value;
+    int   line_number = 0;
+
+    sw->method = LHS;
+    sw->nsamples = 0;
+    sw->seed = 1;
+    sw->spin_up = SPIN_NONE;
+    sw->summary_years = 0;
+    strcpy(sw->summary_fname, "*NOT SET*");
+    strcpy(sw->diagnostics, "");
+    sw->nparams = 0;
+
+    if ((fp = fopen(fname, "r")) == NULL) {
+        fprintf(stderr, "Error opening sweep file %s\n", fname);
+        exit(EXIT_FAILURE);
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        start = lskip(rstrip(line));
+        if (*start == '\0' || *start == ';' || *start == '#') {
+            continue;
+        } else if (*start == '[') {
+            end = find_char_or_comment(start + 1, ']');
+            if (*end != ']') {
+                fprintf(stderr, "%s: no ']' on line %d\n", fname,
+                        line_number);
+                exit(EXIT_FAILURE);
+            }
+            *end = '\0';
+            strncpy0(section, start + 1, sizeof(section));
+        } else {
+            end = find_char_or_comment(start, '=');
+            if (*end != '=') {
+                fprintf(stderr, "%s: expected name = value on line %d\n",
+                        fname, line_number);
+                exit(EXIT_FAILURE);
+            }
+            *end = '\0';
+            name = rstrip(start);
+            value = lskip(end + 1);
+            end = find_char_or_comment(value, '\0');
+            if (*end == ';')
+                *end = '\0';
+            rstrip(value);
+
+            sweep_handler(section, name, value, sw);
+        }
+    }
+    fclose(fp);
+
+    if (sw->nsamples < 1) {
+        fprintf(stderr, "The sweep needs samples >= 1\n");
+        exit(EXIT_FAILURE);
+    }
+    if (sw->nparams == 0) {
+        fprintf(stderr, "The sweep file doesn't list any [ranges]\n");
+        exit(EXIT_FAILURE);
+    }
+    if (sw->method == SOBOL && sw->nparams > SOBOL_MAX_DIM) {
+        fprintf(stderr, "Sobol sampling is limited to %d params, use lhs\n",
+                SOBOL_MAX_DIM);
+        exit(EXIT_FAILURE);
+    }
+    if (strcmp(sw->summary_fname, "*NOT SET*") == 0) {
+        fprintf(stderr, "The sweep file needs a summary_fname\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return;
+}
+
+static void sweep_handler(const char *section, const char *name, char *value,
+                          sweep_setup *sw) {
+    sweep_param *sp = NULL;
+    char         dist[STRING_LENGTH];
+
+    #define MATCH(s, n) strcasecmp(section, s) == 0 && strcasecmp(name, n) == 0
+
+    if (MATCH("sweep", "method")) {
+        if (strcasecmp(value, "lhs") == 0)
+            sw->method = LHS;
+        else if (strcasecmp(value, "sobol") == 0)
+            sw->method = SOBOL;
+        else {
+            fprintf(stderr, "Unknown sweep method: %s\n", value);
+            exit(EXIT_FAILURE);
+        }
+    } else if (MATCH("sweep", "samples")) {
+        sw->nsamples = atoi(value);
+    } else if (MATCH("sweep", "seed")) {
+        sw->seed = (uint64_t)strtoull(value, NULL, 10);
+    } else if (MATCH("sweep", "spin_up")) {
+        if (strcasecmp(value, "none") == 0)
+            sw->spin_up = SPIN_NONE;
+        else if (strcasecmp(value, "shared") == 0)
+            sw->spin_up = SPIN_SHARED;
+        else if (strcasecmp(value, "each") == 0)
+            sw->spin_up = SPIN_EACH;
+        else {
+            fprintf(stderr, "Unknown sweep spin_up option: %s\n", value);
+            exit(EXIT_FAILURE);
+        }
+    } else if (MATCH("sweep", "summary_fname")) {
+        strcpy(sw->summary_fname, value);
+    } else if (MATCH("sweep", "summary_years")) {
+        sw->summary_years = atoi(value);
+    } else if (MATCH("sweep", "diagnostics")) {
+        strcpy(sw->diagnostics, value);
+    } else if (strcasecmp(section, "ranges") == 0) {
+        if (sw->nparams == SWEEP_MAX_PARAMS) {
+            fprintf(stderr, "Too many sweep params, max is %d\n",
+                    SWEEP_MAX_PARAMS);
+            exit(EXIT_FAILURE);
+        }
+        sp = &sw->params[sw->nparams];
+        strncpy0(sp->key, (char *)name, sizeof(sp->key));
+        sp->fld = registry_lookup_key(name);
+        if (sp->fld == NULL ||
+            (sp->fld->type != REG_DOUBLE && sp->fld->type != REG_INT)) {
+            fprintf(stderr, "Can't sweep %s, expected a numeric "
+                    "section.key, e.g. params.g1\n", name);
+            exit(EXIT_FAILURE);
+        }
+        if (sscanf(value, "%s %lf %lf", dist, &sp->a, &sp->b) != 3) {
+            fprintf(stderr, "Expected distribution and two numbers for %s, "
+                    "got: %s\n", name, value);
+            exit(EXIT_FAILURE);
+        }
+        if (strcasecmp(dist, "uniform") == 0) {
+            sp->dist = UNIFORM;
+        } else if (strcasecmp(dist, "loguniform") == 0) {
+            sp->dist = LOGUNIFORM;
+            if (sp->a <= 0.0 || sp->b <= 0.0) {
+                fprintf(stderr, "loguniform range for %s must be > 0\n",
+                        name);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcasecmp(dist, "normal") == 0) {
+            sp->dist = NORMAL;
+        } else {
+            fprintf(stderr, "Unknown distribution for %s: %s\n", name, dist);
+            exit(EXIT_FAILURE);
+        }
+        sw->nparams++;
+    } else {
+        fprintf(stderr, "Unknown sweep option [%s] %s\n", section, name);
+        exit(EXIT_FAILURE);
+    }
+
+    return;
+}
+
+static void latin_hypercube(int n, int d, uint64_t *rng, double **u) {
+    /* one point per 1/n stratum of each param, strata paired at random */
+    int *perm = NULL;
+    int  i, j, k, tmp;
+
+    if ((perm = malloc(n * sizeof(int))) == NULL) {
+        fprintf(stderr, "malloc failed allocating LHS permutation\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (j = 0; j < d; j++) {
+        for (i = 0; i < n; i++)
+            perm[i] = i;
+        for (i = n - 1; i > 0; i--) {
+            k = (int)(rng_uniform(rng) * (i + 1));
+            tmp = perm[i];
+            perm[i] = perm[k];
+            perm[k] = tmp;
+        }
+        for (i = 0; i < n; i++)
+            u[i][j] = (perm[i] + rng_uniform(rng)) / (double)n;
+    }
+    free(perm);
+
+    return;
+}
+
+static void sobol_points(int n, int d, uint64_t *rng, double **u) {
+    /*
+        Points 1..n of the Sobol sequence (the all-zero first point is
+        skipped), XOR'd with a random shift per dimension
+    */
+    uint32_t v[32], x, shift, gray;
+    int      i, j, k, l, s, a;
+
+    for (j = 0; j < d; j++) {
+        if (j == 0) {
+            for (k = 0; k < 32; k++)
+                v[k] = 1u << (31 - k);
+        } else {
+            s = sobol_dirs[j - 1].s;
+            a = sobol_dirs[j - 1].a;
+            for (k = 0; k < s; k++)
+                v[k] = (uint32_t)sobol_dirs[j - 1].m[k] << (31 - k);
+            for (k = s; k < 32; k++) {
+                v[k] = v[k - s] ^ (v[k - s] >> s);
+                for (l = 1; l < s; l++) {
+                    if ((a >> (s - 1 - l)) & 1)
+                        v[k] ^= v[k - l];
+                }
+            }
+        }
+
+        shift = (uint32_t)(splitmix64(rng) >> 32);
+        for (i = 0; i < n; i++) {
+            gray = (uint32_t)(i + 1) ^ ((uint32_t)(i + 1) >> 1);
+            x = 0;
+            for (k = 0; gray != 0; k++, gray >>= 1) {
+                if (gray & 1)
+                    x ^= v[k];
+            }
+            u[i][j] = ((double)(x ^ shift) + 0.5) / 4294967296.0;
+        }
+    }
+
+    return;
+}
+
+static double sample_value(sweep_param *sp, double u) {
+    /* map u ~ U(0,1) on to the param's distribution */
+
+    if (sp->dist == LOGUNIFORM)
+        return (exp(log(sp->a) + u * (log(sp->b) - log(sp->a))));
+    else if (sp->dist == NORMAL)
+        return (sp->a + sp->b * inverse_normal(u));
+
+    return (sp->a + u * (sp->b - sp->a));
+}
+
+static double inverse_normal(double p) {
+    /*
+        Standard normal quantile, relative error < 1.2e-9
+
+        Reference:
+        ----------
+        * Acklam, P. J. (2003) An algorithm for computing the inverse normal
+          cumulative distribution function.
+    */
+    const double a[6] = {-3.969683028665376e+01, 2.209460984245205e+02,
+                         -2.759285104469687e+02, 1.383577518672690e+02,
+                         -3.066479806614716e+01, 2.506628277459239e+00};
+    const double b[5] = {-5.447609879822406e+01, 1.615858368580409e+02,
+                         -1.556989798598866e+02, 6.680131188771972e+01,
+                         -1.328068155288572e+01};
+    const double c[6] = {-7.784894002430293e-03, -3.223964580411365e-01,
+                         -2.400758277161838e+00, -2.549732539343734e+00,
+                         4.374664141464968e+00, 2.938163982698783e+00};
+    const double d[4] = {7.784695709041462e-03, 3.224671290700398e-01,
+                         2.445134137142996e+00, 3.754408661907416e+00};
+    const double p_low = 0.02425;
+    double       q, r;
+
+    if (p < p_low) {
+        q = sqrt(-2.0 * log(p));
+        return ((((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) *
+                 q + c[5]) /
+                ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0));
+    } else if (p > 1.0 - p_low) {
+        q = sqrt(-2.0 * log(1.0 - p));
+        return (-(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) *
+                  q + c[5]) /
+                ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0));
+    }
+
+    q = p - 0.5;
+    r = q * q;
+    return ((((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r +
+             a[5]) * q /
+            (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r +
+             1.0));
+}
+
+static uint64_t splitmix64(uint64_t *x) {
+    /* small, seedable and the same on every platform, unlike rand() */
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+    return (z ^ (z >> 31));
+}
+
+static double rng_uniform(uint64_t *x) {
+    /* [0, 1) with 53 random bits */
+    return ((double)(splitmix64(x) >> 11) * (1.0 / 9007199254740992.0));
+}
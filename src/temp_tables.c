@@ -0,0 +1,127 @@
+/* ============================================================================
+* Leaf temperature response tables (control.temp_tables)
+*
+* The sub-daily canopy re-evaluates the same exp-heavy functions of one
+* temperature on every leaf temperature iteration: Gamma*, Km, the Vcmax and
+* Jmax (peaked) Arrhenius terms, the saturation vapour pressure and its
+* slope. For a given parameter set these are fixed curves, so with
+* control.temp_tables = true they are tabulated once (with the derived
+* params, i.e. again whenever a param changes) every control.temp_table_step
+* deg C between TEMP_TABLE_TMIN and TEMP_TABLE_TMAX, and interpolated
+* linearly. Outside that range, or with the tables off, the functions are
+* evaluated exactly.
+*
+* The interpolation error scales with step^2. The largest relative error of
+* each table is worked out at its interval midpoints when it is built, and
+* gday --check prints it. With typical parameters, at the default 0.1 deg C
+* step:
+*
+*   Gamma*, Km              < 2E-05
+*   Vcmax                   < 2E-05
+*   Jmax                    < 4E-05 (around the high temperature peak)
+*   sat. vapour pressure    < 2E-05
+*   slope                   < 2E-05
+*
+* i.e. well below the precision of the parameters. A 0.5 deg C step is 25
+* times worse, 0.05 deg C 4 times better.
+*
+* =========================================================================== */
+#include "temp_tables.h"
+
+
+void build_temp_tables(control *c, params *p, temp_tables *tt) {
+    /* tabulate the responses for this parameter set */
+    int    i, k;
+    double T, interp, exact, err;
+
+    tt->on = FALSE;
+    if (c->temp_tables == FALSE)
+        return;
+
+    tt->step = MAX(c->temp_table_step, TEMP_TABLE_MIN_STEP);
+    tt->n = (int)((TEMP_TABLE_TMAX - TEMP_TABLE_TMIN) / tt->step + 1E-09) + 1;
+    tt->n = MIN(tt->n, TEMP_TABLE_MAX_POINTS);
+
+    for (k = 0; k < TEMP_TABLE_NUM; k++) {
+        for (i = 0; i < tt->n; i++) {
+            T = TEMP_TABLE_TMIN + i * tt->step;
+            tt->v[k][i] = exact_temp_response(p, k, T);
+        }
+
+        /* the interpolation error is largest mid-way between the points */
+        tt->max_err[k] = 0.0;
+        for (i = 0; i < tt->n - 1; i++) {
+            T = TEMP_TABLE_TMIN + (i + 0.5) * tt->step;
+            interp = 0.5 * (tt->v[k][i] + tt->v[k][i+1]);
+            exact = exact_temp_response(p, k, T);
+            if (exact != 0.0) {
+                err = fabs(interp - exact) / fabs(exact);
+                tt->max_err[k] = MAX(tt->max_err[k], err);
+            }
+        }
+    }
+    tt->on = TRUE;
+
+    return;
+}
+
+double temp_response(params *p, int which, double T) {
+    /*
+        The response at temperature T (deg C), from the table when there is
+        one covering T
+    */
+    temp_tables *tt = &p->derived.tt;
+    double       x, w;
+    int          i;
+
+    if (tt->on) {
+        x = (T - TEMP_TABLE_TMIN) / tt->step;
+        if (x >= 0.0 && x < tt->n - 1) {
+            i = (int)x;
+            w = x - i;
+            return (tt->v[which][i] + w * (tt->v[which][i+1] -
+                                           tt->v[which][i]));
+        }
+    }
+
+    return (exact_temp_response(p, which, T));
+}
+
+double exact_temp_response(params *p, int which, double T) {
+
+    double tref = p->measurement_temp;
+
+    switch (which) {
+    case TT_GAMMA_STAR:
+        return (calc_co2_compensation_point(p, T));
+    case TT_KM:
+        return (calculate_michaelis_menten(p, T));
+    case TT_VCMAX:
+        return (arrhenius(1.0, p->eav, T, tref));
+    case TT_JMAX:
+        return (peaked_arrhenius(1.0, p->eaj, T, tref, p->delsj, p->edj));
+    case TT_SAT_VP:
+        return (calc_sat_water_vapour_press(T));
+    case TT_SLOPE:
+        return (calc_slope_of_sat_vapour_pressure_curve(T));
+    default:
+        fprintf(stderr, "Unknown temperature response %d\n", which);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void print_temp_table_errors(FILE *fp, temp_tables *tt) {
+    /* the largest relative interpolation error of each table */
+    const char *names[TEMP_TABLE_NUM] = {
+        "gamma_star", "km", "vcmax", "jmax", "sat_vp", "slope"
+    };
+    int k;
+
+    fprintf(fp, "temperature tables, %d points every %g deg C, max error:",
+            tt->n, tt->step);
+    for (k = 0; k < TEMP_TABLE_NUM; k++)
+        fprintf(fp, " %s %.1e", names[k], tt->max_err[k]);
+    fprintf(fp, "\n");
+
+    return;
+}
@@ -5,64 +5,6 @@
 #include "rkck.h"
 #include "rkqs.h"
 
-void initialise_soils_day(control *c, fluxes *f, params *p, state *s) {
-    /* Initialise soil water state & parameters  */
-
-    double *fsoil_top = NULL, *fsoil_root = NULL;
-    int     i;
-
-    /* site params not known, so derive them based on Cosby et al */
-
-    if (c->calc_sw_params) {
-        fsoil_top = get_soil_fracs(p->topsoil_type);
-        fsoil_root = get_soil_fracs(p->rootsoil_type);
-
-        /* top soil */
-        calc_soil_params(fsoil_top, &p->theta_fc_topsoil, &p->theta_wp_topsoil,
-                         &p->theta_sp_topsoil, &p->b_topsoil,
-                         &p->psi_sat_topsoil);
-
-        /* Plant available water in top soil (mm) */
-        p->wcapac_topsoil = p->topsoil_depth  *\
-                            (p->theta_fc_topsoil - p->theta_wp_topsoil);
-        /* Root zone */
-        calc_soil_params(fsoil_root, &p->theta_fc_root, &p->theta_wp_root,
-                         &p->theta_sp_root, &p->b_root, &p->psi_sat_root);
-
-        /* Plant available water in rooting zone (mm) */
-        p->wcapac_root = p->rooting_depth * \
-                            (p->theta_fc_root - p->theta_wp_root);
-    }
-
-
-    /* calculate Landsberg and Waring SW modifier parameters if not
-       specified by the user based on a site calibration */
-    if (p->ctheta_topsoil < -900.0 && p->ntheta_topsoil  < -900.0 &&
-        p->ctheta_root < -900.0 && p->ntheta_root < -900.0) {
-        get_soil_params(p->topsoil_type, &p->ctheta_topsoil, &p->ntheta_topsoil);
-        get_soil_params(p->rootsoil_type, &p->ctheta_root, &p->ntheta_root);
-    }
-    /*
-    printf("%f\n", p->wcapac_topsoil);
-    printf("%f\n\n", p->wcapac_root);
-
-    printf("%f\n", p->ctheta_topsoil);
-    printf("%f\n", p->ntheta_topsoil);
-    printf("%f\n", p->ctheta_root);
-    printf("%f\n", p->ntheta_root);
-    printf("%f\n", p->rooting_depth);
-
-    exit(1); */
-
-
-
-    free(fsoil_top);
-    free(fsoil_root);
-
-    return;
-}
-
-
 void calculate_water_balance(control *c, fluxes *f, met *m, params *p,
                              state *s, int daylen, double trans_leaf,
                              double omega_leaf, double rnet_leaf) {
@@ -744,7 +686,7 @@ void penman_leaf_wrapper(met *m, params *p, state *s, double tleaf, double rnet,
 
     lambda = calc_latent_heat_of_vapourisation(m->tair);
     gamma = calc_pyschrometric_constant(m->press, lambda);
-    slope = calc_slope_of_sat_vapour_pressure_curve(m->tair);
+    slope = temp_response(p, TT_SLOPE, m->tair);
 
     penman_monteith(m->press, m->vpd, rnet, slope, lambda, gamma, gh, gv,
                     transpiration, LE);
@@ -801,6 +743,7 @@ void penman_monteith(double press, double vpd, double rnet, double slope,
         *LE = arg1 / arg2; /* W m-2 */
         *transpiration = *LE / lambda; /* mol H20 m-2 s-1 */
     } else {
+        *LE = 0.0;
         *transpiration = 0.0;
     }
 
@@ -1066,12 +1009,11 @@ double calc_sat_water_vapour_press(double tac) {
 
 
 
-double *get_soil_fracs(char *soil_type) {
+void get_soil_fracs(char *soil_type, double *fsoil) {
     /*
      * Based on Table 2 in Cosby et al 1984, page 2.
      * Fractions of silt, sand and clay (in that order)
      */
-    double *fsoil = malloc(3 * sizeof(double));
 
     if (strcmp(soil_type, "sand") == 0) {
         fsoil[0] = 0.05;
@@ -1121,7 +1063,7 @@ double *get_soil_fracs(char *soil_type) {
         prog_error("Could not understand soil type", __LINE__);
     }
 
-    return (fsoil);
+    return;
 }
 
 void get_soil_params(char *soil_type, double *c_theta, double *n_theta) {
@@ -10,47 +10,15 @@ void initialise_soils_sub_daily(control *c, fluxes *f, params *p, state *s) {
         multi-layer model, once it all works we can add something to allow
         texture to be changes by layer/depth.
 
-        NB. get_soil_fracs, calc_soil_params, get_soil_params live in
-            water_balance.c
+        NB. the soil params themselves are worked out once per parameter
+            set, see derived_params.c
     */
 
-    double *fsoil_top = NULL, *fsoil_root = NULL;
-    int     i;
-
-    /* site params not known, so derive them based on Cosby et al */
-    if (c->calc_sw_params) {
-        fsoil_top = get_soil_fracs(p->topsoil_type);
-        fsoil_root = get_soil_fracs(p->rootsoil_type);
-
-        /* top soil */
-        calc_soil_params(fsoil_top, &p->theta_fc_topsoil, &p->theta_wp_topsoil,
-                         &p->theta_sp_topsoil, &p->b_topsoil,
-                         &p->psi_sat_topsoil);
-
-        /* Plant available water in top soil (mm) */
-        p->wcapac_topsoil = p->topsoil_depth  *\
-                            (p->theta_fc_topsoil - p->theta_wp_topsoil);
-        /* Root zone */
-        calc_soil_params(fsoil_root, &p->theta_fc_root, &p->theta_wp_root,
-                         &p->theta_sp_root, &p->b_root, &p->psi_sat_root);
-
-        /* Plant available water in rooting zone (mm) */
-        p->wcapac_root = p->rooting_depth * \
-                            (p->theta_fc_root - p->theta_wp_root);
-    }
-
-
-    /* calculate Landsberg and Waring SW modifier parameters if not
-       specified by the user based on a site calibration */
-    if (p->ctheta_topsoil < -900.0 && p->ntheta_topsoil  < -900.0 &&
-        p->ctheta_root < -900.0 && p->ntheta_root < -900.0) {
-        get_soil_params(p->topsoil_type, &p->ctheta_topsoil, &p->ntheta_topsoil);
-        get_soil_params(p->rootsoil_type, &p->ctheta_root, &p->ntheta_root);
-    }
+    int i;
 
     /* Set up all the hydraulics stuff */
     if (c->water_balance == HYDRAULICS) {
-        calc_saxton_stuff(p, fsoil_root);
+        calc_saxton_stuff(p, p->derived.fsoil_root);
 
         for (i = 0; i < p->wetting; i++) {
             s->wetting_bot[i] = 0.0;
@@ -85,11 +53,6 @@ void initialise_soils_sub_daily(control *c, fluxes *f, params *p, state *s) {
         calc_water_uptake_per_layer(f, p, s);
     }
 
-    if (c->calc_sw_params) {
-        free(fsoil_top);
-        free(fsoil_root);
-    }
-
     return;
 }
 
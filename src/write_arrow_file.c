@@ -0,0 +1,573 @@
+/* ============================================================================
+* Write model output as an Apache Arrow IPC file (a.k.a. Feather v2)
+*
+* Every column is a non-nullable float64. Rows are buffered and written out
+* as a record batch every batch_rows rows, so the memory footprint is fixed
+* irrespective of the length of the run. The file can be read directly with
+* pyarrow.feather.read_table / pandas.read_feather or arrow::read_feather in
+* R.
+*
+* NOTES:
+*   The Arrow metadata are flatbuffers. Rather than pulling in the flatbuffers
+*   and Arrow libraries we write the handful of tables we need (Message,
+*   Schema, Field, RecordBatch, Footer) by hand with a tiny front-to-back
+*   builder: objects are laid out parent first so every uoffset points
+*   forward and is patched once the child has been placed.
+*
+*   Buffers can optionally be LZ4 (frame) or ZSTD compressed, which needs the
+*   model to be built with -DHAVE_LZ4 and/or -DHAVE_ZSTD.
+*
+*   Format reference: https://arrow.apache.org/docs/format/Columnar.html
+*
+* =========================================================================== */
+#include "write_arrow_file.h"
+
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define ARROW_MAGIC "ARROW1"
+#define ARROW_METADATA_V5 4
+#define ARROW_HEADER_SCHEMA 1
+#define ARROW_HEADER_RECORD_BATCH 3
+#define ARROW_TYPE_FLOATING_POINT 3
+#define ARROW_PRECISION_DOUBLE 2
+#define ARROW_CONTINUATION 0xFFFFFFFF
+
+typedef struct {
+    unsigned char *buf;
+    size_t         len;
+    size_t         cap;
+} fbuilder;
+
+static void    fb_init(fbuilder *);
+static size_t  fb_alloc(fbuilder *, size_t);
+static void    fb_pad(fbuilder *, size_t);
+static void    fb_put(fbuilder *, size_t, const void *, size_t);
+static void    fb_uoffset(fbuilder *, size_t, size_t);
+static size_t  fb_table(fbuilder *, int, const int *, size_t *);
+static size_t  fb_vector(fbuilder *, uint32_t, size_t, size_t);
+static size_t  fb_string(fbuilder *, const char *);
+static size_t  fb_schema(fbuilder *, arrow_writer *);
+static size_t  fb_message(fbuilder *, uint8_t, size_t *, size_t *);
+static void    write_bytes(arrow_writer *, const void *, size_t);
+static int32_t write_message(arrow_writer *, fbuilder *);
+static void    write_record_batch(arrow_writer *);
+static void    add_buffer(fbuilder *, size_t, int64_t, int64_t);
+static size_t  compress_buffer(int, const double *, size_t, unsigned char *,
+                               size_t);
+
+
+arrow_writer *arrow_open(FILE *fp, const char **names, int ncols,
+                         int batch_rows, int codec, const char *git_ver) {
+    /*
+        Start a new Arrow file on an already opened stream: magic bytes
+        followed by the schema message
+    */
+    arrow_writer *aw = NULL;
+    fbuilder      fb;
+    size_t        header_pos, body_len_pos;
+    int           i;
+    const char    magic[8] = ARROW_MAGIC;
+
+    if (arrow_codec_available(codec) == 0) {
+        fprintf(stderr, "Arrow compression codec not compiled in, rebuild "
+                        "with -DHAVE_LZ4/-DHAVE_ZSTD\n");
+        exit(EXIT_FAILURE);
+    }
+    if (batch_rows < 1) {
+        fprintf(stderr, "Arrow batch size must be at least one row\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((aw = malloc(sizeof(arrow_writer))) == NULL) {
+        fprintf(stderr, "malloc failed allocating arrow writer\n");
+        exit(EXIT_FAILURE);
+    }
+    aw->fp = fp;
+    aw->offset = 0;
+    aw->ncols = ncols;
+    aw->batch_rows = batch_rows;
+    aw->nrows = 0;
+    aw->codec = codec;
+    aw->nblocks = 0;
+    aw->max_blocks = 64;
+    aw->git_ver = strdup(git_ver);
+    aw->names = malloc(ncols * sizeof(char *));
+    aw->cols = malloc(ncols * sizeof(double *));
+    aw->blocks = malloc(aw->max_blocks * sizeof(arrow_block));
+    if (aw->git_ver == NULL || aw->names == NULL || aw->cols == NULL ||
+        aw->blocks == NULL) {
+        fprintf(stderr, "malloc failed allocating arrow writer\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < ncols; i++) {
+        aw->names[i] = strdup(names[i]);
+        aw->cols[i] = malloc(batch_rows * sizeof(double));
+        if (aw->names[i] == NULL || aw->cols[i] == NULL) {
+            fprintf(stderr, "malloc failed allocating arrow columns\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* magic, padded to 8 bytes */
+    write_bytes(aw, magic, sizeof(magic));
+
+    fb_init(&fb);
+    fb_message(&fb, ARROW_HEADER_SCHEMA, &header_pos, &body_len_pos);
+    fb_uoffset(&fb, header_pos, fb_schema(&fb, aw));
+    write_message(aw, &fb);
+    free(fb.buf);
+
+    return (aw);
+}
+
+void arrow_write_row(arrow_writer *aw, const double *row) {
+    /* buffer a row, writing the record batch out once it is full */
+    int i;
+
+    for (i = 0; i < aw->ncols; i++)
+        aw->cols[i][aw->nrows] = row[i];
+    aw->nrows++;
+
+    if (aw->nrows == aw->batch_rows)
+        write_record_batch(aw);
+
+    return;
+}
+
+void arrow_close(arrow_writer *aw) {
+    /*
+        Flush the last (partial) batch, then write the end-of-stream marker
+        and the file footer, which repeats the schema and indexes the record
+        batches. The stream itself is left open for the caller to close.
+    */
+    fbuilder fb;
+    size_t   pos[5], schema_pos, dict_pos, batch_pos, p;
+    int      sizes[5] = {2, 4, 4, 4, 0};
+    int      i;
+    int16_t  version = ARROW_METADATA_V5;
+    uint32_t eos[2] = {ARROW_CONTINUATION, 0};
+    int32_t  footer_len;
+    const char magic[6] = ARROW_MAGIC;
+
+    if (aw->nrows > 0)
+        write_record_batch(aw);
+    write_bytes(aw, eos, sizeof(eos));
+
+    fb_init(&fb);
+    fb_alloc(&fb, 4);
+    fb_uoffset(&fb, 0, fb_table(&fb, 5, sizes, pos));
+    fb_put(&fb, pos[0], &version, 2);
+
+    schema_pos = fb_schema(&fb, aw);
+    fb_uoffset(&fb, pos[1], schema_pos);
+
+    dict_pos = fb_vector(&fb, 0, 24, 8);
+    fb_uoffset(&fb, pos[2], dict_pos);
+
+    batch_pos = fb_vector(&fb, aw->nblocks, 24, 8);
+    fb_uoffset(&fb, pos[3], batch_pos);
+    for (i = 0; i < aw->nblocks; i++) {
+        p = batch_pos + 4 + i * 24;
+        fb_put(&fb, p, &aw->blocks[i].offset, 8);
+        fb_put(&fb, p + 8, &aw->blocks[i].meta_len, 4);
+        fb_put(&fb, p + 16, &aw->blocks[i].body_len, 8);
+    }
+    fb_pad(&fb, 8);
+
+    write_bytes(aw, fb.buf, fb.len);
+    footer_len = (int32_t)fb.len;
+    write_bytes(aw, &footer_len, sizeof(footer_len));
+    write_bytes(aw, magic, sizeof(magic));
+    free(fb.buf);
+
+    for (i = 0; i < aw->ncols; i++) {
+        free(aw->names[i]);
+        free(aw->cols[i]);
+    }
+    free(aw->names);
+    free(aw->cols);
+    free(aw->blocks);
+    free(aw->git_ver);
+    free(aw);
+
+    return;
+}
+
+int arrow_codec_available(int codec) {
+    /* Was the model built with support for this compression codec? */
+    if (codec == ARROW_UNCOMPRESSED)
+        return (1);
+#ifdef HAVE_LZ4
+    if (codec == ARROW_LZ4)
+        return (1);
+#endif
+#ifdef HAVE_ZSTD
+    if (codec == ARROW_ZSTD)
+        return (1);
+#endif
+    return (0);
+}
+
+static void write_record_batch(arrow_writer *aw) {
+    /*
+        Write the buffered rows as a record batch. Each column contributes a
+        (empty) validity buffer and a data buffer; with compression each data
+        buffer is prefixed by its uncompressed length, or -1 if compressing
+        didn't help and the values are stored as is.
+    */
+    fbuilder       fb;
+    size_t         pos[5], nodes_pos, buffers_pos, comp_pos, cpos[2], p;
+    size_t         header_pos, body_len_pos;
+    size_t         raw_len = aw->nrows * sizeof(double);
+    size_t         max_len, body_len = 0, len;
+    int            sizes[5] = {8, 4, 4, 0, 0};
+    int            csizes[2] = {1, 1};
+    int            i;
+    int64_t        nrows = aw->nrows, zero = 0, header_len, blen;
+    int8_t         codec = (int8_t)aw->codec;
+    unsigned char *body = NULL, *tmp = NULL;
+    arrow_block    block;
+
+    /* generous upper bound on the body size */
+    max_len = raw_len + 64;
+#ifdef HAVE_LZ4
+    if (aw->codec == ARROW_LZ4)
+        max_len = LZ4F_compressFrameBound(raw_len, NULL) + 64;
+#endif
+#ifdef HAVE_ZSTD
+    if (aw->codec == ARROW_ZSTD)
+        max_len = ZSTD_compressBound(raw_len) + 64;
+#endif
+    body = malloc(aw->ncols * max_len);
+    tmp = malloc(max_len);
+    if (body == NULL || tmp == NULL) {
+        fprintf(stderr, "malloc failed allocating arrow record batch\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (aw->codec != ARROW_UNCOMPRESSED)
+        sizes[3] = 4;
+
+    fb_init(&fb);
+    fb_message(&fb, ARROW_HEADER_RECORD_BATCH, &header_pos, &body_len_pos);
+    fb_uoffset(&fb, header_pos, fb_table(&fb, 5, sizes, pos));
+    fb_put(&fb, pos[0], &nrows, 8);
+
+    /* one field node per column, nothing is ever null */
+    nodes_pos = fb_vector(&fb, aw->ncols, 16, 8);
+    fb_uoffset(&fb, pos[1], nodes_pos);
+    for (i = 0; i < aw->ncols; i++) {
+        p = nodes_pos + 4 + i * 16;
+        fb_put(&fb, p, &nrows, 8);
+        fb_put(&fb, p + 8, &zero, 8);
+    }
+
+    buffers_pos = fb_vector(&fb, 2 * aw->ncols, 16, 8);
+    fb_uoffset(&fb, pos[2], buffers_pos);
+    for (i = 0; i < aw->ncols; i++) {
+        /* validity bitmap, omitted */
+        add_buffer(&fb, buffers_pos + 4 + 2 * i * 16, (int64_t)body_len, 0);
+
+        /* values */
+        if (aw->codec == ARROW_UNCOMPRESSED) {
+            memcpy(body + body_len, aw->cols[i], raw_len);
+            len = raw_len;
+        } else {
+            len = compress_buffer(aw->codec, aw->cols[i], raw_len, tmp,
+                                  max_len);
+            if (len > 0 && len < raw_len) {
+                header_len = (int64_t)raw_len;
+                memcpy(body + body_len + 8, tmp, len);
+            } else {
+                header_len = -1;
+                len = raw_len;
+                memcpy(body + body_len + 8, aw->cols[i], raw_len);
+            }
+            memcpy(body + body_len, &header_len, 8);
+            len += 8;
+        }
+        add_buffer(&fb, buffers_pos + 4 + (2 * i + 1) * 16, (int64_t)body_len,
+                   (int64_t)len);
+
+        /* keep each buffer 8-byte aligned */
+        body_len += len;
+        while (body_len % 8 != 0)
+            body[body_len++] = 0;
+    }
+
+    if (aw->codec != ARROW_UNCOMPRESSED) {
+        comp_pos = fb_table(&fb, 2, csizes, cpos);
+        fb_uoffset(&fb, pos[3], comp_pos);
+        fb_put(&fb, cpos[0], &codec, 1);
+    }
+
+    /* now the body length is known, patch it into the message */
+    blen = (int64_t)body_len;
+    fb_put(&fb, body_len_pos, &blen, 8);
+
+    block.offset = aw->offset;
+    block.meta_len = write_message(aw, &fb);
+    block.body_len = (int64_t)body_len;
+    write_bytes(aw, body, body_len);
+
+    if (aw->nblocks == aw->max_blocks) {
+        aw->max_blocks *= 2;
+        aw->blocks = realloc(aw->blocks, aw->max_blocks * sizeof(arrow_block));
+        if (aw->blocks == NULL) {
+            fprintf(stderr, "realloc failed growing arrow block index\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    aw->blocks[aw->nblocks++] = block;
+    aw->nrows = 0;
+
+    free(fb.buf);
+    free(body);
+    free(tmp);
+
+    return;
+}
+
+static size_t compress_buffer(int codec, const double *src, size_t src_len,
+                              unsigned char *dst, size_t dst_len) {
+    /* returns the compressed size, or zero on failure */
+    size_t len = 0;
+
+#ifdef HAVE_LZ4
+    if (codec == ARROW_LZ4) {
+        len = LZ4F_compressFrame(dst, dst_len, src, src_len, NULL);
+        if (LZ4F_isError(len))
+            len = 0;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if (codec == ARROW_ZSTD) {
+        len = ZSTD_compress(dst, dst_len, src, src_len, ZSTD_CLEVEL_DEFAULT);
+        if (ZSTD_isError(len))
+            len = 0;
+    }
+#endif
+    (void)codec;
+    (void)src;
+    (void)src_len;
+    (void)dst;
+    (void)dst_len;
+
+    return (len);
+}
+
+static void add_buffer(fbuilder *fb, size_t at, int64_t offset,
+                       int64_t length) {
+    fb_put(fb, at, &offset, 8);
+    fb_put(fb, at + 8, &length, 8);
+}
+
+static size_t fb_message(fbuilder *fb, uint8_t header_type,
+                         size_t *header_pos, size_t *body_len_pos) {
+    /*
+        Root Message table: version, header_type, header, bodyLength. The
+        header offset and body length are left for the caller to fill in.
+    */
+    size_t  pos[4], msg;
+    int     sizes[4] = {2, 1, 4, 8};
+    int16_t version = ARROW_METADATA_V5;
+
+    fb_alloc(fb, 4);
+    msg = fb_table(fb, 4, sizes, pos);
+    fb_uoffset(fb, 0, msg);
+    fb_put(fb, pos[0], &version, 2);
+    fb_put(fb, pos[1], &header_type, 1);
+    *header_pos = pos[2];
+    *body_len_pos = pos[3];
+
+    return (msg);
+}
+
+static size_t fb_schema(fbuilder *fb, arrow_writer *aw) {
+    /*
+        Schema table: little endian, one float64 field per column and the git
+        revision of the model as custom metadata
+    */
+    size_t  schema, pos[3], fields, fpos[6], field, ftype, tpos[1];
+    size_t  meta, kv, kvpos[2];
+    int     sizes[3] = {2, 4, 4};
+    int     field_sizes[6] = {4, 1, 1, 4, 0, 4};
+    int     type_sizes[1] = {2};
+    int     kv_sizes[2] = {4, 4};
+    int     i;
+    int16_t endianness = 0, precision = ARROW_PRECISION_DOUBLE;
+    uint8_t type_type = ARROW_TYPE_FLOATING_POINT;
+
+    schema = fb_table(fb, 3, sizes, pos);
+    fb_put(fb, pos[0], &endianness, 2);
+
+    fields = fb_vector(fb, aw->ncols, 4, 4);
+    fb_uoffset(fb, pos[1], fields);
+    for (i = 0; i < aw->ncols; i++) {
+        field = fb_table(fb, 6, field_sizes, fpos);
+        fb_uoffset(fb, fields + 4 + i * 4, field);
+        fb_put(fb, fpos[2], &type_type, 1);
+        fb_uoffset(fb, fpos[0], fb_string(fb, aw->names[i]));
+        ftype = fb_table(fb, 1, type_sizes, tpos);
+        fb_put(fb, tpos[0], &precision, 2);
+        fb_uoffset(fb, fpos[3], ftype);
+        fb_uoffset(fb, fpos[5], fb_vector(fb, 0, 4, 4));
+    }
+
+    meta = fb_vector(fb, 1, 4, 4);
+    fb_uoffset(fb, pos[2], meta);
+    kv = fb_table(fb, 2, kv_sizes, kvpos);
+    fb_uoffset(fb, meta + 4, kv);
+    fb_uoffset(fb, kvpos[0], fb_string(fb, "gday_git_revision"));
+    fb_uoffset(fb, kvpos[1], fb_string(fb, aw->git_ver));
+
+    return (schema);
+}
+
+static void write_bytes(arrow_writer *aw, const void *data, size_t len) {
+    if (len > 0 && fwrite(data, 1, len, aw->fp) != len) {
+        fprintf(stderr, "Error writing arrow output file\n");
+        exit(EXIT_FAILURE);
+    }
+    aw->offset += (int64_t)len;
+}
+
+static int32_t write_message(arrow_writer *aw, fbuilder *fb) {
+    /*
+        Encapsulated message: continuation marker, metadata length and the
+        flatbuffer padded so the body that follows starts 8-byte aligned.
+        Returns the total metadata size including the prefix.
+    */
+    uint32_t marker = ARROW_CONTINUATION;
+    int32_t  len;
+
+    fb_pad(fb, 8);
+    len = (int32_t)fb->len;
+    write_bytes(aw, &marker, 4);
+    write_bytes(aw, &len, 4);
+    write_bytes(aw, fb->buf, fb->len);
+
+    return (len + 8);
+}
+
+/*
+** Minimal flatbuffer builder
+*/
+static void fb_init(fbuilder *fb) {
+    fb->len = 0;
+    fb->cap = 1024;
+    if ((fb->buf = calloc(fb->cap, 1)) == NULL) {
+        fprintf(stderr, "malloc failed allocating flatbuffer\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static size_t fb_alloc(fbuilder *fb, size_t n) {
+    /* reserve n zeroed bytes at the end of the buffer, return their offset */
+    size_t pos = fb->len;
+
+    while (fb->len + n > fb->cap) {
+        fb->buf = realloc(fb->buf, fb->cap * 2);
+        if (fb->buf == NULL) {
+            fprintf(stderr, "realloc failed growing flatbuffer\n");
+            exit(EXIT_FAILURE);
+        }
+        memset(fb->buf + fb->cap, 0, fb->cap);
+        fb->cap *= 2;
+    }
+    fb->len += n;
+
+    return (pos);
+}
+
+static void fb_pad(fbuilder *fb, size_t align) {
+    while (fb->len % align != 0)
+        fb_alloc(fb, 1);
+}
+
+static void fb_put(fbuilder *fb, size_t pos, const void *data, size_t n) {
+    memcpy(fb->buf + pos, data, n);
+}
+
+static void fb_uoffset(fbuilder *fb, size_t at, size_t target) {
+    /* uoffsets are relative to where they are stored and point forwards */
+    uint32_t off = (uint32_t)(target - at);
+    fb_put(fb, at, &off, 4);
+}
+
+static size_t fb_table(fbuilder *fb, int nfields, const int *sizes,
+                       size_t *pos) {
+    /*
+        Lay out a vtable immediately followed by its table. Field i takes
+        sizes[i] bytes (0 = not present) and its absolute offset is returned
+        in pos[i]. The table starts 8-byte aligned so scalars are naturally
+        aligned.
+    */
+    size_t   vt, table;
+    uint16_t vlen = (uint16_t)(4 + 2 * nfields), tlen = 4, off;
+    int32_t  soff;
+    int      i;
+
+    fb_pad(fb, 2);
+    vt = fb_alloc(fb, vlen);
+    for (i = 0; i < nfields; i++) {
+        if (sizes[i] == 0) {
+            pos[i] = 0;
+            continue;
+        }
+        while (tlen % sizes[i] != 0)
+            tlen++;
+        off = tlen;
+        fb_put(fb, vt + 4 + 2 * i, &off, 2);
+        pos[i] = off;
+        tlen += sizes[i];
+    }
+    fb_put(fb, vt, &vlen, 2);
+    fb_put(fb, vt + 2, &tlen, 2);
+
+    fb_pad(fb, 8);
+    table = fb_alloc(fb, tlen);
+    soff = (int32_t)(table - vt);
+    fb_put(fb, table, &soff, 4);
+    for (i = 0; i < nfields; i++) {
+        if (sizes[i] != 0)
+            pos[i] += table;
+    }
+
+    return (table);
+}
+
+static size_t fb_vector(fbuilder *fb, uint32_t n, size_t elem_size,
+                        size_t align) {
+    /*
+        Vector of n elements; the length prefix sits just before the first
+        element, which is aligned to align bytes. Returns the offset of the
+        length prefix.
+    */
+    size_t vec;
+
+    fb_pad(fb, 4);
+    while ((fb->len + 4) % align != 0)
+        fb_alloc(fb, 4);
+    vec = fb_alloc(fb, 4 + n * elem_size);
+    fb_put(fb, vec, &n, 4);
+
+    return (vec);
+}
+
+static size_t fb_string(fbuilder *fb, const char *s) {
+    uint32_t n = (uint32_t)strlen(s);
+    size_t   str;
+
+    fb_pad(fb, 4);
+    str = fb_alloc(fb, 4 + n + 1);
+    fb_put(fb, str, &n, 4);
+    fb_put(fb, str + 4, s, n);
+
+    return (str);
+}
@@ -0,0 +1,382 @@
+/* ============================================================================
+* Write model output to a NetCDF-4 file
+*
+* CF (1.8) time series: variables are dimensioned (site, time) with an
+* unlimited time axis, chunked one site by chunk_days days and deflated, with
+* the sites' latitude and longitude alongside. Variable names, long names
+* and units come from the same tables as the CSV header
+* (daily_output_names/_long_names/_units).
+*
+* A file holds netcdf_nsites sites, which can be written either
+*   - by one process, an ensemble (--overrides) holds the file open and its
+*     members write one site each, see run_ensemble, or
+*   - by separate runs, each writing its netcdf_site: whichever runs first
+*     creates the file, the others open it and fill in their own slot, in
+*     any order, and a rerun of a site only overwrites that site.
+*
+* NOTES:
+*   Optional, needs the model built with -DHAVE_NETCDF and linked against
+*   libnetcdf, see the Makefile. Separate runs have to take turns, NetCDF-4
+*   files can't be written by two processes at once. A one site file is
+*   always created afresh. Every site shares the time axis, so their met
+*   files have to start in the same year.
+*
+* =========================================================================== */
+#include "write_netcdf_file.h"
+
+#ifdef HAVE_NETCDF
+#include <netcdf.h>
+
+static void nc_check(int, const char *);
+static int  def_dim(int, const char *, const char *, size_t);
+static int  def_var(int, const char *, nc_type, int, const int *,
+                    const size_t *, int, int);
+static void put_text(int, int, const char *, const char *);
+static void put_units(int, const char *, const char *, int, const char *);
+
+
+netcdf_writer *netcdf_open(const char *fname, const char **names,
+                           const char **long_names, const char **units,
+                           int nvars, int nsites, int chunk_days, int deflate,
+                           int start_year, const char *git_ver) {
+    /*
+        Create the file, or open it to add sites when another run got there
+        first. The sites are then picked with netcdf_set_site.
+    */
+    netcdf_writer *nw = NULL;
+    int     i, status, dimids[2], site_var, varid, *sites;
+    size_t  chunks[2];
+    char    time_units[64];
+
+    if (nsites < 1) {
+        fprintf(stderr, "netcdf_nsites must be at least 1\n");
+        exit(EXIT_FAILURE);
+    }
+    if (chunk_days < 1) {
+        fprintf(stderr, "NetCDF chunk size must be at least one day\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((nw = malloc(sizeof(netcdf_writer))) == NULL) {
+        fprintf(stderr, "malloc failed allocating netcdf writer\n");
+        exit(EXIT_FAILURE);
+    }
+    nw->nvars = nvars;
+    nw->nsites = nsites;
+    nw->site = -1;
+    nw->start_year = start_year;
+    nw->shared = 0;
+    nw->chunk_days = chunk_days;
+    nw->ndays = 0;
+    nw->t0 = 0;
+    nw->varids = malloc(nvars * sizeof(int));
+    nw->buf = malloc(nvars * sizeof(double *));
+    if (nw->varids == NULL || nw->buf == NULL) {
+        fprintf(stderr, "malloc failed allocating netcdf writer\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < nvars; i++) {
+        if ((nw->buf[i] = malloc(chunk_days * sizeof(double))) == NULL) {
+            fprintf(stderr, "malloc failed allocating netcdf buffers\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (nsites == 1) {
+        /* nobody else's results can be in a one site file */
+        nc_check(nc_create(fname, NC_NETCDF4 | NC_CLOBBER, &nw->ncid),
+                 "creating file");
+    } else {
+        status = nc_create(fname, NC_NETCDF4 | NC_NOCLOBBER, &nw->ncid);
+        if (status == NC_EEXIST) {
+            nc_check(nc_open(fname, NC_WRITE, &nw->ncid), "opening file");
+            nc_check(nc_redef(nw->ncid), "redef");
+        } else {
+            nc_check(status, "creating file");
+        }
+    }
+
+    /*
+        Everything below is looked up before it's defined, so whichever run
+        gets there first sets the file up and the rest (or a rerun) find it
+        there
+    */
+    dimids[0] = def_dim(nw->ncid, fname, "site", nsites);
+    dimids[1] = def_dim(nw->ncid, fname, "time", NC_UNLIMITED);
+
+    site_var = def_var(nw->ncid, "site", NC_INT, 1, &dimids[0], NULL, 0, 0);
+    put_text(nw->ncid, site_var, "long_name", "site index");
+    put_text(nw->ncid, site_var, "cf_role", "timeseries_id");
+
+    nw->lat_var = def_var(nw->ncid, "lat", NC_DOUBLE, 1, &dimids[0], NULL,
+                          0, 0);
+    put_text(nw->ncid, nw->lat_var, "standard_name", "latitude");
+    put_text(nw->ncid, nw->lat_var, "long_name", "latitude");
+    put_units(nw->ncid, fname, "lat", nw->lat_var, "degrees_north");
+
+    nw->lon_var = def_var(nw->ncid, "lon", NC_DOUBLE, 1, &dimids[0], NULL,
+                          0, 0);
+    put_text(nw->ncid, nw->lon_var, "standard_name", "longitude");
+    put_text(nw->ncid, nw->lon_var, "long_name", "longitude");
+    put_units(nw->ncid, fname, "lon", nw->lon_var, "degrees_east");
+
+    nw->time_var = def_var(nw->ncid, "time", NC_DOUBLE, 1, &dimids[1], NULL,
+                           0, 0);
+    sprintf(time_units, "days since %d-01-01 00:00:00", start_year);
+    put_text(nw->ncid, nw->time_var, "standard_name", "time");
+    put_text(nw->ncid, nw->time_var, "long_name", "time");
+    put_units(nw->ncid, fname, "time", nw->time_var, time_units);
+    put_text(nw->ncid, nw->time_var, "calendar", "standard");
+    put_text(nw->ncid, nw->time_var, "axis", "T");
+
+    chunks[0] = 1;
+    chunks[1] = chunk_days;
+    for (i = 0; i < nvars; i++) {
+        varid = def_var(nw->ncid, names[i], NC_DOUBLE, 2, dimids, chunks,
+                        deflate, 1);
+        put_text(nw->ncid, varid, "long_name", long_names[i]);
+        put_units(nw->ncid, fname, names[i], varid, units[i]);
+        put_text(nw->ncid, varid, "coordinates", "time lat lon");
+        nw->varids[i] = varid;
+    }
+
+    put_text(nw->ncid, NC_GLOBAL, "Conventions", "CF-1.8");
+    put_text(nw->ncid, NC_GLOBAL, "featureType", "timeSeries");
+    put_text(nw->ncid, NC_GLOBAL, "source", "GDAY");
+    put_text(nw->ncid, NC_GLOBAL, "git_revision", git_ver);
+    nc_check(nc_enddef(nw->ncid), "enddef");
+
+    if ((sites = malloc(nsites * sizeof(int))) == NULL) {
+        fprintf(stderr, "malloc failed allocating netcdf site index\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < nsites; i++)
+        sites[i] = i;
+    nc_check(nc_put_var_int(nw->ncid, site_var, sites), "site");
+    free(sites);
+
+    return (nw);
+}
+
+void netcdf_set_site(netcdf_writer *nw, int site, int start_year,
+                     double latitude, double longitude) {
+    /*
+        The days that follow are for site, which is at latitude, longitude.
+        Anything buffered for the last site is written first.
+    */
+    size_t index = site;
+
+    netcdf_flush(nw);
+
+    if (site < 0 || site >= nw->nsites) {
+        fprintf(stderr, "netcdf_site must be between 0 and %d, not %d\n",
+                nw->nsites - 1, site);
+        exit(EXIT_FAILURE);
+    }
+    if (start_year != nw->start_year) {
+        fprintf(stderr, "NetCDF site %d starts in %d, the file in %d\n",
+                site, start_year, nw->start_year);
+        exit(EXIT_FAILURE);
+    }
+    nc_check(nc_put_var1_double(nw->ncid, nw->lat_var, &index, &latitude),
+             "lat");
+    nc_check(nc_put_var1_double(nw->ncid, nw->lon_var, &index, &longitude),
+             "lon");
+    nw->site = site;
+
+    return;
+}
+
+void netcdf_write_row(netcdf_writer *nw, long t, const double *row) {
+    /*
+        Buffer day t for the current site; a full buffer is written as one
+        chunk. Days are expected in order.
+    */
+    int i;
+
+    if (nw->ndays == 0)
+        nw->t0 = t;
+    for (i = 0; i < nw->nvars; i++)
+        nw->buf[i][nw->ndays] = row[i];
+    nw->ndays++;
+
+    if (nw->ndays == nw->chunk_days)
+        netcdf_flush(nw);
+
+    return;
+}
+
+void netcdf_close(netcdf_writer *nw) {
+    int i;
+
+    netcdf_flush(nw);
+    nc_check(nc_close(nw->ncid), "closing file");
+
+    for (i = 0; i < nw->nvars; i++)
+        free(nw->buf[i]);
+    free(nw->buf);
+    free(nw->varids);
+    free(nw);
+
+    return;
+}
+
+int netcdf_available(void) {
+    return (1);
+}
+
+void netcdf_flush(netcdf_writer *nw) {
+    /* write out the buffered days */
+    int     i;
+    size_t  start[2], count[2], tstart, tcount;
+    double *times = NULL;
+
+    if (nw->ndays == 0)
+        return;
+
+    start[0] = nw->site;
+    start[1] = nw->t0;
+    count[0] = 1;
+    count[1] = nw->ndays;
+    for (i = 0; i < nw->nvars; i++)
+        nc_check(nc_put_vara_double(nw->ncid, nw->varids[i], start, count,
+                                    nw->buf[i]), "writing data");
+
+    /* time coordinate, days since the first day of the run */
+    if ((times = malloc(nw->ndays * sizeof(double))) == NULL) {
+        fprintf(stderr, "malloc failed allocating netcdf time buffer\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < nw->ndays; i++)
+        times[i] = (double)(nw->t0 + i);
+    tstart = nw->t0;
+    tcount = nw->ndays;
+    nc_check(nc_put_vara_double(nw->ncid, nw->time_var, &tstart, &tcount,
+                                times), "writing time");
+    free(times);
+
+    nw->ndays = 0;
+
+    return;
+}
+
+static int def_dim(int ncid, const char *fname, const char *name,
+                   size_t len) {
+    /* the dimension, defined if the file doesn't have it yet */
+    int    dimid;
+    size_t have;
+
+    if (nc_inq_dimid(ncid, name, &dimid) != NC_NOERR) {
+        nc_check(nc_def_dim(ncid, name, len, &dimid), name);
+        return (dimid);
+    }
+    nc_check(nc_inq_dimlen(ncid, dimid, &have), name);
+    if (len != NC_UNLIMITED && have != len) {
+        fprintf(stderr, "%s has %d %ss, this run has %d\n", fname, (int)have,
+                name, (int)len);
+        exit(EXIT_FAILURE);
+    }
+
+    return (dimid);
+}
+
+static int def_var(int ncid, const char *name, nc_type type, int ndims,
+                   const int *dimids, const size_t *chunks, int deflate,
+                   int shuffle) {
+    /* the variable, defined (chunked and deflated if asked) if it's new */
+    int varid;
+
+    if (nc_inq_varid(ncid, name, &varid) == NC_NOERR)
+        return (varid);
+
+    nc_check(nc_def_var(ncid, name, type, ndims, dimids, &varid), name);
+    if (chunks != NULL)
+        nc_check(nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks), name);
+    if (deflate > 0)
+        nc_check(nc_def_var_deflate(ncid, varid, shuffle, 1, deflate), name);
+
+    return (varid);
+}
+
+static void put_text(int ncid, int varid, const char *name,
+                     const char *text) {
+    nc_check(nc_put_att_text(ncid, varid, name, strlen(text), text), name);
+}
+
+static void put_units(int ncid, const char *fname, const char *name,
+                      int varid, const char *units) {
+    /*
+        Set the units, or check a file that has them already agrees - a
+        different start year would put this site's days in the wrong place
+    */
+    char   have[256];
+    size_t len;
+
+    if (nc_inq_attlen(ncid, varid, "units", &len) == NC_NOERR) {
+        if (len >= sizeof(have)) {
+            fprintf(stderr, "%s: %s has units too long to check\n", fname,
+                    name);
+            exit(EXIT_FAILURE);
+        }
+        nc_check(nc_get_att_text(ncid, varid, "units", have), name);
+        have[len] = '\0';
+        if (strcmp(have, units) != 0) {
+            fprintf(stderr, "%s: %s is in %s, this run writes %s\n", fname,
+                    name, have, units);
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+    nc_check(nc_put_att_text(ncid, varid, "units", strlen(units), units),
+             name);
+
+    return;
+}
+
+static void nc_check(int status, const char *what) {
+    if (status != NC_NOERR) {
+        fprintf(stderr, "NetCDF error (%s): %s\n", what, nc_strerror(status));
+        exit(EXIT_FAILURE);
+    }
+}
+
+#else
+
+/* Built without NetCDF support */
+
+static void no_netcdf(void) {
+    fprintf(stderr, "NetCDF output not compiled in, rebuild with "
+                    "-DHAVE_NETCDF\n");
+    exit(EXIT_FAILURE);
+}
+
+netcdf_writer *netcdf_open(const char *fname, const char **names,
+                           const char **long_names, const char **units,
+                           int nvars, int nsites, int chunk_days, int deflate,
+                           int start_year, const char *git_ver) {
+    no_netcdf();
+    return (NULL);
+}
+
+void netcdf_set_site(netcdf_writer *nw, int site, int start_year,
+                     double latitude, double longitude) {
+    no_netcdf();
+}
+
+void netcdf_write_row(netcdf_writer *nw, long t, const double *row) {
+    no_netcdf();
+}
+
+void netcdf_flush(netcdf_writer *nw) {
+    no_netcdf();
+}
+
+void netcdf_close(netcdf_writer *nw) {
+    no_netcdf();
+}
+
+int netcdf_available(void) {
+    return (0);
+}
+
+#endif /* HAVE_NETCDF */
@@ -15,6 +15,122 @@
 * =========================================================================== */
 #include "write_output_file.h"
 
+/* Daily output column names, in the order pack_daily_outputs fills them */
+const char *daily_output_names[NDAILY_OUTPUTS] = {
+    "year", "doy", "wtfac_root", "wtfac_topsoil", "pawater_root", "shoot",
+    "lai", "branch", "stem", "root", "croot", "shootn", "branchn", "stemn",
+    "rootn", "crootn", "cstore", "nstore", "soilc", "soiln", "inorgn",
+    "litterc", "littercag", "littercbg", "litternag", "litternbg",
+    "activesoil", "slowsoil", "passivesoil", "activesoiln", "slowsoiln",
+    "passivesoiln", "et", "transpiration", "soil_evap", "canopy_evap",
+    "runoff", "gs_mol_m2_sec", "ga_mol_m2_sec", "deadleaves", "deadbranch",
+    "deadstems", "deadroots", "deadcroots", "deadleafn", "deadbranchn",
+    "deadstemn", "deadrootn", "deadcrootn", "nep", "gpp", "npp", "hetero_resp",
+    "auto_resp", "apar", "cpleaf", "cpbranch", "cpstem", "cproot", "cpcroot",
+    "npleaf", "npbranch", "npstemimm", "npstemmob", "nproot", "npcroot",
+    "nuptake", "ngross", "nmineralisation", "nloss", "tfac_soil_decomp",
+    "c_into_active", "c_into_slow", "c_into_passive", "active_to_slow",
+    "active_to_passive", "slow_to_active", "slow_to_passive",
+    "passive_to_active", "co2_rel_from_surf_struct_litter",
+    "co2_rel_from_soil_struct_litter", "co2_rel_from_surf_metab_litter",
+    "co2_rel_from_soil_metab_litter", "co2_rel_from_active_pool",
+    "co2_rel_from_slow_pool", "co2_rel_from_passive_pool", "root_exc",
+    "root_exn", "co2_released_exud", "factive", "rtslow", "rexc_cue",
+    "predawn_swp", "midday_lwp", "midday_xwp", "leafretransn", "dead_year",
+    "dead_doy", "theta0", "theta1", "theta2", "theta3", "theta4", "theta5",
+    "theta6", "theta7", "theta8", "theta9", "theta10", "theta11", "theta12",
+    "theta13", "theta14", "theta15", "theta16", "theta17", "theta18",
+    "theta19", "theta20"
+};
+
+/* ...and their units */
+const char *daily_output_units[NDAILY_OUTPUTS] = {
+    "year", "day of year", "1", "1", "mm", "t C ha-1", "m2 m-2", "t C ha-1",
+    "t C ha-1", "t C ha-1", "t C ha-1", "t N ha-1", "t N ha-1", "t N ha-1",
+    "t N ha-1", "t N ha-1", "t C ha-1", "t N ha-1", "t C ha-1", "t N ha-1",
+    "t N ha-1", "t C ha-1", "t C ha-1", "t C ha-1", "t N ha-1", "t N ha-1",
+    "t C ha-1", "t C ha-1", "t C ha-1", "t N ha-1", "t N ha-1", "t N ha-1",
+    "mm d-1", "mm d-1", "mm d-1", "mm d-1", "mm d-1", "mol m-2 s-1",
+    "mol m-2 s-1", "t C ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1",
+    "t C ha-1 d-1", "t C ha-1 d-1", "t N ha-1 d-1", "t N ha-1 d-1",
+    "t N ha-1 d-1", "t N ha-1 d-1", "t N ha-1 d-1", "t C ha-1 d-1",
+    "t C ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1",
+    "umol m-2 d-1", "t C ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1",
+    "t C ha-1 d-1", "t C ha-1 d-1", "t N ha-1 d-1", "t N ha-1 d-1",
+    "t N ha-1 d-1", "t N ha-1 d-1", "t N ha-1 d-1", "t N ha-1 d-1",
+    "t N ha-1 d-1", "t N ha-1 d-1", "t N ha-1 d-1", "t N ha-1 d-1", "1",
+    "t C ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1",
+    "t C ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1",
+    "t C ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1",
+    "t C ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1",
+    "t N ha-1 d-1", "t C ha-1 d-1", "t C ha-1 d-1", "years", "1", "MPa", "MPa",
+    "MPa", "t N ha-1 d-1", "year", "day of year", "m3 m-3", "m3 m-3", "m3 m-3",
+    "m3 m-3", "m3 m-3", "m3 m-3", "m3 m-3", "m3 m-3", "m3 m-3", "m3 m-3",
+    "m3 m-3", "m3 m-3", "m3 m-3", "m3 m-3", "m3 m-3", "m3 m-3", "m3 m-3",
+    "m3 m-3", "m3 m-3", "m3 m-3", "m3 m-3"
+};
+
+/* ...and what they are */
+const char *daily_output_long_names[NDAILY_OUTPUTS] = {
+    "year", "day of year", "soil water stress factor, root zone",
+    "soil water stress factor, topsoil", "plant available water, root zone",
+    "foliage carbon", "leaf area index", "branch carbon", "stem carbon",
+    "fine root carbon", "coarse root carbon", "foliage nitrogen",
+    "branch nitrogen", "stem nitrogen", "fine root nitrogen",
+    "coarse root nitrogen", "stored carbon", "stored nitrogen", "soil carbon",
+    "soil nitrogen", "soil inorganic nitrogen", "litter carbon",
+    "above ground litter carbon", "below ground litter carbon",
+    "above ground litter nitrogen", "below ground litter nitrogen",
+    "active soil carbon", "slow soil carbon", "passive soil carbon",
+    "active soil nitrogen", "slow soil nitrogen", "passive soil nitrogen",
+    "evapotranspiration", "transpiration", "soil evaporation",
+    "canopy interception evaporation", "runoff",
+    "canopy stomatal conductance", "canopy aerodynamic conductance",
+    "leaf litterfall", "branch litterfall", "stem litterfall",
+    "fine root turnover", "coarse root turnover", "leaf litterfall nitrogen",
+    "branch litterfall nitrogen", "stem litterfall nitrogen",
+    "fine root turnover nitrogen", "coarse root turnover nitrogen",
+    "net ecosystem production", "gross primary production",
+    "net primary production", "heterotrophic respiration",
+    "autotrophic respiration", "absorbed photosynthetically active radiation",
+    "carbon allocated to foliage", "carbon allocated to branches",
+    "carbon allocated to stem", "carbon allocated to fine roots",
+    "carbon allocated to coarse roots", "nitrogen allocated to foliage",
+    "nitrogen allocated to branches", "nitrogen allocated to immobile stem",
+    "nitrogen allocated to mobile stem", "nitrogen allocated to fine roots",
+    "nitrogen allocated to coarse roots", "plant nitrogen uptake",
+    "gross nitrogen mineralisation", "net nitrogen mineralisation",
+    "nitrogen loss", "soil temperature factor on decomposition",
+    "carbon into the active soil pool", "carbon into the slow soil pool",
+    "carbon into the passive soil pool", "carbon from active to slow soil",
+    "carbon from active to passive soil", "carbon from slow to active soil",
+    "carbon from slow to passive soil", "carbon from passive to active soil",
+    "CO2 released from surface structural litter",
+    "CO2 released from soil structural litter",
+    "CO2 released from surface metabolic litter",
+    "CO2 released from soil metabolic litter",
+    "CO2 released from the active soil pool",
+    "CO2 released from the slow soil pool",
+    "CO2 released from the passive soil pool", "root carbon exudation",
+    "root nitrogen exudation", "CO2 released from root exudates",
+    "exudate carbon into the active soil pool",
+    "slow soil pool turnover time", "carbon use efficiency of exudation",
+    "predawn soil water potential", "midday leaf water potential",
+    "midday xylem water potential", "leaf nitrogen retranslocation",
+    "year the stand died", "day of year the stand died",
+    "soil water content, layer 0", "soil water content, layer 1",
+    "soil water content, layer 2", "soil water content, layer 3",
+    "soil water content, layer 4", "soil water content, layer 5",
+    "soil water content, layer 6", "soil water content, layer 7",
+    "soil water content, layer 8", "soil water content, layer 9",
+    "soil water content, layer 10", "soil water content, layer 11",
+    "soil water content, layer 12", "soil water content, layer 13",
+    "soil water content, layer 14", "soil water content, layer 15",
+    "soil water content, layer 16", "soil water content, layer 17",
+    "soil water content, layer 18", "soil water content, layer 19",
+    "soil water content, layer 20"
+};
+
 
 void open_output_file(control *c, char *fname, FILE **fp) {
     *fp = fopen(fname, "w");
@@ -26,7 +142,13 @@ void write_output_subdaily_header(control *c, FILE **fp) {
     /*
         Write 30 min fluxes headers to an output CSV file. This is very basic
         for now...
+
+        For binary output the header goes to a separate file and also
+        carries the plant hydraulics columns (when the hydraulics model is
+        switched on) and the dimensions needed to read the binary file back.
     */
+    int ncols = 9;
+    int nrows = c->total_num_days * c->num_hlf_hrs;
 
     /* Git version */
     fprintf(*fp, "#Git_revision_code:%s\n", c->git_code_ver);
@@ -38,7 +160,20 @@ void write_output_subdaily_header(control *c, FILE **fp) {
     ** Canopy stuff...
     */
     fprintf(*fp, "an_canopy,rd_canopy,gsc_canopy,");
-    fprintf(*fp, "apar_canopy,trans_canopy,tleaf\n");
+    if (c->output_ascii == FALSE && c->water_balance == HYDRAULICS) {
+        fprintf(*fp, "apar_canopy,trans_canopy,tleaf,");
+
+        /* hydraulics */
+        fprintf(*fp, "lwp_canopy,xylem_psi,weighted_swp\n");
+        ncols += 3;
+    } else {
+        fprintf(*fp, "apar_canopy,trans_canopy,tleaf\n");
+    }
+
+    if (c->output_ascii == FALSE) {
+        fprintf(*fp, "nrows=%d\n", nrows);
+        fprintf(*fp, "ncols=%d\n", ncols);
+    }
     return;
 }
 
@@ -49,103 +184,17 @@ void write_output_header(control *c, FILE **fp) {
         script to translate the outputs to a nice CSV file with input met
         data, units and nice header information.
     */
-    int ncols = 86;
-    int nrows = c->num_days;
+    int i;
+    int ncols = NDAILY_OUTPUTS;
+    int nrows = c->total_num_days;
 
     /* Git version */
     fprintf(*fp, "#Git_revision_code:%s\n", c->git_code_ver);
 
-    /* time stuff */
-    fprintf(*fp, "year,doy,");
-
-    /*
-    ** STATE
-    */
-
-    /* water*/
-    fprintf(*fp, "wtfac_root,wtfac_topsoil,pawater_root,");
-
-    /* plant */
-    fprintf(*fp, "shoot,lai,branch,stem,root,croot,shootn,branchn,stemn,");
-    fprintf(*fp, "rootn,crootn,cstore,nstore,");
-
-    /* belowground */
-    fprintf(*fp, "soilc,soiln,inorgn,litterc,littercag,littercbg,");
-    fprintf(*fp, "litternag,litternbg,activesoil,slowsoil,");
-    fprintf(*fp, "passivesoil,activesoiln,slowsoiln,passivesoiln,");
-
-    /*
-    ** FLUXES
-    */
-
-    /* water */
-    fprintf(*fp, "et,transpiration,soil_evap,canopy_evap,runoff,");
-    fprintf(*fp, "gs_mol_m2_sec,ga_mol_m2_sec,");
-
-    /* litter */
-    fprintf(*fp, "deadleaves,deadbranch,deadstems,deadroots,deadcroots,");
-    fprintf(*fp, "deadleafn,deadbranchn,deadstemn,deadrootn,deadcrootn,");
-
-    /* C fluxes */
-    fprintf(*fp, "nep,gpp,npp,hetero_resp,auto_resp,apar,");
-
-    /* C & N growth */
-    fprintf(*fp, "cpleaf,cpbranch,cpstem,cproot,cpcroot,");
-    fprintf(*fp, "npleaf,npbranch,npstemimm,npstemmob,nproot,npcroot,");
-
-    /* N stuff */
-    fprintf(*fp, "nuptake,ngross,nmineralisation,nloss,");
-
-    /* traceability stuff */
-    fprintf(*fp, "tfac_soil_decomp,c_into_active,c_into_slow,");
-    fprintf(*fp, "c_into_passive,active_to_slow,active_to_passive,");
-    fprintf(*fp, "slow_to_active,slow_to_passive,passive_to_active,");
-    fprintf(*fp, "co2_rel_from_surf_struct_litter,");
-    fprintf(*fp, "co2_rel_from_soil_struct_litter,");
-    fprintf(*fp, "co2_rel_from_surf_metab_litter,");
-    fprintf(*fp, "co2_rel_from_soil_metab_litter,");
-    fprintf(*fp, "co2_rel_from_active_pool,");
-    fprintf(*fp, "co2_rel_from_slow_pool,");
-    fprintf(*fp, "co2_rel_from_passive_pool,");
-
-    /* extra priming stuff */
-    fprintf(*fp, "root_exc,");
-    fprintf(*fp, "root_exn,");
-    fprintf(*fp, "co2_released_exud,");
-    fprintf(*fp, "factive,");
-    fprintf(*fp, "rtslow,");
-    fprintf(*fp, "rexc_cue,");
-
-
-
-    /* Misc */
-    fprintf(*fp, "predawn_swp,");
-    fprintf(*fp, "midday_lwp,");
-    fprintf(*fp, "midday_xwp,");
-    fprintf(*fp, "leafretransn,");
-    fprintf(*fp, "dead_year,");
-    fprintf(*fp, "dead_doy,");
-    fprintf(*fp, "theta0,");
-    fprintf(*fp, "theta1,");
-    fprintf(*fp, "theta2,");
-    fprintf(*fp, "theta3,");
-    fprintf(*fp, "theta4,");
-    fprintf(*fp, "theta5,");
-    fprintf(*fp, "theta6,");
-    fprintf(*fp, "theta7,");
-    fprintf(*fp, "theta8,");
-    fprintf(*fp, "theta9,");
-    fprintf(*fp, "theta10,");
-    fprintf(*fp, "theta11,");
-    fprintf(*fp, "theta12,");
-    fprintf(*fp, "theta13,");
-    fprintf(*fp, "theta14,");
-    fprintf(*fp, "theta15,");
-    fprintf(*fp, "theta16,");
-    fprintf(*fp, "theta17,");
-    fprintf(*fp, "theta18,");
-    fprintf(*fp, "theta19,");
-    fprintf(*fp, "theta20\n");
+    for (i = 0; i < NDAILY_OUTPUTS; i++) {
+        fprintf(*fp, "%s%s", daily_output_names[i],
+                (i < NDAILY_OUTPUTS - 1) ? "," : "\n");
+    }
 
     if (c->output_ascii == FALSE) {
         fprintf(*fp, "nrows=%d\n", nrows);
@@ -172,196 +221,575 @@ void write_subdaily_outputs_ascii(control *c, canopy_wk *cw, double year,
     return;
 }
 
-void write_daily_outputs_ascii(control *c, canopy_wk *cw, fluxes *f, state *s,
-                               int year, int doy) {
+void write_subdaily_outputs_binary(control *c, canopy_wk *cw, state *s,
+                                   double year, double doy, int hod) {
     /*
-        Write daily state and fluxes headers to an output CSV file. Note we
-        are not writing anything useful like units as there is a wrapper
-        script to translate the outputs to a nice CSV file with input met
-        data, units and nice header information.
+        Write sub-daily canopy fluxes to a binary file, the column order
+        matches the names in the sub-daily header file
     */
+    double temp;
+
+    /* time stuff */
+    fwrite(&year, sizeof(double), 1, c->ofp_sd);
+    fwrite(&doy, sizeof(double), 1, c->ofp_sd);
+    temp = (double)hod;
+    fwrite(&temp, sizeof(double), 1, c->ofp_sd);
+
+    /* Canopy stuff */
+    fwrite(&(cw->an_canopy), sizeof(double), 1, c->ofp_sd);
+    fwrite(&(cw->rd_canopy), sizeof(double), 1, c->ofp_sd);
+    fwrite(&(cw->gsc_canopy), sizeof(double), 1, c->ofp_sd);
+    fwrite(&(cw->apar_canopy), sizeof(double), 1, c->ofp_sd);
+    fwrite(&(cw->trans_canopy), sizeof(double), 1, c->ofp_sd);
+    fwrite(&(cw->tleaf_new), sizeof(double), 1, c->ofp_sd);
+
+    /* hydraulics */
+    if (c->water_balance == HYDRAULICS) {
+        fwrite(&(cw->lwp_canopy), sizeof(double), 1, c->ofp_sd);
+        fwrite(&(cw->xylem_psi), sizeof(double), 1, c->ofp_sd);
+        fwrite(&(s->weighted_swp), sizeof(double), 1, c->ofp_sd);
+    }
 
+    return;
+}
+
+void pack_daily_outputs(control *c, canopy_wk *cw, fluxes *f, state *s,
+                        int year, int doy, double *out) {
+    /*
+        Gather the daily state and fluxes into a single record, ordered as
+        daily_output_names, so the different output backends all write the
+        same thing
+    */
+    int i = 0, j;
 
     /* time stuff */
-    fprintf(c->ofp, "%.10f,%.10f,", (double)year, (double)doy);
+    out[i++] = (double)year;
+    out[i++] = (double)doy;
 
     /*
     ** STATE
-
     */
 
     /* water*/
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,",
-            s->wtfac_root,s->wtfac_topsoil,s->pawater_root);
+    out[i++] = s->wtfac_root;
+    out[i++] = s->wtfac_topsoil;
+    out[i++] = s->pawater_root;
 
     /* plant */
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,%.10f,%.10f,%.10f,%.10f,%.10f,%.10f,",
-                    s->shoot,s->lai,s->branch,s->stem,s->root,s->croot,
-                    s->shootn,s->branchn,s->stemn);
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,%.10f,",
-                    s->rootn,s->crootn,s->cstore,s->nstore);
+    out[i++] = s->shoot;
+    out[i++] = s->lai;
+    out[i++] = s->branch;
+    out[i++] = s->stem;
+    out[i++] = s->root;
+    out[i++] = s->croot;
+    out[i++] = s->shootn;
+    out[i++] = s->branchn;
+    out[i++] = s->stemn;
+    out[i++] = s->rootn;
+    out[i++] = s->crootn;
+    out[i++] = s->cstore;
+    out[i++] = s->nstore;
 
     /* belowground */
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,%.10f,%.10f,%.10f,",
-                    s->soilc,s->soiln,s->inorgn,s->litterc,s->littercag,
-                    s->littercbg);
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,%.10f,%.10f,%.10f,%.10f,%.10f,",
-                    s->litternag,s->litternbg,s->activesoil,s->slowsoil,
-                    s->passivesoil,s->activesoiln,s->slowsoiln,
-                    s->passivesoiln);
+    out[i++] = s->soilc;
+    out[i++] = s->soiln;
+    out[i++] = s->inorgn;
+    out[i++] = s->litterc;
+    out[i++] = s->littercag;
+    out[i++] = s->littercbg;
+    out[i++] = s->litternag;
+    out[i++] = s->litternbg;
+    out[i++] = s->activesoil;
+    out[i++] = s->slowsoil;
+    out[i++] = s->passivesoil;
+    out[i++] = s->activesoiln;
+    out[i++] = s->slowsoiln;
+    out[i++] = s->passivesoiln;
+
     /*
     ** FLUXES
     */
 
     /* water */
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,%.10f,",
-                    f->et,f->transpiration,f->soil_evap,f->canopy_evap);
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,",
-                    f->runoff,f->gs_mol_m2_sec,f->ga_mol_m2_sec);
+    out[i++] = f->et;
+    out[i++] = f->transpiration;
+    out[i++] = f->soil_evap;
+    out[i++] = f->canopy_evap;
+    out[i++] = f->runoff;
+    out[i++] = f->gs_mol_m2_sec;
+    out[i++] = f->ga_mol_m2_sec;
 
     /* litter */
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,%.10f,%.10f,",
-                    f->deadleaves,f->deadbranch,f->deadstems,f->deadroots,
-                    f->deadcroots);
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,%.10f,%.10f,",
-                    f->deadleafn,f->deadbranchn,f->deadstemn,f->deadrootn,
-                    f->deadcrootn);
+    out[i++] = f->deadleaves;
+    out[i++] = f->deadbranch;
+    out[i++] = f->deadstems;
+    out[i++] = f->deadroots;
+    out[i++] = f->deadcroots;
+    out[i++] = f->deadleafn;
+    out[i++] = f->deadbranchn;
+    out[i++] = f->deadstemn;
+    out[i++] = f->deadrootn;
+    out[i++] = f->deadcrootn;
 
     /* C fluxes */
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,%.10f,%.10f,%.10f,",
-                    f->nep,f->gpp,f->npp,f->hetero_resp,f->auto_resp,
-                    f->apar);
+    out[i++] = f->nep;
+    out[i++] = f->gpp;
+    out[i++] = f->npp;
+    out[i++] = f->hetero_resp;
+    out[i++] = f->auto_resp;
+    out[i++] = f->apar;
 
     /* C & N growth */
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,%.10f,%.10f,",
-                    f->cpleaf,f->cpbranch,f->cpstem,f->cproot,f->cpcroot);
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,%.10f,%.10f,%.10f,",
-                    f->npleaf,f->npbranch,f->npstemimm,f->npstemmob,f->nproot,
-                    f->npcroot);
+    out[i++] = f->cpleaf;
+    out[i++] = f->cpbranch;
+    out[i++] = f->cpstem;
+    out[i++] = f->cproot;
+    out[i++] = f->cpcroot;
+    out[i++] = f->npleaf;
+    out[i++] = f->npbranch;
+    out[i++] = f->npstemimm;
+    out[i++] = f->npstemmob;
+    out[i++] = f->nproot;
+    out[i++] = f->npcroot;
 
     /* N stuff */
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,%.10f,",
-                    f->nuptake,f->ngross,f->nmineralisation,f->nloss);
-
+    out[i++] = f->nuptake;
+    out[i++] = f->ngross;
+    out[i++] = f->nmineralisation;
+    out[i++] = f->nloss;
 
     /* traceability stuff */
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,",
-                    f->tfac_soil_decomp,f->c_into_active,f->c_into_slow);
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,",
-                    f->c_into_passive,f->active_to_slow,f->active_to_passive);
-    fprintf(c->ofp, "%.10f,%.10f,%.10f,",
-                    f->slow_to_active,f->slow_to_passive,f->passive_to_active);
-    fprintf(c->ofp, "%.10f,", f->co2_rel_from_surf_struct_litter);
-    fprintf(c->ofp, "%.10f,", f->co2_rel_from_soil_struct_litter);
-    fprintf(c->ofp, "%.10f,", f->co2_rel_from_surf_metab_litter);
-    fprintf(c->ofp, "%.10f,", f->co2_rel_from_soil_metab_litter);
-    fprintf(c->ofp, "%.10f,", f->co2_rel_from_active_pool);
-    fprintf(c->ofp, "%.10f,", f->co2_rel_from_slow_pool);
-    fprintf(c->ofp, "%.10f,", f->co2_rel_from_passive_pool);
+    out[i++] = f->tfac_soil_decomp;
+    out[i++] = f->c_into_active;
+    out[i++] = f->c_into_slow;
+    out[i++] = f->c_into_passive;
+    out[i++] = f->active_to_slow;
+    out[i++] = f->active_to_passive;
+    out[i++] = f->slow_to_active;
+    out[i++] = f->slow_to_passive;
+    out[i++] = f->passive_to_active;
+    out[i++] = f->co2_rel_from_surf_struct_litter;
+    out[i++] = f->co2_rel_from_soil_struct_litter;
+    out[i++] = f->co2_rel_from_surf_metab_litter;
+    out[i++] = f->co2_rel_from_soil_metab_litter;
+    out[i++] = f->co2_rel_from_active_pool;
+    out[i++] = f->co2_rel_from_slow_pool;
+    out[i++] = f->co2_rel_from_passive_pool;
 
     /* extra priming stuff */
-    fprintf(c->ofp, "%.10f,", f->root_exc);
-    fprintf(c->ofp, "%.10f,", f->root_exn);
-    fprintf(c->ofp, "%.10f,", f->co2_released_exud);
-    fprintf(c->ofp, "%.10f,", f->factive);
-    fprintf(c->ofp, "%.10f,", f->rtslow);
-    fprintf(c->ofp, "%.10f,", f->rexc_cue);
+    out[i++] = f->root_exc;
+    out[i++] = f->root_exn;
+    out[i++] = f->co2_released_exud;
+    out[i++] = f->factive;
+    out[i++] = f->rtslow;
+    out[i++] = f->rexc_cue;
 
     /* Misc */
-    fprintf(c->ofp, "%.10f,", s->predawn_swp);
-    fprintf(c->ofp, "%.10f,", s->midday_lwp);
-    fprintf(c->ofp, "%.10f,", s->midday_xwp);
-    fprintf(c->ofp, "%.10f,", f->leafretransn);
-    fprintf(c->ofp, "%.10f,", cw->death_year);
-    fprintf(c->ofp, "%.10f,", cw->death_doy);
-
-    if (c->water_balance == HYDRAULICS) {
-        fprintf(c->ofp, "%.10f,", s->water_frac[0]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[1]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[2]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[3]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[4]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[5]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[6]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[7]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[8]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[9]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[10]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[11]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[12]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[13]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[14]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[15]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[16]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[17]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[18]);
-        fprintf(c->ofp, "%.10f,", s->water_frac[19]);
-        fprintf(c->ofp, "%.10f\n", s->water_frac[20]);
-    } else {
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f,", -999.9);
-        fprintf(c->ofp, "%.10f\n", -999.9);
+    out[i++] = s->predawn_swp;
+    out[i++] = s->midday_lwp;
+    out[i++] = s->midday_xwp;
+    out[i++] = f->leafretransn;
+    out[i++] = cw->death_year;
+    out[i++] = cw->death_doy;
+
+    for (j = 0; j <= 20; j++) {
+        if (c->water_balance == HYDRAULICS)
+            out[i++] = s->water_frac[j];
+        else
+            out[i++] = -999.9;
     }
 
     return;
 }
 
-void write_daily_outputs_binary(control *c, fluxes *f, state *s, int year,
-                                int doy) {
+void write_daily_outputs_ascii(control *c, canopy_wk *cw, fluxes *f, state *s,
+                               int year, int doy) {
     /*
         Write daily state and fluxes headers to an output CSV file. Note we
         are not writing anything useful like units as there is a wrapper
         script to translate the outputs to a nice CSV file with input met
         data, units and nice header information.
     */
-    double temp;
+    int    i;
+    double out[NDAILY_OUTPUTS];
 
-    /* time stuff */
-    temp = (double)year;
-    fwrite(&temp, sizeof(double), 1, c->ofp);
-    temp = (double)doy;
-    fwrite(&temp, sizeof(double), 1, c->ofp);
+    pack_daily_outputs(c, cw, f, s, year, doy, out);
 
+    for (i = 0; i < NDAILY_OUTPUTS - 1; i++) {
+        fprintf(c->ofp, "%.10f,", out[i]);
+    }
+    fprintf(c->ofp, "%.10f\n", out[NDAILY_OUTPUTS - 1]);
 
-    /* plant */
-    fwrite(&(s->shoot), sizeof(double), 1, c->ofp);
-    fwrite(&(s->lai), sizeof(double), 1, c->ofp);
-    fwrite(&(s->branch), sizeof(double), 1, c->ofp);
-    fwrite(&(s->stem), sizeof(double), 1, c->ofp);
-    fwrite(&(s->root), sizeof(double), 1, c->ofp);
+    return;
+}
 
-    /* water */
-    fwrite(&(s->wtfac_root), sizeof(double), 1, c->ofp);
-    fwrite(&(s->pawater_root), sizeof(double), 1, c->ofp);
-    fwrite(&(f->transpiration), sizeof(double), 1, c->ofp);
-    fwrite(&(f->soil_evap), sizeof(double), 1, c->ofp);
-    fwrite(&(f->canopy_evap), sizeof(double), 1, c->ofp);
-    fwrite(&(f->runoff), sizeof(double), 1, c->ofp);
+void write_daily_outputs_arrow(control *c, canopy_wk *cw, fluxes *f, state *s,
+                               int year, int doy) {
+    /*
+        Append the day to the Arrow record batch being filled, the batch is
+        written out once it holds arrow_batch_days days
+    */
+    double out[NDAILY_OUTPUTS];
 
-    /* C fluxes */
-    fwrite(&(f->npp), sizeof(double), 1, c->ofp);
+    pack_daily_outputs(c, cw, f, s, year, doy, out);
+    arrow_write_row(c->aw, out);
 
     return;
 }
 
+void write_daily_outputs_netcdf(control *c, canopy_wk *cw, fluxes *f,
+                                state *s, int year, int doy) {
+    /*
+        Add the day to this run's site in the NetCDF file
+    */
+    double out[NDAILY_OUTPUTS];
+
+    pack_daily_outputs(c, cw, f, s, year, doy, out);
+    netcdf_write_row(c->nw, c->day_idx, out);
+
+    return;
+}
+
+void capture_daily_outputs(output_capture *oc, control *c, canopy_wk *cw,
+                           fluxes *f, state *s, int year, int doy) {
+    /*
+        Append the day's selected outputs to the caller's buffer, days beyond
+        max_days are counted but not stored
+    */
+    double  out[NDAILY_OUTPUTS];
+    double *row;
+    int     i;
+
+    if (oc->ndays < oc->max_days) {
+        pack_daily_outputs(c, cw, f, s, year, doy, out);
+        row = oc->buf + oc->ndays * oc->nout;
+        for (i = 0; i < oc->nout; i++)
+            row[i] = out[oc->col[i]];
+    }
+    oc->ndays++;
+
+    return;
+}
+
+void write_daily_outputs_binary(control *c, canopy_wk *cw, fluxes *f,
+                                state *s, int year, int doy) {
+    /*
+        Write the day as raw doubles, the columns are those listed in the
+        header file (daily_output_names)
+    */
+    double out[NDAILY_OUTPUTS];
+
+    pack_daily_outputs(c, cw, f, s, year, doy, out);
+    fwrite(out, sizeof(double), NDAILY_OUTPUTS, c->ofp);
+
+    return;
+}
+
+
+/*
+** NCEAS (FACE model-data intercomparison) output. Column names, units and
+** long names follow example/scripts/translate_GDAY_output_to_NCEAS_format.py,
+** anything the model doesn't simulate is written as UNDEF.
+*/
+#define NCEAS_NCOLS 116
+#define UNDEF -9999.0
+
+static const char *nceas_cols[NCEAS_NCOLS][3] = {
+    {"YEAR", "--", "Year"},
+    {"DOY", "--", "Day of the year"},
+    {"CO2", "Mean ppm", "CO2"},
+    {"PPT", "PPT", "Precipitation"},
+    {"PAR", "mol m-2", "PAR"},
+    {"AT", "Mean DegC", "Air temp canopy"},
+    {"ST", "Mean DegC", "Soil temp 10 cm"},
+    {"VPD", "kPa h", "Vapour Pres Def"},
+    {"SW", "mm", "Total soil water content"},
+    {"NDEP", "gN m-2 d-1", "N deposition"},
+    {"NEP", "gC m-2 d-1", "Net Eco Prod"},
+    {"GPP", "gC m-2 d-1", "Gross Prim Prod"},
+    {"NPP", "gC m-2 d-1", "Net Prim Prod"},
+    {"CEX", "gC m-2 d-1", "C exudation"},
+    {"CVOC", "gC m-2 d-1", "C VOC Flux"},
+    {"RECO", "gC m-2 d-1", "Resp ecosystem"},
+    {"RAUTO", "gC m-2 d-1", "Resp autotrophic"},
+    {"RLEAF", "gC m-2 d-1", "Resp leaves (maint)"},
+    {"RWOOD", "gC m-2 d-1", "Resp Wood (maint)"},
+    {"RROOT", "gC m-2 d-1", "Resp Fine Root (maint)"},
+    {"RGROW", "gC m-2 d-1", "Resp growth"},
+    {"RHET", "gC m-2 d-1", "Resp heterotrophic"},
+    {"RSOIL", "gC m-2 d-1", "Resp from soil"},
+    {"ET", "kgH2O m-2 d-1", "Evapotranspiration"},
+    {"T", "kgH2O m-2 d-1", "Transpiration"},
+    {"ES", "kgH2O m-2 d-1", "Soil Evaporation"},
+    {"EC", "kgH2O m-2 d-1", "Canopy evaporation"},
+    {"RO", "kgH2O m-2 d-1", "Runoff"},
+    {"DRAIN", "kgH2O m-2 d-1", "Drainage"},
+    {"LE", "MJ m-2", "Latent Energy"},
+    {"SH", "MJ m-2", "Sensible Heat"},
+    {"CL", "gC m-2", "C Leaf Mass"},
+    {"CW", "gC m-2", "C Wood Mass"},
+    {"CCR", "gC m-2", "C Coarse Root mass"},
+    {"CFR", "gC m-2", "C Fine Root mass"},
+    {"TNC", "gC m-2", "C Storage as TNC"},
+    {"CFLIT", "gC m-2", "C Fine Litter Total"},
+    {"CFLITA", "gC m-2", "C Fine Litter above"},
+    {"CFLITB", "gC m-2", "C Fine Litter below"},
+    {"CCLITB", "gC m-2", "C Coarse Litter"},
+    {"CSOIL", "gC m-2 0 to 30 cm", "C Soil"},
+    {"GL", "gC m-2 d-1", "C Leaf growth"},
+    {"GW", "gC m-2 d-1", "C Wood growth"},
+    {"GCR", "gC m-2 d-1", "C Coarse Root growth"},
+    {"GR", "gC m-2 d-1", "C Fine Root growth"},
+    {"GREPR", "gC m-2 d-1", "C reproduction growth"},
+    {"CLLFALL", "gC m-2 d-1", "C Leaf Litterfall"},
+    {"CCRLIN", "gC m-2 d-1", "C Coarse Root litter inputs"},
+    {"CFRLIN", "gC m-2 d-1", "C Fine Root litter inputs"},
+    {"CWIN", "gC m-2 d-1", "C Wood/branch inputs"},
+    {"LAI", "m2 m-2", "LAI projected"},
+    {"LMA", "gC m-2", "Leaf gC/leaf area"},
+    {"NCON", "gN gd.m.-1", "N Conc Leaves"},
+    {"NCAN", "gN m-2", "N Mass Leaves"},
+    {"NWOOD", "gN m-2", "N Mass Wood"},
+    {"NCR", "gN m-2", "N Mass Coarse Roots"},
+    {"NFR", "gN m-2", "N Mass Fine Roots"},
+    {"NSTOR", "gN m-2", "N storage"},
+    {"NLIT", "gN m-2", "N litter aboveground"},
+    {"NRLIT", "gN m-2", "N litter belowground"},
+    {"NDW", "gN m-2", "N Dead wood"},
+    {"NSOIL", "gN m-2 0 to 30 cm", "N Soil Total"},
+    {"NPOOLM", "gN m-2 0 to 30 cm", "N in Mineral form"},
+    {"NPOOLO", "gN m-2 0 to 30 cm", "N in Organic form"},
+    {"NFIX", "gN m-2 d-1", "N fixation"},
+    {"NLITIN", "gN m-2 d-1", "N Leaf Litterfall"},
+    {"NWLIN", "gN m-2 d-1", "N Wood/brch litterfall"},
+    {"NCRLIN", "gN m-2 d-1", "N Coarse Root litter input"},
+    {"NFRLIN", "gN m-2 d-1", "N Fine Root litter input"},
+    {"NUP", "gN m-2 d-1", "N Biomass Uptake"},
+    {"NGMIN", "gN m-2 d-1", "N Gross Mineralization"},
+    {"NMIN", "gN m-2 d-1", "N Net mineralization"},
+    {"NVOL", "gN m-2 d-1", "N Volatilization"},
+    {"NLEACH", "gN m-2 d-1", "N Leaching"},
+    {"NGL", "gN m-2 d-1", "N Leaf growth"},
+    {"NGW", "gN m-2 d-1", "N Wood growth"},
+    {"NGCR", "gN m-2 d-1", "N CR growth"},
+    {"NGR", "gN m-2 d-1", "N Fine Root growth"},
+    {"APARd", "MJ m-2 d-1", "Aborbed PAR"},
+    {"GCd", "mol H2O m-2 s-1", "Average daytime canopy conductance"},
+    {"GAd", "mol H2O m-2 s-1", "Average daytime aerodynamic conductance"},
+    {"GBd", "mol H2O m-2 s-1", "Average daytime leaf boundary conductance"},
+    {"Betad", "frac", "Soil moisture stress"},
+    {"NLRETRANS", "gN m-2 d-1", "Foliage retranslocation"},
+    {"NWRETRANS", "gN m-2 d-1", "Wood/Branch retranslocation"},
+    {"NCRRETRANS", "gN m-2 d-1", "Coarse Root retranslocation"},
+    {"NFRRETRANS", "gN m-2 d-1", "Fine Root retranslocation"},
+    {"CTOACTIVE", "gC m-2 d-1", "C fluxes from litter & slow/passive to active soil pool"},
+    {"CTOSLOW", "gC m-2 d-1", "C fluxes from litter & active soil pool to slow pool"},
+    {"CTOPASSIVE", "gC m-2 d-1", "C fluxes from active & slow soil pool to passive pool"},
+    {"CACTIVETOSLOW", "gC m-2 d-1", "C flux from active soil pool to slow soil pool"},
+    {"CACTIVETOPASSIVE", "gC m-2 d-1", "C flux from active soil pool to passive soil pool"},
+    {"CSLOWTOACTIVE", "gC m-2 d-1", "C flux from slow soil pool to active soil pool"},
+    {"CSLOWTOPASSIVE", "gC m-2 d-1", "C flux from slow pool to passive soil pool"},
+    {"CPASSIVETOACTIVE", "gC m-2 d-1", "C flux from passive pool to active pool"},
+    {"CACTIVE", "gC m-2", "C Active SOM pool"},
+    {"CSLOW", "gC m-2", "C Slow SOM pool"},
+    {"CPASSIVE", "gC m-2", "C Passive SOM pool"},
+    {"CO2SLITSURF", "gC m-2 d-1", "CO2 efflux from surf structural litter"},
+    {"CO2SLITSOIL", "gC m-2 d-1", "CO2 efflux from soil structural litter"},
+    {"CO2MLITSURF", "gC m-2 d-1", "CO2 efflux from surf metabolic litter"},
+    {"CO2MLITSOIL", "gC m-2 d-1", "CO2 efflux from soil metabolic litter"},
+    {"CO2FSOM", "gC m-2 d-1", "CO2 efflux from fast SOM pool"},
+    {"CO2SSOM", "gC m-2 d-1", "CO2 efflux from slow SOM pool"},
+    {"CO2PSOM", "gC m-2 d-1", "CO2 efflux from passive SOM pool"},
+    {"TFACSOM", "frac", "Temperature scalar on C efflux from SOM pools"},
+    {"REXC", "gC m-2 d-1", "Root Exudation of C"},
+    {"REXN", "gN m-2 d-1", "Root Exudation of N"},
+    {"CO2X", "gC m-2 d-1", "CO2 released from exudation"},
+    {"FACTIVE", "gC m-2 d-1", "Total C flux from the active pool"},
+    {"RTSLOW", "years", "Residence time of slow pool"},
+    {"REXCUE", "frac", "REXC carbon use efficiency"},
+    {"CSLO", "gC m-2 d-1", "Total C in the slow pool"},
+    {"NSLO", "gN m-2 d-1", "Total N in the slow pool"},
+    {"CACT", "gC m-2 d-1", "Total C in the active pool"},
+    {"NACT", "gN m-2 d-1", "Total N in the active pool"},
+};
+
+void write_output_header_nceas(control *c, FILE **fp) {
+    /*
+        Write the three NCEAS header rows (long names, units, short names)
+        after the git revision line.
+    */
+    int i, j, row_order[3] = {2, 1, 0};
+
+    /* Git version */
+    fprintf(*fp, "#Git_revision_code:%s\n", c->git_code_ver);
+
+    for (j = 0; j < 3; j++) {
+        for (i = 0; i < NCEAS_NCOLS; i++) {
+            fprintf(*fp, "%s%s", nceas_cols[i][row_order[j]],
+                    (i < NCEAS_NCOLS - 1) ? "," : "\n");
+        }
+    }
+    return;
+}
+
+void write_daily_outputs_nceas(control *c, fluxes *f, met_arrays *ma,
+                               state *s, int year, int doy) {
+    /*
+        Write daily state, fluxes and the met forcing in NCEAS units, i.e.
+        carbon and nitrogen in g m-2 rather than t ha-1. The met echo is
+        taken straight from the daily forcing arrays (the met struct gets
+        unit converted in place during the day) so this is only valid for
+        daily time step runs.
+    */
+    long   d = c->day_idx;
+    double out[NCEAS_NCOLS];
+    double conv = TONNES_HA_2_G_M2;
+    int    i = 0, j;
+
+    /* time stuff */
+    out[i++] = (double)year;
+    out[i++] = (double)doy;
+
+    /* met forcing */
+    out[i++] = ma->co2[d];
+    out[i++] = ma->rain[d];
+    out[i++] = (ma->par_am[d] + ma->par_pm[d]) * MJ_TO_MOL;
+    out[i++] = ma->tair[d];
+    out[i++] = ma->tsoil[d];
+    out[i++] = (ma->vpd_am[d] + ma->vpd_pm[d]) / 2.0;
+    out[i++] = s->pawater_root;
+    out[i++] = ma->ndep[d] * conv;
+
+    /* C fluxes */
+    out[i++] = f->nep * conv;
+    out[i++] = f->gpp * conv;
+    out[i++] = f->npp * conv;
+    out[i++] = UNDEF;                                   /* CEX */
+    out[i++] = UNDEF;                                   /* CVOC */
+    out[i++] = (f->hetero_resp + f->auto_resp) * conv;
+    out[i++] = f->auto_resp * conv;
+    out[i++] = UNDEF;                                   /* RLEAF */
+    out[i++] = UNDEF;                                   /* RWOOD */
+    out[i++] = UNDEF;                                   /* RROOT */
+    out[i++] = UNDEF;                                   /* RGROW */
+    out[i++] = f->hetero_resp * conv;
+    out[i++] = UNDEF;                                   /* RSOIL */
+
+    /* water, mm is the same as kg m-2 */
+    out[i++] = f->et;
+    out[i++] = f->transpiration;
+    out[i++] = f->soil_evap;
+    out[i++] = f->canopy_evap;
+    out[i++] = f->runoff;
+    out[i++] = UNDEF;                                   /* DRAIN */
+    out[i++] = UNDEF;                                   /* LE */
+    out[i++] = UNDEF;                                   /* SH */
+
+    /* C pools */
+    out[i++] = s->shoot * conv;
+    out[i++] = (s->stem + s->branch) * conv;
+    out[i++] = s->croot * conv;
+    out[i++] = s->root * conv;
+    out[i++] = s->cstore * conv;
+    out[i++] = s->litterc * conv;
+    out[i++] = s->littercag * conv;
+    out[i++] = s->littercbg * conv;
+    out[i++] = UNDEF;                                   /* CCLITB */
+    out[i++] = s->soilc * conv;
+
+    /* C growth and litter inputs */
+    out[i++] = f->cpleaf * conv;
+    out[i++] = (f->cpstem + f->cpbranch) * conv;
+    out[i++] = f->cpcroot * conv;
+    out[i++] = f->cproot * conv;
+    out[i++] = UNDEF;                                   /* GREPR */
+    out[i++] = f->deadleaves * conv;
+    out[i++] = f->deadcroots * conv;
+    out[i++] = f->deadroots * conv;
+    out[i++] = (f->deadstems + f->deadbranch) * conv;
+
+    /* canopy */
+    out[i++] = s->lai;
+    out[i++] = s->shoot * conv / s->lai;
+    out[i++] = s->shootn / s->shoot;
+
+    /* N pools */
+    out[i++] = s->shootn * conv;
+    out[i++] = (s->stemn + s->branchn) * conv;
+    out[i++] = s->crootn * conv;
+    out[i++] = s->rootn * conv;
+    out[i++] = s->nstore * conv;
+    out[i++] = s->litternag * conv;
+    out[i++] = s->litternbg * conv;
+    out[i++] = UNDEF;                                   /* NDW */
+    out[i++] = s->soiln * conv;
+    out[i++] = s->inorgn * conv;
+    out[i++] = (s->activesoiln + s->slowsoiln + s->passivesoiln) * conv;
+    out[i++] = ma->nfix[d] * conv;
+
+    /* N fluxes */
+    out[i++] = f->deadleafn * conv;
+    out[i++] = (f->deadbranchn + f->deadstemn) * conv;
+    out[i++] = f->deadcrootn * conv;
+    out[i++] = f->deadrootn * conv;
+    out[i++] = f->nuptake * conv;
+    out[i++] = f->ngross * conv;
+    out[i++] = f->nmineralisation * conv;
+    out[i++] = UNDEF;                                   /* NVOL */
+    out[i++] = f->nloss * conv;
+    out[i++] = f->npleaf * conv;
+    out[i++] = (f->npstemimm + f->npstemmob + f->npbranch) * conv;
+    out[i++] = f->npcroot * conv;
+    out[i++] = f->nproot * conv;
+
+    /* radiation, conductances and water stress */
+    out[i++] = f->apar / SW_2_PAR;
+    out[i++] = f->gs_mol_m2_sec;
+    out[i++] = f->ga_mol_m2_sec;
+    out[i++] = UNDEF;                                   /* GBd */
+    out[i++] = s->wtfac_root;
+
+    /* retranslocation */
+    out[i++] = f->leafretransn * conv;
+    out[i++] = UNDEF;                                   /* NWRETRANS */
+    out[i++] = UNDEF;                                   /* NCRRETRANS */
+    out[i++] = UNDEF;                                   /* NFRRETRANS */
+
+    /* traceability stuff */
+    out[i++] = f->c_into_active * conv;
+    out[i++] = f->c_into_slow * conv;
+    out[i++] = f->c_into_passive * conv;
+    out[i++] = f->active_to_slow * conv;
+    out[i++] = f->active_to_passive * conv;
+    out[i++] = f->slow_to_active * conv;
+    out[i++] = f->slow_to_passive * conv;
+    out[i++] = f->passive_to_active * conv;
+    out[i++] = s->activesoil * conv;
+    out[i++] = s->slowsoil * conv;
+    out[i++] = s->passivesoil * conv;
+    out[i++] = f->co2_rel_from_surf_struct_litter * conv;
+    out[i++] = f->co2_rel_from_soil_struct_litter * conv;
+    out[i++] = f->co2_rel_from_surf_metab_litter * conv;
+    out[i++] = f->co2_rel_from_soil_metab_litter * conv;
+    out[i++] = f->co2_rel_from_active_pool * conv;
+    out[i++] = f->co2_rel_from_slow_pool * conv;
+    out[i++] = f->co2_rel_from_passive_pool * conv;
+    out[i++] = f->tfac_soil_decomp;
+
+    /* priming stuff, not part of the NCEAS set we report */
+    for (j = 0; j < 6; j++)
+        out[i++] = UNDEF;
+    out[i++] = s->slowsoil * conv;
+    out[i++] = s->slowsoiln * conv;
+    out[i++] = s->activesoil * conv;
+    out[i++] = s->activesoiln * conv;
+
+    for (j = 0; j < NCEAS_NCOLS; j++) {
+        fprintf(c->ofp, "%.8f%s", out[j], (j < NCEAS_NCOLS - 1) ? "," : "\n");
+    }
+
+    return;
+}
 
 int write_final_state(control *c, params *p, state *s)
 {
@@ -386,6 +814,8 @@ int write_final_state(control *c, params *p, state *s)
     int line_number = 0;
     int match = FALSE;
 
+    /* from the top, parse_ini_file (or an earlier call) left it at the end */
+    rewind(c->ifp);
     while (fgets(line, sizeof(line), c->ifp) != NULL) {
         strcpy(saved_line, line);
         line_number++;
@@ -452,8 +882,12 @@ int ohandler(char *section, char *name, char *value, control *c, params *p,
     Search for matches of the git and state values and where found write the
     current state values to the output parameter file.
 
-    - also added previous ncd as this potential can be changed internally
+    - also added previous ncd as this potential can be changed internally,
+      the variables written are those flagged RESTART in param_fields.h
     */
+    const reg_field *fld = NULL;
+    const char      *ovalue = NULL;
+    char             buf[STRING_LENGTH];
 
     #define MATCH(s, n) strcasecmp(section, s) == 0 && strcasecmp(name, n) == 0
 
@@ -463,148 +897,19 @@ int ohandler(char *section, char *name, char *value, control *c, params *p,
     if (MATCH("git", "git_hash")) {
         fprintf(c->ofp, "git_hash = %s\n", c->git_code_ver);
         *match = TRUE;
+        return (1);
     }
 
-    /*
-    ** PARAMS
-    */
-    if (MATCH("params", "previous_ncd")) {
-        fprintf(c->ofp, "previous_ncd = %.10f\n", p->previous_ncd);
+    fld = registry_lookup(section, name);
+    if (fld != NULL && (fld->flags & REG_RESTART)) {
+        registry_format(fld, buf, sizeof(buf), c, p, s);
+        fprintf(c->ofp, "%s = %s\n", fld->name, buf);
         *match = TRUE;
     }
 
-    /*
-    ** STATE
-    */
-
-    if (MATCH("state", "activesoil")) {
-        fprintf(c->ofp, "activesoil = %.10f\n", s->activesoil);
-        *match = TRUE;
-    } else if (MATCH("state", "activesoiln")) {
-        fprintf(c->ofp, "activesoiln = %.10f\n", s->activesoiln);
-        *match = TRUE;
-    } else if (MATCH("state", "age")) {
-        fprintf(c->ofp, "age = %.10f\n", s->age);
-        *match = TRUE;
-    } else if (MATCH("state", "avg_albranch")) {
-        fprintf(c->ofp, "avg_albranch = %.10f\n", s->avg_albranch);
-        *match = TRUE;
-    } else if (MATCH("state", "avg_alcroot")) {
-        fprintf(c->ofp, "avg_alcroot = %.10f\n", s->avg_alcroot);
-        *match = TRUE;
-    } else if (MATCH("state", "avg_alleaf")) {
-        fprintf(c->ofp, "avg_alleaf = %.10f\n", s->avg_alleaf);
-        *match = TRUE;
-    } else if (MATCH("state", "avg_alroot")) {
-        fprintf(c->ofp, "avg_alroot = %.10f\n", s->avg_alroot);
-        *match = TRUE;
-    } else if (MATCH("state", "avg_alstem")) {
-        fprintf(c->ofp, "avg_alstem = %.10f\n", s->avg_alstem);
-        *match = TRUE;
-    } else if (MATCH("state", "branch")) {
-        fprintf(c->ofp, "branch = %.10f\n", s->branch);
-        *match = TRUE;
-    } else if (MATCH("state", "branchn")) {
-        fprintf(c->ofp, "branchn = %.10f\n", s->branchn);
-        *match = TRUE;
-    } else if (MATCH("state", "canht")) {
-        fprintf(c->ofp, "canht = %.10f\n", s->canht);
-        *match = TRUE;
-    } else if (MATCH("state", "croot")) {
-        fprintf(c->ofp, "croot = %.10f\n", s->croot);
-        *match = TRUE;
-    } else if (MATCH("state", "crootn")) {
-        fprintf(c->ofp, "crootn = %.10f\n", s->crootn);
-        *match = TRUE;
-    } else if (MATCH("state", "cstore")) {
-        fprintf(c->ofp, "cstore = %.10f\n", s->cstore);
-        *match = TRUE;
-    } else if (MATCH("state", "inorgn")) {
-        fprintf(c->ofp, "inorgn = %.10f\n", s->inorgn);
-        *match = TRUE;
-    } else if (MATCH("state", "lai")) {
-        fprintf(c->ofp, "lai = %.10f\n", s->lai);
-        *match = TRUE;
-    } else if (MATCH("state", "metabsoil")) {
-        fprintf(c->ofp, "metabsoil = %.10f\n", s->metabsoil);
-        *match = TRUE;
-    } else if (MATCH("state", "metabsoiln")) {
-        fprintf(c->ofp, "metabsoiln = %.10f\n", s->metabsoiln);
-        *match = TRUE;
-    } else if (MATCH("state", "metabsurf")) {
-        fprintf(c->ofp, "metabsurf = %.10f\n", s->metabsurf);
-        *match = TRUE;
-    } else if (MATCH("state", "metabsurfn")) {
-        fprintf(c->ofp, "metabsurfn = %.10f\n", s->metabsurfn);
-        *match = TRUE;
-    } else if (MATCH("state", "nstore")) {
-        fprintf(c->ofp, "nstore = %.10f\n", s->nstore);
-        *match = TRUE;
-    } else if (MATCH("state", "passivesoil")) {
-        fprintf(c->ofp, "passivesoil = %.10f\n", s->passivesoil);
-        *match = TRUE;
-    } else if (MATCH("state", "passivesoiln")) {
-        fprintf(c->ofp, "passivesoiln = %.10f\n", s->passivesoiln);
-        *match = TRUE;
-    } else if (MATCH("state", "pawater_root")) {
-        fprintf(c->ofp, "pawater_root = %.10f\n", s->pawater_root);
-        *match = TRUE;
-    } else if (MATCH("state", "pawater_topsoil")) {
-        fprintf(c->ofp, "pawater_topsoil = %.10f\n", s->pawater_topsoil);
-        *match = TRUE;
-    } else if (MATCH("state", "prev_sma")) {
-        fprintf(c->ofp, "prev_sma = %.10f\n", s->prev_sma);
-        *match = TRUE;
-    } else if (MATCH("state", "root")) {
-        fprintf(c->ofp, "root = %.10f\n", s->root);
-        *match = TRUE;
-    } else if (MATCH("state", "root_depth")) {
-        fprintf(c->ofp, "root_depth = %.10f\n", s->root_depth);
-        *match = TRUE;
-    } else if (MATCH("state", "rootn")) {
-        fprintf(c->ofp, "rootn = %.10f\n", s->rootn);
-        *match = TRUE;
-    } else if (MATCH("state", "sapwood")) {
-        fprintf(c->ofp, "sapwood = %.10f\n", s->sapwood);
-        *match = TRUE;
-    } else if (MATCH("state", "shoot")) {
-        fprintf(c->ofp, "shoot = %.10f\n", s->shoot);
-        *match = TRUE;
-    } else if (MATCH("state", "shootn")) {
-        fprintf(c->ofp, "shootn = %.10f\n", s->shootn);
-        *match = TRUE;
-    } else if (MATCH("state", "sla")) {
-        fprintf(c->ofp, "sla = %.10f\n", s->sla);
-        *match = TRUE;
-    } else if (MATCH("state", "slowsoil")) {
-        fprintf(c->ofp, "slowsoil = %.10f\n", s->slowsoil);
-        *match = TRUE;
-    } else if (MATCH("state", "slowsoiln")) {
-        fprintf(c->ofp, "slowsoiln = %.10f\n", s->slowsoiln);
-        *match = TRUE;
-    } else if (MATCH("state", "stem")) {
-        fprintf(c->ofp, "stem = %.10f\n", s->stem);
-        *match = TRUE;
-    } else if (MATCH("state", "stemn")) {
-        fprintf(c->ofp, "stemn = %.10f\n", s->stemn);
-        *match = TRUE;
-    } else if (MATCH("state", "stemnimm")) {
-        fprintf(c->ofp, "stemnimm = %.10f\n", s->stemnimm);
-        *match = TRUE;
-    } else if (MATCH("state", "stemnmob")) {
-        fprintf(c->ofp, "stemnmob = %.10f\n", s->stemnmob);
-        *match = TRUE;
-    } else if (MATCH("state", "structsoil")) {
-        fprintf(c->ofp, "structsoil = %.10f\n", s->structsoil);
-        *match = TRUE;
-    } else if (MATCH("state", "structsoiln")) {
-        fprintf(c->ofp, "structsoiln = %.10f\n", s->structsoiln);
-        *match = TRUE;
-    } else if (MATCH("state", "structsurf")) {
-        fprintf(c->ofp, "structsurf = %.10f\n", s->structsurf);
-        *match = TRUE;
-    } else if (MATCH("state", "structsurfn")) {
-        fprintf(c->ofp, "structsurfn = %.10f\n", s->structsurfn);
+    /* keep any --set/ensemble overrides in the new param file */
+    if (*match == FALSE && (ovalue = find_override(c->ovr, section, name))) {
+        fprintf(c->ofp, "%s = %s\n", fld->name, ovalue);
         *match = TRUE;
     }
 
@@ -0,0 +1,434 @@
+#!/usr/bin/env python
+
+"""
+Tests for the gday command line, run from a checkout once the model is
+built:
+
+    $ cd src && make && cd ..
+    $ python tests/test_gday_cli.py
+
+Each test runs the Duke example for its first three years, with the outputs
+going to a scratch directory. The NetCDF tests need the model built with
+-DHAVE_NETCDF (point $GDAY at it if that isn't src/gday) and the netCDF4
+module to read the files back.
+"""
+
+import configparser
+import os
+import shutil
+import struct
+import subprocess
+import tempfile
+import unittest
+
+try:
+    import netCDF4
+except ImportError:
+    netCDF4 = None
+try:
+    import pyarrow.feather
+except ImportError:
+    pyarrow = None
+
+here = os.path.dirname(os.path.abspath(__file__))
+GDAY = os.environ.get("GDAY", os.path.join(here, "..", "src", "gday"))
+EXAMPLE = os.path.join(here, "..", "example")
+CFG = os.path.join(EXAMPLE, "params", "NCEAS_DUKE_model_youngforest_amb.cfg")
+MET = os.path.join(EXAMPLE, "met_data", "DUKE_met_data_amb_co2.csv")
+
+
+def read_cfg(fname):
+    """ A written .cfg file as {"section.key": value} """
+    cp = configparser.ConfigParser(strict=False, interpolation=None)
+    cp.read(fname)
+    return {"%s.%s" % (sec, key): val
+            for sec in cp.sections() for key, val in cp.items(sec)}
+
+
+@unittest.skipIf(not os.access(GDAY, os.X_OK), "gday isn't built")
+class GdayCase(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp = tempfile.mkdtemp()
+        self.met = os.path.join(self.tmp, "met.csv")
+        with open(MET) as fin, open(self.met, "w") as fout:
+            ndata = 0
+            for line in fin:
+                if not line.startswith("#"):
+                    ndata += 1
+                    if ndata > 365 + 365 + 366:
+                        break
+                fout.write(line)
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp)
+
+    def path(self, fname):
+        return os.path.join(self.tmp, fname)
+
+    def gday(self, *args, **kwargs):
+        """ Run gday on the example, returns the finished process """
+        cmd = [GDAY, "-p", kwargs.get("cfg", CFG),
+               "--set", "files.met_fname=%s" % self.met,
+               "--set", "files.out_fname=%s" % self.path("out.csv"),
+               "--set", "files.out_param_fname=%s" % self.path("final.cfg")]
+        cmd += list(args)
+        proc = subprocess.run(cmd, cwd=EXAMPLE, stdout=subprocess.PIPE,
+                              stderr=subprocess.PIPE, universal_newlines=True)
+        if kwargs.get("check", True):
+            self.assertEqual(proc.returncode, 0, proc.stderr)
+        return proc
+
+    def outputs(self):
+        """ The daily outputs of the last run, a list of rows """
+        with open(self.path("out.csv")) as f:
+            return [[float(x) for x in line.split(",")]
+                    for line in f if line[0].isdigit()]
+
+    def output(self, name):
+        """ One column of the last run's daily outputs """
+        with open(self.path("out.csv")) as f:
+            for line in f:
+                if line.startswith("year,"):
+                    col = line.rstrip().split(",").index(name)
+                    break
+            return [float(line.split(",")[col]) for line in f]
+
+    def final_state(self, *args):
+        """ The .cfg written at the end of a print_options = end run """
+        self.gday("--set", "control.print_options=end", *args)
+        return read_cfg(self.path("final.cfg"))
+
+
+class TestOverrides(GdayCase):
+
+    def test_print_end_writes_the_cfg(self):
+        cfg = self.final_state()
+        self.assertEqual(float(cfg["params.g1"]), 2.74)
+        self.assertIn("state.shoot", cfg)
+
+    def test_set_beats_the_cfg(self):
+        cfg = self.final_state("--set", "params.g1=3.5",
+                               "--set", "control.ncycle=false")
+        self.assertEqual(float(cfg["params.g1"]), 3.5)
+        self.assertEqual(cfg["control.ncycle"], "false")
+
+    def test_the_last_set_wins(self):
+        cfg = self.final_state("--set", "params.g1=3.5",
+                               "--set", "params.g1=4.5")
+        self.assertEqual(float(cfg["params.g1"]), 4.5)
+
+    def test_members_are_tagged(self):
+        # a name from --set is shared by every member, so it gets tagged...
+        csv = self.path("members.csv")
+        with open(csv, "w") as f:
+            f.write("member,params.g1\nlow,2.0\nhigh,5.0\n")
+        self.gday("--set", "control.print_options=end", "--overrides", csv)
+        self.assertTrue(os.path.exists(self.path("final_low.cfg")))
+        self.assertTrue(os.path.exists(self.path("final_high.cfg")))
+        self.assertFalse(os.path.exists(self.path("final.cfg")))
+
+        # ...one in the member's own row is left alone
+        with open(csv, "w") as f:
+            f.write("member,params.g1,files.out_param_fname\n"
+                    "low,2.0,%s\nhigh,5.0,%s\n" % (self.path("a.cfg"),
+                                                   self.path("b.cfg")))
+        self.gday("--set", "control.print_options=end", "--overrides", csv)
+        self.assertTrue(os.path.exists(self.path("a.cfg")))
+        self.assertTrue(os.path.exists(self.path("b.cfg")))
+
+    def test_rows_beat_set(self):
+        csv = self.path("members.csv")
+        with open(csv, "w") as f:
+            f.write("member,params.g1\nlow,2.0\nhigh,5.0\n")
+        self.gday("--set", "control.print_options=end",
+                  "--set", "params.g1=3.5", "--set", "params.sla=6.0",
+                  "--overrides", csv)
+        for member, g1 in (("low", 2.0), ("high", 5.0)):
+            cfg = read_cfg(self.path("final_%s.cfg" % member))
+            self.assertEqual(float(cfg["params.g1"]), g1)
+            self.assertEqual(float(cfg["params.sla"]), 6.0)
+
+    def test_set_names_the_snapshot(self):
+        snap = self.path("start.snap")
+        self.final_state("--set", "files.out_state_fname=%s" % snap,
+                         "--set", "state.shoot=1.5")
+        self.assertTrue(os.path.exists(snap))
+
+        # the run starts from the snapshot's state, not the .cfg's...
+        plain = self.final_state()
+        spun = self.final_state("--set", "files.init_state_fname=%s" % snap)
+        self.assertNotEqual(plain["state.shoot"], spun["state.shoot"])
+
+        # ...and --set still beats the snapshot
+        shoot = self.final_state("--set", "files.init_state_fname=%s" % snap,
+                                 "--set", "params.g1=4.0")
+        self.assertEqual(float(shoot["params.g1"]), 4.0)
+
+    def test_bad_value_fails(self):
+        proc = self.gday("--set", "control.ncycle=maybe", check=False)
+        self.assertNotEqual(proc.returncode, 0)
+        self.assertIn("ncycle", proc.stderr)
+
+
+def read_snapshot(fname):
+    """ A state snapshot as {"section.name": value} """
+    with open(fname, "rb") as f:
+        buf = f.read()
+    magic, version, nfields, git_len = struct.unpack_from("=8sIII", buf)
+    pos = 20 + git_len
+    names = []
+    for i in range(nfields):
+        section, name_len = struct.unpack_from("=BB", buf, pos)
+        name = buf[pos + 2:pos + 2 + name_len].decode()
+        names.append("%s.%s" % ("state" if section == 0 else "params", name))
+        pos += 2 + name_len
+    values = struct.unpack_from("=%dd" % nfields, buf, pos)
+    return dict(zip(names, values))
+
+
+def write_snapshot(fname, values):
+    """ A snapshot holding just values, {"section.name": value} """
+    with open(fname, "wb") as f:
+        f.write(struct.pack("=8sIII", b"GDAYSNAP", 1, len(values), 0))
+        for key in values:
+            section, name = key.split(".")
+            f.write(struct.pack("=BB", 0 if section == "state" else 1,
+                                len(name)) + name.encode())
+        for key in values:
+            f.write(struct.pack("=d", values[key]))
+
+
+class TestSnapshot(GdayCase):
+
+    def test_snapshot_holds_the_final_state(self):
+        snap = self.path("end.snap")
+        cfg = self.final_state("--set", "files.out_state_fname=%s" % snap)
+        values = read_snapshot(snap)
+        self.assertIn("state.shoot", values)
+        for key in set(values) & set(cfg):
+            self.assertAlmostEqual(values[key], float(cfg[key]), places=9)
+
+    def test_snapshot_or_cfg_start_the_same(self):
+        # the snapshot and the .cfg written with it give the same run
+        snap = self.path("end.snap")
+        self.final_state("--set", "files.out_state_fname=%s" % snap)
+        shutil.copy(self.path("final.cfg"), self.path("start.cfg"))
+
+        self.gday("--set", "files.init_state_fname=%s" % snap)
+        from_snap = self.outputs()
+        self.gday(cfg=self.path("start.cfg"))
+        from_cfg = self.outputs()
+        self.assertEqual(len(from_snap), 365 + 365 + 366)
+        for day_snap, day_cfg in zip(from_snap, from_cfg):
+            for a, b in zip(day_snap, day_cfg):
+                self.assertAlmostEqual(a, b, delta=1e-6 * max(1.0, abs(b)))
+
+    def test_unknown_fields_are_skipped(self):
+        # only the fields we know are read, the rest keep the .cfg value
+        snap = self.path("hand.snap")
+        write_snapshot(snap, {"state.shoot": 1.5, "state.not_a_pool": 9.0,
+                              "params.not_a_param": 9.0})
+        self.gday("--set", "files.init_state_fname=%s" % snap)
+        from_snap = self.outputs()
+        self.gday("--set", "state.shoot=1.5")
+        self.assertEqual(from_snap, self.outputs())
+
+    def test_bad_snapshot_fails(self):
+        snap = self.path("bad.snap")
+        with open(snap, "w") as f:
+            f.write("shoot = 1.5\n")
+        proc = self.gday("--set", "files.init_state_fname=%s" % snap,
+                         check=False)
+        self.assertNotEqual(proc.returncode, 0)
+        self.assertIn("not a GDAY state snapshot", proc.stderr)
+
+        self.final_state("--set", "files.out_state_fname=%s" % snap)
+        with open(snap, "rb") as f:
+            head = f.read(100)
+        with open(snap, "wb") as f:
+            f.write(head)
+        proc = self.gday("--set", "files.init_state_fname=%s" % snap,
+                         check=False)
+        self.assertNotEqual(proc.returncode, 0)
+        self.assertIn("Truncated", proc.stderr)
+
+
+class TestSweep(GdayCase):
+
+    def sweep(self, spin_up):
+        ini = self.path("sweep.ini")
+        with open(ini, "w") as f:
+            f.write("[sweep]\nmethod = lhs\nsamples = 2\nseed = 7\n"
+                    "spin_up = %s\nsummary_fname = %s\n"
+                    "diagnostics = gpp:sum\n\n[ranges]\n"
+                    "params.g1 = uniform 2.0 6.0\n"
+                    "control.leaf_itermax = uniform 5.0 20.0\n"
+                    % (spin_up, self.path("sweep.csv")))
+        self.gday("--sweep", ini)
+        with open(self.path("sweep.csv")) as f:
+            return [line.rstrip().split(",") for line in f
+                    if not line.startswith("#")]
+
+    def test_int_params_are_rounded(self):
+        rows = self.sweep("none")
+        col = rows[0].index("control.leaf_itermax")
+        for row in rows[1:]:
+            self.assertEqual(row[col], str(int(row[col])))
+
+    def test_shared_spin_up_has_its_own_file(self):
+        self.sweep("shared")
+        self.assertTrue(os.path.exists(self.path("final_spinup.cfg")))
+        self.assertFalse(os.path.exists(self.path("final.cfg")))
+
+
+class TestOutputFormats(GdayCase):
+
+    def csv_outputs(self):
+        """ The daily outputs (CSV) and their names """
+        self.gday()
+        with open(self.path("out.csv")) as f:
+            for line in f:
+                if line.startswith("year,"):
+                    names = line.rstrip().split(",")
+                    break
+        return names, self.outputs()
+
+    def test_binary_header_matches_the_data(self):
+        names, rows = self.csv_outputs()
+        self.gday("--set", "control.output_ascii=false",
+                  "--set", "files.out_fname=%s" % self.path("out.bin"),
+                  "--set", "files.out_fname_hdr=%s" % self.path("out.hdr"))
+
+        with open(self.path("out.hdr")) as f:
+            hdr = f.read().split("\n")
+        nrows = int(hdr[2].split("=")[1])
+        ncols = int(hdr[3].split("=")[1])
+        self.assertEqual(hdr[1].split(","), names)
+        self.assertEqual((nrows, ncols), (len(rows), len(names)))
+
+        with open(self.path("out.bin"), "rb") as f:
+            data = f.read()
+        self.assertEqual(len(data), nrows * ncols * 8)
+        values = struct.unpack("=%dd" % (nrows * ncols), data)
+        for i, row in enumerate(rows):
+            for a, b in zip(values[i * ncols:(i + 1) * ncols], row):
+                self.assertAlmostEqual(a, b, places=9)
+
+    def test_nceas_layout(self):
+        names, rows = self.csv_outputs()
+        self.gday("--set", "control.output_format=nceas")
+        with open(self.path("out.csv")) as f:
+            lines = [line.rstrip().split(",") for line in f]
+        self.assertTrue(lines[0][0].startswith("#Git_revision_code"))
+        self.assertEqual(lines[3][:3], ["YEAR", "DOY", "CO2"])
+        self.assertEqual(len(lines) - 4, len(rows))
+        self.assertTrue(all(len(row) == len(lines[3]) for row in lines[1:]))
+
+        # gpp in g C m-2 rather than t C ha-1
+        gpp = lines[3].index("GPP")
+        for row, native in zip(lines[4:], rows):
+            self.assertAlmostEqual(float(row[gpp]),
+                                   native[names.index("gpp")] * 100.0,
+                                   places=6)
+
+    @unittest.skipIf(pyarrow is None, "pyarrow isn't installed")
+    def test_arrow_matches_the_csv(self):
+        names, rows = self.csv_outputs()
+        self.gday("--set", "control.output_format=arrow",
+                  "--set", "control.arrow_batch_days=100",
+                  "--set", "files.out_fname=%s" % self.path("out.arrow"))
+
+        table = pyarrow.feather.read_table(self.path("out.arrow"))
+        self.assertEqual(table.column_names, names)
+        self.assertEqual(table.num_rows, len(rows))
+        for j, name in enumerate(names):
+            for a, row in zip(table.column(name).to_pylist(), rows):
+                self.assertAlmostEqual(a, row[j], places=9)
+
+
+@unittest.skipIf(netCDF4 is None, "netCDF4 isn't installed")
+class TestNetCDF(GdayCase):
+
+    def setUp(self):
+        GdayCase.setUp(self)
+        proc = self.gday("--set", "control.output_format=netcdf",
+                         "--set", "files.out_fname=%s" % self.path("x.nc"),
+                         check=False)
+        if "not compiled in" in proc.stderr:
+            self.skipTest("gday was built without NetCDF")
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+
+        # a second site, 3 degrees warmer
+        self.warm = self.path("warm.csv")
+        with open(self.met) as fin, open(self.warm, "w") as fout:
+            for line in fin:
+                if not line.startswith("#"):
+                    cells = line.split(",")
+                    cells[2] = str(float(cells[2]) + 3.0)
+                    line = ",".join(cells)
+                fout.write(line)
+
+    def netcdf(self, *args, **kwargs):
+        return self.gday("--set", "control.output_format=netcdf",
+                         "--set", "files.out_fname=%s" % self.path("out.nc"),
+                         "--set", "control.netcdf_chunk_days=100", *args,
+                         **kwargs)
+
+    def test_sites_from_one_run(self):
+        self.gday()
+        gpp = self.output("gpp")
+
+        # the first site is where the .cfg puts it
+        csv = self.path("sites.csv")
+        with open(csv, "w") as f:
+            f.write("member,files.met_fname,params.latitude,"
+                    "params.longitude\n")
+            f.write("duke,%s,35.9,35.9\n" % self.met)
+            f.write("warm,%s,30.0,-80.0\n" % self.warm)
+        self.netcdf("--overrides", csv)
+
+        with netCDF4.Dataset(self.path("out.nc")) as nc:
+            self.assertEqual(nc.Conventions, "CF-1.8")
+            self.assertEqual(nc.featureType, "timeSeries")
+            self.assertEqual(nc.dimensions["site"].size, 2)
+            self.assertEqual(nc.dimensions["time"].size, len(gpp))
+            self.assertEqual(list(nc["lat"][:]), [35.9, 30.0])
+            self.assertEqual(list(nc["lon"][:]), [35.9, -80.0])
+            self.assertEqual(nc["lat"].units, "degrees_north")
+            self.assertEqual(nc["time"].units,
+                             "days since 1996-01-01 00:00:00")
+            self.assertEqual(nc["site"].cf_role, "timeseries_id")
+            self.assertEqual(nc["gpp"].long_name, "gross primary production")
+            self.assertEqual(nc["gpp"].units, "t C ha-1 d-1")
+            self.assertEqual(nc["gpp"].chunking(), [1, 100])
+
+            # the CSV rounds to 10 d.p.
+            for a, b in zip(nc["gpp"][0, :], gpp):
+                self.assertAlmostEqual(a, b, places=9)
+            self.assertNotAlmostEqual(nc["gpp"][1, :].sum(), sum(gpp))
+
+    def test_sites_from_separate_runs(self):
+        # site 1 first, then site 0, then site 1 again from other met
+        sites = ("--set", "control.netcdf_nsites=2")
+        self.netcdf(*sites, "--set", "control.netcdf_site=1")
+        self.netcdf(*sites, "--set", "control.netcdf_site=0",
+                    "--set", "files.met_fname=%s" % self.warm)
+        with netCDF4.Dataset(self.path("out.nc")) as nc:
+            cool = nc["gpp"][1, :].copy()
+            warm = nc["gpp"][0, :].copy()
+        self.assertNotAlmostEqual(cool.sum(), warm.sum())
+
+        self.netcdf(*sites, "--set", "control.netcdf_site=1",
+                    "--set", "files.met_fname=%s" % self.warm)
+        with netCDF4.Dataset(self.path("out.nc")) as nc:
+            self.assertEqual(list(nc["gpp"][0, :]), list(warm))
+            self.assertEqual(list(nc["gpp"][1, :]), list(warm))
+
+        # the sites have to agree on the file's shape
+        proc = self.netcdf("--set", "control.netcdf_nsites=3", check=False)
+        self.assertNotEqual(proc.returncode, 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,203 @@
+#!/usr/bin/env python
+
+"""
+Tests for the pygday extension (python/), run from a checkout once it's
+built:
+
+    $ cd python && python setup.py build_ext --inplace && cd ..
+    $ python tests/test_pygday.py
+"""
+
+import configparser
+import os
+import sys
+import unittest
+
+import numpy as np
+
+here = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(here, "..", "python"))
+try:
+    import pygday
+except ImportError:
+    pygday = None
+
+EXAMPLE = os.path.join(here, "..", "example")
+CFG = os.path.join(EXAMPLE, "params", "NCEAS_DUKE_model_youngforest_amb.cfg")
+MET = os.path.join(EXAMPLE, "met_data", "DUKE_met_data_amb_co2.csv")
+
+
+@unittest.skipIf(pygday is None, "pygday isn't built")
+class TestForcing(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.met = np.loadtxt(MET, delimiter=",", comments="#")
+
+    def forcing(self, met):
+        return {n: np.ascontiguousarray(met[:, i])
+                for i, n in enumerate(pygday.DAILY_MET)}
+
+    def run_model(self, m):
+        return m.run(outputs=["gpp", "lai"], as_frame=False)
+
+    def test_set_forcing_again(self):
+        m = pygday.Model(CFG)
+        m.set_forcing(self.forcing(self.met))
+        first = self.run_model(m)
+
+        # every column again, many times over, with new arrays each time
+        for i in range(3):
+            m.set_forcing(self.forcing(self.met.copy()))
+        again = self.run_model(m)
+        np.testing.assert_array_equal(first["gpp"], again["gpp"])
+        np.testing.assert_array_equal(first["lai"], again["lai"])
+
+        # one column replaced, then put back
+        co2 = self.met[:, pygday.DAILY_MET.index("co2")] + 200.0
+        m.set_forcing({"co2": co2})
+        high = self.run_model(m)
+        self.assertGreater(high["gpp"].sum(), first["gpp"].sum())
+        m.set_forcing({"co2": self.met[:, pygday.DAILY_MET.index("co2")]})
+        np.testing.assert_array_equal(first["gpp"],
+                                      self.run_model(m)["gpp"])
+
+    def test_set_forcing_new_length(self):
+        m = pygday.Model(CFG)
+        m.set_forcing(self.forcing(self.met))
+        first = self.run_model(m)
+
+        # the first two years, which starts the forcing again
+        m.set_forcing(self.forcing(self.met[:731]))
+        self.assertEqual(m.ndays, 731)
+        short = self.run_model(m)
+        np.testing.assert_array_equal(first["gpp"][:731], short["gpp"])
+
+        m.set_forcing(self.forcing(self.met))
+        self.assertEqual(m.ndays, len(self.met))
+
+    def test_bad_forcing_leaves_model_alone(self):
+        m = pygday.Model(CFG)
+        m.set_forcing(self.forcing(self.met))
+        first = self.run_model(m)
+
+        bad = self.forcing(self.met)
+        bad["tair"] = bad["tair"] + 5.0
+        bad["not_a_column"] = bad["rain"]
+        with self.assertRaises(ValueError):
+            m.set_forcing(bad)
+
+        bad = self.forcing(self.met)
+        bad["tair"] = bad["tair"] + 5.0
+        bad["rain"] = bad["rain"][:10]
+        with self.assertRaises(ValueError):
+            m.set_forcing(bad)
+
+        np.testing.assert_array_equal(first["gpp"],
+                                      self.run_model(m)["gpp"])
+
+    def test_clone_keeps_its_forcing(self):
+        m = pygday.Model(CFG)
+        m.set_forcing(self.forcing(self.met))
+        first = self.run_model(m)
+        copy = m.clone()
+
+        # the clone still has the arrays it was made with
+        m.set_forcing(self.forcing(self.met + 1.0))
+        np.testing.assert_array_equal(first["gpp"],
+                                      self.run_model(copy)["gpp"])
+
+        # but the forcing can't be dropped under it
+        with self.assertRaises(RuntimeError):
+            m.set_forcing(self.forcing(self.met[:365]))
+        del copy
+        m.set_forcing(self.forcing(self.met[:365]))
+        self.assertEqual(m.ndays, 365)
+
+
+@unittest.skipIf(pygday is None, "pygday isn't built")
+class TestRegistry(unittest.TestCase):
+
+    def test_set_get(self):
+        m = pygday.Model(CFG)
+        m.set("params.g1", 4.2)
+        self.assertEqual(float(m.get("params.g1")), 4.2)
+        m.set("control.grazing", 2)
+        self.assertEqual(m.get("control.grazing"), "2")
+        m.set("control.ncycle", False)
+        self.assertEqual(m.get("control.ncycle"), "false")
+        m.set("control.alloc_model", "GRASSES")
+        self.assertEqual(m.get("control.alloc_model"), "grasses")
+        m.set("files.met_fname", "met_data/other.csv")
+        self.assertEqual(m.get("files.met_fname"), "met_data/other.csv")
+
+    def test_every_cfg_key_round_trips(self):
+        # keys the model doesn't know are skipped, as the parser does
+        m = pygday.Model(CFG)
+        cp = configparser.ConfigParser(strict=False, interpolation=None)
+        cp.read(CFG)
+        nkeys = 0
+        for sec in cp.sections():
+            for key, _ in cp.items(sec):
+                try:
+                    value = m.get("%s.%s" % (sec, key))
+                except ValueError:
+                    continue
+                m.set("%s.%s" % (sec, key), value)
+                self.assertEqual(m.get("%s.%s" % (sec, key)), value)
+                nkeys += 1
+        self.assertGreater(nkeys, 200)
+
+    def test_bad_keys_and_values(self):
+        m = pygday.Model(CFG)
+        for key in ("params.not_a_param", "g1", "nosection.g1"):
+            with self.assertRaises(ValueError):
+                m.get(key)
+            with self.assertRaises(ValueError):
+                m.set(key, 1.0)
+
+        # a bad value leaves the old one
+        for key, value in (("control.ncycle", "maybe"),
+                           ("control.gs_model", "not_a_model")):
+            old = m.get(key)
+            with self.assertRaises(ValueError):
+                m.set(key, value)
+            self.assertEqual(m.get(key), old)
+
+
+@unittest.skipIf(pygday is None, "pygday isn't built")
+class TestSelectOutputs(unittest.TestCase):
+
+    def test_select(self):
+        m = pygday.Model(CFG)
+        m.select_outputs(["lai", "gpp", "lai"])
+        self.assertEqual(m.outputs, ["lai", "gpp", "lai"])
+
+    def test_bad_list_keeps_the_selection(self):
+        m = pygday.Model(CFG)
+        m.select_outputs(["gpp", "lai"])
+
+        # an unknown name after good ones
+        with self.assertRaises(ValueError):
+            m.select_outputs(["nep", "npp", "not_an_output", "et"])
+        self.assertEqual(m.outputs, ["gpp", "lai"])
+
+        # more names than there are outputs, repeats are allowed
+        too_many = ["gpp"] * (len(pygday.daily_output_names()) + 1)
+        with self.assertRaises(ValueError):
+            m.select_outputs(too_many)
+        self.assertEqual(m.outputs, ["gpp", "lai"])
+
+        with self.assertRaises(ValueError):
+            m.select_outputs([])
+        self.assertEqual(m.outputs, ["gpp", "lai"])
+
+    def test_all_outputs_repeated(self):
+        m = pygday.Model(CFG)
+        names = list(pygday.daily_output_names())
+        m.select_outputs(names[::-1])
+        self.assertEqual(m.outputs, names[::-1])
+
+
+if __name__ == "__main__":
+    unittest.main()